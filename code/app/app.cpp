@@ -4,6 +4,7 @@
 #include <logs.h>
 
 #include <algorithm>
+#include <chrono>
 #include <map>
 #include <string_view>
 
@@ -17,9 +18,10 @@ App& App::Inst() {
     return inst;
 }
 
-AppResult App::Run() {
+AppResult App::Run(const AppOptions& opts) {
 
     AppResult r = APP_CODE_OK;
+    options = opts;
 
     r = Init();
     if (!APP_CHECK_RESULT(r)) {
@@ -33,10 +35,18 @@ AppResult App::Run() {
 
 AppResult App::Init() {
     AppResult r = APP_CODE_OK;
+    initStart = std::chrono::steady_clock::now();
 
-    APP_CHECK_CALL(InitWindow());
+    // Headless mode doesn't touch GLFW at all
+    if (!options.headless) {
+        APP_CHECK_CALL(InitWindow());
+    }
     APP_CHECK_CALL(VulkanApp::Init());
 
+    // Compare between launches to see the effect of caches on startup
+    std::chrono::duration<double, std::milli> initTime = std::chrono::steady_clock::now() - initStart;
+    PRINT("App initialized in %.3f ms", initTime.count());
+
     return r;
 }
 
@@ -46,10 +56,11 @@ AppResult App::InitWindow() {
     glfwInit();
 
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+    // Resizes rebuild the swapchain
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
     wnd = glfwCreateWindow(
-        APP_DEFAULT_WINDOW_WIDTH,
-        APP_DEFAULT_WINDOW_HEIGHT,
+        static_cast<int>(options.width),
+        static_cast<int>(options.height),
         APP_NAME,
         nullptr, nullptr
     );
@@ -58,6 +69,11 @@ AppResult App::InitWindow() {
         PRINT_E("Failed to create window");
         return APP_CODE_WND_INIT_FAIURE;
     }
+    glfwSetWindowUserPointer(wnd, this);
+    glfwSetFramebufferSizeCallback(wnd, FramebufferSizeCallback);
+    glfwSetKeyCallback(wnd, KeyCallback);
+    glfwSetCursorPosCallback(wnd, CursorPosCallback);
+    framePacer.Init(options.targetFps, options.onDemand, APP_IDLE_WAIT_TIMEOUT);
     PRINT("Window created");
     return APP_CODE_OK;
 #else
@@ -66,13 +82,114 @@ AppResult App::InitWindow() {
 #endif
 }
 
+AppResult App::CreateSurface(VkInstance instance, VkSurfaceKHR& surface) {
+
+#if defined(WIN32) || defined(LINUX) || defined(MAC_OS)
+    VkResult r = glfwCreateWindowSurface(instance, wnd, nullptr, &surface);
+    if (r != VK_SUCCESS) {
+        PRINT_E("Failed to create window surface. Vk error code: %d", r);
+        return APP_CODE_WND_INIT_FAIURE;
+    }
+    PRINT("Window surface created");
+    return APP_CODE_OK;
+#else
+    PRINT_E("Your OS is not supported yet");
+    return APP_CODE_UNSUPPORTED_OS;
+#endif
+}
+
+VkExtent2D App::GetFramebufferExtent() const {
+
+#if defined(WIN32) || defined(LINUX) || defined(MAC_OS)
+    int width  = 0;
+    int height = 0;
+    glfwGetFramebufferSize(wnd, &width, &height);
+    return { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+#else
+    return { options.width, options.height };
+#endif
+}
+
+#if defined(WIN32) || defined(LINUX) || defined(MAC_OS)
+void App::FramebufferSizeCallback(GLFWwindow* window, int width, int height) {
+    auto app = static_cast<App*>(glfwGetWindowUserPointer(window));
+    app->OnFramebufferResize(static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+    app->framePacer.RequestRedraw();
+}
+
+void App::KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    auto app = static_cast<App*>(glfwGetWindowUserPointer(window));
+    if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+        app->CyclePresentPolicy();
+    }
+    app->framePacer.RequestRedraw();
+}
+
+void App::CursorPosCallback(GLFWwindow* window, double x, double y) {
+    auto app = static_cast<App*>(glfwGetWindowUserPointer(window));
+    app->framePacer.RequestRedraw();
+}
+#endif
+
+void App::RequestRedraw() {
+    framePacer.RequestRedraw();
+#if defined(WIN32) || defined(LINUX) || defined(MAC_OS)
+    // Wakes the loop up from the idle wait for events
+    if (!options.headless) {
+        glfwPostEmptyEvent();
+    }
+#endif
+}
+
 AppResult App::Loop() {
 
+    if (IsBenchmarkRequested()) {
+        return RunBenchmark();
+    }
+    if (options.headless) {
+        return HeadlessLoop();
+    }
+    return WindowLoop();
+}
+
+AppResult App::HeadlessLoop() {
+
+    for (uint32_t frame = 0; !options.headlessFrames || frame < options.headlessFrames; ++frame) {
+        APP_CHECK_CALL(LoopFunc());
+    }
+    return FinishHeadlessRendering();
+}
+
+AppResult App::WindowLoop() {
+
 #if defined(WIN32) || defined(LINUX) || defined(MAC_OS)
     while(!glfwWindowShouldClose(wnd)) {
-        glfwPollEvents();
-        LoopFunc();
+        if (framePacer.IsIdle()) {
+            // Static scene: block in the event queue until input or a redraw request
+            glfwWaitEventsTimeout(framePacer.GetIdleTimeout());
+        } else {
+            // Events are polled after the wait for the frame slot to render the freshest input
+            framePacer.WaitForFrame();
+            glfwPollEvents();
+        }
+        // A minimized window has nothing to present, sleep until it's restored
+        int width  = 0;
+        int height = 0;
+        glfwGetFramebufferSize(wnd, &width, &height);
+        if (!width || !height) {
+            glfwWaitEvents();
+            continue;
+        }
+        if (!framePacer.BeginFrame()) {
+            continue;
+        }
+        inputTime = std::chrono::steady_clock::now();
+        APP_CHECK_CALL(LoopFunc());
+        if (options.windowFrames && GetPresentedFramesCount() >= options.windowFrames) {
+            break;
+        }
     }
+    framePacer.PrintStats();
 #else
     PRINT_E("Your OS is not supported yet");
     return APP_CODE_UNSUPPORTED_OS;
@@ -85,7 +202,12 @@ void App::Clear() {
     VulkanApp::Clear();
 
 #if defined(WIN32) || defined(LINUX) || defined(MAC_OS)
-    glfwDestroyWindow(wnd);
-    glfwTerminate();
+    if (!options.headless) {
+        if (wnd) {
+            glfwDestroyWindow(wnd);
+            wnd = nullptr;
+        }
+        glfwTerminate();
+    }
 #endif
 }
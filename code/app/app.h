@@ -3,7 +3,9 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include <app_options.h>
 #include <app_result.h>
+#include <utils/frame_pacer.h>
 #include <vulkan_app/vulkan_app.h>
 
 #include <optional>
@@ -14,7 +16,9 @@ class App final : public VulkanApp {
 // Public methods
 public:
 
-    AppResult Run();
+    AppResult Run(const AppOptions& opts);
+    // Render a window frame even if the scene is static. May be called from any thread
+    void RequestRedraw();
 
 // Main Private methods
 private:
@@ -27,6 +31,20 @@ private:
 private:
 
     AppResult InitWindow();
+    AppResult CreateSurface(VkInstance instance, VkSurfaceKHR& surface) override;
+    VkExtent2D GetFramebufferExtent() const override;
+
+#if defined(WIN32) || defined(LINUX) || defined(MAC_OS)
+    static void FramebufferSizeCallback(GLFWwindow* window, int width, int height);
+    static void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
+    static void CursorPosCallback(GLFWwindow* window, double x, double y);
+#endif
+
+// App loop Private methods
+private:
+
+    AppResult WindowLoop();
+    AppResult HeadlessLoop();
 
 
 // Window objects
@@ -35,6 +53,7 @@ private:
 #if defined(WIN32) || defined(LINUX) || defined(MAC_OS)
     GLFWwindow* wnd = nullptr;
 #endif
+    FramePacer framePacer;
 
 
 // Singleton realisation
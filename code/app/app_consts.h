@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
 
 
 // @todo move some of this options to CMake or to cli options
@@ -12,6 +13,110 @@
 #define APP_DEFAULT_WINDOW_HEIGHT 600
 
 
+// Vulkan version the instance is created with. Device features and functions of the higher versions
+// can't be used even if the driver supports them
+
+#define APP_VK_API_VERSION VK_API_VERSION_1_2
+
+
+// Headless mode defaults
+
+// Count of frames rendered in headless mode before exit. 0 means infinite rendering
+#define APP_DEFAULT_HEADLESS_FRAMES 100
+
+
+// Pipeline cache file used if other is not specified
+
+#define APP_DEFAULT_PIPELINE_CACHE_PATH "pipeline_cache.bin"
+
+
+// Physical devices' capabilities snapshot file used if other is not specified
+
+#define APP_DEFAULT_CAPS_SNAPSHOT_PATH "device_caps.bin"
+
+
+// Count of frames recorded by CPU while GPU is still executing the previous ones
+
+#define APP_DEFAULT_FRAMES_IN_FLIGHT 2
+#define APP_MAX_FRAMES_IN_FLIGHT     8
+
+
+// Count of command recording threads. 0 means count of hardware threads
+
+#define APP_DEFAULT_RECORD_THREADS 0
+
+
+// Count of job system threads. 0 means count of hardware threads
+
+#define APP_DEFAULT_JOB_THREADS 0
+
+
+// Count of background pipeline compile threads. 0 means half of hardware threads
+
+#define APP_DEFAULT_PIPELINE_THREADS 0
+
+
+// Window loop pacing. 0 target FPS means no limit
+
+#define APP_DEFAULT_TARGET_FPS 0
+// Longest wait for events while the scene is static, s. Bounds the reaction to non-event signals
+#define APP_IDLE_WAIT_TIMEOUT 0.5
+
+
+// Width of the CPU occlusion culling depth buffer. Height follows the render target aspect
+
+#define APP_OCCLUSION_BUFFER_WIDTH 320
+// Count of the largest on screen occluders rasterized every frame
+#define APP_OCCLUSION_MAX_OCCLUDERS 256
+
+
+// Size of the staging ring buffer used for streaming uploads
+
+#define APP_STAGING_RING_SIZE (64ull * 1024 * 1024)
+
+
+// Virtual texture streaming. Default device memory budget for the resident pages, MiB
+
+#define APP_VT_DEFAULT_BUDGET_MB 32
+// Pages uploaded per frame at most. Limits the frame time spikes while the camera moves fast
+#define APP_VT_UPLOADS_PER_FRAME 32
+// Pages requested from the loader thread and not made resident yet at most
+#define APP_VT_MAX_PENDING_PAGES 256
+// Size and tile size of the texture generated if the file given doesn't exist, texels
+#define APP_VT_GENERATED_SIZE 4096
+#define APP_VT_GENERATED_TILE 128
+// Screen pixels per side of a feedback pass cell
+#define APP_VT_FEEDBACK_CELL 8
+
+
+// Meshes. FIFO post-transform cache size the converter clusters triangles for and the statistics simulate
+
+#define APP_MESH_VERTEX_CACHE_SIZE 16
+// Segments around the sphere generated if the mesh file given doesn't exist. 512 need 32-bit indices
+#define APP_MESH_GENERATED_SEGMENTS 512
+// Bytes of a mesh section copied into the staging ring at once
+#define APP_MESH_UPLOAD_CHUNK (4ull * 1024 * 1024)
+
+
+// Capacity of the bindless resource table. Clamped by the device update-after-bind limits
+
+#define APP_BINDLESS_MAX_TEXTURES 65536
+#define APP_BINDLESS_MAX_BUFFERS  65536
+#define APP_BINDLESS_MAX_SAMPLERS 256
+
+
+// Directory of the compiled SPIR-V shaders relative to the executable. The build puts them there
+
+#ifndef APP_SHADERS_DIR
+#define APP_SHADERS_DIR "shaders"
+#endif
+
+
+// Max count of profiler events written into a trace capture
+
+#define APP_PROFILER_CAPTURE_EVENTS (1024 * 1024)
+
+
 // Application name
 
 #define APP_NAME "Vulkan prog"
@@ -27,9 +132,28 @@ constexpr std::array<const char*, vulkanValidationLayersCount> vulkanValidationL
 };
 
 
-// If POWER_SAVE is true an integrated GPU will be used. If false, then discrete
+// If POWER_SAVE is true an integrated GPU is preferred by default. If false, then discrete.
+// Can be changed with --gpu-policy
 #define POWER_SAVE 1
 
 
 // Enables logs if true
 #define DEBUG_LOGS 1
+
+// Max level of compiled log messages: 0 errors, 1 warnings, 2 info, 3 verbose. Tags may lower it
+#if DEBUG_LOGS
+#define LOGS_COMPILED_LEVEL 3
+#else
+#define LOGS_COMPILED_LEVEL 0
+#endif
+
+// Print logs from a background thread. If false, messages are printed right on the calling thread
+#define LOGS_ASYNC 1
+// Size of the log messages ring of every logging thread
+#define LOGS_RING_SIZE (256u * 1024)
+// Max count of threads logging simultaneously, messages of the others are dropped
+#define LOGS_MAX_THREAD_RINGS 64
+// Longer string arguments are truncated
+#define LOGS_MAX_STRING_LENGTH 4096
+// Period of the logger thread checks when there are no messages
+#define LOGS_FLUSH_PERIOD_MS 2
@@ -0,0 +1,285 @@
+#include <app_options.h>
+
+#include <logs.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <string_view>
+
+namespace {
+
+bool ParseUint(const char* str, uint32_t& value) {
+    // strtoul negates "-1" into a huge value instead of failing
+    if (!str || !*str || *str == '-') {
+        return false;
+    }
+    char* end = nullptr;
+    errno = 0;
+    auto parsed = std::strtoull(str, &end, 10);
+    if (*end != '\0' || errno == ERANGE || parsed > UINT32_MAX) {
+        return false;
+    }
+    value = static_cast<uint32_t>(parsed);
+    return true;
+}
+
+void PrintUsage() {
+    PRINT("Usage: hello [options]");
+    PRINT("  --headless                render offscreen without a window");
+    PRINT("  --frames <N>              frames to render in headless mode (0 is infinite)");
+    PRINT("  --dump <path>             write the last headless frame to a PPM file");
+    PRINT("  --pipeline-cache <path>   pipeline cache file");
+    PRINT("  --no-pipeline-cache       don't load and save pipeline cache");
+    PRINT("  --caps-snapshot <path>    GPU capabilities snapshot file");
+    PRINT("  --no-caps-snapshot        query GPU capabilities from the driver on every launch");
+    PRINT("  --frames-in-flight <N>    frames recorded ahead of GPU (1-8)");
+    PRINT("  --record-threads <N>      command recording threads (0 is all hardware threads)");
+    PRINT("  --job-threads <N>         job system threads (0 is all hardware threads)");
+    PRINT("  --pipeline-threads <N>    background pipeline compile threads (0 is half of hardware threads)");
+    PRINT("  --staging-stress <MiB>    upload the amount every headless frame through the staging ring");
+    PRINT("  --gpu-cull <N>            frustum cull N instances on GPU every headless frame");
+    PRINT("  --cpu-cull <mode>         cull the --gpu-cull instances on CPU too: frustum or occlusion");
+    PRINT("  --virtual-texture <path>  stream a tiled texture every headless frame, generated if missing");
+    PRINT("  --vt-budget <MiB>         device memory for the resident virtual texture pages");
+    PRINT("  --vt-software             stream into an atlas even if the GPU supports sparse residency");
+    PRINT("  --mesh <path>             upload a converted mesh file in headless mode, a test one if missing");
+    PRINT("  --mesh-bench <path>       benchmark OBJ against converted mesh loading on the OBJ file and exit");
+    PRINT("  --scene-bench <N>         benchmark scene transform kernels on N nodes and exit");
+    PRINT("  --cull-bench <N>          benchmark CPU culling of N objects on 1 to all threads and exit");
+    PRINT("  --pipeline-cache-bench    time startup to the first pipeline and pipeline creation with an empty");
+    PRINT("                            and a warm cache and exit. Startup is warm if the cache file exists");
+    PRINT("  --caps-bench              benchmark GPUs probing with a cold and a warm capabilities snapshot and exit");
+    PRINT("  --log-bench <N>           benchmark sync against async logging of N messages and exit");
+    PRINT("  --record-bench <N>        benchmark recording N command jobs on 1 to all threads and exit");
+    PRINT("  --log-level <tag>=<lvl>   runtime level of a log tag: error, warning, info or verbose");
+    PRINT("  --profile <path>          capture CPU and GPU scopes into a Chrome trace JSON file");
+    PRINT("  --gpu-policy <policy>     GPU choice: performance, power-save or least-loaded");
+    PRINT("  --gpu <uuid>              use the GPU with the UUID regardless of the policy");
+    PRINT("  --multi-gpu <afr|sfr>     render headless frames on all the suitable GPUs");
+    PRINT("  --present-mode <policy>   swapchain present mode: latency, throughput or vsync");
+    PRINT("  --fps <N>                 limit the window frame rate (0 is unlimited)");
+    PRINT("  --on-demand               render window frames only on input, wait for events otherwise");
+    PRINT("  --window-frames <N>       close the window after N presented frames (0 is until closed)");
+    PRINT("  --width <N>               render target width");
+    PRINT("  --height <N>              render target height");
+}
+
+} // namespace
+
+AppResult ParseAppOptions(int argc, char** argv, AppOptions& options) {
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+        if (arg == "--headless") {
+            options.headless = true;
+            continue;
+        }
+        if (arg == "--on-demand") {
+            options.onDemand = true;
+            continue;
+        }
+        if (arg == "--vt-software") {
+            options.virtualTextureSoftware = true;
+            continue;
+        }
+        if (arg == "--pipeline-cache-bench") {
+            options.pipelineCacheBench = true;
+            options.headless = true;
+            continue;
+        }
+        if (arg == "--caps-bench") {
+            options.capsBench = true;
+            options.headless = true;
+            continue;
+        }
+        if (arg == "--dump" && value) {
+            options.dumpPath = value;
+            ++i;
+            continue;
+        }
+        if (arg == "--pipeline-cache" && value) {
+            options.pipelineCachePath = value;
+            ++i;
+            continue;
+        }
+        if (arg == "--no-pipeline-cache") {
+            options.pipelineCachePath.clear();
+            continue;
+        }
+        if (arg == "--caps-snapshot" && value) {
+            options.capsSnapshotPath = value;
+            ++i;
+            continue;
+        }
+        if (arg == "--no-caps-snapshot") {
+            options.capsSnapshotPath.clear();
+            continue;
+        }
+        if (arg == "--gpu-policy" && value) {
+            std::string_view policy = value;
+            if (policy == "performance") {
+                options.devicePolicy = DevicePolicy::Performance;
+            } else if (policy == "power-save") {
+                options.devicePolicy = DevicePolicy::PowerSave;
+            } else if (policy == "least-loaded") {
+                options.devicePolicy = DevicePolicy::LeastLoaded;
+            } else {
+                PRINT_E("Invalid GPU policy: \"%s\"", value);
+                PrintUsage();
+                return APP_CODE_INVALID_ARGS;
+            }
+            ++i;
+            continue;
+        }
+        if (arg == "--multi-gpu" && value) {
+            std::string_view mode = value;
+            if (mode == "afr") {
+                options.multiGpuMode = MultiGpuMode::Afr;
+            } else if (mode == "sfr") {
+                options.multiGpuMode = MultiGpuMode::Sfr;
+            } else {
+                PRINT_E("Invalid multi-GPU mode: \"%s\"", value);
+                PrintUsage();
+                return APP_CODE_INVALID_ARGS;
+            }
+            ++i;
+            continue;
+        }
+        if (arg == "--present-mode" && value) {
+            std::string_view policy = value;
+            if (policy == "latency") {
+                options.presentPolicy = PresentPolicy::LowLatency;
+            } else if (policy == "throughput") {
+                options.presentPolicy = PresentPolicy::Throughput;
+            } else if (policy == "vsync") {
+                options.presentPolicy = PresentPolicy::Vsync;
+            } else {
+                PRINT_E("Invalid present mode policy: \"%s\"", value);
+                PrintUsage();
+                return APP_CODE_INVALID_ARGS;
+            }
+            ++i;
+            continue;
+        }
+        if (arg == "--cpu-cull" && value) {
+            std::string_view mode = value;
+            if (mode == "frustum") {
+                options.cpuCullMode = CpuCullMode::Frustum;
+            } else if (mode == "occlusion") {
+                options.cpuCullMode = CpuCullMode::Occlusion;
+            } else {
+                PRINT_E("Invalid CPU culling mode: \"%s\"", value);
+                PrintUsage();
+                return APP_CODE_INVALID_ARGS;
+            }
+            ++i;
+            continue;
+        }
+        if (arg == "--gpu" && value) {
+            options.deviceUUID = value;
+            ++i;
+            continue;
+        }
+        if (arg == "--profile" && value) {
+            options.profilePath = value;
+            ++i;
+            continue;
+        }
+        if (arg == "--virtual-texture" && value) {
+            options.virtualTexturePath = value;
+            ++i;
+            continue;
+        }
+        if (arg == "--mesh" && value) {
+            options.meshPath = value;
+            ++i;
+            continue;
+        }
+        if (arg == "--mesh-bench" && value) {
+            options.meshBenchPath = value;
+            ++i;
+            continue;
+        }
+
+        if (arg == "--log-level" && value) {
+            // Applied right away to have the level for the rest of the initialization
+            std::string_view setting = value;
+            auto separator = setting.rfind('=');
+            int level = 0;
+            if (separator == std::string_view::npos || !logs::ParseLevel(setting.substr(separator + 1), level)) {
+                PRINT_E("Invalid log level setting: \"%s\"", value);
+                PrintUsage();
+                return APP_CODE_INVALID_ARGS;
+            }
+            logs::SetTagLevel(setting.substr(0, separator), level);
+            ++i;
+            continue;
+        }
+        if (arg == "--staging-stress") {
+            uint32_t megabytes = 0;
+            if (!ParseUint(value, megabytes)) {
+                PRINT_E("Invalid command line argument: \"%s\"", argv[i]);
+                PrintUsage();
+                return APP_CODE_INVALID_ARGS;
+            }
+            options.stagingStressSize = uint64_t(megabytes) * 1024 * 1024;
+            ++i;
+            continue;
+        }
+
+        uint32_t* target = nullptr;
+        if (arg == "--frames") {
+            target = &options.headlessFrames;
+        } else if (arg == "--frames-in-flight") {
+            target = &options.framesInFlight;
+        } else if (arg == "--record-threads") {
+            target = &options.recordThreads;
+        } else if (arg == "--width") {
+            target = &options.width;
+        } else if (arg == "--height") {
+            target = &options.height;
+        } else if (arg == "--gpu-cull") {
+            target = &options.gpuCullInstances;
+        } else if (arg == "--job-threads") {
+            target = &options.jobThreads;
+        } else if (arg == "--pipeline-threads") {
+            target = &options.pipelineThreads;
+        } else if (arg == "--fps") {
+            target = &options.targetFps;
+        } else if (arg == "--window-frames") {
+            target = &options.windowFrames;
+        } else if (arg == "--vt-budget") {
+            target = &options.virtualTextureBudget;
+        } else if (arg == "--scene-bench") {
+            target = &options.sceneBenchNodes;
+        } else if (arg == "--cull-bench") {
+            target = &options.cullBenchObjects;
+        } else if (arg == "--record-bench") {
+            target = &options.recordBenchJobs;
+            options.headless = true;
+        } else if (arg == "--log-bench") {
+            target = &options.logBenchMessages;
+        }
+
+        if (!target || !ParseUint(value, *target)) {
+            PRINT_E("Invalid command line argument: \"%s\"", argv[i]);
+            PrintUsage();
+            return APP_CODE_INVALID_ARGS;
+        }
+        ++i;
+    }
+
+    if (!options.width || !options.height) {
+        PRINT_E("Render target size can't be zero");
+        return APP_CODE_INVALID_ARGS;
+    }
+    if (!options.framesInFlight || options.framesInFlight > APP_MAX_FRAMES_IN_FLIGHT) {
+        PRINT_E("Frames in flight count must be in range 1-%d", APP_MAX_FRAMES_IN_FLIGHT);
+        return APP_CODE_INVALID_ARGS;
+    }
+
+    return APP_CODE_OK;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <app_consts.h>
+#include <app_result.h>
+
+#include <cstdint>
+#include <string>
+
+// Policy of choosing a GPU among the suitable ones
+enum class DevicePolicy {
+    // Discrete GPU with the most VRAM and the highest limits
+    Performance,
+    // Integrated GPU first
+    PowerSave,
+    // GPU with the most free VRAM. Spreads several app instances over the adapters
+    LeastLoaded,
+};
+
+// Distribution of headless frames over several GPUs
+enum class MultiGpuMode {
+    Off,
+    // Alternate frame rendering: whole frames go to the GPUs in turn
+    Afr,
+    // Split frame rendering: every GPU renders a band of each frame
+    Sfr,
+};
+
+// Visibility of the culling scene computed on CPU jobs
+enum class CpuCullMode {
+    Off,
+    Frustum,
+    // Frustum and software occlusion culling
+    Occlusion,
+};
+
+// Choice of the swapchain present mode
+enum class PresentPolicy {
+    // Mailbox or immediate: the newest frame is shown as soon as possible
+    LowLatency,
+    // Immediate or mailbox: frame rate is never limited by the display
+    Throughput,
+    // FIFO relaxed or FIFO: every frame is shown in sync with the display
+    Vsync,
+};
+
+// Runtime options of the application. Defaults are taken from app_consts.h
+struct AppOptions {
+    // Render into an offscreen image. No window and no surface are created
+    bool headless = false;
+    // Count of frames to be rendered in headless mode. 0 means infinite rendering
+    uint32_t headlessFrames = APP_DEFAULT_HEADLESS_FRAMES;
+    // Path to write the last headless frame to (PPM). Empty to skip
+    std::string dumpPath;
+
+    // Path to the persistent pipeline cache. Empty to disable persistence
+    std::string pipelineCachePath = APP_DEFAULT_PIPELINE_CACHE_PATH;
+    // Path to the snapshot of GPUs' capabilities skipping the driver queries. Empty to always query
+    std::string capsSnapshotPath = APP_DEFAULT_CAPS_SNAPSHOT_PATH;
+
+    // Count of frames CPU may run ahead of GPU
+    uint32_t framesInFlight = APP_DEFAULT_FRAMES_IN_FLIGHT;
+    // Count of threads recording secondary command buffers. 0 means count of hardware threads
+    uint32_t recordThreads = APP_DEFAULT_RECORD_THREADS;
+    // Count of job system threads including the main one. 0 means count of hardware threads
+    uint32_t jobThreads = APP_DEFAULT_JOB_THREADS;
+    // Count of background pipeline compile threads. 0 means half of hardware threads
+    uint32_t pipelineThreads = APP_DEFAULT_PIPELINE_THREADS;
+    // Bytes streamed through the staging ring every headless frame to stress uploads. 0 to disable
+    uint64_t stagingStressSize = 0;
+    // Count of instances culled on GPU every headless frame. 0 to disable
+    uint32_t gpuCullInstances = 0;
+    // Cull the same instances on CPU every headless frame
+    CpuCullMode cpuCullMode = CpuCullMode::Off;
+    // Tiled texture file streamed every headless frame. Generated if it doesn't exist. Empty to disable
+    std::string virtualTexturePath;
+    // Device memory for the resident virtual texture pages, MiB
+    uint32_t virtualTextureBudget = APP_VT_DEFAULT_BUDGET_MB;
+    // Use the atlas and the page table even if the GPU supports sparse residency
+    bool virtualTextureSoftware = false;
+    // GPU-ready mesh file uploaded in headless mode. A test mesh is converted if it doesn't exist. Empty to disable
+    std::string meshPath;
+    // OBJ file to benchmark the mesh loaders on instead of rendering. Generated if it doesn't exist. Empty to disable
+    std::string meshBenchPath;
+    // Count of scene nodes to benchmark the transform kernels on instead of rendering. 0 to disable
+    uint32_t sceneBenchNodes = 0;
+    // Count of objects to benchmark CPU culling on instead of rendering. 0 to disable
+    uint32_t cullBenchObjects = 0;
+    // Measure the startup to the first usable pipeline, cold without the pipeline cache file and warm with it,
+    // then benchmark pipeline creation with an empty and a warm cache instead of rendering. Runs headless
+    bool pipelineCacheBench = false;
+    // Count of jobs to benchmark command recording on 1 to all threads instead of rendering. 0 to disable
+    uint32_t recordBenchJobs = 0;
+    // Count of messages to benchmark the synchronous and asynchronous logging on instead of rendering. 0 to disable
+    uint32_t logBenchMessages = 0;
+    // Benchmark GPUs probing with a cold and a warm capabilities snapshot instead of rendering. Runs headless
+    bool capsBench = false;
+    // Path to write the profiler Chrome trace to. Empty to disable capturing
+    std::string profilePath;
+
+    DevicePolicy devicePolicy = POWER_SAVE ? DevicePolicy::PowerSave : DevicePolicy::Performance;
+    // UUID of the GPU to be used regardless of the policy. Empty to choose by the policy
+    std::string deviceUUID;
+    // Use all the suitable GPUs for headless rendering
+    MultiGpuMode multiGpuMode = MultiGpuMode::Off;
+
+    // Swapchain present mode policy. Can be switched at runtime with the P key
+    PresentPolicy presentPolicy = PresentPolicy::LowLatency;
+    // Window frame rate limit. 0 means no limit
+    uint32_t targetFps = APP_DEFAULT_TARGET_FPS;
+    // Treat the scene as static: render only on input and redraw requests, wait for events otherwise
+    bool onDemand = false;
+    // Count of frames to be presented before the window is closed. 0 to render until it's closed
+    uint32_t windowFrames = 0;
+
+    uint32_t width  = APP_DEFAULT_WINDOW_WIDTH;
+    uint32_t height = APP_DEFAULT_WINDOW_HEIGHT;
+};
+
+/**
+ * @brief
+ * Parse command line options
+ * @param argc
+ * count of arguments
+ * @param argv
+ * arguments
+ * @param options
+ * parsed options. Unspecified ones keep their default values
+ * @return
+ * AppResult code
+*/
+AppResult ParseAppOptions(int argc, char** argv, AppOptions& options);
@@ -11,6 +11,8 @@ enum AppResultCodes : AppResult {
     APP_CODE_VK_INIT_FAIURE,
     APP_CODE_VK_COMMAND_FAIURE,
     APP_CODE_DEV_ENUM_FAILED,
+    APP_CODE_INVALID_ARGS,
+    APP_CODE_IO_FAILURE,
     APP_CODE_UNKNOWN = ~((AppResult)0)
 };
 
@@ -0,0 +1,285 @@
+#include <scene/cpu_culler.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CPU_CULLER_SSE 1
+#include <xmmintrin.h>
+#else
+#define CPU_CULLER_SSE 0
+#endif
+
+#include <logs.h>
+#include <scene/frustum.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+double MsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Larger on screen occluders go first, ties are broken by the index to keep the choice deterministic
+template<typename Candidate>
+bool IsLargerOccluder(const Candidate& left, const Candidate& right) {
+    return left.size > right.size || (left.size == right.size && left.object < right.object);
+}
+
+} // namespace
+
+void CpuCuller::Reserve(size_t count) {
+    for (auto array : { &centersX, &centersY, &centersZ, &extentsX, &extentsY, &extentsZ, &radii }) {
+        array->reserve(count);
+    }
+    occluders.reserve(count);
+    visibility.reserve(count);
+}
+
+void CpuCuller::Clear() {
+    for (auto array : { &centersX, &centersY, &centersZ, &extentsX, &extentsY, &extentsZ, &radii }) {
+        array->clear();
+    }
+    occluders.clear();
+    visibility.clear();
+    threadCandidates.clear();
+    projectedOccluders.clear();
+    occlusionBuffer.Clear();
+    maxOccludersCount = 0;
+    stats = {};
+}
+
+uint32_t CpuCuller::AddBox(const glm::vec3& min, const glm::vec3& max, bool occluder) {
+    glm::vec3 extent = (max - min) * 0.5f;
+    centersX.push_back((min.x + max.x) * 0.5f);
+    centersY.push_back((min.y + max.y) * 0.5f);
+    centersZ.push_back((min.z + max.z) * 0.5f);
+    extentsX.push_back(extent.x);
+    extentsY.push_back(extent.y);
+    extentsZ.push_back(extent.z);
+    radii.push_back(std::sqrt(extent.x * extent.x + extent.y * extent.y + extent.z * extent.z));
+    occluders.push_back(occluder);
+    return static_cast<uint32_t>(centersX.size() - 1);
+}
+
+uint32_t CpuCuller::AddSphere(const glm::vec3& center, float radius) {
+    centersX.push_back(center.x);
+    centersY.push_back(center.y);
+    centersZ.push_back(center.z);
+    // The box around the sphere is never tighter than the sphere, so the radius is what is tested
+    extentsX.push_back(radius);
+    extentsY.push_back(radius);
+    extentsZ.push_back(radius);
+    radii.push_back(radius);
+    occluders.push_back(false);
+    return static_cast<uint32_t>(centersX.size() - 1);
+}
+
+void CpuCuller::SetOcclusion(uint32_t width, uint32_t height, uint32_t maxOccluders) {
+    if (!width || !height || !maxOccluders) {
+        occlusionBuffer.Clear();
+        maxOccludersCount = 0;
+        return;
+    }
+    occlusionBuffer.Resize(width, height);
+    maxOccludersCount = maxOccluders;
+}
+
+bool CpuCuller::SetSimd(bool enabled) {
+    simd = enabled && CPU_CULLER_SSE;
+    return simd == enabled;
+}
+
+glm::vec3 CpuCuller::GetMin(size_t object) const {
+    return glm::vec3(centersX[object] - extentsX[object], centersY[object] - extentsY[object],
+                     centersZ[object] - extentsZ[object]);
+}
+
+glm::vec3 CpuCuller::GetMax(size_t object) const {
+    return glm::vec3(centersX[object] + extentsX[object], centersY[object] + extentsY[object],
+                     centersZ[object] + extentsZ[object]);
+}
+
+uint32_t CpuCuller::CullFrustumRange(const glm::vec4 (&planes)[6], size_t begin, size_t end) {
+
+    // An object is outside if it is behind a plane farther than its radius along the plane normal.
+    // The radius of a box is its projection on the normal, spheres are limited by their radius
+    uint32_t visible = 0;
+    size_t i = begin;
+
+#if CPU_CULLER_SSE
+    if (simd) {
+        __m128 planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+        for (int p = 0; p < 6; ++p) {
+            planeX[p] = _mm_set1_ps(planes[p].x);
+            planeY[p] = _mm_set1_ps(planes[p].y);
+            planeZ[p] = _mm_set1_ps(planes[p].z);
+            planeW[p] = _mm_set1_ps(planes[p].w);
+            absX[p]   = _mm_set1_ps(std::abs(planes[p].x));
+            absY[p]   = _mm_set1_ps(std::abs(planes[p].y));
+            absZ[p]   = _mm_set1_ps(std::abs(planes[p].z));
+        }
+        __m128 zero = _mm_setzero_ps();
+
+        for (; i + 4 <= end; i += 4) {
+            __m128 x  = _mm_loadu_ps(&centersX[i]);
+            __m128 y  = _mm_loadu_ps(&centersY[i]);
+            __m128 z  = _mm_loadu_ps(&centersZ[i]);
+            __m128 ex = _mm_loadu_ps(&extentsX[i]);
+            __m128 ey = _mm_loadu_ps(&extentsY[i]);
+            __m128 ez = _mm_loadu_ps(&extentsZ[i]);
+            __m128 r  = _mm_loadu_ps(&radii[i]);
+
+            __m128 inside = _mm_cmpeq_ps(zero, zero);
+            for (int p = 0; p < 6; ++p) {
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], x), _mm_mul_ps(planeY[p], y)),
+                                             _mm_add_ps(_mm_mul_ps(planeZ[p], z), planeW[p]));
+                __m128 boxRadius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absX[p], ex), _mm_mul_ps(absY[p], ey)),
+                                              _mm_mul_ps(absZ[p], ez));
+                __m128 radius = _mm_min_ps(boxRadius, r);
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+            }
+
+            int mask = _mm_movemask_ps(inside);
+            for (int lane = 0; lane < 4; ++lane) {
+                uint8_t laneVisible = (mask >> lane) & 1;
+                visibility[i + lane] = laneVisible;
+                visible += laneVisible;
+            }
+        }
+    }
+#endif
+
+    for (; i < end; ++i) {
+        bool inside = true;
+        for (int p = 0; p < 6 && inside; ++p) {
+            const auto& plane = planes[p];
+            float distance = (plane.x * centersX[i] + plane.y * centersY[i]) + (plane.z * centersZ[i] + plane.w);
+            float boxRadius = (std::abs(plane.x) * extentsX[i] + std::abs(plane.y) * extentsY[i]) +
+                              std::abs(plane.z) * extentsZ[i];
+            inside = distance + std::min(boxRadius, radii[i]) >= 0.0f;
+        }
+        visibility[i] = inside;
+        visible += inside;
+    }
+
+    return visible;
+}
+
+uint32_t CpuCuller::Cull(JobSystem& jobs, const glm::mat4& viewProj, const glm::vec3& eye) {
+
+    size_t count = centersX.size();
+    visibility.resize(count);
+
+    auto start = std::chrono::steady_clock::now();
+
+    glm::vec4 planes[6];
+    ExtractFrustumPlanes(viewProj, planes);
+    bool occlusion = maxOccludersCount != 0;
+    threadCandidates.resize(jobs.GetThreadsCount() ? jobs.GetThreadsCount() : 1);
+    for (auto& candidates : threadCandidates) {
+        candidates.clear();
+    }
+    // Clip space w to estimate the on screen size of occluders
+    glm::vec4 rowW(viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3]);
+
+    std::atomic<uint32_t> inFrustum{ 0 };
+    jobs.ParallelFor(count, frustumGrain, [&](size_t begin, size_t end) {
+        uint32_t visible = CullFrustumRange(planes, begin, end);
+        inFrustum.fetch_add(visible, std::memory_order_relaxed);
+        if (!occlusion || !visible) {
+            return;
+        }
+        auto& candidates = threadCandidates[jobs.GetThreadIndex()];
+        for (size_t i = begin; i < end; ++i) {
+            if (!visibility[i] || !occluders[i]) {
+                continue;
+            }
+            float w = rowW.x * centersX[i] + rowW.y * centersY[i] + rowW.z * centersZ[i] + rowW.w;
+            if (w > 0.0f) {
+                candidates.push_back({ radii[i] / w, static_cast<uint32_t>(i) });
+            }
+        }
+    });
+
+    stats.lastInFrustum   = inFrustum.load();
+    stats.lastFrustumTime = MsSince(start);
+
+    uint32_t visible = stats.lastInFrustum;
+    stats.lastOccluders     = 0;
+    stats.lastOcclusionTime = 0.0;
+    if (occlusion && visible) {
+        start = std::chrono::steady_clock::now();
+        visible = CullOcclusion(jobs, viewProj, eye);
+        stats.lastOcclusionTime = MsSince(start);
+    }
+
+    stats.lastVisible = visible;
+    stats.totalFrustumTime   += stats.lastFrustumTime;
+    stats.totalOcclusionTime += stats.lastOcclusionTime;
+    ++stats.frames;
+    return visible;
+}
+
+uint32_t CpuCuller::CullOcclusion(JobSystem& jobs, const glm::mat4& viewProj, const glm::vec3& eye) {
+
+    // The largest on screen occluders hide the most
+    auto& candidates = threadCandidates[0];
+    for (size_t i = 1; i < threadCandidates.size(); ++i) {
+        candidates.insert(candidates.end(), threadCandidates[i].begin(), threadCandidates[i].end());
+    }
+    if (candidates.size() > maxOccludersCount) {
+        std::nth_element(candidates.begin(), candidates.begin() + maxOccludersCount, candidates.end(),
+                         IsLargerOccluder<Candidate>);
+        candidates.resize(maxOccludersCount);
+    }
+
+    projectedOccluders.clear();
+    for (const auto& candidate : candidates) {
+        OcclusionBuffer::ProjectedBox box;
+        if (occlusionBuffer.ProjectBox(viewProj, eye, GetMin(candidate.object), GetMax(candidate.object), box)) {
+            projectedOccluders.push_back(box);
+        }
+    }
+    stats.lastOccluders = static_cast<uint32_t>(projectedOccluders.size());
+
+    // Bands of rows are rasterized independently
+    jobs.ParallelFor(occlusionBuffer.GetHeight(), rasterRows, [this](size_t begin, size_t end) {
+        auto rowBegin = static_cast<uint32_t>(begin);
+        auto rowEnd   = static_cast<uint32_t>(end);
+        occlusionBuffer.ResetRows(rowBegin, rowEnd);
+        for (const auto& box : projectedOccluders) {
+            occlusionBuffer.RasterizeBox(box, rowBegin, rowEnd);
+        }
+        occlusionBuffer.UpdateTiles(rowBegin, rowEnd);
+    });
+
+    std::atomic<uint32_t> visible{ 0 };
+    jobs.ParallelFor(visibility.size(), occludeeGrain, [&](size_t begin, size_t end) {
+        uint32_t rangeVisible = 0;
+        for (size_t i = begin; i < end; ++i) {
+            if (!visibility[i]) {
+                continue;
+            }
+            if (occlusionBuffer.IsBoxVisible(viewProj, GetMin(i), GetMax(i))) {
+                ++rangeVisible;
+            } else {
+                visibility[i] = 0;
+            }
+        }
+        visible.fetch_add(rangeVisible, std::memory_order_relaxed);
+    });
+
+    return visible.load();
+}
+
+void CpuCuller::PrintStats() const {
+    if (!stats.frames) {
+        return;
+    }
+    PRINT("CPU culling: %zu objects, last frame %u in frustum, %u visible with %u occluders",
+          GetObjectsCount(), stats.lastInFrustum, stats.lastVisible, stats.lastOccluders);
+    PRINT("CPU culling average time: frustum %.3f ms, occlusion %.3f ms",
+          stats.totalFrustumTime / stats.frames, stats.totalOcclusionTime / stats.frames);
+}
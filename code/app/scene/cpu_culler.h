@@ -0,0 +1,127 @@
+#pragma once
+
+#include <scene/occlusion_buffer.h>
+#include <utils/job_system.h>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief
+ * Visibility of scene objects computed on CPU jobs. Objects are bounding spheres or AABBs kept
+ * in SoA arrays and tested against the frustum 4 at a time with SSE. Optionally the objects in the
+ * frustum are tested against a software depth buffer of the largest on screen occluders
+*/
+class CpuCuller {
+
+public:
+
+    struct Stats {
+        uint64_t frames           = 0;
+        uint32_t lastInFrustum    = 0;
+        uint32_t lastVisible      = 0;
+        uint32_t lastOccluders    = 0;
+        // Time of the phases, ms
+        double lastFrustumTime    = 0.0;
+        double lastOcclusionTime  = 0.0;
+        double totalFrustumTime   = 0.0;
+        double totalOcclusionTime = 0.0;
+    };
+
+    CpuCuller() = default;
+    CpuCuller(const CpuCuller&) = delete;
+
+    void Reserve(size_t count);
+    void Clear();
+
+    /**
+     * @brief
+     * Add an object bounded by a world space box
+     * @param occluder
+     * the object fills the box and may hide the others
+     * @return
+     * index of the object
+    */
+    uint32_t AddBox(const glm::vec3& min, const glm::vec3& max, bool occluder);
+    // Add an object bounded by a world space sphere. Spheres aren't occluders
+    uint32_t AddSphere(const glm::vec3& center, float radius);
+
+    /**
+     * @brief
+     * Enable occlusion culling
+     * @param width
+     * width of the depth buffer. 0 disables occlusion culling
+     * @param height
+     * height of the depth buffer
+     * @param maxOccluders
+     * count of the largest on screen occluders rasterized every frame
+    */
+    void SetOcclusion(uint32_t width, uint32_t height, uint32_t maxOccluders);
+    // false if the build has no SSE. Scalar code is used then
+    bool SetSimd(bool enabled);
+
+    /**
+     * @brief
+     * Compute visibility of the objects
+     * @param jobs
+     * job system running the tests
+     * @param viewProj
+     * view-projection matrix with [0, 1] depth range
+     * @param eye
+     * world space camera position
+     * @return
+     * count of visible objects
+    */
+    uint32_t Cull(JobSystem& jobs, const glm::mat4& viewProj, const glm::vec3& eye);
+
+    // Non-zero for the visible objects after Cull
+    const std::vector<uint8_t>& GetVisibility() const { return visibility; }
+    size_t GetObjectsCount() const { return centersX.size(); }
+    const OcclusionBuffer& GetOcclusionBuffer() const { return occlusionBuffer; }
+
+    const Stats& GetStats() const { return stats; }
+    void PrintStats() const;
+
+private:
+
+    // Test the objects [begin, end) against the frustum. Returns count of the visible ones
+    uint32_t CullFrustumRange(const glm::vec4 (&planes)[6], size_t begin, size_t end);
+    uint32_t CullOcclusion(JobSystem& jobs, const glm::mat4& viewProj, const glm::vec3& eye);
+
+    glm::vec3 GetMin(size_t object) const;
+    glm::vec3 GetMax(size_t object) const;
+
+private:
+
+    // Objects are tested in jobs of the count
+    static constexpr size_t frustumGrain   = 4096;
+    static constexpr size_t occludeeGrain  = 1024;
+    // Occluders are rasterized by bands of the rows count
+    static constexpr uint32_t rasterRows   = 16;
+    static_assert(rasterRows % OcclusionBuffer::tileSize == 0, "Bands must consist of whole tiles");
+
+    std::vector<float> centersX, centersY, centersZ;
+    // Half sizes of the boxes. Spheres have the radius there
+    std::vector<float> extentsX, extentsY, extentsZ;
+    // Radius of the spheres. Length of the extents for the boxes
+    std::vector<float> radii;
+    std::vector<uint8_t> occluders;
+    std::vector<uint8_t> visibility;
+
+    bool simd = true;
+    OcclusionBuffer occlusionBuffer;
+    uint32_t maxOccludersCount = 0;
+    // Visible occluders found by the every job thread
+    struct Candidate {
+        float size;
+        uint32_t object;
+    };
+    std::vector<std::vector<Candidate>> threadCandidates;
+    std::vector<OcclusionBuffer::ProjectedBox> projectedOccluders;
+
+    Stats stats;
+};
@@ -0,0 +1,134 @@
+#include <scene/cull_benchmark.h>
+
+#include <logs.h>
+#include <scene/cpu_culler.h>
+#include <utils/bench_stats.h>
+#include <utils/job_system.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// One of the objects is a building occluder
+constexpr uint32_t buildingsRatio = 16;
+constexpr uint32_t occlusionWidth  = 320;
+constexpr uint32_t occlusionHeight = 180;
+constexpr uint32_t maxOccluders    = 256;
+
+/**
+ * @brief
+ * Fill the culler with buildings and small objects between them on a square of the ground
+ * @return
+ * side of the square
+*/
+float BuildCity(uint32_t objectsCount, CpuCuller& culler) {
+
+    float side = std::sqrt(static_cast<float>(objectsCount)) * 4.0f;
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> ground(0.0f, side);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    culler.Reserve(objectsCount);
+    for (uint32_t i = 0; i < objectsCount; ++i) {
+        glm::vec3 position(ground(random), 0.0f, ground(random));
+        if (i % buildingsRatio == 0) {
+            glm::vec3 size(4.0f + unit(random) * 8.0f, 5.0f + unit(random) * 25.0f, 4.0f + unit(random) * 8.0f);
+            culler.AddBox(position, position + size, true);
+        } else if (i % 4 == 0) {
+            float radius = 0.25f + unit(random);
+            culler.AddSphere(position + glm::vec3(0.0f, radius, 0.0f), radius);
+        } else {
+            glm::vec3 size(0.5f + unit(random) * 1.5f);
+            culler.AddBox(position, position + size, false);
+        }
+    }
+    return side;
+}
+
+// Phase times of a configuration
+struct RunTimes {
+    double frustum   = 0.0;
+    double occlusion = 0.0;
+};
+
+RunTimes Measure(CpuCuller& culler, JobSystem& jobs, const glm::mat4& viewProj, const glm::vec3& eye) {
+    std::vector<double> frustumTimes, occlusionTimes;
+    for (int i = 0; i < benchIterations; ++i) {
+        culler.Cull(jobs, viewProj, eye);
+        frustumTimes.push_back(culler.GetStats().lastFrustumTime);
+        occlusionTimes.push_back(culler.GetStats().lastOcclusionTime);
+    }
+    return { Median(frustumTimes), Median(occlusionTimes) };
+}
+
+} // namespace
+
+AppResult RunCullBenchmark(uint32_t objectsCount) {
+
+    CpuCuller culler;
+    float side = BuildCity(objectsCount, culler);
+
+    // Camera stands in a corner of the city and looks along the diagonal
+    glm::vec3 eye(side * 0.1f, 8.0f, side * 0.1f);
+    glm::mat4 view = glm::lookAt(eye, glm::vec3(side * 0.6f, 2.0f, side * 0.6f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.5f, side * 2.0f);
+    glm::mat4 viewProj = proj * view;
+
+    // Single thread results are the reference
+    JobSystem jobs;
+    jobs.Init(1);
+    culler.SetSimd(false);
+    uint32_t inFrustum = culler.Cull(jobs, viewProj, eye);
+    std::vector<uint8_t> frustumReference = culler.GetVisibility();
+    culler.SetSimd(true);
+    culler.SetOcclusion(occlusionWidth, occlusionHeight, maxOccluders);
+    uint32_t visible = culler.Cull(jobs, viewProj, eye);
+    std::vector<uint8_t> occlusionReference = culler.GetVisibility();
+
+    PRINT("Cull benchmark: %u objects, %u in frustum, %u visible with %u occluders (%ux%u depth buffer)",
+          objectsCount, inFrustum, visible, culler.GetStats().lastOccluders, occlusionWidth, occlusionHeight);
+
+    uint32_t hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    std::vector<uint32_t> threadCounts;
+    for (uint32_t threads = 1; threads < hardwareThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(hardwareThreads);
+
+    bool matched = true;
+    double baseTime = 0.0;
+    for (auto threads : threadCounts) {
+        jobs.Init(threads);
+
+        culler.SetOcclusion(0, 0, 0);
+        culler.SetSimd(false);
+        RunTimes scalar = Measure(culler, jobs, viewProj, eye);
+        matched &= culler.GetVisibility() == frustumReference;
+        culler.SetSimd(true);
+        RunTimes simd = Measure(culler, jobs, viewProj, eye);
+        matched &= culler.GetVisibility() == frustumReference;
+
+        culler.SetOcclusion(occlusionWidth, occlusionHeight, maxOccluders);
+        RunTimes occlusion = Measure(culler, jobs, viewProj, eye);
+        matched &= culler.GetVisibility() == occlusionReference;
+
+        double total = occlusion.frustum + occlusion.occlusion;
+        if (!baseTime) {
+            baseTime = total;
+        }
+        PRINT("  %2u threads: frustum scalar %.3f ms, SIMD %.3f ms; with occlusion %.3f + %.3f ms (x%.2f)",
+              threads, scalar.frustum, simd.frustum, occlusion.frustum, occlusion.occlusion, baseTime / total);
+    }
+
+    if (!matched) {
+        PRINT_E("Culling results differ between the runs");
+        return APP_CODE_UNKNOWN;
+    }
+    return APP_CODE_OK;
+}
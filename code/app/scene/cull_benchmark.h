@@ -0,0 +1,16 @@
+#pragma once
+
+#include <app_result.h>
+
+#include <cstdint>
+
+/**
+ * @brief
+ * Benchmark CpuCuller on a random city of boxes and spheres with 1 to all hardware job threads.
+ * Results of every run are checked against the single thread ones
+ * @param objectsCount
+ * count of scene objects
+ * @return
+ * AppResult code. APP_CODE_UNKNOWN if some results differ
+*/
+AppResult RunCullBenchmark(uint32_t objectsCount);
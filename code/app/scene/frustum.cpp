@@ -0,0 +1,22 @@
+#include <scene/frustum.h>
+
+#include <cmath>
+
+void ExtractFrustumPlanes(const glm::mat4& viewProj, glm::vec4 (&planes)[6]) {
+    // GLM matrices are column major
+    auto row = [&viewProj](int i) {
+        return glm::vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]);
+    };
+    glm::vec4 r0 = row(0), r1 = row(1), r2 = row(2), r3 = row(3);
+
+    planes[0] = r3 + r0; // left
+    planes[1] = r3 - r0; // right
+    planes[2] = r3 + r1; // bottom
+    planes[3] = r3 - r1; // top
+    planes[4] = r2;      // near
+    planes[5] = r3 - r2; // far
+    for (auto& plane : planes) {
+        float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+        plane = plane / length;
+    }
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+/**
+ * @brief
+ * Get world space frustum planes of a view-projection matrix with [0, 1] depth range.
+ * Planes are normalized and their normals point inside the frustum
+ * @param viewProj
+ * view-projection matrix
+ * @param planes
+ * left, right, bottom, top, near and far planes
+*/
+void ExtractFrustumPlanes(const glm::mat4& viewProj, glm::vec4 (&planes)[6]);
@@ -0,0 +1,193 @@
+#include <scene/mesh_benchmark.h>
+
+#include <app_consts.h>
+#include <logs.h>
+#include <scene/mesh_builder.h>
+#include <scene/mesh_file.h>
+#include <scene/mesh_optimizer.h>
+#include <scene/obj_loader.h>
+#include <utils/bench_stats.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Text parsing is orders of magnitude slower than loading the mesh file, so it runs less iterations
+constexpr int objIterations = 3;
+
+typedef std::array<uint16_t, 3> PositionKey;
+typedef std::array<uint16_t, 9> TriangleKey;
+
+std::string MeshPathFor(const char* objPath) {
+    std::string path = objPath;
+    size_t extension = path.rfind('.');
+    if (extension != std::string::npos && path.find_first_of("/\\", extension) == std::string::npos) {
+        path.resize(extension);
+    }
+    return path + ".mesh";
+}
+
+// Triangle of quantized positions starting from the smallest vertex, so the winding is kept
+TriangleKey MakeTriangleKey(const PositionKey (&corners)[3]) {
+    size_t first = 0;
+    for (size_t i = 1; i < 3; ++i) {
+        if (corners[i] < corners[first]) {
+            first = i;
+        }
+    }
+    TriangleKey key{};
+    for (size_t i = 0; i < 3; ++i) {
+        const auto& corner = corners[(first + i) % 3];
+        std::copy(corner.begin(), corner.end(), key.begin() + i * 3);
+    }
+    return key;
+}
+
+/**
+ * @brief
+ * Check the mesh file has the triangles of the source mesh: order of the triangles and the vertices
+ * may change, positions quantized with the file's bounds and windings must not
+*/
+bool MatchTriangles(const MeshData& source, const MeshFile& file, const std::vector<uint32_t>& fileIndices) {
+
+    const auto& header = file.GetHeader();
+    if (fileIndices.size() != source.indices.size()) {
+        return false;
+    }
+
+    std::vector<TriangleKey> sourceKeys;
+    std::vector<TriangleKey> fileKeys;
+    sourceKeys.reserve(source.indices.size() / 3);
+    fileKeys.reserve(source.indices.size() / 3);
+    auto vertices = reinterpret_cast<const MeshFile::Vertex*>(file.GetSectionData(MeshFile::Vertices));
+    for (size_t t = 0; t < source.indices.size(); t += 3) {
+        PositionKey sourceCorners[3];
+        PositionKey fileCorners[3];
+        for (size_t corner = 0; corner < 3; ++corner) {
+            const auto& vertex = source.vertices[source.indices[t + corner]];
+            const auto& quantized = vertices[fileIndices[t + corner]];
+            for (size_t i = 0; i < 3; ++i) {
+                sourceCorners[corner][i] = MeshFile::QuantizeUnorm(vertex.position[i], header.positionOffset[i],
+                                                                   header.positionScale[i]);
+                fileCorners[corner][i] = quantized.position[i];
+            }
+        }
+        sourceKeys.push_back(MakeTriangleKey(sourceCorners));
+        fileKeys.push_back(MakeTriangleKey(fileCorners));
+    }
+    std::sort(sourceKeys.begin(), sourceKeys.end());
+    std::sort(fileKeys.begin(), fileKeys.end());
+    return sourceKeys == fileKeys;
+}
+
+} // namespace
+
+AppResult RunMeshBenchmark(const char* objPath) {
+
+    if (!std::ifstream(objPath)) {
+        MeshData generated;
+        GenerateTestMesh(APP_MESH_GENERATED_SEGMENTS, generated);
+        APP_CHECK_CALL(WriteObj(objPath, generated));
+        PRINT("Test mesh %s generated: %zu vertices, %zu triangles", objPath, generated.vertices.size(),
+              generated.indices.size() / 3);
+    }
+    uint64_t objSize = static_cast<uint64_t>(std::ifstream(objPath, std::ios::binary | std::ios::ate).tellg());
+
+    MeshData source;
+    APP_CHECK_CALL(LoadObj(objPath, source));
+    std::string meshPath = MeshPathFor(objPath);
+    MeshBuildStats buildStats;
+    APP_CHECK_CALL(BuildMeshFile(source, meshPath.c_str(), APP_MESH_VERTEX_CACHE_SIZE, buildStats));
+
+    uint32_t trianglesCount = static_cast<uint32_t>(source.indices.size() / 3);
+    uint64_t objBuffersSize = source.vertices.size() * sizeof(MeshData::Vertex) +
+                              source.indices.size() * sizeof(uint32_t);
+    PRINT("Mesh benchmark: %s, %zu vertices, %u triangles; converted to %s with %u-bit indices",
+          objPath, source.vertices.size(), trianglesCount, meshPath.c_str(), buildStats.indexSize * 8);
+
+    // Stand-in for the mapped staging ring both loaders write the vertex and index buffers to
+    std::vector<uint8_t> staging(std::max<uint64_t>(objBuffersSize, buildStats.fileSize));
+
+    std::vector<double> objTimes;
+    for (int i = 0; i < objIterations; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        MeshData mesh;
+        APP_CHECK_CALL(LoadObj(objPath, mesh));
+        size_t verticesSize = mesh.vertices.size() * sizeof(MeshData::Vertex);
+        std::memcpy(staging.data(), mesh.vertices.data(), verticesSize);
+        std::memcpy(staging.data() + verticesSize, mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+        std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - start;
+        objTimes.push_back(time.count());
+    }
+
+    std::vector<double> meshTimes;
+    MeshFile file;
+    for (int i = 0; i < benchIterations; ++i) {
+        // Mapping again every time, so page faults are paid like on a real load
+        auto start = std::chrono::steady_clock::now();
+        APP_CHECK_CALL(file.Open(meshPath.c_str()));
+        uint64_t verticesSize = file.GetSectionSize(MeshFile::Vertices);
+        std::memcpy(staging.data(), file.GetSectionData(MeshFile::Vertices), verticesSize);
+        std::memcpy(staging.data() + verticesSize, file.GetSectionData(MeshFile::Indices),
+                    file.GetSectionSize(MeshFile::Indices));
+        file.Close();
+        std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - start;
+        meshTimes.push_back(time.count());
+    }
+
+    APP_CHECK_CALL(file.Open(meshPath.c_str()));
+    // Copied, Close resets the header
+    MeshFile::FileHeader header = file.GetHeader();
+    std::vector<uint32_t> fileIndices(header.indexCount);
+    if (header.indexSize == 2) {
+        auto indices = reinterpret_cast<const uint16_t*>(file.GetSectionData(MeshFile::Indices));
+        std::copy(indices, indices + header.indexCount, fileIndices.begin());
+    } else {
+        std::memcpy(fileIndices.data(), file.GetSectionData(MeshFile::Indices), fileIndices.size() * sizeof(uint32_t));
+    }
+    bool matched = MatchTriangles(source, file, fileIndices);
+    uint64_t meshBuffersSize = file.GetSectionSize(MeshFile::Vertices) + file.GetSectionSize(MeshFile::Indices);
+    file.Close();
+
+    double objTime  = Median(objTimes);
+    double meshTime = Median(meshTimes);
+    auto mibPerSecond = [](uint64_t bytes, double milliseconds) {
+        return milliseconds > 0.0 ? bytes / (1024.0 * 1024.0) / (milliseconds / 1000.0) : 0.0;
+    };
+    PRINT("  OBJ loader:  %8.3f ms, %.1f MiB of text at %.1f MiB/s, %.1f MiB of float buffers",
+          objTime, objSize / (1024.0 * 1024.0), mibPerSecond(objSize, objTime), objBuffersSize / (1024.0 * 1024.0));
+    PRINT("  mesh file:   %8.3f ms, %.1f MiB of buffers at %.1f MiB/s (x%.1f faster, x%.2f smaller)",
+          meshTime, meshBuffersSize / (1024.0 * 1024.0), mibPerSecond(meshBuffersSize, meshTime),
+          meshTime > 0.0 ? objTime / meshTime : 0.0, static_cast<double>(objBuffersSize) / meshBuffersSize);
+
+    uint32_t sourceVertexCount = static_cast<uint32_t>(source.vertices.size());
+    auto fetchBefore = AnalyzeVertexFetch(source.indices, sourceVertexCount, sizeof(MeshData::Vertex),
+                                          APP_MESH_VERTEX_CACHE_SIZE);
+    auto fetchAfter = AnalyzeVertexFetch(fileIndices, header.vertexCount, header.vertexStride,
+                                         APP_MESH_VERTEX_CACHE_SIZE);
+    // Index fetch is linear in both cases, it's counted with the index sizes
+    double bytesBefore = (fetchBefore.fetchedBytes + source.indices.size() * sizeof(uint32_t)) /
+                         static_cast<double>(trianglesCount);
+    double bytesAfter  = (fetchAfter.fetchedBytes + fileIndices.size() * header.indexSize) /
+                         static_cast<double>(trianglesCount);
+    PRINT("  vertex cache (FIFO %u): ACMR %.3f -> %.3f, ATVR %.3f -> %.3f",
+          APP_MESH_VERTEX_CACHE_SIZE, buildStats.cacheBefore.acmr, buildStats.cacheAfter.acmr,
+          buildStats.cacheBefore.atvr, buildStats.cacheAfter.atvr);
+    PRINT("  vertex fetch: %.1f -> %.1f bytes per triangle (x%.2f less), overfetch %.2f -> %.2f",
+          bytesBefore, bytesAfter, bytesAfter > 0.0 ? bytesBefore / bytesAfter : 0.0,
+          fetchBefore.overfetch, fetchAfter.overfetch);
+    PRINT("  quantization error: position %.6f, normal %.4f degrees",
+          buildStats.positionError, buildStats.normalError);
+
+    if (!matched) {
+        PRINT_E("Mesh file triangles don't match the OBJ ones");
+        return APP_CODE_UNKNOWN;
+    }
+    return APP_CODE_OK;
+}
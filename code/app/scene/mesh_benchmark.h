@@ -0,0 +1,16 @@
+#pragma once
+
+#include <app_result.h>
+
+/**
+ * @brief
+ * Benchmark loading a mesh from an OBJ file with the naive text loader against loading its MeshFile
+ * conversion by mapping the file and copying the sections, and compare vertex fetch of the two with
+ * a simulated vertex cache. The OBJ file is generated if it doesn't exist, the mesh file is converted
+ * next to it
+ * @param objPath
+ * OBJ file path
+ * @return
+ * AppResult code. APP_CODE_UNKNOWN if the loaded meshes don't match
+*/
+AppResult RunMeshBenchmark(const char* objPath);
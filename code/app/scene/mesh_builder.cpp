@@ -0,0 +1,226 @@
+#include <scene/mesh_builder.h>
+
+#include <logs.h>
+#include <scene/mesh_file.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+#include <random>
+
+namespace {
+
+constexpr float pi = 3.14159265358979f;
+
+void Normalize(float vector[3]) {
+    float length = std::sqrt(vector[0] * vector[0] + vector[1] * vector[1] + vector[2] * vector[2]);
+    if (length > 0.0f) {
+        vector[0] /= length;
+        vector[1] /= length;
+        vector[2] /= length;
+    } else {
+        vector[0] = 0.0f;
+        vector[1] = 0.0f;
+        vector[2] = 1.0f;
+    }
+}
+
+// Offset and scale of the unorm quantization of an attribute component
+void ComputeBounds(const std::vector<MeshData::Vertex>& vertices, size_t component, bool uv,
+                   float& offset, float& scale) {
+    float low  = INFINITY;
+    float high = -INFINITY;
+    for (const auto& vertex : vertices) {
+        float value = uv ? vertex.uv[component] : vertex.position[component];
+        low  = std::min(low, value);
+        high = std::max(high, value);
+    }
+    offset = low;
+    scale  = high - low;
+}
+
+bool WritePadding(std::ofstream& file, uint64_t& position) {
+    static const char zeros[MeshFile::sectionAlignment] = {};
+    uint64_t padding = (MeshFile::sectionAlignment - position % MeshFile::sectionAlignment) % MeshFile::sectionAlignment;
+    file.write(zeros, static_cast<std::streamsize>(padding));
+    position += padding;
+    return static_cast<bool>(file);
+}
+
+} // namespace
+
+AppResult BuildMeshFile(const MeshData& source, const char* path, uint32_t cacheSize, MeshBuildStats& stats) {
+
+    if (source.vertices.empty() || source.indices.empty() || source.indices.size() % 3) {
+        PRINT_E("Mesh to convert must be a non-empty triangle list");
+        return APP_CODE_INVALID_ARGS;
+    }
+
+    stats = {};
+    uint32_t sourceVertexCount = static_cast<uint32_t>(source.vertices.size());
+    stats.cacheBefore = AnalyzeVertexCache(source.indices, sourceVertexCount, cacheSize);
+
+    MeshData mesh = source;
+    OptimizeVertexCache(mesh.indices, sourceVertexCount);
+    OptimizeOverdraw(mesh.indices, mesh.vertices, cacheSize);
+    OptimizeVertexFetch(mesh);
+
+    MeshFile::FileHeader header{};
+    header.magic        = MeshFile::fileMagic;
+    header.version      = MeshFile::fileVersion;
+    header.vertexCount  = static_cast<uint32_t>(mesh.vertices.size());
+    header.indexCount   = static_cast<uint32_t>(mesh.indices.size());
+    header.vertexStride = sizeof(MeshFile::Vertex);
+    header.indexSize    = header.vertexCount <= 0x10000 ? 2 : 4;
+    for (size_t i = 0; i < 3; ++i) {
+        ComputeBounds(mesh.vertices, i, false, header.positionOffset[i], header.positionScale[i]);
+    }
+    for (size_t i = 0; i < 2; ++i) {
+        ComputeBounds(mesh.vertices, i, true, header.uvOffset[i], header.uvScale[i]);
+    }
+
+    std::vector<MeshFile::Vertex> vertices(mesh.vertices.size());
+    for (size_t v = 0; v < vertices.size(); ++v) {
+        const auto& vertex = mesh.vertices[v];
+        auto& quantized = vertices[v];
+        for (size_t i = 0; i < 3; ++i) {
+            quantized.position[i] = MeshFile::QuantizeUnorm(vertex.position[i], header.positionOffset[i],
+                                                            header.positionScale[i]);
+            float decoded = MeshFile::DequantizeUnorm(quantized.position[i], header.positionOffset[i],
+                                                      header.positionScale[i]);
+            stats.positionError = std::max(stats.positionError, std::abs(decoded - vertex.position[i]));
+        }
+        quantized.position[3] = 0;
+        for (size_t i = 0; i < 2; ++i) {
+            quantized.uv[i] = MeshFile::QuantizeUnorm(vertex.uv[i], header.uvOffset[i], header.uvScale[i]);
+        }
+
+        float normal[3] = { vertex.normal[0], vertex.normal[1], vertex.normal[2] };
+        Normalize(normal);
+        MeshFile::EncodeOctahedral(normal, quantized.normal);
+        float decoded[3];
+        MeshFile::DecodeOctahedral(quantized.normal, decoded);
+        float cosine = std::clamp(normal[0] * decoded[0] + normal[1] * decoded[1] + normal[2] * decoded[2], -1.0f, 1.0f);
+        stats.normalError = std::max(stats.normalError, std::acos(cosine) * 180.0f / pi);
+    }
+
+    std::vector<uint16_t> shortIndices;
+    const void* indexData = mesh.indices.data();
+    if (header.indexSize == 2) {
+        shortIndices.assign(mesh.indices.begin(), mesh.indices.end());
+        indexData = shortIndices.data();
+    }
+
+    uint64_t position = sizeof(header);
+    position += (MeshFile::sectionAlignment - position % MeshFile::sectionAlignment) % MeshFile::sectionAlignment;
+    header.sections[MeshFile::Vertices] = { position, uint64_t(header.vertexCount) * header.vertexStride };
+    position += header.sections[MeshFile::Vertices].size;
+    position += (MeshFile::sectionAlignment - position % MeshFile::sectionAlignment) % MeshFile::sectionAlignment;
+    header.sections[MeshFile::Indices] = { position, uint64_t(header.indexCount) * header.indexSize };
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        PRINT_E("Failed to create mesh file %s", path);
+        return APP_CODE_IO_FAILURE;
+    }
+    uint64_t written = sizeof(header);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    WritePadding(file, written);
+    file.write(reinterpret_cast<const char*>(vertices.data()),
+               static_cast<std::streamsize>(header.sections[MeshFile::Vertices].size));
+    written += header.sections[MeshFile::Vertices].size;
+    WritePadding(file, written);
+    file.write(static_cast<const char*>(indexData), static_cast<std::streamsize>(header.sections[MeshFile::Indices].size));
+    written += header.sections[MeshFile::Indices].size;
+    if (!file) {
+        PRINT_E("Failed to write mesh file %s", path);
+        return APP_CODE_IO_FAILURE;
+    }
+
+    stats.vertexCount = header.vertexCount;
+    stats.indexCount  = header.indexCount;
+    stats.indexSize   = header.indexSize;
+    stats.cacheAfter  = AnalyzeVertexCache(mesh.indices, header.vertexCount, cacheSize);
+    stats.fileSize    = written;
+    return APP_CODE_OK;
+}
+
+void GenerateTestMesh(uint32_t segments, MeshData& mesh) {
+
+    segments = std::max(segments, 4u);
+    uint32_t rings = segments / 2;
+    mesh.vertices.clear();
+    mesh.indices.clear();
+
+    // Seam and pole vertices are duplicated to have their own uvs
+    for (uint32_t ring = 0; ring <= rings; ++ring) {
+        float v = static_cast<float>(ring) / rings;
+        float theta = v * pi;
+        for (uint32_t segment = 0; segment <= segments; ++segment) {
+            float u = static_cast<float>(segment) / segments;
+            float phi = u * 2.0f * pi;
+            float radius = 1.0f + 0.05f * std::sin(theta * 9.0f) * std::sin(phi * 12.0f);
+            MeshData::Vertex vertex{};
+            vertex.position[0] = radius * std::sin(theta) * std::cos(phi);
+            vertex.position[1] = radius * std::cos(theta);
+            vertex.position[2] = radius * std::sin(theta) * std::sin(phi);
+            vertex.uv[0] = u;
+            vertex.uv[1] = v;
+            mesh.vertices.push_back(vertex);
+        }
+    }
+    uint32_t rowSize = segments + 1;
+    for (uint32_t ring = 0; ring < rings; ++ring) {
+        for (uint32_t segment = 0; segment < segments; ++segment) {
+            uint32_t a = ring * rowSize + segment;
+            uint32_t b = a + rowSize;
+            if (ring) {
+                mesh.indices.insert(mesh.indices.end(), { a, a + 1, b });
+            }
+            if (ring + 1 < rings) {
+                mesh.indices.insert(mesh.indices.end(), { a + 1, b + 1, b });
+            }
+        }
+    }
+
+    // Smooth normals are the sums of the faces' ones weighted by area
+    for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+        const float* a = mesh.vertices[mesh.indices[i]].position;
+        const float* b = mesh.vertices[mesh.indices[i + 1]].position;
+        const float* c = mesh.vertices[mesh.indices[i + 2]].position;
+        float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+        float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+        float normal[3] = { ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0] };
+        for (size_t corner = 0; corner < 3; ++corner) {
+            for (size_t k = 0; k < 3; ++k) {
+                mesh.vertices[mesh.indices[i + corner]].normal[k] += normal[k];
+            }
+        }
+    }
+    for (auto& vertex : mesh.vertices) {
+        Normalize(vertex.normal);
+    }
+
+    std::mt19937 random(7);
+    std::vector<uint32_t> permutation(mesh.vertices.size());
+    std::iota(permutation.begin(), permutation.end(), 0u);
+    std::shuffle(permutation.begin(), permutation.end(), random);
+    std::vector<MeshData::Vertex> vertices(mesh.vertices.size());
+    for (size_t v = 0; v < permutation.size(); ++v) {
+        vertices[permutation[v]] = mesh.vertices[v];
+    }
+    mesh.vertices.swap(vertices);
+
+    std::vector<uint32_t> triangles(mesh.indices.size() / 3);
+    std::iota(triangles.begin(), triangles.end(), 0u);
+    std::shuffle(triangles.begin(), triangles.end(), random);
+    std::vector<uint32_t> indices;
+    indices.reserve(mesh.indices.size());
+    for (auto triangle : triangles) {
+        for (size_t corner = 0; corner < 3; ++corner) {
+            indices.push_back(permutation[mesh.indices[triangle * 3 + corner]]);
+        }
+    }
+    mesh.indices.swap(indices);
+}
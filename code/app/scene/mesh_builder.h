@@ -0,0 +1,48 @@
+#pragma once
+
+#include <app_result.h>
+#include <scene/mesh_data.h>
+#include <scene/mesh_optimizer.h>
+
+#include <cstdint>
+
+// Results of a mesh conversion
+struct MeshBuildStats {
+    uint32_t vertexCount = 0;
+    uint32_t indexCount  = 0;
+    // 2 or 4 bytes
+    uint32_t indexSize   = 0;
+    VertexCacheStats cacheBefore;
+    VertexCacheStats cacheAfter;
+    // Largest quantization errors: position in mesh units, normal in degrees
+    float positionError  = 0.0f;
+    float normalError    = 0.0f;
+    uint64_t fileSize    = 0;
+};
+
+/**
+ * @brief
+ * Convert a mesh to the MeshFile format: reorder triangles for the vertex cache and overdraw,
+ * reorder vertices for fetch, quantize them and choose the smallest index size
+ * @param source
+ * mesh to convert
+ * @param path
+ * output mesh file path
+ * @param cacheSize
+ * FIFO vertex cache size of the overdraw clusters and of the statistics
+ * @param stats
+ * conversion results
+ * @return
+ * AppResult code
+*/
+AppResult BuildMeshFile(const MeshData& source, const char* path, uint32_t cacheSize, MeshBuildStats& stats);
+
+/**
+ * @brief
+ * Generate a bumpy sphere with shuffled triangles and vertices, like meshes exported with no optimization
+ * @param segments
+ * segments around the sphere, half of them from pole to pole
+ * @param mesh
+ * generated mesh
+*/
+void GenerateTestMesh(uint32_t segments, MeshData& mesh);
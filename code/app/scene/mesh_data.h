@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Indexed triangle mesh with full precision attributes, the form meshes are edited and converted in
+struct MeshData {
+    // Plain floats to keep the 32 bytes layout text loaders upload as is
+    struct Vertex {
+        float position[3];
+        float normal[3];
+        float uv[2];
+    };
+    static_assert(sizeof(Vertex) == 32, "MeshData::Vertex must be tightly packed");
+
+    std::vector<Vertex> vertices;
+    // Triangle list
+    std::vector<uint32_t> indices;
+};
@@ -0,0 +1,126 @@
+#include <scene/mesh_file.h>
+
+#include <logs.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Sign for the octahedral folding, zero goes to the positive side
+float SignNotZero(float value) {
+    return value >= 0.0f ? 1.0f : -1.0f;
+}
+
+// Largest of the indices, the sections are aligned for the direct reads
+template<typename Index>
+uint32_t FindMaxIndex(const uint8_t* data, uint32_t count) {
+    const Index* indices = reinterpret_cast<const Index*>(data);
+    Index maxIndex = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        maxIndex = std::max(maxIndex, indices[i]);
+    }
+    return maxIndex;
+}
+
+} // namespace
+
+AppResult MeshFile::Open(const char* path) {
+
+    Close();
+
+    if (!file.Open(path)) {
+        PRINT_E("Failed to open mesh file %s", path);
+        return APP_CODE_IO_FAILURE;
+    }
+    if (file.GetSize() < sizeof(FileHeader)) {
+        PRINT_E("Mesh file %s is truncated", path);
+        file.Close();
+        return APP_CODE_IO_FAILURE;
+    }
+    std::memcpy(&header, file.GetData(), sizeof(header));
+    if (header.magic != fileMagic || header.version != fileVersion || header.vertexStride != sizeof(Vertex) ||
+        (header.indexSize != 2 && header.indexSize != 4) || !header.vertexCount || !header.indexCount ||
+        header.indexCount % 3 || (header.indexSize == 2 && header.vertexCount > 0x10000)) {
+        PRINT_E("Mesh file %s has unsupported header", path);
+        file.Close();
+        return APP_CODE_IO_FAILURE;
+    }
+
+    const uint64_t expectedSizes[SectionsCount] = {
+        uint64_t(header.vertexCount) * header.vertexStride,
+        uint64_t(header.indexCount) * header.indexSize,
+    };
+    // Compared without adding offset and size, a crafted offset must not wrap around
+    for (uint32_t i = 0; i < SectionsCount; ++i) {
+        const auto& section = header.sections[i];
+        if (section.size != expectedSizes[i] || section.offset % sectionAlignment ||
+            section.offset < sizeof(FileHeader) || section.offset > file.GetSize() ||
+            section.size > file.GetSize() - section.offset) {
+            PRINT_E("Mesh file %s is truncated or has invalid sections", path);
+            file.Close();
+            return APP_CODE_IO_FAILURE;
+        }
+    }
+
+    // Out of range indices would make the draws read past the vertex buffer
+    const uint8_t* indices = GetSectionData(Indices);
+    uint32_t maxIndex = header.indexSize == 2 ? FindMaxIndex<uint16_t>(indices, header.indexCount)
+                                              : FindMaxIndex<uint32_t>(indices, header.indexCount);
+    if (maxIndex >= header.vertexCount) {
+        PRINT_E("Mesh file %s has index %u out of %u vertices", path, maxIndex, header.vertexCount);
+        file.Close();
+        return APP_CODE_IO_FAILURE;
+    }
+
+    return APP_CODE_OK;
+}
+
+void MeshFile::Close() {
+    file.Close();
+    header = {};
+}
+
+uint16_t MeshFile::QuantizeUnorm(float value, float offset, float scale) {
+    float normalized = scale > 0.0f ? (value - offset) / scale : 0.0f;
+    return static_cast<uint16_t>(std::lround(std::clamp(normalized, 0.0f, 1.0f) * unormMax));
+}
+
+float MeshFile::DequantizeUnorm(uint16_t value, float offset, float scale) {
+    return offset + static_cast<float>(value) / unormMax * scale;
+}
+
+void MeshFile::EncodeOctahedral(const float normal[3], int16_t encoded[2]) {
+
+    // Project on the octahedron, the lower half is folded over the diagonals
+    float length = std::abs(normal[0]) + std::abs(normal[1]) + std::abs(normal[2]);
+    float x = length > 0.0f ? normal[0] / length : 0.0f;
+    float y = length > 0.0f ? normal[1] / length : 0.0f;
+    if (normal[2] < 0.0f) {
+        float foldedX = (1.0f - std::abs(y)) * SignNotZero(x);
+        float foldedY = (1.0f - std::abs(x)) * SignNotZero(y);
+        x = foldedX;
+        y = foldedY;
+    }
+    encoded[0] = static_cast<int16_t>(std::lround(std::clamp(x, -1.0f, 1.0f) * snormMax));
+    encoded[1] = static_cast<int16_t>(std::lround(std::clamp(y, -1.0f, 1.0f) * snormMax));
+}
+
+void MeshFile::DecodeOctahedral(const int16_t encoded[2], float normal[3]) {
+
+    // Same as the SNORM vertex format conversion
+    float x = std::max(static_cast<float>(encoded[0]) / snormMax, -1.0f);
+    float y = std::max(static_cast<float>(encoded[1]) / snormMax, -1.0f);
+    float z = 1.0f - std::abs(x) - std::abs(y);
+    if (z < 0.0f) {
+        float unfoldedX = (1.0f - std::abs(y)) * SignNotZero(x);
+        float unfoldedY = (1.0f - std::abs(x)) * SignNotZero(y);
+        x = unfoldedX;
+        y = unfoldedY;
+    }
+    float length = std::sqrt(x * x + y * y + z * z);
+    normal[0] = x / length;
+    normal[1] = y / length;
+    normal[2] = z / length;
+}
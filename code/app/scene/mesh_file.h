@@ -0,0 +1,100 @@
+#pragma once
+
+#include <app_result.h>
+#include <utils/mapped_file.h>
+
+#include <cstdint>
+
+/**
+ * @brief
+ * GPU-ready binary mesh. The file is a header followed by sections holding the vertex and the index buffers
+ * byte for byte as they are bound, so loading is mapping the file and copying the sections into staging memory.
+ * Vertices are quantized to 16 bytes:
+ *  - position is R16G16B16A16_UNORM in the mesh bounds, w is 0;
+ *  - normal is R16G16_SNORM octahedral encoding;
+ *  - uv is R16G16_UNORM in the uv bounds.
+ * Indices are 16-bit if every vertex is addressable by them, 32-bit otherwise.
+ * Files are produced offline by the mesh_converter tool, see BuildMeshFile
+*/
+class MeshFile {
+
+public:
+
+    static constexpr uint32_t fileMagic   = 0x4853454D; // "MESH"
+    static constexpr uint32_t fileVersion = 1;
+    // Alignment of the sections in the file, covers copy offset alignments of any GPU
+    static constexpr uint32_t sectionAlignment = 256;
+    // Largest quantized value of the unorm attributes
+    static constexpr float unormMax = 65535.0f;
+    static constexpr float snormMax = 32767.0f;
+
+    enum Section : uint32_t {
+        Vertices,
+        Indices,
+        SectionsCount,
+    };
+
+    struct Vertex {
+        uint16_t position[4];
+        int16_t normal[2];
+        uint16_t uv[2];
+    };
+    static_assert(sizeof(Vertex) == 16, "MeshFile::Vertex must be tightly packed");
+
+    struct SectionInfo {
+        // From the file start, multiple of sectionAlignment
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t vertexStride;
+        // 2 or 4 bytes
+        uint32_t indexSize;
+        // Attribute value is offset + quantized / unormMax * scale
+        float positionOffset[3];
+        float positionScale[3];
+        float uvOffset[2];
+        float uvScale[2];
+        SectionInfo sections[SectionsCount];
+    };
+    static_assert(sizeof(FileHeader) == 96, "MeshFile::FileHeader layout is part of the format");
+
+    MeshFile() = default;
+    MeshFile(const MeshFile&) = delete;
+
+    /**
+     * @brief
+     * Map the file and validate the header, the sections and the index range. Only the indices are read,
+     * the vertex pages are read by the OS on the first access
+     * @param path
+     * mesh file path
+     * @return
+     * AppResult code
+    */
+    AppResult Open(const char* path);
+    void Close();
+
+    bool IsOpen() const { return file.IsOpen(); }
+    const FileHeader& GetHeader() const { return header; }
+    // Section bytes in the mapping, valid until Close
+    const uint8_t* GetSectionData(Section section) const { return file.GetData() + header.sections[section].offset; }
+    uint64_t GetSectionSize(Section section) const { return header.sections[section].size; }
+    size_t GetFileSize() const { return file.GetSize(); }
+
+    // Quantization shared by the converter and the decoders
+    static uint16_t QuantizeUnorm(float value, float offset, float scale);
+    static float DequantizeUnorm(uint16_t value, float offset, float scale);
+    // Normal must be unit length
+    static void EncodeOctahedral(const float normal[3], int16_t encoded[2]);
+    static void DecodeOctahedral(const int16_t encoded[2], float normal[3]);
+
+private:
+
+    MappedFile file;
+    FileHeader header{};
+};
@@ -0,0 +1,338 @@
+#include <scene/mesh_optimizer.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// LRU cache modelled by the Forsyth scores. Larger than the FIFO caches of GPUs, which favours
+// locality in general over matching a particular hardware
+constexpr uint32_t forsythCacheSize = 32;
+// Score of the vertices of the last triangle. Lower than the next ones, so strips are not always followed
+constexpr float lastTriangleScore = 0.75f;
+constexpr float cacheDecayPower   = 1.5f;
+constexpr float valenceBoostScale = 2.0f;
+constexpr float valenceBoostPower = 0.5f;
+// Scores of vertices with more live triangles are the same
+constexpr uint32_t maxValence = 32;
+
+// Direct mapped cache of the vertex fetch simulation
+constexpr uint32_t fetchLineSize  = 64;
+constexpr uint32_t fetchLineCount = 256;
+
+constexpr uint32_t noVertex = ~0u;
+
+struct VertexScores {
+    float cache[forsythCacheSize];
+    float valence[maxValence + 1];
+
+    VertexScores() {
+        for (uint32_t i = 0; i < forsythCacheSize; ++i) {
+            if (i < 3) {
+                cache[i] = lastTriangleScore;
+            } else {
+                float scale = 1.0f - static_cast<float>(i - 3) / (forsythCacheSize - 3);
+                cache[i] = std::pow(scale, cacheDecayPower);
+            }
+        }
+        valence[0] = 0.0f;
+        for (uint32_t i = 1; i <= maxValence; ++i) {
+            valence[i] = valenceBoostScale * std::pow(static_cast<float>(i), -valenceBoostPower);
+        }
+    }
+
+    // Position is -1 for vertices out of the cache
+    float Get(int position, uint32_t liveTriangles) const {
+        if (!liveTriangles) {
+            return -1.0f;
+        }
+        float score = position >= 0 ? cache[position] : 0.0f;
+        return score + valence[std::min(liveTriangles, maxValence)];
+    }
+};
+
+// Vectors of a triangle for clustering
+void TriangleFrame(const std::vector<MeshData::Vertex>& vertices, const uint32_t* triangle,
+                   float centroid[3], float normal[3]) {
+    const float* a = vertices[triangle[0]].position;
+    const float* b = vertices[triangle[1]].position;
+    const float* c = vertices[triangle[2]].position;
+    float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+    float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+    // Not normalized: twice the area, so larger triangles weigh more
+    normal[0] = ab[1] * ac[2] - ab[2] * ac[1];
+    normal[1] = ab[2] * ac[0] - ab[0] * ac[2];
+    normal[2] = ab[0] * ac[1] - ab[1] * ac[0];
+    for (int i = 0; i < 3; ++i) {
+        centroid[i] = (a[i] + b[i] + c[i]) / 3.0f;
+    }
+}
+
+} // namespace
+
+void OptimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount) {
+
+    static const VertexScores scores;
+    uint32_t trianglesCount = static_cast<uint32_t>(indices.size() / 3);
+    if (trianglesCount < 2) {
+        return;
+    }
+
+    // Triangles of every vertex. Emitted ones are swapped out of the vertex's live range
+    std::vector<uint32_t> liveTriangles(vertexCount, 0);
+    for (uint32_t i = 0; i < trianglesCount * 3; ++i) {
+        ++liveTriangles[indices[i]];
+    }
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (uint32_t v = 0; v < vertexCount; ++v) {
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+    }
+    std::vector<uint32_t> adjacency(trianglesCount * 3);
+    {
+        std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (uint32_t i = 0; i < trianglesCount * 3; ++i) {
+            adjacency[fill[indices[i]]++] = i / 3;
+        }
+    }
+
+    std::vector<int> cachePositions(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (uint32_t v = 0; v < vertexCount; ++v) {
+        vertexScores[v] = scores.Get(-1, liveTriangles[v]);
+    }
+    std::vector<float> triangleScores(trianglesCount);
+    std::vector<bool> emitted(trianglesCount, false);
+    uint32_t bestTriangle = 0;
+    for (uint32_t t = 0; t < trianglesCount; ++t) {
+        const uint32_t* triangle = &indices[t * 3];
+        triangleScores[t] = vertexScores[triangle[0]] + vertexScores[triangle[1]] + vertexScores[triangle[2]];
+        if (triangleScores[t] > triangleScores[bestTriangle]) {
+            bestTriangle = t;
+        }
+    }
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    // Three more entries for the vertices pushed by a triangle before the cache is trimmed
+    uint32_t cache[forsythCacheSize + 3];
+    uint32_t cacheCount = 0;
+    uint32_t newCache[forsythCacheSize + 3];
+    // Input order fallback when no triangle in the cache is left
+    uint32_t cursor = 0;
+
+    for (uint32_t emittedCount = 0; emittedCount < trianglesCount; ++emittedCount) {
+        if (bestTriangle == noVertex) {
+            while (emitted[cursor]) {
+                ++cursor;
+            }
+            bestTriangle = cursor;
+        }
+        const uint32_t* triangle = &indices[bestTriangle * 3];
+        result.insert(result.end(), triangle, triangle + 3);
+        emitted[bestTriangle] = true;
+
+        // Retire the triangle from its vertices
+        for (int i = 0; i < 3; ++i) {
+            uint32_t v = triangle[i];
+            uint32_t* begin = &adjacency[adjacencyOffsets[v]];
+            uint32_t* end   = begin + liveTriangles[v];
+            auto found = std::find(begin, end, bestTriangle);
+            std::swap(*found, *(end - 1));
+            --liveTriangles[v];
+        }
+
+        // The triangle's vertices go to the front, the rest keeps its order
+        uint32_t newCount = 0;
+        for (int i = 0; i < 3; ++i) {
+            newCache[newCount++] = triangle[i];
+        }
+        for (uint32_t i = 0; i < cacheCount; ++i) {
+            uint32_t v = cache[i];
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+                newCache[newCount++] = v;
+            }
+        }
+        for (uint32_t i = forsythCacheSize; i < newCount; ++i) {
+            cachePositions[newCache[i]] = -1;
+            vertexScores[newCache[i]] = scores.Get(-1, liveTriangles[newCache[i]]);
+        }
+        cacheCount = std::min(newCount, forsythCacheSize);
+        std::copy(newCache, newCache + cacheCount, cache);
+        for (uint32_t i = 0; i < cacheCount; ++i) {
+            cachePositions[cache[i]] = static_cast<int>(i);
+            vertexScores[cache[i]] = scores.Get(static_cast<int>(i), liveTriangles[cache[i]]);
+        }
+
+        // Only triangles of the cached vertices changed score enough to be the next best
+        bestTriangle = noVertex;
+        float bestScore = -1.0f;
+        for (uint32_t i = 0; i < cacheCount; ++i) {
+            uint32_t v = cache[i];
+            for (uint32_t a = 0; a < liveTriangles[v]; ++a) {
+                uint32_t t = adjacency[adjacencyOffsets[v] + a];
+                const uint32_t* other = &indices[t * 3];
+                triangleScores[t] = vertexScores[other[0]] + vertexScores[other[1]] + vertexScores[other[2]];
+                if (triangleScores[t] > bestScore) {
+                    bestScore = triangleScores[t];
+                    bestTriangle = t;
+                }
+            }
+        }
+    }
+
+    indices.swap(result);
+}
+
+void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<MeshData::Vertex>& vertices,
+                      uint32_t cacheSize) {
+
+    uint32_t trianglesCount = static_cast<uint32_t>(indices.size() / 3);
+    if (trianglesCount < 2 || !cacheSize) {
+        return;
+    }
+
+    // A cluster starts where all the vertices of a triangle miss the FIFO cache
+    std::vector<uint32_t> clusterStarts;
+    std::vector<uint32_t> cacheTimes(vertices.size(), 0);
+    uint32_t time = cacheSize + 1;
+    for (uint32_t t = 0; t < trianglesCount; ++t) {
+        uint32_t misses = 0;
+        for (int i = 0; i < 3; ++i) {
+            uint32_t v = indices[t * 3 + i];
+            if (time - cacheTimes[v] > cacheSize) {
+                cacheTimes[v] = time++;
+                ++misses;
+            }
+        }
+        if (misses == 3 || !t) {
+            clusterStarts.push_back(t);
+        }
+    }
+    uint32_t clustersCount = static_cast<uint32_t>(clusterStarts.size());
+    clusterStarts.push_back(trianglesCount);
+
+    struct Cluster {
+        uint32_t first;
+        uint32_t count;
+        float sortKey;
+    };
+    std::vector<Cluster> clusters(clustersCount);
+    std::vector<float> centroids(clustersCount * 3, 0.0f);
+    std::vector<float> normals(clustersCount * 3, 0.0f);
+    float meshCentroid[3] = {};
+    float meshArea = 0.0f;
+    for (uint32_t c = 0; c < clustersCount; ++c) {
+        float area = 0.0f;
+        for (uint32_t t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t) {
+            float centroid[3], normal[3];
+            TriangleFrame(vertices, &indices[t * 3], centroid, normal);
+            float weight = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+            for (int i = 0; i < 3; ++i) {
+                centroids[c * 3 + i] += centroid[i] * weight;
+                normals[c * 3 + i]   += normal[i];
+            }
+            area += weight;
+        }
+        for (int i = 0; i < 3; ++i) {
+            meshCentroid[i] += centroids[c * 3 + i];
+            if (area > 0.0f) {
+                centroids[c * 3 + i] /= area;
+            }
+        }
+        meshArea += area;
+        clusters[c] = { clusterStarts[c], clusterStarts[c + 1] - clusterStarts[c], 0.0f };
+    }
+    for (int i = 0; i < 3; ++i) {
+        meshCentroid[i] = meshArea > 0.0f ? meshCentroid[i] / meshArea : 0.0f;
+    }
+
+    for (uint32_t c = 0; c < clustersCount; ++c) {
+        const float* normal = &normals[c * 3];
+        float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        float key = 0.0f;
+        for (int i = 0; i < 3 && length > 0.0f; ++i) {
+            key += (centroids[c * 3 + i] - meshCentroid[i]) * normal[i] / length;
+        }
+        clusters[c].sortKey = key;
+    }
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) {
+        return a.sortKey > b.sortKey;
+    });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (const auto& cluster : clusters) {
+        auto begin = indices.begin() + size_t(cluster.first) * 3;
+        result.insert(result.end(), begin, begin + size_t(cluster.count) * 3);
+    }
+    indices.swap(result);
+}
+
+void OptimizeVertexFetch(MeshData& mesh) {
+
+    std::vector<uint32_t> remap(mesh.vertices.size(), noVertex);
+    std::vector<MeshData::Vertex> vertices;
+    vertices.reserve(mesh.vertices.size());
+    for (auto& index : mesh.indices) {
+        if (remap[index] == noVertex) {
+            remap[index] = static_cast<uint32_t>(vertices.size());
+            vertices.push_back(mesh.vertices[index]);
+        }
+        index = remap[index];
+    }
+    mesh.vertices.swap(vertices);
+}
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize) {
+
+    VertexCacheStats stats;
+    if (indices.empty() || !vertexCount) {
+        return stats;
+    }
+
+    // A vertex is in the FIFO while less than cacheSize misses happened after it was added
+    std::vector<uint32_t> cacheTimes(vertexCount, 0);
+    uint32_t time = cacheSize + 1;
+    uint64_t misses = 0;
+    for (auto index : indices) {
+        if (time - cacheTimes[index] > cacheSize) {
+            cacheTimes[index] = time++;
+            ++misses;
+        }
+    }
+    stats.acmr = static_cast<double>(misses) / (indices.size() / 3);
+    stats.atvr = static_cast<double>(misses) / vertexCount;
+    return stats;
+}
+
+VertexFetchStats AnalyzeVertexFetch(const std::vector<uint32_t>& indices, uint32_t vertexCount,
+                                    uint32_t vertexStride, uint32_t cacheSize) {
+
+    VertexFetchStats stats;
+    if (indices.empty() || !vertexCount || !vertexStride) {
+        return stats;
+    }
+
+    std::vector<uint32_t> cacheTimes(vertexCount, 0);
+    uint32_t time = cacheSize + 1;
+    // Tag of the line in every slot, lines are numbered from 1 to tell the empty slots
+    std::vector<uint64_t> lineTags(fetchLineCount, 0);
+    for (auto index : indices) {
+        if (time - cacheTimes[index] <= cacheSize) {
+            continue;
+        }
+        cacheTimes[index] = time++;
+
+        uint64_t first = uint64_t(index) * vertexStride / fetchLineSize;
+        uint64_t last  = (uint64_t(index) * vertexStride + vertexStride - 1) / fetchLineSize;
+        for (uint64_t line = first; line <= last; ++line) {
+            uint64_t& tag = lineTags[line % fetchLineCount];
+            if (tag != line + 1) {
+                tag = line + 1;
+                stats.fetchedBytes += fetchLineSize;
+            }
+        }
+    }
+    stats.overfetch = static_cast<double>(stats.fetchedBytes) / (uint64_t(vertexCount) * vertexStride);
+    return stats;
+}
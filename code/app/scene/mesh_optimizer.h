@@ -0,0 +1,88 @@
+#pragma once
+
+#include <scene/mesh_data.h>
+
+#include <cstdint>
+#include <vector>
+
+// Post-transform vertex cache behaviour of an index buffer
+struct VertexCacheStats {
+    // Vertex shader invocations per triangle. 3 is no reuse, about 0.5 is the best for regular grids
+    double acmr = 0.0;
+    // Vertex shader invocations per vertex. 1 is the best
+    double atvr = 0.0;
+};
+
+// Memory traffic of vertex fetch behind the post-transform cache
+struct VertexFetchStats {
+    uint64_t fetchedBytes = 0;
+    // Fetched bytes per byte of the vertex buffer. 1 is every vertex read once
+    double overfetch = 0.0;
+};
+
+/**
+ * @brief
+ * Reorder triangles for the post-transform vertex cache with Forsyth's linear-speed algorithm:
+ * the triangle with the highest score is emitted next, vertices score for being recently used
+ * and for having few triangles left
+ * @param indices
+ * triangle list to reorder in place
+ * @param vertexCount
+ * count of vertices the indices refer to
+*/
+void OptimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount);
+
+/**
+ * @brief
+ * Reorder clusters of a cache optimized triangle list to draw the outer surfaces first, after Sander et al.
+ * Clusters are split where the simulated vertex cache restarts, so the cache efficiency is kept.
+ * Clusters facing away from the mesh center are drawn first as they more likely occlude the rest
+ * @param indices
+ * triangle list to reorder in place
+ * @param vertices
+ * mesh vertices
+ * @param cacheSize
+ * simulated FIFO vertex cache size
+*/
+void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<MeshData::Vertex>& vertices,
+                      uint32_t cacheSize);
+
+/**
+ * @brief
+ * Renumber vertices in the order of their first use by the indices, so vertex fetch reads the buffer
+ * almost sequentially. Unused vertices are dropped
+ * @param mesh
+ * mesh to reorder in place
+*/
+void OptimizeVertexFetch(MeshData& mesh);
+
+/**
+ * @brief
+ * Simulate a FIFO post-transform cache, the kind most GPUs are closest to
+ * @param indices
+ * triangle list
+ * @param vertexCount
+ * count of vertices the indices refer to
+ * @param cacheSize
+ * cache entries
+ * @return
+ * cache statistics
+*/
+VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize);
+
+/**
+ * @brief
+ * Simulate vertex fetch of the post-transform cache misses through a direct mapped cache of 64 bytes lines
+ * @param indices
+ * triangle list
+ * @param vertexCount
+ * count of vertices the indices refer to
+ * @param vertexStride
+ * vertex size in the buffer, bytes
+ * @param cacheSize
+ * FIFO post-transform cache entries
+ * @return
+ * fetch statistics
+*/
+VertexFetchStats AnalyzeVertexFetch(const std::vector<uint32_t>& indices, uint32_t vertexCount,
+                                    uint32_t vertexStride, uint32_t cacheSize);
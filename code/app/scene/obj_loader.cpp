@@ -0,0 +1,191 @@
+#include <scene/obj_loader.h>
+
+#include <logs.h>
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <tuple>
+
+namespace {
+
+// Position, uv and normal indices of a face corner, 0-based. -1 if absent
+typedef std::tuple<int, int, int> Corner;
+
+// Resolve a 1-based or negative relative OBJ index. -1 if it's out of the list
+int ResolveIndex(long index, size_t count) {
+    long resolved = index > 0 ? index - 1 : static_cast<long>(count) + index;
+    return (resolved >= 0 && resolved < static_cast<long>(count)) ? static_cast<int>(resolved) : -1;
+}
+
+bool ParseCorner(const std::string& token, size_t positions, size_t uvs, size_t normals, Corner& corner) {
+    long indices[3] = {};
+    bool present[3] = {};
+    size_t start = 0;
+    for (int i = 0; i < 3 && start <= token.size(); ++i) {
+        size_t end = token.find('/', start);
+        std::string part = token.substr(start, end == std::string::npos ? std::string::npos : end - start);
+        if (!part.empty()) {
+            indices[i] = std::strtol(part.c_str(), nullptr, 10);
+            present[i] = true;
+        }
+        if (end == std::string::npos) {
+            break;
+        }
+        start = end + 1;
+    }
+    if (!present[0]) {
+        return false;
+    }
+    int position = ResolveIndex(indices[0], positions);
+    int uv       = present[1] ? ResolveIndex(indices[1], uvs) : -1;
+    int normal   = present[2] ? ResolveIndex(indices[2], normals) : -1;
+    if (position < 0 || (present[1] && uv < 0) || (present[2] && normal < 0)) {
+        return false;
+    }
+    corner = Corner(position, uv, normal);
+    return true;
+}
+
+} // namespace
+
+AppResult LoadObj(const char* path, MeshData& mesh) {
+
+    std::ifstream file(path);
+    if (!file) {
+        PRINT_E("Failed to open OBJ file %s", path);
+        return APP_CODE_IO_FAILURE;
+    }
+
+    std::vector<float> positions;
+    std::vector<float> uvs;
+    std::vector<float> normals;
+    std::map<Corner, uint32_t> cornerVertices;
+    mesh.vertices.clear();
+    mesh.indices.clear();
+
+    std::string line;
+    std::vector<uint32_t> face;
+    size_t lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        std::istringstream stream(line);
+        std::string type;
+        stream >> type;
+
+        if (type == "v") {
+            float x = 0.0f, y = 0.0f, z = 0.0f;
+            stream >> x >> y >> z;
+            positions.insert(positions.end(), { x, y, z });
+        } else if (type == "vt") {
+            float u = 0.0f, v = 0.0f;
+            stream >> u >> v;
+            uvs.insert(uvs.end(), { u, v });
+        } else if (type == "vn") {
+            float x = 0.0f, y = 0.0f, z = 0.0f;
+            stream >> x >> y >> z;
+            normals.insert(normals.end(), { x, y, z });
+        } else if (type == "f") {
+            face.clear();
+            std::string token;
+            bool hasNormals = true;
+            while (stream >> token) {
+                Corner corner;
+                if (!ParseCorner(token, positions.size() / 3, uvs.size() / 2, normals.size() / 3, corner)) {
+                    PRINT_E("OBJ file %s has an invalid face at line %zu", path, lineNumber);
+                    return APP_CODE_IO_FAILURE;
+                }
+                hasNormals &= std::get<2>(corner) >= 0;
+                auto found = cornerVertices.find(corner);
+                if (found == cornerVertices.end()) {
+                    MeshData::Vertex vertex{};
+                    int position = std::get<0>(corner);
+                    int uv       = std::get<1>(corner);
+                    int normal   = std::get<2>(corner);
+                    for (int i = 0; i < 3; ++i) {
+                        vertex.position[i] = positions[position * 3 + i];
+                        vertex.normal[i]   = normal >= 0 ? normals[normal * 3 + i] : 0.0f;
+                    }
+                    if (uv >= 0) {
+                        vertex.uv[0] = uvs[uv * 2];
+                        vertex.uv[1] = uvs[uv * 2 + 1];
+                    }
+                    // Corners without a normal get their face's one and are never shared
+                    uint32_t index = static_cast<uint32_t>(mesh.vertices.size());
+                    mesh.vertices.push_back(vertex);
+                    if (normal >= 0) {
+                        found = cornerVertices.emplace(corner, index).first;
+                    }
+                    face.push_back(index);
+                } else {
+                    face.push_back(found->second);
+                }
+            }
+            if (face.size() < 3) {
+                PRINT_E("OBJ file %s has a face of less than 3 vertices at line %zu", path, lineNumber);
+                return APP_CODE_IO_FAILURE;
+            }
+            if (!hasNormals) {
+                const float* a = mesh.vertices[face[0]].position;
+                const float* b = mesh.vertices[face[1]].position;
+                const float* c = mesh.vertices[face[2]].position;
+                float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+                float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+                float n[3] = { ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0] };
+                float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                for (auto index : face) {
+                    auto& vertex = mesh.vertices[index];
+                    if (vertex.normal[0] == 0.0f && vertex.normal[1] == 0.0f && vertex.normal[2] == 0.0f &&
+                        length > 0.0f) {
+                        for (int i = 0; i < 3; ++i) {
+                            vertex.normal[i] = n[i] / length;
+                        }
+                    }
+                }
+            }
+            for (size_t i = 2; i < face.size(); ++i) {
+                mesh.indices.insert(mesh.indices.end(), { face[0], face[i - 1], face[i] });
+            }
+        }
+    }
+
+    if (mesh.indices.empty()) {
+        PRINT_E("OBJ file %s has no faces", path);
+        return APP_CODE_IO_FAILURE;
+    }
+    return APP_CODE_OK;
+}
+
+AppResult WriteObj(const char* path, const MeshData& mesh) {
+
+    FILE* file = std::fopen(path, "w");
+    if (!file) {
+        PRINT_E("Failed to create OBJ file %s", path);
+        return APP_CODE_IO_FAILURE;
+    }
+    for (const auto& vertex : mesh.vertices) {
+        std::fprintf(file, "v %.6f %.6f %.6f\n", vertex.position[0], vertex.position[1], vertex.position[2]);
+    }
+    for (const auto& vertex : mesh.vertices) {
+        std::fprintf(file, "vt %.6f %.6f\n", vertex.uv[0], vertex.uv[1]);
+    }
+    for (const auto& vertex : mesh.vertices) {
+        std::fprintf(file, "vn %.6f %.6f %.6f\n", vertex.normal[0], vertex.normal[1], vertex.normal[2]);
+    }
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        uint32_t a = mesh.indices[i] + 1;
+        uint32_t b = mesh.indices[i + 1] + 1;
+        uint32_t c = mesh.indices[i + 2] + 1;
+        std::fprintf(file, "f %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, b, b, b, c, c, c);
+    }
+    bool failed = std::ferror(file) != 0;
+    failed |= std::fclose(file) != 0;
+    if (failed) {
+        PRINT_E("Failed to write OBJ file %s", path);
+        return APP_CODE_IO_FAILURE;
+    }
+    return APP_CODE_OK;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <app_result.h>
+#include <scene/mesh_data.h>
+
+/**
+ * @brief
+ * Load a Wavefront OBJ mesh the straightforward way: the text is read line by line through streams
+ * and vertices are deduplicated by a map of their position, uv and normal indices.
+ * Only v, vt, vn and f statements are read, polygons are triangulated as fans.
+ * Missing uvs are zero, missing normals are the face ones
+ * @param path
+ * OBJ file path
+ * @param mesh
+ * loaded mesh
+ * @return
+ * AppResult code
+*/
+AppResult LoadObj(const char* path, MeshData& mesh);
+
+/**
+ * @brief
+ * Write a mesh to a Wavefront OBJ file with the attributes of a vertex sharing one index
+ * @param path
+ * OBJ file path
+ * @param mesh
+ * mesh to write
+ * @return
+ * AppResult code
+*/
+AppResult WriteObj(const char* path, const MeshData& mesh);
@@ -0,0 +1,240 @@
+#include <scene/occlusion_buffer.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Clip space w below which a point is treated as behind the camera
+constexpr float minClipW = 1e-5f;
+
+// Corners of the faces as indices of box corners: bit 0 is max x, bit 1 is max y, bit 2 is max z
+constexpr uint8_t faceCorners[6][4] = {
+    { 0, 2, 6, 4 }, // -X
+    { 1, 3, 7, 5 }, // +X
+    { 0, 1, 5, 4 }, // -Y
+    { 2, 3, 7, 6 }, // +Y
+    { 0, 1, 3, 2 }, // -Z
+    { 4, 5, 7, 6 }, // +Z
+};
+
+/**
+ * @brief
+ * Project corners of a box to the screen
+ * @return
+ * false if a corner is behind the near plane
+*/
+bool ProjectCorners(const glm::mat4& viewProj, const glm::vec3& min, const glm::vec3& max, float width, float height,
+                    float (&x)[8], float (&y)[8], float (&z)[8]) {
+    // Corners are the min one shifted along the box edges
+    glm::vec4 base = viewProj * glm::vec4(min, 1.0f);
+    glm::vec4 edges[3] = { viewProj[0] * (max.x - min.x), viewProj[1] * (max.y - min.y),
+                           viewProj[2] * (max.z - min.z) };
+    for (int corner = 0; corner < 8; ++corner) {
+        glm::vec4 clip = base;
+        for (int axis = 0; axis < 3; ++axis) {
+            if (corner & (1 << axis)) {
+                clip = clip + edges[axis];
+            }
+        }
+        if (clip.w < minClipW || clip.z < 0.0f) {
+            return false;
+        }
+        float invW = 1.0f / clip.w;
+        x[corner] = (clip.x * invW * 0.5f + 0.5f) * width;
+        y[corner] = (clip.y * invW * 0.5f + 0.5f) * height;
+        z[corner] = clip.z * invW;
+    }
+    return true;
+}
+
+} // namespace
+
+void OcclusionBuffer::Resize(uint32_t bufferWidth, uint32_t bufferHeight) {
+    width  = bufferWidth;
+    height = bufferHeight;
+    depth.assign(size_t(width) * height, 1.0f);
+    tilesX = (width + tileSize - 1) / tileSize;
+    tilesY = (height + tileSize - 1) / tileSize;
+    tilesMaxDepth.assign(size_t(tilesX) * tilesY, 1.0f);
+}
+
+void OcclusionBuffer::Clear() {
+    width  = 0;
+    height = 0;
+    depth.clear();
+    depth.shrink_to_fit();
+    tilesX = 0;
+    tilesY = 0;
+    tilesMaxDepth.clear();
+}
+
+bool OcclusionBuffer::ProjectBox(const glm::mat4& viewProj, const glm::vec3& eye, const glm::vec3& min,
+                                 const glm::vec3& max, ProjectedBox& box) const {
+
+    if (!ProjectCorners(viewProj, min, max, static_cast<float>(width), static_cast<float>(height),
+                        box.x, box.y, box.z)) {
+        return false;
+    }
+
+    // Only faces turned to the camera can be the nearest ones
+    box.faces = 0;
+    for (int axis = 0; axis < 3; ++axis) {
+        if (eye[axis] < min[axis]) {
+            box.faces |= 1 << (axis * 2);
+        } else if (eye[axis] > max[axis]) {
+            box.faces |= 1 << (axis * 2 + 1);
+        }
+    }
+    return box.faces != 0;
+}
+
+void OcclusionBuffer::ResetRows(uint32_t rowBegin, uint32_t rowEnd) {
+    std::fill(depth.begin() + size_t(rowBegin) * width, depth.begin() + size_t(rowEnd) * width, 1.0f);
+}
+
+void OcclusionBuffer::RasterizeBox(const ProjectedBox& box, uint32_t rowBegin, uint32_t rowEnd) {
+    for (int face = 0; face < 6; ++face) {
+        if (box.faces & (1 << face)) {
+            RasterizeQuad(box, faceCorners[face], rowBegin, rowEnd);
+        }
+    }
+}
+
+void OcclusionBuffer::UpdateTiles(uint32_t rowBegin, uint32_t rowEnd) {
+    for (uint32_t tileY = rowBegin / tileSize; tileY * tileSize < rowEnd; ++tileY) {
+        uint32_t endY = std::min((tileY + 1) * tileSize, height);
+        for (uint32_t tileX = 0; tileX < tilesX; ++tileX) {
+            uint32_t beginX = tileX * tileSize;
+            uint32_t endX   = std::min(beginX + tileSize, width);
+            float maxDepth = 0.0f;
+            for (uint32_t row = tileY * tileSize; row < endY; ++row) {
+                const float* line = depth.data() + size_t(row) * width;
+                maxDepth = std::max(maxDepth, *std::max_element(line + beginX, line + endX));
+            }
+            tilesMaxDepth[size_t(tileY) * tilesX + tileX] = maxDepth;
+        }
+    }
+}
+
+void OcclusionBuffer::RasterizeQuad(const ProjectedBox& box, const uint8_t (&corners)[4],
+                                    uint32_t rowBegin, uint32_t rowEnd) {
+
+    float x[4], y[4], z[4];
+    for (int i = 0; i < 4; ++i) {
+        x[i] = box.x[corners[i]];
+        y[i] = box.y[corners[i]];
+        z[i] = box.z[corners[i]];
+    }
+
+    float area = 0.0f;
+    for (int i = 0; i < 4; ++i) {
+        int next = (i + 1) % 4;
+        area += x[i] * y[next] - x[next] * y[i];
+    }
+    // Faces thinner than a pixel don't cover any pixel fully
+    if (std::abs(area) < 1.0f) {
+        return;
+    }
+    float orientation = area > 0.0f ? 1.0f : -1.0f;
+
+    // Depth plane of a non-degenerate half of the quad
+    int a = 0, b = 1, c = 2;
+    float triangleArea = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (std::abs(triangleArea) < std::abs(area) * 0.25f) {
+        b = 2;
+        c = 3;
+        triangleArea = (x[2] - x[0]) * (y[3] - y[0]) - (x[3] - x[0]) * (y[2] - y[0]);
+    }
+    float dzdx = ((z[b] - z[a]) * (y[c] - y[a]) - (z[c] - z[a]) * (y[b] - y[a])) / triangleArea;
+    float dzdy = ((z[c] - z[a]) * (x[b] - x[a]) - (z[b] - z[a]) * (x[c] - x[a])) / triangleArea;
+    // Farthest depth of the face within a pixel
+    float depthBias = 0.5f * (std::abs(dzdx) + std::abs(dzdy));
+
+    // Edge functions are non-negative inside. A pixel is covered fully if the function
+    // at its center exceeds the change over half of the pixel
+    float edgeDx[4], edgeDy[4], edgeBias[4];
+    for (int i = 0; i < 4; ++i) {
+        int next = (i + 1) % 4;
+        edgeDx[i]   = -(y[next] - y[i]) * orientation;
+        edgeDy[i]   =  (x[next] - x[i]) * orientation;
+        edgeBias[i] = 0.5f * (std::abs(edgeDx[i]) + std::abs(edgeDy[i]));
+    }
+
+    float minX = std::min({ x[0], x[1], x[2], x[3] });
+    float maxX = std::max({ x[0], x[1], x[2], x[3] });
+    float minY = std::min({ y[0], y[1], y[2], y[3] });
+    float maxY = std::max({ y[0], y[1], y[2], y[3] });
+    int beginX = std::max(0, static_cast<int>(std::floor(minX)));
+    int endX   = std::min(static_cast<int>(width), static_cast<int>(std::ceil(maxX)));
+    int beginY = std::max(static_cast<int>(rowBegin), static_cast<int>(std::floor(minY)));
+    int endY   = std::min(static_cast<int>(rowEnd), static_cast<int>(std::ceil(maxY)));
+    if (beginX >= endX || beginY >= endY) {
+        return;
+    }
+
+    float startX = beginX + 0.5f;
+    for (int row = beginY; row < endY; ++row) {
+        float centerY = row + 0.5f;
+        float edges[4];
+        for (int i = 0; i < 4; ++i) {
+            edges[i] = edgeDx[i] * (startX - x[i]) + edgeDy[i] * (centerY - y[i]) - edgeBias[i];
+        }
+        float pixelDepth = z[a] + dzdx * (startX - x[a]) + dzdy * (centerY - y[a]) + depthBias;
+
+        float* line = depth.data() + size_t(row) * width;
+        for (int column = beginX; column < endX; ++column) {
+            if (edges[0] >= 0.0f && edges[1] >= 0.0f && edges[2] >= 0.0f && edges[3] >= 0.0f) {
+                line[column] = std::min(line[column], pixelDepth);
+            }
+            for (int i = 0; i < 4; ++i) {
+                edges[i] += edgeDx[i];
+            }
+            pixelDepth += dzdx;
+        }
+    }
+}
+
+bool OcclusionBuffer::IsBoxVisible(const glm::mat4& viewProj, const glm::vec3& min, const glm::vec3& max) const {
+
+    float x[8], y[8], z[8];
+    if (!ProjectCorners(viewProj, min, max, static_cast<float>(width), static_cast<float>(height), x, y, z)) {
+        // Crosses the near plane
+        return true;
+    }
+    float minX = *std::min_element(x, x + 8);
+    float maxX = *std::max_element(x, x + 8);
+    float minY = *std::min_element(y, y + 8);
+    float maxY = *std::max_element(y, y + 8);
+    float minZ = *std::min_element(z, z + 8);
+
+    // Every pixel the box touches
+    int beginX = std::max(0, static_cast<int>(std::floor(minX)));
+    int endX   = std::min(static_cast<int>(width), static_cast<int>(std::floor(maxX)) + 1);
+    int beginY = std::max(0, static_cast<int>(std::floor(minY)));
+    int endY   = std::min(static_cast<int>(height), static_cast<int>(std::floor(maxY)) + 1);
+    if (beginX >= endX || beginY >= endY) {
+        return true;
+    }
+
+    int size = static_cast<int>(tileSize);
+    for (int tileY = beginY / size; tileY * size < endY; ++tileY) {
+        for (int tileX = beginX / size; tileX * size < endX; ++tileX) {
+            if (tilesMaxDepth[size_t(tileY) * tilesX + tileX] < minZ) {
+                // Every pixel of the tile hides the box
+                continue;
+            }
+            int rowEnd    = std::min(endY, (tileY + 1) * size);
+            int columnEnd = std::min(endX, (tileX + 1) * size);
+            for (int row = std::max(beginY, tileY * size); row < rowEnd; ++row) {
+                const float* line = depth.data() + size_t(row) * width;
+                for (int column = std::max(beginX, tileX * size); column < columnEnd; ++column) {
+                    if (line[column] >= minZ) {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+    return false;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief
+ * Low resolution software depth buffer for occlusion culling. Occluder boxes are rasterized
+ * conservatively: only pixels fully covered by a face get its farthest depth within the pixel,
+ * so an occludee is never reported hidden while a part of it may be seen.
+ * Depth range is [0, 1] with 0 at the near plane. Rows are independent, so bands of rows
+ * may be reset and rasterized by different threads. Max depth of pixel tiles lets tests skip
+ * the tiles fully hidden by the occluders
+*/
+class OcclusionBuffer {
+
+public:
+
+    // Screen space corners of a box and its faces turned to the camera
+    struct ProjectedBox {
+        float x[8];
+        float y[8];
+        float z[8];
+        // Bit per face: -X, +X, -Y, +Y, -Z, +Z
+        uint8_t faces;
+    };
+
+    // Bands of rows passed to the methods start at multiples of the tile size
+    static constexpr uint32_t tileSize = 8;
+
+    OcclusionBuffer() = default;
+
+    void Resize(uint32_t bufferWidth, uint32_t bufferHeight);
+    void Clear();
+
+    /**
+     * @brief
+     * Project an occluder box
+     * @param viewProj
+     * view-projection matrix
+     * @param eye
+     * camera position to skip faces turned away
+     * @param min
+     * world space min corner
+     * @param max
+     * world space max corner
+     * @param box
+     * projected box
+     * @return
+     * false if the box crosses the near plane and can't be an occluder
+    */
+    bool ProjectBox(const glm::mat4& viewProj, const glm::vec3& eye, const glm::vec3& min, const glm::vec3& max,
+                    ProjectedBox& box) const;
+
+    // Fill the rows [rowBegin, rowEnd) with the far depth
+    void ResetRows(uint32_t rowBegin, uint32_t rowEnd);
+    // Rasterize the box faces into the rows [rowBegin, rowEnd)
+    void RasterizeBox(const ProjectedBox& box, uint32_t rowBegin, uint32_t rowEnd);
+    // Update max depth of the tiles in the rows [rowBegin, rowEnd) after rasterization
+    void UpdateTiles(uint32_t rowBegin, uint32_t rowEnd);
+
+    /**
+     * @brief
+     * Test a box against the rasterized occluders. Thread safe while the buffer isn't written
+     * @return
+     * false if the box is hidden behind the occluders
+    */
+    bool IsBoxVisible(const glm::mat4& viewProj, const glm::vec3& min, const glm::vec3& max) const;
+
+    uint32_t GetWidth() const { return width; }
+    uint32_t GetHeight() const { return height; }
+    const float* GetDepth() const { return depth.data(); }
+
+private:
+
+    // Rasterize a convex planar quad of the box corners
+    void RasterizeQuad(const ProjectedBox& box, const uint8_t (&corners)[4], uint32_t rowBegin, uint32_t rowEnd);
+
+private:
+
+    uint32_t width  = 0;
+    uint32_t height = 0;
+    std::vector<float> depth;
+    uint32_t tilesX = 0;
+    uint32_t tilesY = 0;
+    std::vector<float> tilesMaxDepth;
+};
@@ -0,0 +1,162 @@
+#include <scene/scene_benchmark.h>
+
+#include <logs.h>
+#include <scene/scene_transforms.h>
+#include <utils/bench_stats.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+
+// Children of a node in the benchmark tree
+constexpr uint32_t treeFanout = 8;
+// Allowed difference relative to the magnitude of a value
+constexpr float maxRelativeError = 1e-4f;
+
+// Node of the naive AoS update
+struct NaiveNode {
+    glm::vec3 position;
+    glm::quat rotation;
+    glm::vec3 scale;
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+    uint32_t parent;
+    glm::mat4 world;
+    glm::vec3 worldMin;
+    glm::vec3 worldMax;
+};
+
+void BuildNaiveScene(uint32_t nodesCount, std::vector<NaiveNode>& nodes) {
+
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> scale(0.8f, 1.2f);
+
+    nodes.resize(nodesCount);
+    for (uint32_t i = 0; i < nodesCount; ++i) {
+        auto& node = nodes[i];
+        node.parent = i ? (i - 1) / treeFanout : SceneTransforms::invalidNode;
+        node.position = glm::vec3(unit(random), unit(random), unit(random)) * 4.0f;
+        glm::vec3 axis(unit(random), unit(random), unit(random) + 2.0f);
+        node.rotation = glm::angleAxis(unit(random) * 3.14159265f, glm::normalize(axis));
+        node.scale = glm::vec3(scale(random), scale(random), scale(random));
+        glm::vec3 center(unit(random), unit(random), unit(random));
+        glm::vec3 extent(scale(random), scale(random), scale(random));
+        node.boundsMin = center - extent;
+        node.boundsMax = center + extent;
+    }
+}
+
+// Straightforward glm code the kernels are compared with. Parents precede children in the tree
+void UpdateNaive(std::vector<NaiveNode>& nodes) {
+    for (auto& node : nodes) {
+        glm::mat4 local = glm::translate(glm::mat4(1.0f), node.position) * glm::mat4_cast(node.rotation) *
+                          glm::scale(glm::mat4(1.0f), node.scale);
+        node.world = node.parent == SceneTransforms::invalidNode ? local : nodes[node.parent].world * local;
+
+        node.worldMin = glm::vec3(INFINITY);
+        node.worldMax = glm::vec3(-INFINITY);
+        for (int corner = 0; corner < 8; ++corner) {
+            glm::vec4 point(corner & 1 ? node.boundsMax.x : node.boundsMin.x,
+                            corner & 2 ? node.boundsMax.y : node.boundsMin.y,
+                            corner & 4 ? node.boundsMax.z : node.boundsMin.z, 1.0f);
+            point = node.world * point;
+            for (int i = 0; i < 3; ++i) {
+                node.worldMin[i] = std::min(node.worldMin[i], point[i]);
+                node.worldMax[i] = std::max(node.worldMax[i], point[i]);
+            }
+        }
+    }
+}
+
+bool IsClose(float value, float reference) {
+    return std::abs(value - reference) <= maxRelativeError * std::max(1.0f, std::abs(reference));
+}
+
+// Compare the SceneTransforms results with the naive ones
+bool Verify(const SceneTransforms& transforms, const std::vector<NaiveNode>& nodes) {
+    for (uint32_t i = 0; i < nodes.size(); ++i) {
+        glm::mat4 world = transforms.GetWorld(i);
+        glm::vec3 min, max;
+        transforms.GetWorldBounds(i, min, max);
+        for (int column = 0; column < 4; ++column) {
+            for (int row = 0; row < 4; ++row) {
+                if (!IsClose(world[column][row], nodes[i].world[column][row])) {
+                    PRINT_E("Node %u world matrix [%d][%d] is %f, expected %f",
+                            i, column, row, world[column][row], nodes[i].world[column][row]);
+                    return false;
+                }
+            }
+        }
+        for (int axis = 0; axis < 3; ++axis) {
+            if (!IsClose(min[axis], nodes[i].worldMin[axis]) || !IsClose(max[axis], nodes[i].worldMax[axis])) {
+                PRINT_E("Node %u world bounds differ along axis %d", i, axis);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+template<typename Func>
+double MeasureMedian(Func&& func) {
+    std::vector<double> times;
+    for (int i = 0; i < benchIterations; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        func();
+        times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return Median(times);
+}
+
+} // namespace
+
+AppResult RunSceneBenchmark(uint32_t nodesCount) {
+
+    std::vector<NaiveNode> nodes;
+    BuildNaiveScene(nodesCount, nodes);
+
+    SceneTransforms transforms;
+    transforms.Reserve(nodesCount);
+    for (const auto& node : nodes) {
+        auto id = transforms.AddNode(node.parent);
+        transforms.SetPosition(id, node.position);
+        transforms.SetRotation(id, node.rotation);
+        transforms.SetScale(id, node.scale);
+        transforms.SetLocalBounds(id, node.boundsMin, node.boundsMax);
+    }
+
+    double naiveTime = MeasureMedian([&nodes]() { UpdateNaive(nodes); });
+    PRINT("Scene benchmark: %u nodes, %u levels. Naive glm update %.3f ms",
+          nodesCount, transforms.GetLevelsCount(), naiveTime);
+
+    bool matched = true;
+    for (auto kernels : { SceneTransforms::Kernels::Scalar, SceneTransforms::Kernels::Sse,
+                          SceneTransforms::Kernels::Avx2 }) {
+        if (!transforms.SetKernels(kernels)) {
+            continue;
+        }
+
+        // Phases of the last iteration
+        SceneTransforms::Timings phases;
+        double time = MeasureMedian([&transforms, &phases]() {
+            transforms.Update();
+            phases = transforms.GetTimings();
+        });
+        if (!Verify(transforms, nodes)) {
+            PRINT_E("Scene kernels \"%s\" don't match the naive update", transforms.GetKernelsName());
+            matched = false;
+            continue;
+        }
+        PRINT("  %-6s %8.3f ms (x%.2f): compose %.3f ms, multiply %.3f ms, bounds %.3f ms",
+              transforms.GetKernelsName(), time, naiveTime / time, phases.compose, phases.multiply, phases.bounds);
+    }
+
+    return matched ? APP_CODE_OK : APP_CODE_UNKNOWN;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <app_result.h>
+
+#include <cstdint>
+
+/**
+ * @brief
+ * Benchmark the SceneTransforms kernels against the naive per-node glm::mat4 update. Builds a tree of
+ * random transforms, runs every kernel set supported by CPU, checks its results and prints the timings
+ * @param nodesCount
+ * count of scene nodes
+ * @return
+ * AppResult code. APP_CODE_UNKNOWN if some kernels don't match the reference
+*/
+AppResult RunSceneBenchmark(uint32_t nodesCount);
@@ -0,0 +1,288 @@
+#include <scene/scene_transforms.h>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+double MsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// CPU and OS support AVX2 and FMA
+bool IsAvx2Supported() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int info[4];
+    __cpuid(info, 1);
+    bool fma     = (info[2] & (1 << 12)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    if (!fma || !osxsave || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    // Checks the OS support of AVX state too
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+    return false;
+#endif
+}
+
+} // namespace
+
+SceneTransforms::SceneTransforms() {
+    SetKernels(Kernels::Best);
+}
+
+const TransformKernels* SceneTransforms::FindKernels(Kernels kernels) {
+    switch (kernels) {
+    case Kernels::Scalar:
+        return &GetScalarTransformKernels();
+    case Kernels::Sse:
+        return GetSseTransformKernels();
+    case Kernels::Avx2:
+        return IsAvx2Supported() ? GetAvx2TransformKernels() : nullptr;
+    case Kernels::Best:
+        if (auto found = FindKernels(Kernels::Avx2)) {
+            return found;
+        }
+        if (auto found = FindKernels(Kernels::Sse)) {
+            return found;
+        }
+        return FindKernels(Kernels::Scalar);
+    default:
+        return nullptr;
+    }
+}
+
+bool SceneTransforms::IsSupported(Kernels kernels) {
+    return FindKernels(kernels) != nullptr;
+}
+
+bool SceneTransforms::SetKernels(Kernels kernels) {
+    auto found = FindKernels(kernels);
+    if (!found) {
+        return false;
+    }
+    kernelSet = found;
+    return true;
+}
+
+SceneTransforms::NodeId SceneTransforms::AddNode(NodeId parent) {
+
+    NodeId node = static_cast<NodeId>(slotOfNode.size());
+    uint32_t slot = static_cast<uint32_t>(parents.size());
+    uint32_t parentSlot = parent == invalidNode ? ~0u : slotOfNode[parent];
+    uint32_t depth = parent == invalidNode ? 0 : depths[parentSlot] + 1;
+
+    // Appending keeps the order while the depth doesn't decrease
+    if (!layoutDirty) {
+        if (!depths.empty() && depth < depths.back()) {
+            layoutDirty = true;
+        } else if (depth >= levelStarts.size()) {
+            levelStarts.push_back(slot);
+        }
+    }
+
+    slotOfNode.push_back(slot);
+    nodeOfSlot.push_back(node);
+    parents.push_back(parentSlot);
+    depths.push_back(depth);
+
+    positionsX.push_back(0.0f);
+    positionsY.push_back(0.0f);
+    positionsZ.push_back(0.0f);
+    rotationsX.push_back(0.0f);
+    rotationsY.push_back(0.0f);
+    rotationsZ.push_back(0.0f);
+    rotationsW.push_back(1.0f);
+    scalesX.push_back(1.0f);
+    scalesY.push_back(1.0f);
+    scalesZ.push_back(1.0f);
+
+    locals.resize(locals.size() + 16);
+    worlds.resize(worlds.size() + 16);
+    boundsCenters.resize(boundsCenters.size() + 4);
+    boundsExtents.resize(boundsExtents.size() + 4);
+    worldMins.resize(worldMins.size() + 4);
+    worldMaxs.resize(worldMaxs.size() + 4);
+
+    return node;
+}
+
+void SceneTransforms::Reserve(size_t count) {
+    for (auto array : { &positionsX, &positionsY, &positionsZ, &rotationsX, &rotationsY, &rotationsZ, &rotationsW,
+                        &scalesX, &scalesY, &scalesZ }) {
+        array->reserve(count);
+    }
+    parents.reserve(count);
+    depths.reserve(count);
+    slotOfNode.reserve(count);
+    nodeOfSlot.reserve(count);
+    locals.reserve(count * 16);
+    worlds.reserve(count * 16);
+    for (auto array : { &boundsCenters, &boundsExtents, &worldMins, &worldMaxs }) {
+        array->reserve(count * 4);
+    }
+}
+
+void SceneTransforms::Clear() {
+    for (auto array : { &positionsX, &positionsY, &positionsZ, &rotationsX, &rotationsY, &rotationsZ, &rotationsW,
+                        &scalesX, &scalesY, &scalesZ, &locals, &worlds,
+                        &boundsCenters, &boundsExtents, &worldMins, &worldMaxs }) {
+        array->clear();
+    }
+    parents.clear();
+    depths.clear();
+    slotOfNode.clear();
+    nodeOfSlot.clear();
+    levelStarts.clear();
+    layoutDirty = false;
+    timings = {};
+}
+
+void SceneTransforms::SetPosition(NodeId node, const glm::vec3& position) {
+    uint32_t slot = slotOfNode[node];
+    positionsX[slot] = position.x;
+    positionsY[slot] = position.y;
+    positionsZ[slot] = position.z;
+}
+
+void SceneTransforms::SetRotation(NodeId node, const glm::quat& rotation) {
+    uint32_t slot = slotOfNode[node];
+    rotationsX[slot] = rotation.x;
+    rotationsY[slot] = rotation.y;
+    rotationsZ[slot] = rotation.z;
+    rotationsW[slot] = rotation.w;
+}
+
+void SceneTransforms::SetScale(NodeId node, const glm::vec3& scale) {
+    uint32_t slot = slotOfNode[node];
+    scalesX[slot] = scale.x;
+    scalesY[slot] = scale.y;
+    scalesZ[slot] = scale.z;
+}
+
+void SceneTransforms::SetLocalBounds(NodeId node, const glm::vec3& min, const glm::vec3& max) {
+    size_t slot = slotOfNode[node];
+    // Kernels need center and half size
+    for (int i = 0; i < 3; ++i) {
+        boundsCenters[slot * 4 + i] = (min[i] + max[i]) * 0.5f;
+        boundsExtents[slot * 4 + i] = (max[i] - min[i]) * 0.5f;
+    }
+}
+
+void SceneTransforms::Relayout() {
+
+    size_t count = parents.size();
+    uint32_t levelsCount = depths.empty() ? 0 : *std::max_element(depths.begin(), depths.end()) + 1;
+
+    // Stable counting sort by the depth
+    levelStarts.assign(levelsCount, 0);
+    std::vector<size_t> next(levelsCount + 1, 0);
+    for (auto depth : depths) {
+        ++next[depth + 1];
+    }
+    for (uint32_t level = 0; level < levelsCount; ++level) {
+        next[level + 1] += next[level];
+        levelStarts[level] = next[level];
+    }
+    std::vector<uint32_t> newSlots(count);
+    for (size_t slot = 0; slot < count; ++slot) {
+        newSlots[slot] = static_cast<uint32_t>(next[depths[slot]]++);
+    }
+
+    auto permute = [&newSlots, count](auto& array, size_t stride) {
+        auto sorted = array;
+        for (size_t slot = 0; slot < count; ++slot) {
+            std::copy_n(array.begin() + slot * stride, stride, sorted.begin() + size_t(newSlots[slot]) * stride);
+        }
+        array.swap(sorted);
+    };
+    for (auto array : { &positionsX, &positionsY, &positionsZ, &rotationsX, &rotationsY, &rotationsZ, &rotationsW,
+                        &scalesX, &scalesY, &scalesZ }) {
+        permute(*array, 1);
+    }
+    permute(boundsCenters, 4);
+    permute(boundsExtents, 4);
+    permute(depths, 1);
+    permute(nodeOfSlot, 1);
+    permute(parents, 1);
+    for (auto& parent : parents) {
+        if (parent != ~0u) {
+            parent = newSlots[parent];
+        }
+    }
+    for (size_t slot = 0; slot < count; ++slot) {
+        slotOfNode[nodeOfSlot[slot]] = static_cast<uint32_t>(slot);
+    }
+
+    layoutDirty = false;
+}
+
+TransformArrays SceneTransforms::GetArrays() {
+    TransformArrays arrays{};
+    arrays.positionsX    = positionsX.data();
+    arrays.positionsY    = positionsY.data();
+    arrays.positionsZ    = positionsZ.data();
+    arrays.rotationsX    = rotationsX.data();
+    arrays.rotationsY    = rotationsY.data();
+    arrays.rotationsZ    = rotationsZ.data();
+    arrays.rotationsW    = rotationsW.data();
+    arrays.scalesX       = scalesX.data();
+    arrays.scalesY       = scalesY.data();
+    arrays.scalesZ       = scalesZ.data();
+    arrays.parents       = parents.data();
+    arrays.locals        = locals.data();
+    arrays.worlds        = worlds.data();
+    arrays.boundsCenters = boundsCenters.data();
+    arrays.boundsExtents = boundsExtents.data();
+    arrays.worldMins     = worldMins.data();
+    arrays.worldMaxs     = worldMaxs.data();
+    return arrays;
+}
+
+void SceneTransforms::Update() {
+
+    if (layoutDirty) {
+        Relayout();
+    }
+
+    size_t count = parents.size();
+    TransformArrays arrays = GetArrays();
+
+    // Local matrices and bounds don't depend on the hierarchy and go in one batch
+    auto start = std::chrono::steady_clock::now();
+    kernelSet->compose(arrays, 0, count);
+    timings.compose = MsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    for (size_t level = 0; level < levelStarts.size(); ++level) {
+        size_t end = level + 1 < levelStarts.size() ? levelStarts[level + 1] : count;
+        kernelSet->multiply(arrays, levelStarts[level], end);
+    }
+    timings.multiply = MsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    kernelSet->transformBounds(arrays, 0, count);
+    timings.bounds = MsSince(start);
+}
+
+glm::mat4 SceneTransforms::GetWorld(NodeId node) const {
+    glm::mat4 world;
+    std::memcpy(&world[0][0], &worlds[size_t(slotOfNode[node]) * 16], 16 * sizeof(float));
+    return world;
+}
+
+void SceneTransforms::GetWorldBounds(NodeId node, glm::vec3& min, glm::vec3& max) const {
+    size_t slot = slotOfNode[node];
+    min = glm::vec3(worldMins[slot * 4], worldMins[slot * 4 + 1], worldMins[slot * 4 + 2]);
+    max = glm::vec3(worldMaxs[slot * 4], worldMaxs[slot * 4 + 1], worldMaxs[slot * 4 + 2]);
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <scene/transform_kernels.h>
+
+#include <glm/gtc/quaternion.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief
+ * Transform hierarchy of scene nodes kept in SoA arrays. Nodes are stored ordered by the depth,
+ * so the update goes level by level over contiguous ranges and parents are always updated before
+ * their children. Local TRS, world matrices and world AABBs are computed by batched SIMD kernels:
+ * AVX2 if CPU supports it, SSE or the scalar fallback otherwise
+*/
+class SceneTransforms {
+
+public:
+
+    typedef uint32_t NodeId;
+    static constexpr NodeId invalidNode = ~0u;
+
+    enum class Kernels {
+        Scalar,
+        Sse,
+        Avx2,
+        // The fastest supported by CPU
+        Best,
+    };
+
+    SceneTransforms();
+
+    /**
+     * @brief
+     * Add a node with identity transform and empty bounds
+     * @param parent
+     * existing node or invalidNode for a root
+     * @return
+     * id of the node
+    */
+    NodeId AddNode(NodeId parent = invalidNode);
+    void Reserve(size_t count);
+    void Clear();
+
+    void SetPosition(NodeId node, const glm::vec3& position);
+    void SetRotation(NodeId node, const glm::quat& rotation);
+    void SetScale(NodeId node, const glm::vec3& scale);
+    // Bounds in the node space
+    void SetLocalBounds(NodeId node, const glm::vec3& min, const glm::vec3& max);
+
+    // Update world matrices and bounds of all the nodes
+    void Update();
+
+    glm::mat4 GetWorld(NodeId node) const;
+    void GetWorldBounds(NodeId node, glm::vec3& min, glm::vec3& max) const;
+
+    /**
+     * @brief
+     * Choose the kernels
+     * @param kernels
+     * kernels to use
+     * @return
+     * false if the kernels aren't supported by the build or CPU. Previous ones are kept then
+    */
+    bool SetKernels(Kernels kernels);
+    const char* GetKernelsName() const { return kernelSet->name; }
+    static bool IsSupported(Kernels kernels);
+
+    size_t GetNodesCount() const { return parents.size(); }
+    uint32_t GetLevelsCount() const { return static_cast<uint32_t>(levelStarts.size()); }
+
+    // Time of the last Update phases, ms
+    struct Timings {
+        double compose   = 0.0;
+        double multiply  = 0.0;
+        double bounds    = 0.0;
+    };
+    const Timings& GetTimings() const { return timings; }
+
+private:
+
+    static const TransformKernels* FindKernels(Kernels kernels);
+
+    // Sort the slots by the depth after nodes were added
+    void Relayout();
+    TransformArrays GetArrays();
+
+private:
+
+    // Slots ordered by the depth
+    std::vector<float> positionsX, positionsY, positionsZ;
+    std::vector<float> rotationsX, rotationsY, rotationsZ, rotationsW;
+    std::vector<float> scalesX, scalesY, scalesZ;
+    std::vector<uint32_t> parents;
+    std::vector<uint32_t> depths;
+    // 16 floats per slot
+    std::vector<float> locals;
+    std::vector<float> worlds;
+    // 4 floats per slot
+    std::vector<float> boundsCenters;
+    std::vector<float> boundsExtents;
+    std::vector<float> worldMins;
+    std::vector<float> worldMaxs;
+
+    // First slot of every level
+    std::vector<size_t> levelStarts;
+    std::vector<uint32_t> slotOfNode;
+    std::vector<NodeId> nodeOfSlot;
+    bool layoutDirty = false;
+
+    const TransformKernels* kernelSet = nullptr;
+    Timings timings;
+};
@@ -0,0 +1,201 @@
+#include <scene/transform_kernels.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRANSFORM_KERNELS_SSE 1
+#include <xmmintrin.h>
+#else
+#define TRANSFORM_KERNELS_SSE 0
+#endif
+
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+constexpr uint32_t noParent = ~0u;
+
+void ComposeScalar(const TransformArrays& a, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+        float x = a.rotationsX[i], y = a.rotationsY[i], z = a.rotationsZ[i], w = a.rotationsW[i];
+        float xx = x * x, yy = y * y, zz = z * z;
+        float xy = x * y, xz = x * z, yz = y * z;
+        float wx = w * x, wy = w * y, wz = w * z;
+        float sx = a.scalesX[i], sy = a.scalesY[i], sz = a.scalesZ[i];
+
+        float* m = a.locals + i * 16;
+        m[0]  = (1.0f - 2.0f * (yy + zz)) * sx;
+        m[1]  = 2.0f * (xy + wz) * sx;
+        m[2]  = 2.0f * (xz - wy) * sx;
+        m[3]  = 0.0f;
+        m[4]  = 2.0f * (xy - wz) * sy;
+        m[5]  = (1.0f - 2.0f * (xx + zz)) * sy;
+        m[6]  = 2.0f * (yz + wx) * sy;
+        m[7]  = 0.0f;
+        m[8]  = 2.0f * (xz + wy) * sz;
+        m[9]  = 2.0f * (yz - wx) * sz;
+        m[10] = (1.0f - 2.0f * (xx + yy)) * sz;
+        m[11] = 0.0f;
+        m[12] = a.positionsX[i];
+        m[13] = a.positionsY[i];
+        m[14] = a.positionsZ[i];
+        m[15] = 1.0f;
+    }
+}
+
+void MultiplyScalar(const TransformArrays& a, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+        const float* l = a.locals + i * 16;
+        float* r = a.worlds + i * 16;
+        if (a.parents[i] == noParent) {
+            std::memcpy(r, l, 16 * sizeof(float));
+            continue;
+        }
+        const float* p = a.worlds + size_t(a.parents[i]) * 16;
+        for (int col = 0; col < 4; ++col) {
+            for (int row = 0; row < 4; ++row) {
+                r[col * 4 + row] = p[row] * l[col * 4] + p[4 + row] * l[col * 4 + 1] +
+                                   p[8 + row] * l[col * 4 + 2] + p[12 + row] * l[col * 4 + 3];
+            }
+        }
+    }
+}
+
+void TransformBoundsScalar(const TransformArrays& a, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+        const float* m = a.worlds + i * 16;
+        const float* c = a.boundsCenters + i * 4;
+        const float* e = a.boundsExtents + i * 4;
+        for (int row = 0; row < 3; ++row) {
+            // Arvo's method: extent of the rotated box is the sum of the absolute axes
+            float center = m[row] * c[0] + m[4 + row] * c[1] + m[8 + row] * c[2] + m[12 + row];
+            float extent = std::fabs(m[row]) * e[0] + std::fabs(m[4 + row]) * e[1] + std::fabs(m[8 + row]) * e[2];
+            a.worldMins[i * 4 + row] = center - extent;
+            a.worldMaxs[i * 4 + row] = center + extent;
+        }
+        a.worldMins[i * 4 + 3] = 1.0f;
+        a.worldMaxs[i * 4 + 3] = 1.0f;
+    }
+}
+
+#if TRANSFORM_KERNELS_SSE
+
+// Broadcast a lane
+#define TRANSFORM_SPLAT(v, lane) _mm_shuffle_ps(v, v, _MM_SHUFFLE(lane, lane, lane, lane))
+
+// Write a column of 4 matrices given as SoA components
+inline void StoreColumns(float* matrices, size_t column, __m128 x, __m128 y, __m128 z, __m128 w) {
+    _MM_TRANSPOSE4_PS(x, y, z, w);
+    _mm_storeu_ps(matrices + column * 4, x);
+    _mm_storeu_ps(matrices + 16 + column * 4, y);
+    _mm_storeu_ps(matrices + 32 + column * 4, z);
+    _mm_storeu_ps(matrices + 48 + column * 4, w);
+}
+
+// 4 nodes at a time straight from the SoA arrays
+void ComposeSse(const TransformArrays& a, size_t begin, size_t end) {
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 zero = _mm_setzero_ps();
+
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m128 x = _mm_loadu_ps(a.rotationsX + i);
+        __m128 y = _mm_loadu_ps(a.rotationsY + i);
+        __m128 z = _mm_loadu_ps(a.rotationsZ + i);
+        __m128 w = _mm_loadu_ps(a.rotationsW + i);
+        __m128 sx = _mm_loadu_ps(a.scalesX + i);
+        __m128 sy = _mm_loadu_ps(a.scalesY + i);
+        __m128 sz = _mm_loadu_ps(a.scalesZ + i);
+
+        __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+        __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+        __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+        float* m = a.locals + i * 16;
+        StoreColumns(m, 0,
+                     _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx),
+                     _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx),
+                     _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx),
+                     zero);
+        StoreColumns(m, 1,
+                     _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy),
+                     _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy),
+                     _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy),
+                     zero);
+        StoreColumns(m, 2,
+                     _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz),
+                     _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz),
+                     _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz),
+                     zero);
+        StoreColumns(m, 3, _mm_loadu_ps(a.positionsX + i), _mm_loadu_ps(a.positionsY + i),
+                     _mm_loadu_ps(a.positionsZ + i), one);
+    }
+    ComposeScalar(a, i, end);
+}
+
+void MultiplySse(const TransformArrays& a, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+        const float* l = a.locals + i * 16;
+        float* r = a.worlds + i * 16;
+        if (a.parents[i] == noParent) {
+            std::memcpy(r, l, 16 * sizeof(float));
+            continue;
+        }
+        const float* p = a.worlds + size_t(a.parents[i]) * 16;
+        __m128 p0 = _mm_loadu_ps(p);
+        __m128 p1 = _mm_loadu_ps(p + 4);
+        __m128 p2 = _mm_loadu_ps(p + 8);
+        __m128 p3 = _mm_loadu_ps(p + 12);
+        for (int col = 0; col < 4; ++col) {
+            __m128 lc = _mm_loadu_ps(l + col * 4);
+            __m128 result = _mm_mul_ps(p0, TRANSFORM_SPLAT(lc, 0));
+            result = _mm_add_ps(result, _mm_mul_ps(p1, TRANSFORM_SPLAT(lc, 1)));
+            result = _mm_add_ps(result, _mm_mul_ps(p2, TRANSFORM_SPLAT(lc, 2)));
+            result = _mm_add_ps(result, _mm_mul_ps(p3, TRANSFORM_SPLAT(lc, 3)));
+            _mm_storeu_ps(r + col * 4, result);
+        }
+    }
+}
+
+void TransformBoundsSse(const TransformArrays& a, size_t begin, size_t end) {
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    for (size_t i = begin; i < end; ++i) {
+        const float* m = a.worlds + i * 16;
+        __m128 m0 = _mm_loadu_ps(m);
+        __m128 m1 = _mm_loadu_ps(m + 4);
+        __m128 m2 = _mm_loadu_ps(m + 8);
+        __m128 m3 = _mm_loadu_ps(m + 12);
+        __m128 c = _mm_loadu_ps(a.boundsCenters + i * 4);
+        __m128 e = _mm_loadu_ps(a.boundsExtents + i * 4);
+
+        __m128 center = _mm_add_ps(m3, _mm_mul_ps(m0, TRANSFORM_SPLAT(c, 0)));
+        center = _mm_add_ps(center, _mm_mul_ps(m1, TRANSFORM_SPLAT(c, 1)));
+        center = _mm_add_ps(center, _mm_mul_ps(m2, TRANSFORM_SPLAT(c, 2)));
+
+        __m128 extent = _mm_mul_ps(_mm_andnot_ps(signMask, m0), TRANSFORM_SPLAT(e, 0));
+        extent = _mm_add_ps(extent, _mm_mul_ps(_mm_andnot_ps(signMask, m1), TRANSFORM_SPLAT(e, 1)));
+        extent = _mm_add_ps(extent, _mm_mul_ps(_mm_andnot_ps(signMask, m2), TRANSFORM_SPLAT(e, 2)));
+
+        // w of an affine matrix columns is 0 except the translation one, so w of the results is 1 +- 0
+        _mm_storeu_ps(a.worldMins + i * 4, _mm_sub_ps(center, extent));
+        _mm_storeu_ps(a.worldMaxs + i * 4, _mm_add_ps(center, extent));
+    }
+}
+
+#endif
+
+} // namespace
+
+const TransformKernels& GetScalarTransformKernels() {
+    static const TransformKernels kernels = { "scalar", ComposeScalar, MultiplyScalar, TransformBoundsScalar };
+    return kernels;
+}
+
+const TransformKernels* GetSseTransformKernels() {
+#if TRANSFORM_KERNELS_SSE
+    static const TransformKernels kernels = { "sse", ComposeSse, MultiplySse, TransformBoundsSse };
+    return &kernels;
+#else
+    return nullptr;
+#endif
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Kernels of SceneTransforms. The header is shared with the AVX2 translation unit compiled with other
+// instruction set flags, so it must not pull inline code like GLM or STL: the linker could pick
+// the AVX2 copy of an inline function for the whole program
+
+// Raw views of the SceneTransforms arrays. Matrices are column major, 16 floats per node,
+// bounds are 4 floats per node with unused w
+struct TransformArrays {
+    const float* positionsX;
+    const float* positionsY;
+    const float* positionsZ;
+    const float* rotationsX;
+    const float* rotationsY;
+    const float* rotationsZ;
+    const float* rotationsW;
+    const float* scalesX;
+    const float* scalesY;
+    const float* scalesZ;
+    // Slot of the parent or ~0u for roots. Parents precede their children
+    const uint32_t* parents;
+    float* locals;
+    float* worlds;
+    const float* boundsCenters;
+    const float* boundsExtents;
+    float* worldMins;
+    float* worldMaxs;
+};
+
+// Kernels process the slots [begin, end). Parents of the range must be updated before
+struct TransformKernels {
+    const char* name;
+    // Local matrices from positions, rotations and scales: T * R * S
+    void (*compose)(const TransformArrays& arrays, size_t begin, size_t end);
+    // World matrices: parent world * local
+    void (*multiply)(const TransformArrays& arrays, size_t begin, size_t end);
+    // World AABBs of the local ones
+    void (*transformBounds)(const TransformArrays& arrays, size_t begin, size_t end);
+};
+
+const TransformKernels& GetScalarTransformKernels();
+// nullptr if the build has no SSE
+const TransformKernels* GetSseTransformKernels();
+// nullptr if the build has no AVX2 kernels. CPU support is checked by the caller
+const TransformKernels* GetAvx2TransformKernels();
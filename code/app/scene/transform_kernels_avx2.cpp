@@ -0,0 +1,163 @@
+// Compiled with AVX2 and FMA enabled. Used only if CPU supports them, see SceneTransforms.
+// Must include nothing with inline functions besides the intrinsics, see transform_kernels.h
+
+#include <scene/transform_kernels.h>
+
+#if defined(__AVX2__)
+
+#include <immintrin.h>
+
+namespace {
+
+constexpr uint32_t noParent = ~0u;
+
+// Broadcast a lane within both 128-bit halves
+#define TRANSFORM_SPLAT(v, lane) _mm256_shuffle_ps(v, v, _MM_SHUFFLE(lane, lane, lane, lane))
+
+// Two unaligned 128-bit loads into one register
+inline __m256 Load2(const float* low, const float* high) {
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(low)), _mm_loadu_ps(high), 1);
+}
+
+// Write a column of 8 matrices given as SoA components
+inline void StoreColumns(float* matrices, size_t column, __m256 x, __m256 y, __m256 z, __m256 w) {
+    __m256 xy0 = _mm256_unpacklo_ps(x, y);
+    __m256 xy1 = _mm256_unpackhi_ps(x, y);
+    __m256 zw0 = _mm256_unpacklo_ps(z, w);
+    __m256 zw1 = _mm256_unpackhi_ps(z, w);
+    // Lanes hold columns of the nodes k and k + 4
+    __m256 c0 = _mm256_shuffle_ps(xy0, zw0, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 c1 = _mm256_shuffle_ps(xy0, zw0, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 c2 = _mm256_shuffle_ps(xy1, zw1, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 c3 = _mm256_shuffle_ps(xy1, zw1, _MM_SHUFFLE(3, 2, 3, 2));
+
+    float* m = matrices + column * 4;
+    _mm_storeu_ps(m,       _mm256_castps256_ps128(c0));
+    _mm_storeu_ps(m + 16,  _mm256_castps256_ps128(c1));
+    _mm_storeu_ps(m + 32,  _mm256_castps256_ps128(c2));
+    _mm_storeu_ps(m + 48,  _mm256_castps256_ps128(c3));
+    _mm_storeu_ps(m + 64,  _mm256_extractf128_ps(c0, 1));
+    _mm_storeu_ps(m + 80,  _mm256_extractf128_ps(c1, 1));
+    _mm_storeu_ps(m + 96,  _mm256_extractf128_ps(c2, 1));
+    _mm_storeu_ps(m + 112, _mm256_extractf128_ps(c3, 1));
+}
+
+// 8 nodes at a time straight from the SoA arrays
+void ComposeAvx2(const TransformArrays& a, size_t begin, size_t end) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 zero = _mm256_setzero_ps();
+
+    size_t i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 x = _mm256_loadu_ps(a.rotationsX + i);
+        __m256 y = _mm256_loadu_ps(a.rotationsY + i);
+        __m256 z = _mm256_loadu_ps(a.rotationsZ + i);
+        __m256 w = _mm256_loadu_ps(a.rotationsW + i);
+        __m256 sx = _mm256_loadu_ps(a.scalesX + i);
+        __m256 sy = _mm256_loadu_ps(a.scalesY + i);
+        __m256 sz = _mm256_loadu_ps(a.scalesZ + i);
+
+        // Doubled products save the multiplications by two
+        __m256 x2 = _mm256_add_ps(x, x), y2 = _mm256_add_ps(y, y), z2 = _mm256_add_ps(z, z);
+        __m256 xx = _mm256_mul_ps(x, x2), yy = _mm256_mul_ps(y, y2), zz = _mm256_mul_ps(z, z2);
+        __m256 xy = _mm256_mul_ps(x, y2), xz = _mm256_mul_ps(x, z2), yz = _mm256_mul_ps(y, z2);
+        __m256 wx = _mm256_mul_ps(w, x2), wy = _mm256_mul_ps(w, y2), wz = _mm256_mul_ps(w, z2);
+
+        float* m = a.locals + i * 16;
+        StoreColumns(m, 0,
+                     _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(yy, zz)), sx),
+                     _mm256_mul_ps(_mm256_add_ps(xy, wz), sx),
+                     _mm256_mul_ps(_mm256_sub_ps(xz, wy), sx),
+                     zero);
+        StoreColumns(m, 1,
+                     _mm256_mul_ps(_mm256_sub_ps(xy, wz), sy),
+                     _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, zz)), sy),
+                     _mm256_mul_ps(_mm256_add_ps(yz, wx), sy),
+                     zero);
+        StoreColumns(m, 2,
+                     _mm256_mul_ps(_mm256_add_ps(xz, wy), sz),
+                     _mm256_mul_ps(_mm256_sub_ps(yz, wx), sz),
+                     _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, yy)), sz),
+                     zero);
+        StoreColumns(m, 3, _mm256_loadu_ps(a.positionsX + i), _mm256_loadu_ps(a.positionsY + i),
+                     _mm256_loadu_ps(a.positionsZ + i), one);
+    }
+    GetScalarTransformKernels().compose(a, i, end);
+}
+
+// Two result columns per 256-bit register
+void MultiplyAvx2(const TransformArrays& a, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+        const float* l = a.locals + i * 16;
+        float* r = a.worlds + i * 16;
+        __m256 l01 = _mm256_loadu_ps(l);
+        __m256 l23 = _mm256_loadu_ps(l + 8);
+        if (a.parents[i] == noParent) {
+            _mm256_storeu_ps(r, l01);
+            _mm256_storeu_ps(r + 8, l23);
+            continue;
+        }
+        const float* p = a.worlds + size_t(a.parents[i]) * 16;
+        __m256 p0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(p));
+        __m256 p1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(p + 4));
+        __m256 p2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(p + 8));
+        __m256 p3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(p + 12));
+
+        __m256 r01 = _mm256_mul_ps(p0, TRANSFORM_SPLAT(l01, 0));
+        r01 = _mm256_fmadd_ps(p1, TRANSFORM_SPLAT(l01, 1), r01);
+        r01 = _mm256_fmadd_ps(p2, TRANSFORM_SPLAT(l01, 2), r01);
+        r01 = _mm256_fmadd_ps(p3, TRANSFORM_SPLAT(l01, 3), r01);
+
+        __m256 r23 = _mm256_mul_ps(p0, TRANSFORM_SPLAT(l23, 0));
+        r23 = _mm256_fmadd_ps(p1, TRANSFORM_SPLAT(l23, 1), r23);
+        r23 = _mm256_fmadd_ps(p2, TRANSFORM_SPLAT(l23, 2), r23);
+        r23 = _mm256_fmadd_ps(p3, TRANSFORM_SPLAT(l23, 3), r23);
+
+        _mm256_storeu_ps(r, r01);
+        _mm256_storeu_ps(r + 8, r23);
+    }
+}
+
+// Two nodes per 256-bit register
+void TransformBoundsAvx2(const TransformArrays& a, size_t begin, size_t end) {
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+
+    size_t i = begin;
+    for (; i + 2 <= end; i += 2) {
+        const float* m = a.worlds + i * 16;
+        // Column k of both matrices
+        __m256 m0 = Load2(m, m + 16);
+        __m256 m1 = Load2(m + 4, m + 20);
+        __m256 m2 = Load2(m + 8, m + 24);
+        __m256 m3 = Load2(m + 12, m + 28);
+        __m256 c = _mm256_loadu_ps(a.boundsCenters + i * 4);
+        __m256 e = _mm256_loadu_ps(a.boundsExtents + i * 4);
+
+        __m256 center = _mm256_fmadd_ps(m0, TRANSFORM_SPLAT(c, 0), m3);
+        center = _mm256_fmadd_ps(m1, TRANSFORM_SPLAT(c, 1), center);
+        center = _mm256_fmadd_ps(m2, TRANSFORM_SPLAT(c, 2), center);
+
+        __m256 extent = _mm256_mul_ps(_mm256_andnot_ps(signMask, m0), TRANSFORM_SPLAT(e, 0));
+        extent = _mm256_fmadd_ps(_mm256_andnot_ps(signMask, m1), TRANSFORM_SPLAT(e, 1), extent);
+        extent = _mm256_fmadd_ps(_mm256_andnot_ps(signMask, m2), TRANSFORM_SPLAT(e, 2), extent);
+
+        _mm256_storeu_ps(a.worldMins + i * 4, _mm256_sub_ps(center, extent));
+        _mm256_storeu_ps(a.worldMaxs + i * 4, _mm256_add_ps(center, extent));
+    }
+    GetScalarTransformKernels().transformBounds(a, i, end);
+}
+
+} // namespace
+
+const TransformKernels* GetAvx2TransformKernels() {
+    static const TransformKernels kernels = { "avx2", ComposeAvx2, MultiplyAvx2, TransformBoundsAvx2 };
+    return &kernels;
+}
+
+#else
+
+const TransformKernels* GetAvx2TransformKernels() {
+    return nullptr;
+}
+
+#endif
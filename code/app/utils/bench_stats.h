@@ -0,0 +1,21 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+// Iterations of a measured benchmark configuration. Median of them is reported, so outliers
+// of a busy system don't move the result
+constexpr int benchIterations = 15;
+
+/**
+ * @brief
+ * Median of the measured times
+ * @param times
+ * times of the iterations, not empty. Reordered
+ * @return
+ * median time
+*/
+inline double Median(std::vector<double>& times) {
+    std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+    return times[times.size() / 2];
+}
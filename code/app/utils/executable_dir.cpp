@@ -0,0 +1,67 @@
+#include <utils/executable_dir.h>
+
+#if defined(WIN32) || defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <mach-o/dyld.h>
+#include <cstdint>
+#else
+#include <unistd.h>
+#endif
+
+#include <vector>
+
+namespace {
+
+std::string QueryExecutablePath() {
+
+    std::vector<char> buffer(256);
+#if defined(WIN32) || defined(_WIN32)
+    // Truncated paths fill the whole buffer
+    for (;;) {
+        DWORD length = GetModuleFileNameA(nullptr, buffer.data(), static_cast<DWORD>(buffer.size()));
+        if (!length) {
+            return {};
+        }
+        if (length < buffer.size()) {
+            return std::string(buffer.data(), length);
+        }
+        buffer.resize(buffer.size() * 2);
+    }
+#elif defined(__APPLE__)
+    uint32_t size = static_cast<uint32_t>(buffer.size());
+    if (_NSGetExecutablePath(buffer.data(), &size) != 0) {
+        // Size is set to the required one
+        buffer.resize(size);
+        if (_NSGetExecutablePath(buffer.data(), &size) != 0) {
+            return {};
+        }
+    }
+    return buffer.data();
+#else
+    // readlink doesn't terminate the path and truncates it silently
+    for (;;) {
+        ssize_t length = readlink("/proc/self/exe", buffer.data(), buffer.size());
+        if (length <= 0) {
+            return {};
+        }
+        if (static_cast<size_t>(length) < buffer.size()) {
+            return std::string(buffer.data(), static_cast<size_t>(length));
+        }
+        buffer.resize(buffer.size() * 2);
+    }
+#endif
+}
+
+} // namespace
+
+std::string GetExecutableDir() {
+    // Doesn't change while the process runs
+    static const std::string dir = [] {
+        std::string path = QueryExecutablePath();
+        size_t separator = path.find_last_of("/\\");
+        return separator == std::string::npos ? std::string(".") : path.substr(0, separator);
+    }();
+    return dir;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <string>
+
+/**
+ * @brief
+ * Directory of the running executable, so files shipped next to it are found from any working directory
+ * @return
+ * directory path without the trailing separator. Current directory if the executable path is unknown
+*/
+std::string GetExecutableDir();
@@ -0,0 +1,204 @@
+#include <utils/frame_pacer.h>
+
+#include <logs.h>
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#if defined(WIN32) || defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+namespace {
+
+// Sleep the waits are made of. Longer sleeps overshoot more
+constexpr std::chrono::milliseconds sleepQuantum(1);
+// Sleep statistics are aged to follow changes of the OS scheduler load
+constexpr uint64_t maxSleepSamples = 1024;
+
+const char* modeNames[] = { "unlimited", "limited", "idle" };
+
+// CPU time of all the process threads, s
+double GetProcessCpuTime() {
+#if defined(WIN32) || defined(_WIN32)
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+        return 0.0;
+    }
+    auto toTicks = [](const FILETIME& time) {
+        return (static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    };
+    // 100 ns ticks
+    return (toTicks(kernel) + toTicks(user)) * 1e-7;
+#else
+    timespec time{};
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+#endif
+}
+
+double Seconds(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration<double>(duration).count();
+}
+
+} // namespace
+
+double FramePacer::ModeStats::GetJitter() const {
+    return intervals > 1 ? std::sqrt(intervalM2 / (intervals - 1)) : 0.0;
+}
+
+void FramePacer::Init(uint32_t targetFps, bool onDemandRedraw, double idleWaitTimeout) {
+
+    period = targetFps ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / targetFps))
+                       : Clock::duration::zero();
+    onDemand    = onDemandRedraw;
+    idleTimeout = idleWaitTimeout;
+    // The first frame is always rendered
+    redrawRequested.store(true, std::memory_order_release);
+
+    // Conservative until the first sleeps are measured
+    sleepEstimate = 0.005;
+    sleepMean     = 0.0;
+    sleepM2       = 0.0;
+    sleepsCount   = 0;
+
+    for (auto& modeStats : stats) {
+        modeStats = {};
+    }
+    nextFrameTime   = Clock::now();
+    lastAccountTime = nextFrameTime;
+    lastCpuTime     = GetProcessCpuTime();
+    lastFrameMode   = Mode::Count;
+    pendingSleep    = 0.0;
+    pendingSpin     = 0.0;
+
+    if (period.count()) {
+        PRINT("Frame rate is limited to %u FPS", targetFps);
+    }
+    if (onDemand) {
+        PRINT("Frames are rendered on demand, the loop waits for events while the scene is static");
+    }
+}
+
+void FramePacer::SleepAndMeasure() {
+
+    auto start = Clock::now();
+    std::this_thread::sleep_for(sleepQuantum);
+    double observed = Seconds(Clock::now() - start);
+    pendingSleep += observed;
+
+    if (sleepsCount >= maxSleepSamples) {
+        sleepM2 *= 0.5;
+        sleepsCount /= 2;
+    }
+    // Welford's online mean and variance
+    ++sleepsCount;
+    double delta = observed - sleepMean;
+    sleepMean += delta / sleepsCount;
+    sleepM2   += delta * (observed - sleepMean);
+    if (sleepsCount > 1) {
+        sleepEstimate = sleepMean + std::sqrt(sleepM2 / (sleepsCount - 1));
+    }
+}
+
+void FramePacer::WaitForFrame() {
+
+    if (!period.count()) {
+        return;
+    }
+
+    auto now = Clock::now();
+    if (now < nextFrameTime) {
+        // Sleeping is cheap but inaccurate: sleep while a sleep surely ends before the slot
+        while (Seconds(nextFrameTime - now) > sleepEstimate) {
+            SleepAndMeasure();
+            now = Clock::now();
+        }
+        // Spin the last part of the wait
+        auto spinStart = now;
+        while (now < nextFrameTime) {
+            std::this_thread::yield();
+            now = Clock::now();
+        }
+        pendingSpin += Seconds(now - spinStart);
+    }
+
+    // A late frame shifts the schedule instead of making the next ones come faster
+    nextFrameTime += period;
+    if (nextFrameTime <= now) {
+        nextFrameTime = now + period;
+    }
+}
+
+bool FramePacer::BeginFrame() {
+
+    bool render = !onDemand || redrawRequested.exchange(false, std::memory_order_acq_rel);
+    Mode mode = !render ? Mode::Idle : (period.count() ? Mode::Limited : Mode::Unlimited);
+    Account(mode);
+
+    auto& modeStats = stats[static_cast<size_t>(mode)];
+    if (!render) {
+        ++modeStats.emptyIterations;
+        // Time between frames separated by idle waits is not a frame time
+        lastFrameMode = Mode::Count;
+        return false;
+    }
+
+    auto now = lastAccountTime;
+    if (lastFrameMode == mode) {
+        double interval = Seconds(now - lastFrameTime);
+        ++modeStats.intervals;
+        double delta = interval - modeStats.intervalMean;
+        modeStats.intervalMean += delta / modeStats.intervals;
+        modeStats.intervalM2   += delta * (interval - modeStats.intervalMean);
+        modeStats.maxInterval   = std::max(modeStats.maxInterval, interval);
+    }
+    lastFrameTime = now;
+    lastFrameMode = mode;
+    ++modeStats.frames;
+    return true;
+}
+
+void FramePacer::Account(Mode mode) {
+
+    // The iteration since the previous call is counted to the mode it ends in
+    auto now = Clock::now();
+    double cpuTime = GetProcessCpuTime();
+    auto& modeStats = stats[static_cast<size_t>(mode)];
+    modeStats.wallTime  += Seconds(now - lastAccountTime);
+    modeStats.cpuTime   += cpuTime - lastCpuTime;
+    modeStats.sleepTime += pendingSleep;
+    modeStats.spinTime  += pendingSpin;
+
+    lastAccountTime = now;
+    lastCpuTime     = cpuTime;
+    pendingSleep    = 0.0;
+    pendingSpin     = 0.0;
+}
+
+FramePacer::Mode FramePacer::GetMode() const {
+    if (IsIdle()) {
+        return Mode::Idle;
+    }
+    return period.count() ? Mode::Limited : Mode::Unlimited;
+}
+
+void FramePacer::PrintStats() const {
+    for (size_t i = 0; i < static_cast<size_t>(Mode::Count); ++i) {
+        const auto& modeStats = stats[i];
+        if (!modeStats.frames && !modeStats.emptyIterations) {
+            continue;
+        }
+        PRINT("Frame pacer %s: %llu frames (%.1f FPS), frame time %.3f ms, jitter %.3f ms, max %.3f ms",
+              modeNames[i], static_cast<unsigned long long>(modeStats.frames),
+              modeStats.wallTime > 0.0 ? modeStats.frames / modeStats.wallTime : 0.0,
+              modeStats.intervalMean * 1000.0, modeStats.GetJitter() * 1000.0, modeStats.maxInterval * 1000.0);
+        PRINT("Frame pacer %s: CPU %.1f%% of a core over %.3f s, slept %.3f s, spun %.3f s, %llu empty iterations",
+              modeNames[i], modeStats.GetCpuUtilization() * 100.0, modeStats.wallTime, modeStats.sleepTime,
+              modeStats.spinTime, static_cast<unsigned long long>(modeStats.emptyIterations));
+    }
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * @brief
+ * Paces the window loop instead of rendering as fast as possible.
+ * With a target frame rate the loop waits for the next frame slot: it sleeps while the remaining
+ * time is longer than the measured sleep overshoot and spins the rest for accuracy.
+ * In on-demand mode the scene is static and frames are rendered only after a redraw request,
+ * the loop blocks in the event queue between them.
+ * Wall time, process CPU time and frame-time jitter are collected for every mode
+*/
+class FramePacer {
+
+public:
+
+    enum class Mode : uint8_t {
+        // No waits, frames go back to back
+        Unlimited,
+        // Frames are started at the target rate
+        Limited,
+        // Static scene, the loop waits for events
+        Idle,
+        Count,
+    };
+
+    struct ModeStats {
+        uint64_t frames = 0;
+        // Loop iterations which rendered nothing, e.g. idle wake-ups
+        uint64_t emptyIterations = 0;
+        double wallTime = 0.0;
+        double cpuTime  = 0.0;
+        // Time slept and spun waiting for the frame slots, s
+        double sleepTime = 0.0;
+        double spinTime  = 0.0;
+        // Intervals between consecutive frames, s
+        uint64_t intervals = 0;
+        double intervalMean = 0.0;
+        double intervalM2   = 0.0;
+        double maxInterval  = 0.0;
+
+        double GetCpuUtilization() const { return wallTime > 0.0 ? cpuTime / wallTime : 0.0; }
+        // Standard deviation of the frame time
+        double GetJitter() const;
+    };
+
+    /**
+     * @brief
+     * Set up the pacing
+     * @param targetFps
+     * frame rate limit. 0 to disable limiting
+     * @param onDemandRedraw
+     * render only on redraw requests
+     * @param idleWaitTimeout
+     * longest idle wait for events, s
+    */
+    void Init(uint32_t targetFps, bool onDemandRedraw, double idleWaitTimeout);
+
+    // Render the next frame even if the scene is static. Thread safe, the caller must wake up the event wait
+    void RequestRedraw() { redrawRequested.store(true, std::memory_order_release); }
+
+    // The loop should block in the event queue instead of polling
+    bool IsIdle() const { return onDemand && !redrawRequested.load(std::memory_order_acquire); }
+    double GetIdleTimeout() const { return idleTimeout; }
+
+    // Wait for the next frame slot. Returns at once without a target frame rate
+    void WaitForFrame();
+    /**
+     * @brief
+     * Account the loop iteration and decide whether it renders a frame
+     * @return
+     * false if the scene is static and nothing requested a redraw
+    */
+    bool BeginFrame();
+
+    Mode GetMode() const;
+    const ModeStats& GetStats(Mode mode) const { return stats[static_cast<size_t>(mode)]; }
+    void PrintStats() const;
+
+private:
+
+    typedef std::chrono::steady_clock Clock;
+
+    // Sleep shortly and learn how long such sleeps actually take
+    void SleepAndMeasure();
+    void Account(Mode mode);
+
+private:
+
+    Clock::duration period{};
+    bool onDemand = false;
+    double idleTimeout = 0.0;
+    std::atomic<bool> redrawRequested{ true };
+
+    Clock::time_point nextFrameTime;
+    // Estimated duration of a 1 ms sleep: mean plus standard deviation of the measured ones, s
+    double sleepEstimate = 0.0;
+    double sleepMean     = 0.0;
+    double sleepM2       = 0.0;
+    uint64_t sleepsCount = 0;
+
+    ModeStats stats[static_cast<size_t>(Mode::Count)];
+    Clock::time_point lastAccountTime;
+    double lastCpuTime = 0.0;
+    Clock::time_point lastFrameTime;
+    Mode lastFrameMode = Mode::Count;
+    // Waits of the current iteration
+    double pendingSleep = 0.0;
+    double pendingSpin  = 0.0;
+};
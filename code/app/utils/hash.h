@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// 64-bit FNV-1a hash
+
+constexpr uint64_t hashFnvOffsetBasis = 0xcbf29ce484222325ull;
+constexpr uint64_t hashFnvPrime       = 0x100000001b3ull;
+
+/**
+ * @brief
+ * Hash raw bytes
+ * @param data
+ * bytes to hash
+ * @param size
+ * size of data in bytes
+ * @param seed
+ * previous hash value to continue hashing with
+ * @return
+ * hash value
+*/
+inline uint64_t HashBytes(const void* data, size_t size, uint64_t seed = hashFnvOffsetBasis) {
+    auto bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= hashFnvPrime;
+    }
+    return hash;
+}
+
+// Compile-time hash of a c-string
+constexpr uint64_t HashString(const char* str, uint64_t seed = hashFnvOffsetBasis) {
+    uint64_t hash = seed;
+    while (*str) {
+        hash ^= static_cast<uint8_t>(*str++);
+        hash *= hashFnvPrime;
+    }
+    return hash;
+}
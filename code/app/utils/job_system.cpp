@@ -0,0 +1,164 @@
+#include <utils/job_system.h>
+
+#include <logs.h>
+
+#include <algorithm>
+
+namespace {
+
+// Identifies the worker threads. Other threads are treated as the one called Init
+thread_local const JobSystem* currentSystem = nullptr;
+thread_local uint32_t currentIndex = 0;
+
+} // namespace
+
+void JobSystem::Init(uint32_t threadsCount) {
+
+    Clear();
+    if (!threadsCount) {
+        threadsCount = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    threads.resize(threadsCount);
+    for (auto& thread : threads) {
+        thread = std::make_unique<Thread>();
+    }
+    // The thread 0 is the calling one
+    for (uint32_t i = 1; i < threadsCount; ++i) {
+        threads[i]->thread = std::thread(&JobSystem::WorkerFunc, this, i);
+    }
+
+    PRINT_V("Job system started %u threads", threadsCount);
+}
+
+uint32_t JobSystem::GetThreadIndex() const {
+    return currentSystem == this ? currentIndex : 0;
+}
+
+void JobSystem::Dispatch(size_t count, size_t grain, JobFunc func, const void* context) {
+
+    if (!count) {
+        return;
+    }
+    grain = std::max<size_t>(grain, 1);
+    size_t jobsCount = (count + grain - 1) / grain;
+    if (jobsCount == 1 || threads.size() < 2) {
+        func(context, 0, count);
+        return;
+    }
+
+    uint32_t index = GetThreadIndex();
+    std::atomic<uint32_t> pending{ static_cast<uint32_t>(jobsCount) };
+    std::vector<Job> jobs(jobsCount);
+    for (size_t i = 0; i < jobsCount; ++i) {
+        jobs[i] = { func, context, i * grain, std::min(count, (i + 1) * grain), &pending };
+    }
+
+    // The first job is run by this thread right away, the rest may be stolen
+    auto& deque = threads[index]->deque;
+    std::vector<Job*> overflow;
+    for (size_t i = 1; i < jobsCount; ++i) {
+        queuedJobs.fetch_add(1);
+        if (!deque.Push(&jobs[i])) {
+            queuedJobs.fetch_sub(1);
+            overflow.push_back(&jobs[i]);
+        }
+    }
+    if (sleepingThreads.load()) {
+        // Taking the mutex orders the notification after the sleeping thread checked queuedJobs
+        { std::lock_guard<std::mutex> lock(mutex); }
+        wakeCondition.notify_all();
+    }
+
+    Execute(index, jobs[0]);
+    for (auto job : overflow) {
+        Execute(index, *job);
+    }
+
+    // Help with any jobs until ours are done
+    while (pending.load(std::memory_order_acquire)) {
+        if (Job* job = FindJob(index)) {
+            Execute(index, *job);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+JobSystem::Job* JobSystem::FindJob(uint32_t index) {
+
+    if (Job* job = threads[index]->deque.Pop()) {
+        queuedJobs.fetch_sub(1);
+        return job;
+    }
+
+    size_t count = threads.size();
+    for (size_t i = 1; i < count; ++i) {
+        if (Job* job = threads[(index + i) % count]->deque.Steal()) {
+            queuedJobs.fetch_sub(1);
+            ++threads[index]->stats.stolenJobs;
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+void JobSystem::Execute(uint32_t index, Job& job) {
+    job.func(job.context, job.begin, job.end);
+    ++threads[index]->stats.executedJobs;
+    // The job may be freed by the dispatching thread right after that
+    job.pending->fetch_sub(1, std::memory_order_release);
+}
+
+void JobSystem::WorkerFunc(uint32_t index) {
+
+    currentSystem = this;
+    currentIndex  = index;
+
+    uint32_t spins = 0;
+    while (true) {
+        if (Job* job = FindJob(index)) {
+            Execute(index, *job);
+            spins = 0;
+            continue;
+        }
+        if (++spins < idleSpins) {
+            std::this_thread::yield();
+            continue;
+        }
+        spins = 0;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        sleepingThreads.fetch_add(1);
+        wakeCondition.wait(lock, [this] { return stopping || queuedJobs.load() > 0; });
+        sleepingThreads.fetch_sub(1);
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+void JobSystem::PrintStats() const {
+    for (size_t i = 0; i < threads.size(); ++i) {
+        const auto& stats = threads[i]->stats;
+        PRINT("Job thread %zu: %llu jobs, %llu stolen", i, static_cast<unsigned long long>(stats.executedJobs),
+              static_cast<unsigned long long>(stats.stolenJobs));
+    }
+}
+
+void JobSystem::Clear() {
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeCondition.notify_all();
+    for (auto& thread : threads) {
+        if (thread->thread.joinable()) {
+            thread->thread.join();
+        }
+    }
+    threads.clear();
+    queuedJobs = 0;
+    stopping = false;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <utils/work_stealing_deque.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief
+ * Work-stealing job scheduler. Every thread owns a Chase-Lev deque: jobs are pushed to the deque
+ * of the dispatching thread and idle threads steal them from the others. The dispatching thread
+ * runs jobs too while it waits, so nested dispatches from the jobs are allowed.
+ * Besides the jobs' threads, only the thread called Init may dispatch
+*/
+class JobSystem {
+
+public:
+
+    // Processes the items [begin, end) of a dispatch
+    typedef void (*JobFunc)(const void* context, size_t begin, size_t end);
+
+    struct ThreadStats {
+        uint64_t executedJobs = 0;
+        // Jobs taken from the deques of other threads
+        uint64_t stolenJobs   = 0;
+    };
+
+    JobSystem() = default;
+    JobSystem(const JobSystem&) = delete;
+    ~JobSystem() { Clear(); }
+
+    /**
+     * @brief
+     * Start worker threads
+     * @param threadsCount
+     * count of threads running jobs including the calling one. 0 to use all the hardware threads
+    */
+    void Init(uint32_t threadsCount);
+    void Clear();
+
+    /**
+     * @brief
+     * Split the range into jobs, run them in parallel and wait for them
+     * @param count
+     * count of items
+     * @param grain
+     * max count of items in a job
+     * @param func
+     * callable with (size_t begin, size_t end) arguments
+    */
+    template<typename Func>
+    void ParallelFor(size_t count, size_t grain, const Func& func) {
+        Dispatch(count, grain, [](const void* context, size_t begin, size_t end) {
+            (*static_cast<const Func*>(context))(begin, end);
+        }, &func);
+    }
+    void Dispatch(size_t count, size_t grain, JobFunc func, const void* context);
+
+    uint32_t GetThreadsCount() const { return static_cast<uint32_t>(threads.size()); }
+    // Index of the calling thread in [0, GetThreadsCount()). 0 for the thread called Init
+    uint32_t GetThreadIndex() const;
+    const ThreadStats& GetThreadStats(uint32_t thread) const { return threads[thread]->stats; }
+    void PrintStats() const;
+
+private:
+
+    struct Job {
+        JobFunc func;
+        const void* context;
+        size_t begin;
+        size_t end;
+        std::atomic<uint32_t>* pending;
+    };
+
+    struct Thread {
+        Thread() : deque(maxQueuedJobs) {}
+
+        WorkStealingDeque<Job> deque;
+        std::thread thread;
+        ThreadStats stats;
+    };
+
+    // Deque capacity. Jobs which don't fit are run by the dispatching thread
+    static constexpr size_t maxQueuedJobs = 4096;
+    // Attempts to find a job before a worker goes to sleep
+    static constexpr uint32_t idleSpins = 256;
+
+    void WorkerFunc(uint32_t index);
+    // Pop a job of the thread or steal one from the others
+    Job* FindJob(uint32_t index);
+    void Execute(uint32_t index, Job& job);
+
+private:
+
+    std::vector<std::unique_ptr<Thread>> threads;
+
+    // Jobs pushed and not taken yet. Sleeping workers are woken when it is non-zero
+    std::atomic<uint32_t> queuedJobs{ 0 };
+    std::atomic<uint32_t> sleepingThreads{ 0 };
+    std::mutex mutex;
+    std::condition_variable wakeCondition;
+    bool stopping = false;
+};
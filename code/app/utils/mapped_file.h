@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief
+ * Read-only memory mapping of a whole file. Pages are loaded by the OS on access,
+ * so opening is cheap regardless of the file size
+*/
+class MappedFile {
+
+public:
+
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * @brief
+     * Map a file
+     * @param path
+     * file path
+     * @return
+     * false if the file doesn't exist, is empty or can't be mapped
+    */
+    bool Open(const char* path);
+    void Close();
+
+    const uint8_t* GetData() const { return data; }
+    size_t GetSize() const { return size; }
+    bool IsOpen() const { return data != nullptr; }
+
+private:
+
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+#if defined(WIN32) || defined(_WIN32)
+    void* fileHandle    = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
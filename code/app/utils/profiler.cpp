@@ -0,0 +1,195 @@
+#include <utils/profiler.h>
+
+#include <logs.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <thread>
+
+namespace {
+
+// Small sequential ids are easier to read in the trace viewers than native thread ids
+uint32_t GetThreadId() {
+    static std::atomic<uint32_t> nextId{ 0 };
+    thread_local uint32_t id = nextId.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+// Thread track of GPU events in the trace
+constexpr uint32_t gpuTrackId = 1000;
+
+void WriteJsonString(std::ofstream& file, const char* str) {
+    file << '"';
+    for (; *str; ++str) {
+        if (*str == '"' || *str == '\\') {
+            file << '\\';
+        }
+        file << *str;
+    }
+    file << '"';
+}
+
+double Percentile(std::vector<float>& samples, double fraction) {
+    size_t index = std::min(samples.size() - 1, static_cast<size_t>(fraction * samples.size()));
+    std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+    return samples[index];
+}
+
+} // namespace
+
+Profiler& Profiler::Inst() {
+    static Profiler inst;
+    return inst;
+}
+
+Profiler::Profiler() {
+    for (auto& frameBuffer : frames) {
+        frameBuffer.events.reset(new Event[maxEventsPerFrame]);
+    }
+    origin = Now();
+}
+
+uint64_t Profiler::Now() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void Profiler::AddEvent(const char* name, uint64_t start, uint64_t end, EventKind kind) {
+
+    uint64_t currentFrame = frame.load(std::memory_order_acquire);
+    auto& frameBuffer = frames[currentFrame % framesCount];
+
+    uint32_t index = frameBuffer.reserved.fetch_add(1, std::memory_order_relaxed);
+    if (index >= maxEventsPerFrame) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    auto& event  = frameBuffer.events[index];
+    event.name   = name;
+    event.start  = start;
+    event.end    = end;
+    event.frame  = currentFrame;
+    event.thread = (kind == EventKind::Gpu) ? gpuTrackId : GetThreadId();
+    event.kind   = kind;
+
+    frameBuffer.committed.fetch_add(1, std::memory_order_release);
+}
+
+void Profiler::EndFrame() {
+
+    // The slot of the next frame still holds the oldest frame. Writers left it framesCount - 1 frames ago
+    uint64_t nextFrame = frame.load(std::memory_order_relaxed) + 1;
+    CollectFrame(static_cast<uint32_t>(nextFrame % framesCount));
+    frame.store(nextFrame, std::memory_order_release);
+}
+
+void Profiler::CollectFrame(uint32_t slot) {
+
+    auto& frameBuffer = frames[slot];
+    uint32_t count = std::min(frameBuffer.reserved.load(std::memory_order_acquire), maxEventsPerFrame);
+
+    // Let a late writer finish its event
+    while (frameBuffer.committed.load(std::memory_order_acquire) < count) {
+        std::this_thread::yield();
+    }
+
+    for (uint32_t i = 0; i < count; ++i) {
+        const auto& event = frameBuffer.events[i];
+
+        auto& scope = history[event.name];
+        if (scope.samples.size() < statsWindow) {
+            scope.samples.push_back(0.0f);
+        }
+        scope.samples[scope.next] = static_cast<float>((event.end - event.start) / 1e6);
+        scope.next = (scope.next + 1) % statsWindow;
+        ++scope.count;
+
+        if (capturedEvents.size() < captureLimit) {
+            capturedEvents.push_back(event);
+        }
+    }
+
+    frameBuffer.committed.store(0, std::memory_order_relaxed);
+    frameBuffer.reserved.store(0, std::memory_order_release);
+}
+
+void Profiler::StartCapture(size_t maxEvents) {
+    captureLimit = maxEvents;
+    capturedEvents.clear();
+    capturedEvents.reserve(std::min<size_t>(maxEvents, 1u << 16));
+}
+
+AppResult Profiler::SaveChromeTrace(const char* path) {
+
+    // Collect frames still in flight
+    for (uint32_t i = 0; i < framesCount; ++i) {
+        EndFrame();
+    }
+
+    std::ofstream file(path);
+    if (!file) {
+        PRINT_E("Failed to open \"%s\" for writing", path);
+        return APP_CODE_IO_FAILURE;
+    }
+
+    // Nanosecond precision, the default 6 significant digits lose it after a second of the trace
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << gpuTrackId << ",\"args\":{\"name\":\"GPU\"}}";
+    for (const auto& event : capturedEvents) {
+        // Complete events, timestamps are in microseconds
+        file << ",\n{\"name\":";
+        WriteJsonString(file, event.name);
+        file << ",\"cat\":\"" << (event.kind == EventKind::Gpu ? "gpu" : "cpu") << "\",\"ph\":\"X\""
+             << ",\"ts\":" << (event.start - std::min(event.start, origin)) / 1000.0
+             << ",\"dur\":" << (event.end - event.start) / 1000.0
+             << ",\"pid\":0,\"tid\":" << event.thread
+             << ",\"args\":{\"frame\":" << event.frame << "}}";
+    }
+    file << "\n]}\n";
+
+    if (!file) {
+        PRINT_E("Failed to write trace to \"%s\"", path);
+        return APP_CODE_IO_FAILURE;
+    }
+    PRINT("%zu profiler events written to \"%s\"", capturedEvents.size(), path);
+    return APP_CODE_OK;
+}
+
+Profiler::ScopeStats Profiler::GetScopeStats(const char* name) const {
+
+    ScopeStats stats;
+    auto it = history.find(name);
+    if (it == history.end() || it->second.samples.empty()) {
+        return stats;
+    }
+
+    std::vector<float> samples = it->second.samples;
+    stats.p50   = Percentile(samples, 0.50);
+    stats.p95   = Percentile(samples, 0.95);
+    stats.p99   = Percentile(samples, 0.99);
+    stats.count = it->second.count;
+    return stats;
+}
+
+void Profiler::PrintStats() const {
+
+    // Sorted output is easier to compare between runs
+    std::map<std::string, ScopeStats> sorted;
+    for (const auto& scope : history) {
+        sorted[scope.first] = GetScopeStats(scope.first.c_str());
+    }
+    for (const auto& scope : sorted) {
+        PRINT("Profile %-24s p50 %8.3f ms  p95 %8.3f ms  p99 %8.3f ms  (%llu samples)", scope.first.c_str(),
+              scope.second.p50, scope.second.p95, scope.second.p99,
+              static_cast<unsigned long long>(scope.second.count));
+    }
+    if (GetDroppedCount()) {
+        PRINT_W("Profiler dropped %llu events. Increase Profiler::maxEventsPerFrame",
+                static_cast<unsigned long long>(GetDroppedCount()));
+    }
+}
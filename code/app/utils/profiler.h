@@ -0,0 +1,141 @@
+#pragma once
+
+#include <app_result.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Declare a CPU scope lasting until the end of the C++ scope
+#define PROFILE_SCOPE(name) ProfileScope _PROFILE_CONCAT(_profileScope, __LINE__)(name)
+
+#define _PROFILE_CONCAT_IMPL(a, b) a##b
+#define _PROFILE_CONCAT(a, b) _PROFILE_CONCAT_IMPL(a, b)
+
+/**
+ * @brief
+ * Frame profiler collecting CPU and GPU scopes. Scopes are written from any thread
+ * into a lock-free buffer of the current frame. Buffers of finished frames are collected
+ * on EndFrame into rolling per-scope statistics and optionally into a Chrome trace capture.
+ * Has no device dependency, GPU scopes are added already converted to the CPU clock
+*/
+class Profiler {
+
+public:
+
+    enum class EventKind : uint8_t {
+        Cpu,
+        Gpu,
+    };
+
+    struct Event {
+        // Static string, is not copied
+        const char* name;
+        uint64_t start;
+        uint64_t end;
+        uint64_t frame;
+        uint32_t thread;
+        EventKind kind;
+    };
+
+    struct ScopeStats {
+        // Milliseconds over the rolling window
+        double p50 = 0.0;
+        double p95 = 0.0;
+        double p99 = 0.0;
+        uint64_t count = 0;
+    };
+
+    static constexpr uint32_t framesCount = 4;
+    static constexpr uint32_t maxEventsPerFrame = 4096;
+    static constexpr uint32_t statsWindow = 256;
+
+    static Profiler& Inst();
+
+    // Nanoseconds of the profiler clock
+    static uint64_t Now();
+
+    // Add an event to the current frame. Thread safe and lock-free
+    void AddEvent(const char* name, uint64_t start, uint64_t end, EventKind kind);
+    /**
+     * @brief
+     * Finish the current frame and collect the oldest one. Must be called from one thread
+    */
+    void EndFrame();
+
+    /**
+     * @brief
+     * Start collecting events for a Chrome trace
+     * @param maxEvents
+     * capture stops when it has the count of events
+    */
+    void StartCapture(size_t maxEvents);
+    /**
+     * @brief
+     * Write the captured events in Chrome trace event format (chrome://tracing, Perfetto)
+     * @param path
+     * JSON file path
+     * @return
+     * AppResult code
+    */
+    AppResult SaveChromeTrace(const char* path);
+
+    // Statistics of a scope over the last statsWindow occurrences
+    ScopeStats GetScopeStats(const char* name) const;
+    void PrintStats() const;
+
+    uint64_t GetDroppedCount() const { return dropped.load(std::memory_order_relaxed); }
+    uint64_t GetFrame() const { return frame.load(std::memory_order_relaxed); }
+
+private:
+
+    Profiler();
+    Profiler(const Profiler&) = delete;
+
+    void CollectFrame(uint32_t slot);
+
+private:
+
+    struct FrameBuffer {
+        std::unique_ptr<Event[]> events;
+        std::atomic<uint32_t> reserved{ 0 };
+        std::atomic<uint32_t> committed{ 0 };
+    };
+
+    struct ScopeHistory {
+        std::vector<float> samples;
+        uint32_t next = 0;
+        uint64_t count = 0;
+    };
+
+    FrameBuffer frames[framesCount];
+    std::atomic<uint64_t> frame{ 0 };
+    std::atomic<uint64_t> dropped{ 0 };
+
+    // Collector thread only
+    std::unordered_map<std::string, ScopeHistory> history;
+    std::vector<Event> capturedEvents;
+    size_t captureLimit = 0;
+    // Trace timestamps are relative to the profiler creation
+    uint64_t origin = 0;
+};
+
+
+// RAII CPU scope. Use PROFILE_SCOPE
+class ProfileScope {
+
+public:
+
+    explicit ProfileScope(const char* name) : name(name), start(Profiler::Now()) {}
+    ~ProfileScope() { Profiler::Inst().AddEvent(name, start, Profiler::Now(), Profiler::EventKind::Cpu); }
+
+    ProfileScope(const ProfileScope&) = delete;
+
+private:
+
+    const char* name;
+    uint64_t start;
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <utils/hash.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <string>
+#include <thread>
+
+/**
+ * @brief
+ * Unique name of a temporary file next to the target one, to write it fully before the rename.
+ * Random per process and counted per call, so concurrent processes and threads saving the same file
+ * never write into each other's temporary file
+ * @param path
+ * path of the file to be replaced
+ * @return
+ * temporary file path in the same directory, so the rename doesn't cross file systems
+*/
+inline std::string MakeTempPath(const std::string& path) {
+    static const uint64_t processSeed = [] {
+        uint64_t seed = std::random_device{}();
+        seed = (seed << 32) ^ std::random_device{}();
+        auto time = std::chrono::steady_clock::now().time_since_epoch().count();
+        return HashBytes(&time, sizeof(time), seed);
+    }();
+    static std::atomic<uint32_t> counter{0};
+
+    auto threadId = std::hash<std::thread::id>{}(std::this_thread::get_id());
+    uint32_t index = counter.fetch_add(1, std::memory_order_relaxed);
+    uint64_t suffix = HashBytes(&threadId, sizeof(threadId), processSeed);
+    suffix = HashBytes(&index, sizeof(index), suffix);
+
+    char buffer[24];
+    std::snprintf(buffer, sizeof(buffer), ".%016llx", static_cast<unsigned long long>(suffix));
+    return path + buffer + ".tmp";
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/**
+ * @brief
+ * Chase-Lev work-stealing deque of a fixed capacity (Le, Pop, Cohen, Nardelli, "Correct and Efficient
+ * Work-Stealing for Weak Memory Models"). The owner thread pushes and pops at the bottom,
+ * other threads steal from the top. Items are not owned by the deque
+*/
+template<typename T>
+class WorkStealingDeque {
+
+public:
+
+    /**
+     * @brief
+     * @param capacity
+     * max count of items. Rounded up to a power of two
+    */
+    explicit WorkStealingDeque(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        mask = size - 1;
+        buffer = std::make_unique<std::atomic<T*>[]>(size);
+    }
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+
+    // Owner only. false if the deque is full
+    bool Push(T* item) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        if (static_cast<size_t>(b - t) > mask) {
+            return false;
+        }
+        buffer[static_cast<size_t>(b) & mask].store(item, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Owner only. The last pushed item or nullptr
+    T* Pop() {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            // Empty
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        T* item = buffer[static_cast<size_t>(b) & mask].load(std::memory_order_relaxed);
+        if (t == b) {
+            // The last item, race with thieves for it
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                item = nullptr;
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    // Any thread. The first pushed item or nullptr if the deque is empty or another thread won the race
+    T* Steal() {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            return nullptr;
+        }
+        T* item = buffer[static_cast<size_t>(t) & mask].load(std::memory_order_relaxed);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return item;
+    }
+
+    // Approximate when other threads use the deque
+    bool IsEmpty() const {
+        return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed);
+    }
+
+private:
+
+    // Thieves and the owner write different ends, keep them in different cache lines
+    alignas(64) std::atomic<int64_t> top{ 0 };
+    alignas(64) std::atomic<int64_t> bottom{ 0 };
+    std::unique_ptr<std::atomic<T*>[]> buffer;
+    size_t mask = 0;
+};
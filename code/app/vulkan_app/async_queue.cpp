@@ -0,0 +1,233 @@
+#include <vulkan_app/async_queue.h>
+
+#include <logs.h>
+
+AppResult AsyncQueue::Init(VkDevice device, uint32_t family, uint32_t queueIndex, const char* name) {
+
+    dev          = device;
+    this->family = family;
+    this->name   = name;
+    vkGetDeviceQueue(dev, family, queueIndex, &queue);
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags            = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT |
+                                VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = family;
+
+    VkResult r = vkCreateCommandPool(dev, &poolInfo, nullptr, &commandPool);
+    if (r != VK_SUCCESS) {
+        PRINT_E("Failed to create %s queue command pool. Vk error code: %d", name, r);
+        return APP_CODE_VK_COMMAND_FAIURE;
+    }
+
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType         = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue  = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+
+    r = vkCreateSemaphore(dev, &semaphoreInfo, nullptr, &timeline);
+    if (r != VK_SUCCESS) {
+        PRINT_E("Failed to create %s queue timeline semaphore. Vk error code: %d", name, r);
+        return APP_CODE_VK_COMMAND_FAIURE;
+    }
+
+    lastSubmitted = 0;
+    PRINT("%s queue: family %u, index %u", name, family, queueIndex);
+    return APP_CODE_OK;
+}
+
+AppResult AsyncQueue::Submit(const RecordFunc& record, const std::vector<SyncPoint>& waits, uint64_t& value) {
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    RecycleCommandBuffers();
+
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    if (!freeBuffers.empty()) {
+        commandBuffer = freeBuffers.back();
+        freeBuffers.pop_back();
+        vkResetCommandBuffer(commandBuffer, 0);
+    } else {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool        = commandPool;
+        allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+
+        VkResult r = vkAllocateCommandBuffers(dev, &allocInfo, &commandBuffer);
+        if (r != VK_SUCCESS) {
+            PRINT_E("Failed to allocate %s queue command buffer. Vk error code: %d", name, r);
+            return APP_CODE_VK_COMMAND_FAIURE;
+        }
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    record(commandBuffer);
+    VkResult r = vkEndCommandBuffer(commandBuffer);
+    if (r != VK_SUCCESS) {
+        freeBuffers.push_back(commandBuffer);
+        PRINT_E("Failed to record %s queue commands. Vk error code: %d", name, r);
+        return APP_CODE_VK_COMMAND_FAIURE;
+    }
+
+    std::vector<VkSemaphore> waitSemaphores;
+    std::vector<uint64_t> waitValues;
+    std::vector<VkPipelineStageFlags> waitStages;
+    waitSemaphores.reserve(waits.size());
+    waitValues.reserve(waits.size());
+    waitStages.reserve(waits.size());
+    for (const auto& wait : waits) {
+        waitSemaphores.push_back(wait.semaphore);
+        waitValues.push_back(wait.value);
+        waitStages.push_back(wait.stage);
+    }
+    uint64_t signalValue = lastSubmitted + 1;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType                     = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount   = static_cast<uint32_t>(waitValues.size());
+    timelineInfo.pWaitSemaphoreValues      = waitValues.data();
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues    = &signalValue;
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext                = &timelineInfo;
+    submitInfo.waitSemaphoreCount   = static_cast<uint32_t>(waitSemaphores.size());
+    submitInfo.pWaitSemaphores      = waitSemaphores.data();
+    submitInfo.pWaitDstStageMask    = waitStages.data();
+    submitInfo.commandBufferCount   = 1;
+    submitInfo.pCommandBuffers      = &commandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores    = &timeline;
+
+    r = vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+    if (r != VK_SUCCESS) {
+        freeBuffers.push_back(commandBuffer);
+        PRINT_E("Failed to submit to %s queue. Vk error code: %d", name, r);
+        return APP_CODE_VK_COMMAND_FAIURE;
+    }
+
+    lastSubmitted = signalValue;
+    pendingBuffers.push_back({ commandBuffer, signalValue });
+    value = signalValue;
+    return APP_CODE_OK;
+}
+
+AppResult AsyncQueue::BindSparse(const std::vector<VkSparseImageMemoryBindInfo>& imageBinds,
+                                 const std::vector<VkSparseImageOpaqueMemoryBindInfo>& opaqueBinds,
+                                 const std::vector<SyncPoint>& waits, uint64_t& value) {
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::vector<VkSemaphore> waitSemaphores;
+    std::vector<uint64_t> waitValues;
+    waitSemaphores.reserve(waits.size());
+    waitValues.reserve(waits.size());
+    for (const auto& wait : waits) {
+        waitSemaphores.push_back(wait.semaphore);
+        waitValues.push_back(wait.value);
+    }
+    uint64_t signalValue = lastSubmitted + 1;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType                     = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount   = static_cast<uint32_t>(waitValues.size());
+    timelineInfo.pWaitSemaphoreValues      = waitValues.data();
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues    = &signalValue;
+
+    VkBindSparseInfo bindInfo{};
+    bindInfo.sType                = VK_STRUCTURE_TYPE_BIND_SPARSE_INFO;
+    bindInfo.pNext                = &timelineInfo;
+    bindInfo.waitSemaphoreCount   = static_cast<uint32_t>(waitSemaphores.size());
+    bindInfo.pWaitSemaphores      = waitSemaphores.data();
+    bindInfo.imageOpaqueBindCount = static_cast<uint32_t>(opaqueBinds.size());
+    bindInfo.pImageOpaqueBinds    = opaqueBinds.data();
+    bindInfo.imageBindCount       = static_cast<uint32_t>(imageBinds.size());
+    bindInfo.pImageBinds          = imageBinds.data();
+    bindInfo.signalSemaphoreCount = 1;
+    bindInfo.pSignalSemaphores    = &timeline;
+
+    VkResult r = vkQueueBindSparse(queue, 1, &bindInfo, VK_NULL_HANDLE);
+    if (r != VK_SUCCESS) {
+        PRINT_E("Failed to bind sparse memory on %s queue. Vk error code: %d", name, r);
+        return APP_CODE_VK_COMMAND_FAIURE;
+    }
+
+    lastSubmitted = signalValue;
+    value = signalValue;
+    return APP_CODE_OK;
+}
+
+uint64_t AsyncQueue::GetLastSubmitted() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return lastSubmitted;
+}
+
+bool AsyncQueue::IsCompleted(uint64_t value) const {
+    uint64_t completed = 0;
+    vkGetSemaphoreCounterValue(dev, timeline, &completed);
+    return completed >= value;
+}
+
+AppResult AsyncQueue::Wait(uint64_t value, uint64_t timeout) const {
+
+    if (timeline == VK_NULL_HANDLE) {
+        return APP_CODE_OK;
+    }
+
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores    = &timeline;
+    waitInfo.pValues        = &value;
+
+    VkResult r = vkWaitSemaphores(dev, &waitInfo, timeout);
+    if (r != VK_SUCCESS) {
+        PRINT_W("Waiting for %s queue value %llu failed. Vk error code: %d", name,
+                static_cast<unsigned long long>(value), r);
+        return APP_CODE_VK_COMMAND_FAIURE;
+    }
+    return APP_CODE_OK;
+}
+
+void AsyncQueue::RecycleCommandBuffers() {
+
+    if (pendingBuffers.empty()) {
+        return;
+    }
+    uint64_t completed = 0;
+    vkGetSemaphoreCounterValue(dev, timeline, &completed);
+
+    // Submissions are completed in the timeline order
+    while (!pendingBuffers.empty() && pendingBuffers.front().value <= completed) {
+        freeBuffers.push_back(pendingBuffers.front().commandBuffer);
+        pendingBuffers.pop_front();
+    }
+}
+
+void AsyncQueue::Clear() {
+    if (dev == VK_NULL_HANDLE) {
+        return;
+    }
+    WaitIdle();
+    vkDestroySemaphore(dev, timeline, nullptr);
+    vkDestroyCommandPool(dev, commandPool, nullptr);
+
+    pendingBuffers.clear();
+    freeBuffers.clear();
+    timeline      = VK_NULL_HANDLE;
+    commandPool   = VK_NULL_HANDLE;
+    queue         = VK_NULL_HANDLE;
+    dev           = VK_NULL_HANDLE;
+    lastSubmitted = 0;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <app_result.h>
+#include <vulkan_app/vk_base.h>
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief
+ * Queue for asynchronous work (asset uploads, compute passes) submitted apart from the frames.
+ * Every submission signals the next value of the queue timeline semaphore, so other queues
+ * could wait for it on GPU and CPU could poll it without fences.
+ * Resources shared between queues of different families must be created with
+ * VK_SHARING_MODE_CONCURRENT or have their ownership transferred by the recorded barriers
+*/
+class AsyncQueue {
+
+public:
+
+    // Point of a timeline to be waited by a submission
+    struct SyncPoint {
+        VkSemaphore semaphore      = VK_NULL_HANDLE;
+        uint64_t value             = 0;
+        VkPipelineStageFlags stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    };
+
+    // Records commands of a submission
+    typedef std::function<void(VkCommandBuffer)> RecordFunc;
+
+    AsyncQueue() = default;
+    AsyncQueue(const AsyncQueue&) = delete;
+
+    /**
+     * @brief
+     * Get the queue and create its command pool and timeline semaphore
+     * @param device
+     * logical device
+     * @param family
+     * family of the queue
+     * @param queueIndex
+     * index of the queue in the family
+     * @param name
+     * name of the queue for the logs
+     * @return
+     * AppResult code
+    */
+    AppResult Init(VkDevice device, uint32_t family, uint32_t queueIndex, const char* name);
+    void Clear();
+
+    /**
+     * @brief
+     * Record and submit commands. Thread safe
+     * @param record
+     * function recording the commands
+     * @param waits
+     * timeline points to be waited before execution
+     * @param value
+     * timeline value signaled when the submission is completed
+     * @return
+     * AppResult code
+    */
+    AppResult Submit(const RecordFunc& record, const std::vector<SyncPoint>& waits, uint64_t& value);
+    /**
+     * @brief
+     * Bind or unbind memory of sparse images with vkQueueBindSparse. The queue family must support
+     * sparse binding. Thread safe
+     * @param imageBinds
+     * binds of sparse image blocks. Null memory unbinds the blocks
+     * @param opaqueBinds
+     * opaque binds, e.g. of the mip tails
+     * @param waits
+     * timeline points to be waited before binding. Stages are ignored
+     * @param value
+     * timeline value signaled when the binds are done
+     * @return
+     * AppResult code
+    */
+    AppResult BindSparse(const std::vector<VkSparseImageMemoryBindInfo>& imageBinds,
+                         const std::vector<VkSparseImageOpaqueMemoryBindInfo>& opaqueBinds,
+                         const std::vector<SyncPoint>& waits, uint64_t& value);
+    // Check if the submission with the timeline value is completed without blocking
+    bool IsCompleted(uint64_t value) const;
+    // Block until the submission with the timeline value is completed
+    AppResult Wait(uint64_t value, uint64_t timeout = UINT64_MAX) const;
+    // Wait for all the submissions
+    void WaitIdle() const { Wait(GetLastSubmitted()); }
+
+    SyncPoint GetSyncPoint(uint64_t value, VkPipelineStageFlags stage) const { return { timeline, value, stage }; }
+    VkQueue GetQueue() const { return queue; }
+    uint32_t GetFamily() const { return family; }
+    uint64_t GetLastSubmitted() const;
+
+private:
+
+    // Return command buffers of completed submissions to the free list
+    void RecycleCommandBuffers();
+
+private:
+
+    struct PendingBuffer {
+        VkCommandBuffer commandBuffer;
+        uint64_t value;
+    };
+
+    VkDevice dev = VK_NULL_HANDLE;
+    VkQueue queue = VK_NULL_HANDLE;
+    uint32_t family = 0;
+    const char* name = "";
+
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    VkSemaphore timeline = VK_NULL_HANDLE;
+    uint64_t lastSubmitted = 0;
+
+    std::deque<PendingBuffer> pendingBuffers;
+    std::vector<VkCommandBuffer> freeBuffers;
+    // Guards the submissions and lastSubmitted
+    mutable std::mutex mutex;
+};
@@ -0,0 +1,324 @@
+#include <vulkan_app/bindless_table.h>
+
+#include <logs.h>
+
+#include <algorithm>
+
+namespace {
+
+const char* KindName(BindlessTable::Kind kind) {
+    switch (kind) {
+    case BindlessTable::Kind::Texture:
+        return "textures";
+    case BindlessTable::Kind::Buffer:
+        return "buffers";
+    case BindlessTable::Kind::Sampler:
+        return "samplers";
+    default:
+        return "unknown";
+    }
+}
+
+} // namespace
+
+AppResult BindlessTable::Init(VkPhysicalDevice physDevice, VkDevice device, uint32_t framesInFlight) {
+
+    dev         = device;
+    framesCount = std::max(framesInFlight, 1u);
+    stats       = {};
+
+    VkPhysicalDeviceDescriptorIndexingProperties indexingProps{};
+    indexingProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties2{};
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties2.pNext = &indexingProps;
+    vkGetPhysicalDeviceProperties2(physDevice, &properties2);
+
+    // Every stage may access the whole table, so per stage limits apply too
+    const VkDescriptorType types[kindsCount] = {
+        VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        VK_DESCRIPTOR_TYPE_SAMPLER,
+    };
+    slots[static_cast<uint32_t>(Kind::Texture)].capacity =
+        std::min({ uint32_t(APP_BINDLESS_MAX_TEXTURES), indexingProps.maxDescriptorSetUpdateAfterBindSampledImages,
+                   indexingProps.maxPerStageDescriptorUpdateAfterBindSampledImages });
+    slots[static_cast<uint32_t>(Kind::Buffer)].capacity =
+        std::min({ uint32_t(APP_BINDLESS_MAX_BUFFERS), indexingProps.maxDescriptorSetUpdateAfterBindStorageBuffers,
+                   indexingProps.maxPerStageDescriptorUpdateAfterBindStorageBuffers });
+    slots[static_cast<uint32_t>(Kind::Sampler)].capacity =
+        std::min({ uint32_t(APP_BINDLESS_MAX_SAMPLERS), indexingProps.maxDescriptorSetUpdateAfterBindSamplers,
+                   indexingProps.maxPerStageDescriptorUpdateAfterBindSamplers });
+
+    VkDescriptorSetLayoutBinding bindings[kindsCount]{};
+    VkDescriptorBindingFlags bindingFlags[kindsCount]{};
+    VkDescriptorPoolSize poolSizes[kindsCount]{};
+    for (uint32_t i = 0; i < kindsCount; ++i) {
+        slots[i].freeList.clear();
+        slots[i].next = 0;
+
+        bindings[i].binding         = i;
+        bindings[i].descriptorType  = types[i];
+        bindings[i].descriptorCount = slots[i].capacity;
+        bindings[i].stageFlags      = VK_SHADER_STAGE_ALL;
+        // Slots are written while the set is bound to pending command buffers, unused slots may be stale
+        bindingFlags[i] = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                          VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT |
+                          VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+        poolSizes[i].type            = types[i];
+        poolSizes[i].descriptorCount = slots[i].capacity;
+    }
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo{};
+    flagsInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    flagsInfo.bindingCount  = kindsCount;
+    flagsInfo.pBindingFlags = bindingFlags;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext        = &flagsInfo;
+    layoutInfo.flags        = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    layoutInfo.bindingCount = kindsCount;
+    layoutInfo.pBindings    = bindings;
+
+    VkResult r = vkCreateDescriptorSetLayout(dev, &layoutInfo, nullptr, &setLayout);
+    if (r != VK_SUCCESS) {
+        PRINT_E("Failed to create bindless descriptor set layout. Vk error code: %d", r);
+        return APP_CODE_VK_COMMAND_FAIURE;
+    }
+
+    VkPushConstantRange pushConstants{};
+    pushConstants.stageFlags = VK_SHADER_STAGE_ALL;
+    pushConstants.offset     = 0;
+    pushConstants.size       = pushConstantsSize;
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount         = 1;
+    pipelineLayoutInfo.pSetLayouts            = &setLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges    = &pushConstants;
+
+    r = vkCreatePipelineLayout(dev, &pipelineLayoutInfo, nullptr, &pipelineLayout);
+    if (r != VK_SUCCESS) {
+        PRINT_E("Failed to create bindless pipeline layout. Vk error code: %d", r);
+        return APP_CODE_VK_COMMAND_FAIURE;
+    }
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags         = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    poolInfo.maxSets       = 1;
+    poolInfo.poolSizeCount = kindsCount;
+    poolInfo.pPoolSizes    = poolSizes;
+
+    r = vkCreateDescriptorPool(dev, &poolInfo, nullptr, &pool);
+    if (r != VK_SUCCESS) {
+        PRINT_E("Failed to create bindless descriptor pool. Vk error code: %d", r);
+        return APP_CODE_VK_COMMAND_FAIURE;
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool     = pool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts        = &setLayout;
+
+    r = vkAllocateDescriptorSets(dev, &allocInfo, &set);
+    if (r != VK_SUCCESS) {
+        PRINT_E("Failed to allocate bindless descriptor set. Vk error code: %d", r);
+        return APP_CODE_VK_COMMAND_FAIURE;
+    }
+
+    PRINT("Bindless table created: %u textures, %u buffers, %u samplers",
+          slots[0].capacity, slots[1].capacity, slots[2].capacity);
+    return APP_CODE_OK;
+}
+
+uint32_t BindlessTable::Allocate(Kind kind) {
+
+    uint32_t kindIndex = static_cast<uint32_t>(kind);
+    auto& kindSlots = slots[kindIndex];
+
+    uint32_t index = invalidIndex;
+    if (!kindSlots.freeList.empty()) {
+        index = kindSlots.freeList.back();
+        kindSlots.freeList.pop_back();
+    } else if (kindSlots.next < kindSlots.capacity) {
+        index = kindSlots.next++;
+    } else {
+        PRINT_E("Bindless table is out of %s (%u)", KindName(kind), kindSlots.capacity);
+        return invalidIndex;
+    }
+
+    ++stats.used[kindIndex];
+    stats.peak[kindIndex] = std::max(stats.peak[kindIndex], stats.used[kindIndex]);
+    return index;
+}
+
+uint32_t BindlessTable::AddTexture(VkImageView view, VkImageLayout layout) {
+    uint32_t index = Allocate(Kind::Texture);
+    if (index != invalidIndex) {
+        PendingWrite write{};
+        write.kind              = Kind::Texture;
+        write.index             = index;
+        write.image.imageView   = view;
+        write.image.imageLayout = layout;
+        pendingWrites.push_back(write);
+    }
+    return index;
+}
+
+uint32_t BindlessTable::AddBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) {
+    uint32_t index = Allocate(Kind::Buffer);
+    if (index != invalidIndex) {
+        PendingWrite write{};
+        write.kind          = Kind::Buffer;
+        write.index         = index;
+        write.buffer.buffer = buffer;
+        write.buffer.offset = offset;
+        write.buffer.range  = range;
+        pendingWrites.push_back(write);
+    }
+    return index;
+}
+
+uint32_t BindlessTable::AddSampler(VkSampler sampler) {
+    uint32_t index = Allocate(Kind::Sampler);
+    if (index != invalidIndex) {
+        PendingWrite write{};
+        write.kind          = Kind::Sampler;
+        write.index         = index;
+        write.image.sampler = sampler;
+        pendingWrites.push_back(write);
+    }
+    return index;
+}
+
+void BindlessTable::Release(Kind kind, uint32_t index) {
+    uint32_t kindIndex = static_cast<uint32_t>(kind);
+    if (index >= slots[kindIndex].next) {
+        PRINT_W("Release of unallocated bindless slot %u of %s", index, KindName(kind));
+        return;
+    }
+    // The descriptor stays valid for the recorded frames, PARTIALLY_BOUND allows it to go stale after
+    retired.push_back({ currentFrame, kind, index });
+    --stats.used[kindIndex];
+}
+
+void BindlessTable::BeginFrame(uint64_t frameNumber) {
+    currentFrame = frameNumber;
+    // Frame N is finished when frame N + framesInFlight gets its resources
+    while (!retired.empty() && retired.front().frame + framesCount <= frameNumber) {
+        const auto& slot = retired.front();
+        slots[static_cast<uint32_t>(slot.kind)].freeList.push_back(slot.index);
+        retired.pop_front();
+        ++stats.recycled;
+    }
+}
+
+void BindlessTable::Flush() {
+
+    if (pendingWrites.empty()) {
+        return;
+    }
+
+    // Consecutive slots of a kind are written with one descriptor range
+    std::sort(pendingWrites.begin(), pendingWrites.end(), [](const PendingWrite& a, const PendingWrite& b) {
+        return a.kind != b.kind ? a.kind < b.kind : a.index < b.index;
+    });
+
+    std::vector<VkDescriptorImageInfo> images;
+    std::vector<VkDescriptorBufferInfo> buffers;
+    std::vector<VkWriteDescriptorSet> writes;
+    // Writes point into the arrays, so they must not reallocate
+    images.reserve(pendingWrites.size());
+    buffers.reserve(pendingWrites.size());
+
+    for (const auto& pending : pendingWrites) {
+        bool isBuffer = pending.kind == Kind::Buffer;
+        if (isBuffer) {
+            buffers.push_back(pending.buffer);
+        } else {
+            images.push_back(pending.image);
+        }
+
+        if (!writes.empty()) {
+            auto& last = writes.back();
+            if (last.dstBinding == static_cast<uint32_t>(pending.kind) &&
+                last.dstArrayElement + last.descriptorCount == pending.index) {
+                ++last.descriptorCount;
+                continue;
+            }
+        }
+
+        VkWriteDescriptorSet write{};
+        write.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet          = set;
+        write.dstBinding      = static_cast<uint32_t>(pending.kind);
+        write.dstArrayElement = pending.index;
+        write.descriptorCount = 1;
+        switch (pending.kind) {
+        case Kind::Texture:
+            write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+            write.pImageInfo     = &images.back();
+            break;
+        case Kind::Buffer:
+            write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            write.pBufferInfo    = &buffers.back();
+            break;
+        default:
+            write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+            write.pImageInfo     = &images.back();
+            break;
+        }
+        writes.push_back(write);
+    }
+
+    vkUpdateDescriptorSets(dev, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+    stats.writes += pendingWrites.size();
+    ++stats.updates;
+    pendingWrites.clear();
+}
+
+void BindlessTable::Bind(VkCommandBuffer cmd, VkPipelineBindPoint bindPoint) const {
+    vkCmdBindDescriptorSets(cmd, bindPoint, pipelineLayout, 0, 1, &set, 0, nullptr);
+}
+
+void BindlessTable::PrintStats() const {
+    for (uint32_t i = 0; i < kindsCount; ++i) {
+        PRINT("Bindless %s: %u used, %u peak of %u", KindName(static_cast<Kind>(i)),
+              stats.used[i], stats.peak[i], slots[i].capacity);
+    }
+    PRINT("Bindless table: %llu descriptors written in %llu updates, %llu slots recycled",
+          static_cast<unsigned long long>(stats.writes), static_cast<unsigned long long>(stats.updates),
+          static_cast<unsigned long long>(stats.recycled));
+}
+
+void BindlessTable::Clear() {
+    if (dev == VK_NULL_HANDLE) {
+        return;
+    }
+    // The set is freed with the pool
+    if (pool != VK_NULL_HANDLE) {
+        vkDestroyDescriptorPool(dev, pool, nullptr);
+    }
+    if (pipelineLayout != VK_NULL_HANDLE) {
+        vkDestroyPipelineLayout(dev, pipelineLayout, nullptr);
+    }
+    if (setLayout != VK_NULL_HANDLE) {
+        vkDestroyDescriptorSetLayout(dev, setLayout, nullptr);
+    }
+
+    for (auto& kindSlots : slots) {
+        kindSlots = {};
+    }
+    retired.clear();
+    pendingWrites.clear();
+    set            = VK_NULL_HANDLE;
+    pool           = VK_NULL_HANDLE;
+    pipelineLayout = VK_NULL_HANDLE;
+    setLayout      = VK_NULL_HANDLE;
+    dev            = VK_NULL_HANDLE;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <app_consts.h>
+#include <app_result.h>
+#include <utils/hash.h>
+#include <vulkan_app/vk_base.h>
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+/**
+ * @brief
+ * Bindless resource table. One update-after-bind descriptor set holds arrays of all the textures,
+ * buffers and samplers, it is bound once per command buffer and draws select resources by 32-bit
+ * indices passed in push constants. Released slots are reused only after the frames which could
+ * access them are finished, so descriptors are never overwritten while GPU reads them
+*/
+class BindlessTable {
+
+public:
+
+    // Kind of a resource. Is the binding of its array in the set
+    enum class Kind : uint32_t {
+        // VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE
+        Texture,
+        // VK_DESCRIPTOR_TYPE_STORAGE_BUFFER
+        Buffer,
+        // VK_DESCRIPTOR_TYPE_SAMPLER
+        Sampler,
+        Count,
+    };
+
+    static constexpr uint32_t kindsCount = static_cast<uint32_t>(Kind::Count);
+    static constexpr uint32_t invalidIndex = ~0u;
+    // Guaranteed maxPushConstantsSize. Pipelines share the layout, so the range is fixed
+    static constexpr uint32_t pushConstantsSize = 128;
+    // Identifies the pipeline layout in pipeline keys
+    static constexpr uint64_t pipelineLayoutKey = HashString("BindlessTable");
+
+    struct Stats {
+        uint32_t used[kindsCount] = {};
+        uint32_t peak[kindsCount] = {};
+        // Descriptors written and vkUpdateDescriptorSets calls they took
+        uint64_t writes  = 0;
+        uint64_t updates = 0;
+        uint64_t recycled = 0;
+    };
+
+    /**
+     * @brief
+     * Create the set and the pipeline layout sharing it
+     * @param physDevice
+     * physical device to get update-after-bind limits of
+     * @param device
+     * logical device. Must have descriptor indexing features enabled
+     * @param framesInFlight
+     * count of frames which may use a released slot
+     * @return
+     * AppResult code
+    */
+    AppResult Init(VkPhysicalDevice physDevice, VkDevice device, uint32_t framesInFlight);
+    void Clear();
+
+    // Add resources. Return the index for shaders or invalidIndex if the table is full
+    uint32_t AddTexture(VkImageView view, VkImageLayout layout);
+    uint32_t AddBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+    uint32_t AddSampler(VkSampler sampler);
+    // Free the slot. It is reused when the frames recorded till now are finished
+    void Release(Kind kind, uint32_t index);
+
+    /**
+     * @brief
+     * Recycle slots released by the finished frames. Call after the frame resources are acquired
+     * @param frameNumber
+     * number of the frame to be recorded. Frames before frameNumber - framesInFlight are finished
+    */
+    void BeginFrame(uint64_t frameNumber);
+    // Write the added descriptors. Call before submission of the commands using them
+    void Flush();
+    void Bind(VkCommandBuffer cmd, VkPipelineBindPoint bindPoint) const;
+
+    VkDescriptorSetLayout GetSetLayout() const { return setLayout; }
+    VkPipelineLayout GetPipelineLayout() const { return pipelineLayout; }
+    uint32_t GetCapacity(Kind kind) const { return slots[static_cast<uint32_t>(kind)].capacity; }
+    const Stats& GetStats() const { return stats; }
+    void PrintStats() const;
+
+private:
+
+    struct Slots {
+        // Released slots ready for reuse
+        std::vector<uint32_t> freeList;
+        // Slots from next to capacity were never used
+        uint32_t next     = 0;
+        uint32_t capacity = 0;
+    };
+
+    struct RetiredSlot {
+        uint64_t frame;
+        Kind kind;
+        uint32_t index;
+    };
+
+    struct PendingWrite {
+        Kind kind;
+        uint32_t index;
+        VkDescriptorImageInfo image;
+        VkDescriptorBufferInfo buffer;
+    };
+
+    uint32_t Allocate(Kind kind);
+
+private:
+
+    VkDevice dev = VK_NULL_HANDLE;
+    VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+    VkDescriptorSet set   = VK_NULL_HANDLE;
+
+    Slots slots[kindsCount];
+    std::deque<RetiredSlot> retired;
+    std::vector<PendingWrite> pendingWrites;
+    uint32_t framesCount = 1;
+    uint64_t currentFrame = 0;
+
+    Stats stats;
+};
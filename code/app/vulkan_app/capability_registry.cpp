@@ -0,0 +1,118 @@
+#include <vulkan_app/capability_registry.h>
+
+#include <logs.h>
+
+#include <cstring>
+
+void NameSet::Insert(const char* name) {
+    names.emplace(HashString(name), name);
+}
+
+bool NameSet::Contains(const char* name) const {
+    if (!name) {
+        return false;
+    }
+    auto found = names.find(HashString(name));
+    // Names are compared only to reject a hash collision
+    return found != names.end() && found->second == name;
+}
+
+std::vector<const char*> NameSet::GetNames() const {
+    std::vector<const char*> result;
+    result.reserve(names.size());
+    for (const auto& name : names) {
+        result.push_back(name.second.c_str());
+    }
+    return result;
+}
+
+AppResult CapabilityRegistry::Init() {
+
+    if (initialized) {
+        return APP_CODE_OK;
+    }
+
+    APP_CHECK_CALL(EnumerateInstanceExtensions(nullptr, instanceExtensions));
+
+    uint32_t count = 0;
+    std::vector<VkLayerProperties> layersProps;
+    vkEnumerateInstanceLayerProperties(&count, nullptr);
+    layersProps.resize(count);
+    VkResult r = vkEnumerateInstanceLayerProperties(&count, layersProps.data());
+    if (r != VK_SUCCESS) {
+        PRINT_E("Can't get available layers list. Vk error code: %d", r);
+        return APP_CODE_VK_COMMAND_FAIURE;
+    }
+    layersProps.resize(count);
+
+    for (const auto& layer : layersProps) {
+        layers.Insert(layer.layerName);
+        APP_CHECK_CALL(EnumerateInstanceExtensions(layer.layerName, layersExtensions[HashString(layer.layerName)]));
+    }
+
+    initialized = true;
+    PRINT_V("%zu instance extensions and %zu layers available", instanceExtensions.GetSize(), layers.GetSize());
+    return APP_CODE_OK;
+}
+
+AppResult CapabilityRegistry::EnumerateInstanceExtensions(const char* layer, NameSet& extensions) {
+
+    uint32_t count = 0;
+    std::vector<VkExtensionProperties> extProps;
+    vkEnumerateInstanceExtensionProperties(layer, &count, nullptr);
+    extProps.resize(count);
+    VkResult r = vkEnumerateInstanceExtensionProperties(layer, &count, extProps.data());
+    if (r != VK_SUCCESS) {
+        PRINT_E("Can't get supported extensions list. Vk error code: %d", r);
+        return APP_CODE_VK_COMMAND_FAIURE;
+    }
+
+    for (uint32_t i = 0; i < count; ++i) {
+        extensions.Insert(extProps[i].extensionName);
+    }
+    return APP_CODE_OK;
+}
+
+AppResult CapabilityRegistry::EnumerateDeviceExtensions(VkPhysicalDevice device, NameSet& extensions) {
+
+    uint32_t count = 0;
+    std::vector<VkExtensionProperties> extProps;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &count, nullptr);
+    extProps.resize(count);
+    VkResult r = vkEnumerateDeviceExtensionProperties(device, nullptr, &count, extProps.data());
+    if (r != VK_SUCCESS && r != VK_INCOMPLETE) {
+        PRINT_E("Can't get device extensions list. Vk error code: %d", r);
+        return APP_CODE_VK_COMMAND_FAIURE;
+    }
+
+    extensions.Clear();
+    for (uint32_t i = 0; i < count; ++i) {
+        extensions.Insert(extProps[i].extensionName);
+    }
+    return APP_CODE_OK;
+}
+
+bool CapabilityRegistry::HasLayerExtension(const char* layer, const char* name) const {
+    return GetLayerExtensions(layer).Contains(name);
+}
+
+const NameSet& CapabilityRegistry::GetLayerExtensions(const char* layer) const {
+    auto found = layer ? layersExtensions.find(HashString(layer)) : layersExtensions.end();
+    return (found != layersExtensions.end()) ? found->second : emptySet;
+}
+
+void CapabilityRegistry::FindMissing(const NamesList& names, const NameSet& set, NamesList& missing) {
+    missing.clear();
+    for (auto name : names) {
+        if (!set.Contains(name)) {
+            missing.push_back(name);
+        }
+    }
+}
+
+void CapabilityRegistry::Clear() {
+    instanceExtensions.Clear();
+    layers.Clear();
+    layersExtensions.clear();
+    initialized = false;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <app_result.h>
+#include <utils/hash.h>
+#include <vulkan_app/vk_base.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief
+ * Set of interned extension or layer names keyed by their 64-bit hash.
+ * Lookups by a precomputed hash don't touch the name at all
+*/
+class NameSet {
+
+public:
+
+    void Insert(const char* name);
+    bool Contains(const char* name) const;
+    // Lookup by a compile-time hash like HashString(VK_KHR_SWAPCHAIN_EXTENSION_NAME)
+    bool Contains(uint64_t hash) const { return names.find(hash) != names.end(); }
+
+    size_t GetSize() const { return names.size(); }
+    // Interned names, valid until the set is changed
+    std::vector<const char*> GetNames() const;
+    void Clear() { names.clear(); }
+
+private:
+
+    struct IdentityHash {
+        size_t operator()(uint64_t hash) const { return static_cast<size_t>(hash); }
+    };
+
+    std::unordered_map<uint64_t, std::string, IdentityHash> names;
+};
+
+/**
+ * @brief
+ * Instance extensions, layers and extensions provided by the layers.
+ * Enumerated once on Init, all the queries are hash lookups
+*/
+class CapabilityRegistry {
+
+public:
+
+    typedef std::vector<const char*> NamesList;
+
+    AppResult Init();
+    void Clear();
+
+    bool HasInstanceExtension(const char* name) const { return instanceExtensions.Contains(name); }
+    bool HasLayer(const char* name) const { return layers.Contains(name); }
+    bool HasLayerExtension(const char* layer, const char* name) const;
+
+    /**
+     * @brief
+     * Collect the names missing in a set
+     * @param names
+     * names to be checked
+     * @param set
+     * supported names
+     * @param missing
+     * names of the list not found in the set
+    */
+    static void FindMissing(const NamesList& names, const NameSet& set, NamesList& missing);
+
+    const NameSet& GetInstanceExtensions() const { return instanceExtensions; }
+    const NameSet& GetLayers() const { return layers; }
+    // Extensions of a layer. Empty set for unknown layers
+    const NameSet& GetLayerExtensions(const char* layer) const;
+
+    /**
+     * @brief
+     * Enumerate extensions of a physical device
+     * @param device
+     * physical device
+     * @param extensions
+     * set to fill
+     * @return
+     * AppResult code
+    */
+    static AppResult EnumerateDeviceExtensions(VkPhysicalDevice device, NameSet& extensions);
+
+private:
+
+    static AppResult EnumerateInstanceExtensions(const char* layer, NameSet& extensions);
+
+private:
+
+    NameSet instanceExtensions;
+    NameSet layers;
+    std::unordered_map<uint64_t, NameSet> layersExtensions;
+    NameSet emptySet;
+    bool initialized = false;
+};
@@ -0,0 +1,197 @@
+#include <vulkan_app/capability_snapshot.h>
+
+#include <app_consts.h>
+#include <logs.h>
+#include <utils/hash.h>
+#include <utils/temp_path.h>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+
+constexpr uint32_t snapshotFileMagic   = 0x4b4e4a43; // "CJNK"
+constexpr uint32_t snapshotFileVersion = 1;
+
+} // namespace
+
+uint64_t CapabilitySnapshot::GetLayoutHash() {
+    const uint64_t sizes[] = {
+        VK_HEADER_VERSION,
+        // Features are queried up to the instance version
+        APP_VK_API_VERSION,
+        sizeof(FileEntry),
+        sizeof(VkPhysicalDeviceMemoryProperties),
+        sizeof(VkQueueFamilyProperties),
+        FeatureSet().Pack().size(),
+    };
+    return HashBytes(sizes, sizeof(sizes));
+}
+
+bool CapabilitySnapshot::Load(const std::string& path) {
+
+    Clear();
+
+    if (!file.Open(path.c_str())) {
+        PRINT("Device capabilities snapshot \"%s\" not found", path.c_str());
+        return false;
+    }
+
+    FileHeader header{};
+    bool valid = file.GetSize() >= sizeof(header);
+    if (valid) {
+        std::memcpy(&header, file.GetData(), sizeof(header));
+        valid = header.magic == snapshotFileMagic && header.version == snapshotFileVersion &&
+                header.layoutHash == GetLayoutHash() && header.dataSize == file.GetSize() - sizeof(header) &&
+                header.dataSize >= uint64_t(header.devicesCount) * sizeof(FileEntry);
+    }
+    if (valid) {
+        valid = HashBytes(file.GetData() + sizeof(header), header.dataSize) == header.dataHash;
+    }
+    if (!valid) {
+        PRINT_W("Device capabilities snapshot \"%s\" is outdated or corrupted. It will be rebuilt", path.c_str());
+        file.Close();
+        return false;
+    }
+
+    entriesCount = header.devicesCount;
+    return true;
+}
+
+void CapabilitySnapshot::Clear() {
+    file.Close();
+    entriesCount = 0;
+}
+
+bool CapabilitySnapshot::Find(const VkPhysicalDeviceProperties& properties, const uint8_t (&deviceUUID)[VK_UUID_SIZE],
+                              Device& device) const {
+
+    const uint8_t* entries = file.GetData() + sizeof(FileHeader);
+    for (size_t i = 0; i < entriesCount; ++i) {
+        FileEntry entry{};
+        std::memcpy(&entry, entries + i * sizeof(FileEntry), sizeof(entry));
+        if (std::memcmp(entry.deviceUUID, deviceUUID, VK_UUID_SIZE) ||
+            entry.vendorID != properties.vendorID || entry.deviceID != properties.deviceID ||
+            entry.driverVersion != properties.driverVersion || entry.apiVersion != properties.apiVersion) {
+            continue;
+        }
+
+        uint64_t dataSize = sizeof(VkPhysicalDeviceMemoryProperties) +
+                            uint64_t(entry.familiesCount) * sizeof(VkQueueFamilyProperties) +
+                            uint64_t(entry.featuresCount) * sizeof(VkBool32) + entry.extensionsSize;
+        if (entry.offset > file.GetSize() || dataSize > file.GetSize() - entry.offset) {
+            return false;
+        }
+
+        const uint8_t* data = file.GetData() + entry.offset;
+        std::memcpy(&device.memoryProps, data, sizeof(device.memoryProps));
+        data += sizeof(device.memoryProps);
+
+        device.familiesProps.resize(entry.familiesCount);
+        std::memcpy(device.familiesProps.data(), data, entry.familiesCount * sizeof(VkQueueFamilyProperties));
+        data += entry.familiesCount * sizeof(VkQueueFamilyProperties);
+
+        // The mapping isn't aligned for VkBool32
+        std::vector<VkBool32> features(entry.featuresCount);
+        std::memcpy(features.data(), data, entry.featuresCount * sizeof(VkBool32));
+        data += entry.featuresCount * sizeof(VkBool32);
+        if (!device.features.Unpack(features.data(), features.size())) {
+            return false;
+        }
+
+        device.extensions.Clear();
+        const char* name = reinterpret_cast<const char*>(data);
+        const char* namesEnd = name + entry.extensionsSize;
+        while (name < namesEnd) {
+            device.extensions.Insert(name);
+            name += strnlen(name, namesEnd - name) + 1;
+        }
+
+        std::memcpy(device.deviceUUID, entry.deviceUUID, VK_UUID_SIZE);
+        device.vendorID      = entry.vendorID;
+        device.deviceID      = entry.deviceID;
+        device.driverVersion = entry.driverVersion;
+        device.apiVersion    = entry.apiVersion;
+        return true;
+    }
+
+    return false;
+}
+
+AppResult CapabilitySnapshot::Save(const std::string& path, const std::vector<Device>& devices) {
+
+    std::vector<FileEntry> entries(devices.size());
+    std::vector<uint8_t> data;
+    uint64_t dataOffset = sizeof(FileHeader) + entries.size() * sizeof(FileEntry);
+
+    auto append = [&data](const void* ptr, size_t size) {
+        auto bytes = static_cast<const uint8_t*>(ptr);
+        data.insert(data.end(), bytes, bytes + size);
+    };
+
+    for (size_t i = 0; i < devices.size(); ++i) {
+        const auto& device = devices[i];
+        auto& entry = entries[i];
+
+        std::memcpy(entry.deviceUUID, device.deviceUUID, VK_UUID_SIZE);
+        entry.vendorID      = device.vendorID;
+        entry.deviceID      = device.deviceID;
+        entry.driverVersion = device.driverVersion;
+        entry.apiVersion    = device.apiVersion;
+        entry.offset        = dataOffset + data.size();
+
+        append(&device.memoryProps, sizeof(device.memoryProps));
+
+        entry.familiesCount = static_cast<uint32_t>(device.familiesProps.size());
+        append(device.familiesProps.data(), device.familiesProps.size() * sizeof(VkQueueFamilyProperties));
+
+        auto features = device.features.Pack();
+        entry.featuresCount = static_cast<uint32_t>(features.size());
+        append(features.data(), features.size() * sizeof(VkBool32));
+
+        size_t namesStart = data.size();
+        for (auto name : device.extensions.GetNames()) {
+            append(name, std::strlen(name) + 1);
+        }
+        entry.extensionsSize = static_cast<uint32_t>(data.size() - namesStart);
+    }
+
+    uint64_t dataHash = HashBytes(entries.data(), entries.size() * sizeof(FileEntry));
+
+    FileHeader header{};
+    header.magic        = snapshotFileMagic;
+    header.version      = snapshotFileVersion;
+    header.layoutHash   = GetLayoutHash();
+    header.devicesCount = static_cast<uint32_t>(entries.size());
+    header.dataSize     = entries.size() * sizeof(FileEntry) + data.size();
+    header.dataHash     = HashBytes(data.data(), data.size(), dataHash);
+
+    // Write to a temporary file and replace the old one to never leave a partially written snapshot.
+    // Processes started together save the same snapshot, each one writes its own temporary file
+    std::string tmpPath = MakeTempPath(path);
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(FileEntry));
+        out.write(reinterpret_cast<const char*>(data.data()), data.size());
+        if (!out.flush()) {
+            PRINT_E("Failed to write device capabilities snapshot to \"%s\"", tmpPath.c_str());
+            out.close();
+            std::error_code ec;
+            std::filesystem::remove(tmpPath, ec);
+            return APP_CODE_IO_FAILURE;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, path, ec);
+    if (ec) {
+        PRINT_E("Failed to replace device capabilities snapshot \"%s\": %s", path.c_str(), ec.message().c_str());
+        std::filesystem::remove(tmpPath, ec);
+        return APP_CODE_IO_FAILURE;
+    }
+
+    PRINT("Device capabilities snapshot saved to \"%s\" (%zu devices, %zu bytes)",
+          path.c_str(), devices.size(), sizeof(header) + static_cast<size_t>(header.dataSize));
+    return APP_CODE_OK;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <app_result.h>
+#include <utils/mapped_file.h>
+#include <vulkan_app/capability_registry.h>
+#include <vulkan_app/feature_set.h>
+#include <vulkan_app/vk_base.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief
+ * Physical devices' capabilities stored on disk between launches to skip the driver queries on startup.
+ * The file is memory mapped and its devices are keyed by the device UUID, IDs and the driver version,
+ * so a driver update or another GPU invalidates only own entry
+*/
+class CapabilitySnapshot {
+
+public:
+
+    struct Device {
+        // Key of the entry
+        uint8_t  deviceUUID[VK_UUID_SIZE];
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint32_t apiVersion;
+
+        VkPhysicalDeviceMemoryProperties memoryProps;
+        std::vector<VkQueueFamilyProperties> familiesProps;
+        FeatureSet features;
+        NameSet extensions;
+    };
+
+    /**
+     * @brief
+     * Map the snapshot file and validate it
+     * @param path
+     * snapshot file path
+     * @return
+     * false if the file is missing or invalid. Find fails then
+    */
+    bool Load(const std::string& path);
+    void Clear();
+
+    /**
+     * @brief
+     * Get a stored device. Thread safe
+     * @param properties
+     * properties of the device, give the key with deviceUUID
+     * @param deviceUUID
+     * VkPhysicalDeviceIDProperties::deviceUUID of the device
+     * @param device
+     * stored capabilities
+     * @return
+     * false if the device isn't stored or was stored with another driver
+    */
+    bool Find(const VkPhysicalDeviceProperties& properties, const uint8_t (&deviceUUID)[VK_UUID_SIZE],
+              Device& device) const;
+
+    // Atomically replace the snapshot file with the devices
+    static AppResult Save(const std::string& path, const std::vector<Device>& devices);
+
+    size_t GetDevicesCount() const { return entriesCount; }
+
+private:
+
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        // Sizes of the stored Vulkan structs, the data is copied as is
+        uint64_t layoutHash;
+        uint32_t devicesCount;
+        uint32_t reserved;
+        // Bytes following the header: entries and their data
+        uint64_t dataSize;
+        uint64_t dataHash;
+    };
+
+    struct FileEntry {
+        uint8_t  deviceUUID[VK_UUID_SIZE];
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint32_t apiVersion;
+        uint32_t familiesCount;
+        uint32_t featuresCount;
+        // Null terminated names one after another
+        uint32_t extensionsSize;
+        uint32_t reserved;
+        // From the file start
+        uint64_t offset;
+    };
+
+    static uint64_t GetLayoutHash();
+
+private:
+
+    MappedFile file;
+    size_t entriesCount = 0;
+};
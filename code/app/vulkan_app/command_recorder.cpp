@@ -0,0 +1,196 @@
+#include <vulkan_app/command_recorder.h>
+
+#include <logs.h>
+
+#include <algorithm>
+#include <chrono>
+
+AppResult CommandRecorder::Init(VkDevice device, uint32_t queueFamily, uint32_t framesInFlight, uint32_t threadsCount) {
+
+    dev = device;
+    if (!threadsCount) {
+        threadsCount = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    workers = std::vector<Worker>(threadsCount);
+    for (auto& worker : workers) {
+        worker.framePools.resize(framesInFlight);
+        for (auto& framePool : worker.framePools) {
+            // Pools are only reset as a whole, buffers of the previous use are reused
+            VkCommandPoolCreateInfo poolInfo{};
+            poolInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            poolInfo.flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+            poolInfo.queueFamilyIndex = queueFamily;
+
+            VkResult r = vkCreateCommandPool(dev, &poolInfo, nullptr, &framePool.pool);
+            if (r != VK_SUCCESS) {
+                PRINT_E("Failed to create worker command pool. Vk error code: %d", r);
+                return APP_CODE_VK_COMMAND_FAIURE;
+            }
+        }
+    }
+
+    stopping = false;
+    for (uint32_t i = 0; i < threadsCount; ++i) {
+        workers[i].thread = std::thread(&CommandRecorder::WorkerFunc, this, i, generation);
+    }
+
+    PRINT("Command recorder started %u worker threads", threadsCount);
+    return APP_CODE_OK;
+}
+
+void CommandRecorder::BeginFrame(uint32_t frameIndex) {
+    currentFrame = frameIndex;
+    for (auto& worker : workers) {
+        auto& framePool = worker.framePools[frameIndex];
+        vkResetCommandPool(dev, framePool.pool, 0);
+        framePool.usedBuffers = 0;
+    }
+}
+
+AppResult CommandRecorder::Record(const std::vector<RecordJob>& jobs, const VkCommandBufferInheritanceInfo& inheritance,
+                                  std::vector<VkCommandBuffer>& commandBuffers) {
+
+    commandBuffers.clear();
+    if (jobs.empty()) {
+        return APP_CODE_OK;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        taskJobs        = &jobs;
+        taskInheritance = &inheritance;
+        taskOutput.assign(workers.size(), VK_NULL_HANDLE);
+        pendingWorkers  = static_cast<uint32_t>(workers.size());
+        ++generation;
+    }
+    startCondition.notify_all();
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        doneCondition.wait(lock, [this] { return pendingWorkers == 0; });
+        taskJobs        = nullptr;
+        taskInheritance = nullptr;
+    }
+
+    for (size_t i = 0; i < workers.size(); ++i) {
+        if (workers[i].result != VK_SUCCESS) {
+            PRINT_E("Failed to record secondary command buffer. Vk error code: %d", workers[i].result);
+            return APP_CODE_VK_COMMAND_FAIURE;
+        }
+        if (taskOutput[i] != VK_NULL_HANDLE) {
+            commandBuffers.push_back(taskOutput[i]);
+        }
+    }
+
+    return APP_CODE_OK;
+}
+
+void CommandRecorder::WorkerFunc(uint32_t workerIndex, uint64_t seenGeneration) {
+
+    auto& worker = workers[workerIndex];
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            startCondition.wait(lock, [&] { return stopping || generation != seenGeneration; });
+            if (stopping) {
+                return;
+            }
+            seenGeneration = generation;
+        }
+
+        // Split the jobs evenly keeping their order
+        size_t jobsCount = taskJobs->size();
+        size_t first = jobsCount * workerIndex / workers.size();
+        size_t last  = jobsCount * (workerIndex + 1) / workers.size();
+
+        worker.result = VK_SUCCESS;
+        if (first < last) {
+            auto start = std::chrono::steady_clock::now();
+            worker.result = RecordChunk(worker, first, last, taskOutput[workerIndex]);
+            worker.stats.lastRecordTime =
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            worker.stats.totalRecordTime += worker.stats.lastRecordTime;
+            worker.stats.recordedJobs += last - first;
+        } else {
+            worker.stats.lastRecordTime = 0.0;
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            --pendingWorkers;
+        }
+        doneCondition.notify_one();
+    }
+}
+
+VkResult CommandRecorder::RecordChunk(Worker& worker, size_t first, size_t last, VkCommandBuffer& commandBuffer) {
+
+    auto& framePool = worker.framePools[currentFrame];
+
+    if (framePool.usedBuffers == framePool.buffers.size()) {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool        = framePool.pool;
+        allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer newBuffer = VK_NULL_HANDLE;
+        VkResult r = vkAllocateCommandBuffers(dev, &allocInfo, &newBuffer);
+        if (r != VK_SUCCESS) {
+            return r;
+        }
+        framePool.buffers.push_back(newBuffer);
+    }
+    commandBuffer = framePool.buffers[framePool.usedBuffers++];
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags            = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.pInheritanceInfo = taskInheritance;
+    if (taskInheritance->renderPass != VK_NULL_HANDLE) {
+        beginInfo.flags |= VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    }
+
+    VkResult r = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    if (r != VK_SUCCESS) {
+        return r;
+    }
+    for (size_t i = first; i < last; ++i) {
+        (*taskJobs)[i](commandBuffer);
+    }
+    return vkEndCommandBuffer(commandBuffer);
+}
+
+void CommandRecorder::PrintStats() const {
+    for (size_t i = 0; i < workers.size(); ++i) {
+        const auto& stats = workers[i].stats;
+        PRINT("Recording thread %zu: %llu jobs in %.3f ms, last frame %.3f ms", i,
+              static_cast<unsigned long long>(stats.recordedJobs), stats.totalRecordTime, stats.lastRecordTime);
+    }
+}
+
+void CommandRecorder::Clear() {
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    startCondition.notify_all();
+    for (auto& worker : workers) {
+        if (worker.thread.joinable()) {
+            worker.thread.join();
+        }
+    }
+
+    if (dev != VK_NULL_HANDLE) {
+        for (auto& worker : workers) {
+            for (auto& framePool : worker.framePools) {
+                vkDestroyCommandPool(dev, framePool.pool, nullptr);
+            }
+        }
+    }
+    workers.clear();
+    dev = VK_NULL_HANDLE;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <app_result.h>
+#include <vulkan_app/vk_base.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief
+ * Records secondary command buffers on a pool of worker threads.
+ * Every worker owns a command pool per frame in flight, so recording takes no locks.
+ * Jobs are split into contiguous chunks, one secondary command buffer per worker,
+ * which keeps the order of the jobs when the buffers are executed one by one
+*/
+class CommandRecorder {
+
+public:
+
+    // Records commands of one job into a secondary command buffer
+    typedef std::function<void(VkCommandBuffer)> RecordJob;
+
+    struct ThreadStats {
+        // Time spent recording the last frame, ms
+        double lastRecordTime  = 0.0;
+        double totalRecordTime = 0.0;
+        uint64_t recordedJobs  = 0;
+    };
+
+    CommandRecorder() = default;
+    CommandRecorder(const CommandRecorder&) = delete;
+    ~CommandRecorder() { Clear(); }
+
+    /**
+     * @brief
+     * Create worker threads and their command pools
+     * @param device
+     * logical device
+     * @param queueFamily
+     * family of the queue the primary command buffers are submitted to
+     * @param framesInFlight
+     * count of frames which command buffers could be in use simultaneously
+     * @param threadsCount
+     * count of worker threads. 0 to use all the hardware threads
+     * @return
+     * AppResult code
+    */
+    AppResult Init(VkDevice device, uint32_t queueFamily, uint32_t framesInFlight, uint32_t threadsCount);
+    void Clear();
+
+    /**
+     * @brief
+     * Reset command pools of the frame. Command buffers recorded for the frame must be completed
+     * @param frameIndex
+     * index of the frame in flight
+    */
+    void BeginFrame(uint32_t frameIndex);
+    /**
+     * @brief
+     * Record the jobs into secondary command buffers in parallel and wait for the recording
+     * @param jobs
+     * jobs to record
+     * @param inheritance
+     * inheritance info of the secondary command buffers. If render pass is set,
+     * buffers are recorded to continue it
+     * @param commandBuffers
+     * recorded command buffers to be executed with vkCmdExecuteCommands in the same order
+     * @return
+     * AppResult code
+    */
+    AppResult Record(const std::vector<RecordJob>& jobs, const VkCommandBufferInheritanceInfo& inheritance,
+                     std::vector<VkCommandBuffer>& commandBuffers);
+
+    uint32_t GetThreadsCount() const { return static_cast<uint32_t>(workers.size()); }
+    const ThreadStats& GetThreadStats(uint32_t thread) const { return workers[thread].stats; }
+    void PrintStats() const;
+
+private:
+
+    struct FramePool {
+        VkCommandPool pool = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> buffers;
+        uint32_t usedBuffers = 0;
+    };
+
+    struct Worker {
+        std::thread thread;
+        std::vector<FramePool> framePools;
+        ThreadStats stats;
+        VkResult result = VK_SUCCESS;
+    };
+
+    void WorkerFunc(uint32_t workerIndex, uint64_t seenGeneration);
+    VkResult RecordChunk(Worker& worker, size_t first, size_t last, VkCommandBuffer& commandBuffer);
+
+private:
+
+    VkDevice dev = VK_NULL_HANDLE;
+    std::vector<Worker> workers;
+    uint32_t currentFrame = 0;
+
+    // Current task shared with the workers
+    const std::vector<RecordJob>* taskJobs = nullptr;
+    const VkCommandBufferInheritanceInfo* taskInheritance = nullptr;
+    std::vector<VkCommandBuffer> taskOutput;
+
+    std::mutex mutex;
+    std::condition_variable startCondition;
+    std::condition_variable doneCondition;
+    uint64_t generation = 0;
+    uint32_t pendingWorkers = 0;
+    bool stopping = false;
+};
@@ -0,0 +1,325 @@
+#include <vulkan_app/feature_set.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FEATURE_SET_SSE2 1
+#include <emmintrin.h>
+#else
+#define FEATURE_SET_SSE2 0
+#endif
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Fields of the feature structs in declaration order
+#define FEATURES_10(X) \
+    X(robustBufferAccess) X(fullDrawIndexUint32) X(imageCubeArray) X(independentBlend) X(geometryShader) \
+    X(tessellationShader) X(sampleRateShading) X(dualSrcBlend) X(logicOp) X(multiDrawIndirect) \
+    X(drawIndirectFirstInstance) X(depthClamp) X(depthBiasClamp) X(fillModeNonSolid) X(depthBounds) X(wideLines) \
+    X(largePoints) X(alphaToOne) X(multiViewport) X(samplerAnisotropy) X(textureCompressionETC2) \
+    X(textureCompressionASTC_LDR) X(textureCompressionBC) X(occlusionQueryPrecise) X(pipelineStatisticsQuery) \
+    X(vertexPipelineStoresAndAtomics) X(fragmentStoresAndAtomics) X(shaderTessellationAndGeometryPointSize) \
+    X(shaderImageGatherExtended) X(shaderStorageImageExtendedFormats) X(shaderStorageImageMultisample) \
+    X(shaderStorageImageReadWithoutFormat) X(shaderStorageImageWriteWithoutFormat) \
+    X(shaderUniformBufferArrayDynamicIndexing) X(shaderSampledImageArrayDynamicIndexing) \
+    X(shaderStorageBufferArrayDynamicIndexing) X(shaderStorageImageArrayDynamicIndexing) X(shaderClipDistance) \
+    X(shaderCullDistance) X(shaderFloat64) X(shaderInt64) X(shaderInt16) X(shaderResourceResidency) \
+    X(shaderResourceMinLod) X(sparseBinding) X(sparseResidencyBuffer) X(sparseResidencyImage2D) \
+    X(sparseResidencyImage3D) X(sparseResidency2Samples) X(sparseResidency4Samples) X(sparseResidency8Samples) \
+    X(sparseResidency16Samples) X(sparseResidencyAliased) X(variableMultisampleRate) X(inheritedQueries)
+
+#define FEATURES_11(X) \
+    X(storageBuffer16BitAccess) X(uniformAndStorageBuffer16BitAccess) X(storagePushConstant16) \
+    X(storageInputOutput16) X(multiview) X(multiviewGeometryShader) X(multiviewTessellationShader) \
+    X(variablePointersStorageBuffer) X(variablePointers) X(protectedMemory) X(samplerYcbcrConversion) \
+    X(shaderDrawParameters)
+
+#define FEATURES_12(X) \
+    X(samplerMirrorClampToEdge) X(drawIndirectCount) X(storageBuffer8BitAccess) \
+    X(uniformAndStorageBuffer8BitAccess) X(storagePushConstant8) X(shaderBufferInt64Atomics) \
+    X(shaderSharedInt64Atomics) X(shaderFloat16) X(shaderInt8) X(descriptorIndexing) \
+    X(shaderInputAttachmentArrayDynamicIndexing) X(shaderUniformTexelBufferArrayDynamicIndexing) \
+    X(shaderStorageTexelBufferArrayDynamicIndexing) X(shaderUniformBufferArrayNonUniformIndexing) \
+    X(shaderSampledImageArrayNonUniformIndexing) X(shaderStorageBufferArrayNonUniformIndexing) \
+    X(shaderStorageImageArrayNonUniformIndexing) X(shaderInputAttachmentArrayNonUniformIndexing) \
+    X(shaderUniformTexelBufferArrayNonUniformIndexing) X(shaderStorageTexelBufferArrayNonUniformIndexing) \
+    X(descriptorBindingUniformBufferUpdateAfterBind) X(descriptorBindingSampledImageUpdateAfterBind) \
+    X(descriptorBindingStorageImageUpdateAfterBind) X(descriptorBindingStorageBufferUpdateAfterBind) \
+    X(descriptorBindingUniformTexelBufferUpdateAfterBind) X(descriptorBindingStorageTexelBufferUpdateAfterBind) \
+    X(descriptorBindingUpdateUnusedWhilePending) X(descriptorBindingPartiallyBound) \
+    X(descriptorBindingVariableDescriptorCount) X(runtimeDescriptorArray) X(samplerFilterMinmax) \
+    X(scalarBlockLayout) X(imagelessFramebuffer) X(uniformBufferStandardLayout) X(shaderSubgroupExtendedTypes) \
+    X(separateDepthStencilLayouts) X(hostQueryReset) X(timelineSemaphore) X(bufferDeviceAddress) \
+    X(bufferDeviceAddressCaptureReplay) X(bufferDeviceAddressMultiDevice) X(vulkanMemoryModel) \
+    X(vulkanMemoryModelDeviceScope) X(vulkanMemoryModelAvailabilityVisibilityChains) \
+    X(shaderOutputViewportIndex) X(shaderOutputLayer) X(subgroupBroadcastDynamicId)
+
+#define FEATURES_13(X) \
+    X(robustImageAccess) X(inlineUniformBlock) X(descriptorBindingInlineUniformBlockUpdateAfterBind) \
+    X(pipelineCreationCacheControl) X(privateData) X(shaderDemoteToHelperInvocation) X(shaderTerminateInvocation) \
+    X(subgroupSizeControl) X(computeFullSubgroups) X(synchronization2) X(textureCompressionASTC_HDR) \
+    X(shaderZeroInitializeWorkgroupMemory) X(dynamicRendering) X(shaderIntegerDotProduct) X(maintenance4)
+
+#define FEATURE_NAME(field) #field,
+
+constexpr const char* features10Names[] = { FEATURES_10(FEATURE_NAME) };
+constexpr const char* features11Names[] = { FEATURES_11(FEATURE_NAME) };
+constexpr const char* features12Names[] = { FEATURES_12(FEATURE_NAME) };
+constexpr const char* features13Names[] = { FEATURES_13(FEATURE_NAME) };
+
+#undef FEATURE_NAME
+
+// Names are matched to the fields by order, so every list must cover its struct densely in declaration order
+template<class T, size_t N>
+constexpr bool IsDense(const size_t (&offsets)[N]) {
+    for (size_t i = 0; i < N; ++i) {
+        if (offsets[i] != offsets[0] + i * sizeof(VkBool32)) {
+            return false;
+        }
+    }
+    // Structs with pNext may have tail padding
+    size_t end = offsets[0] + N * sizeof(VkBool32);
+    return end <= sizeof(T) && sizeof(T) - end < alignof(T);
+}
+
+#define FEATURE_OFFSET_10(field) offsetof(VkPhysicalDeviceFeatures, field),
+#define FEATURE_OFFSET_11(field) offsetof(VkPhysicalDeviceVulkan11Features, field),
+#define FEATURE_OFFSET_12(field) offsetof(VkPhysicalDeviceVulkan12Features, field),
+#define FEATURE_OFFSET_13(field) offsetof(VkPhysicalDeviceVulkan13Features, field),
+
+constexpr size_t features10Offsets[] = { FEATURES_10(FEATURE_OFFSET_10) };
+constexpr size_t features11Offsets[] = { FEATURES_11(FEATURE_OFFSET_11) };
+constexpr size_t features12Offsets[] = { FEATURES_12(FEATURE_OFFSET_12) };
+constexpr size_t features13Offsets[] = { FEATURES_13(FEATURE_OFFSET_13) };
+
+#undef FEATURE_OFFSET_10
+#undef FEATURE_OFFSET_11
+#undef FEATURE_OFFSET_12
+#undef FEATURE_OFFSET_13
+
+static_assert(IsDense<VkPhysicalDeviceFeatures>(features10Offsets), "Vulkan 1.0 features list mismatch");
+static_assert(IsDense<VkPhysicalDeviceVulkan11Features>(features11Offsets), "Vulkan 1.1 features list mismatch");
+static_assert(IsDense<VkPhysicalDeviceVulkan12Features>(features12Offsets), "Vulkan 1.2 features list mismatch");
+static_assert(IsDense<VkPhysicalDeviceVulkan13Features>(features13Offsets), "Vulkan 1.3 features list mismatch");
+
+// Description of a feature struct as an array of VkBool32
+struct FeatureStruct {
+    const char* name;
+    // Offset of the first feature in the struct
+    size_t offset;
+    uint32_t count;
+    const char* const* names;
+    // Struct is chained only if the device supports the version
+    uint32_t apiVersion;
+};
+
+template<size_t N>
+constexpr FeatureStruct DescribeFeatures(const char* name, size_t offset, const char* const (&names)[N],
+                                         uint32_t apiVersion) {
+    return { name, offset, static_cast<uint32_t>(N), names, apiVersion };
+}
+
+// In the order of FeatureSet::GetStruct
+constexpr FeatureStruct featureStructs[] = {
+    DescribeFeatures("Vulkan10", offsetof(VkPhysicalDeviceFeatures2, features), features10Names, VK_API_VERSION_1_0),
+    DescribeFeatures("Vulkan11", features11Offsets[0], features11Names, VK_API_VERSION_1_2),
+    DescribeFeatures("Vulkan12", features12Offsets[0], features12Names, VK_API_VERSION_1_2),
+    DescribeFeatures("Vulkan13", features13Offsets[0], features13Names, VK_API_VERSION_1_3),
+};
+
+/**
+ * @brief
+ * Find required features which are not supported
+ * @param required
+ * required features
+ * @param supported
+ * supported features
+ * @param count
+ * count of features
+ * @param missing
+ * indicies of the missing features. Optional, the search stops on the first one without it
+ * @return
+ * true if no feature is missing
+*/
+bool MatchFeatures(const VkBool32* required, const VkBool32* supported, uint32_t count,
+                   std::vector<uint32_t>* missing) {
+
+    bool matched = true;
+    uint32_t i = 0;
+
+#if FEATURE_SET_SSE2
+    // Any non zero value is VK_TRUE, so compare with zero instead of testing bits
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 4 <= count; i += 4) {
+        __m128i req = _mm_loadu_si128(reinterpret_cast<const __m128i*>(required + i));
+        __m128i sup = _mm_loadu_si128(reinterpret_cast<const __m128i*>(supported + i));
+        // Required and not supported
+        __m128i absent = _mm_andnot_si128(_mm_cmpeq_epi32(req, zero), _mm_cmpeq_epi32(sup, zero));
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(absent));
+        if (!mask) {
+            continue;
+        }
+        matched = false;
+        if (!missing) {
+            return false;
+        }
+        for (uint32_t lane = 0; lane < 4; ++lane) {
+            if (mask & (1 << lane)) {
+                missing->push_back(i + lane);
+            }
+        }
+    }
+#endif
+
+    for (; i < count; ++i) {
+        if (required[i] && !supported[i]) {
+            matched = false;
+            if (!missing) {
+                return false;
+            }
+            missing->push_back(i);
+        }
+    }
+
+    return matched;
+}
+
+} // namespace
+
+FeatureSet::FeatureSet() {
+    features.sType   = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features11.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES;
+    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+}
+
+FeatureSet::FeatureSet(const FeatureSet& other) : FeatureSet() {
+    *this = other;
+}
+
+FeatureSet& FeatureSet::operator=(const FeatureSet& other) {
+    // Chain pointers refer to the other set, so only the features are copied
+    for (size_t i = 0; i < structsCount; ++i) {
+        std::memcpy(GetBools(i), other.GetBools(i), featureStructs[i].count * sizeof(VkBool32));
+        GetStruct(i)->pNext = nullptr;
+    }
+    return *this;
+}
+
+VkBaseOutStructure* FeatureSet::GetStruct(size_t structIndex) {
+    switch (structIndex) {
+    case 0:
+        return reinterpret_cast<VkBaseOutStructure*>(&features);
+    case 1:
+        return reinterpret_cast<VkBaseOutStructure*>(&features11);
+    case 2:
+        return reinterpret_cast<VkBaseOutStructure*>(&features12);
+    default:
+        return reinterpret_cast<VkBaseOutStructure*>(&features13);
+    }
+}
+
+VkBool32* FeatureSet::GetBools(size_t structIndex) {
+    return reinterpret_cast<VkBool32*>(reinterpret_cast<uint8_t*>(GetStruct(structIndex)) +
+                                       featureStructs[structIndex].offset);
+}
+
+const VkBool32* FeatureSet::GetBools(size_t structIndex) const {
+    return const_cast<FeatureSet*>(this)->GetBools(structIndex);
+}
+
+void FeatureSet::Link(uint32_t apiVersion, bool skipEmpty) {
+
+    VkBaseOutStructure* last = GetStruct(0);
+    last->pNext = nullptr;
+    for (size_t i = 1; i < structsCount; ++i) {
+        auto* current = GetStruct(i);
+        current->pNext = nullptr;
+        if (apiVersion < featureStructs[i].apiVersion) {
+            continue;
+        }
+        if (skipEmpty) {
+            const VkBool32* bools = GetBools(i);
+            bool empty = std::all_of(bools, bools + featureStructs[i].count, [](VkBool32 b) { return !b; });
+            if (empty) {
+                continue;
+            }
+        }
+        last->pNext = current;
+        last = current;
+    }
+}
+
+void FeatureSet::Query(VkPhysicalDevice device, uint32_t deviceVersion, uint32_t instanceVersion) {
+
+    *this = FeatureSet();
+    // Structs of versions above the instance one are invalid in the chain even if the driver knows them
+    uint32_t apiVersion = std::min(deviceVersion, instanceVersion);
+    if (apiVersion < VK_API_VERSION_1_1) {
+        vkGetPhysicalDeviceFeatures(device, &features.features);
+        return;
+    }
+    Link(apiVersion, false);
+    vkGetPhysicalDeviceFeatures2(device, &features);
+    Link(0, false);
+}
+
+bool FeatureSet::Supports(const FeatureSet& required, std::vector<std::string>* missing) const {
+
+    bool supported = true;
+    std::vector<uint32_t> missingIndicies;
+    for (size_t i = 0; i < structsCount; ++i) {
+        const auto& desc = featureStructs[i];
+        missingIndicies.clear();
+        if (MatchFeatures(required.GetBools(i), GetBools(i), desc.count, missing ? &missingIndicies : nullptr)) {
+            continue;
+        }
+        supported = false;
+        if (!missing) {
+            return false;
+        }
+        for (auto index : missingIndicies) {
+            missing->push_back(std::string(desc.name) + "." + desc.names[index]);
+        }
+    }
+    return supported;
+}
+
+uint32_t FeatureSet::GetEnabledCount() const {
+    uint32_t count = 0;
+    for (size_t i = 0; i < structsCount; ++i) {
+        const VkBool32* bools = GetBools(i);
+        count += static_cast<uint32_t>(std::count_if(bools, bools + featureStructs[i].count,
+                                                     [](VkBool32 b) { return b != VK_FALSE; }));
+    }
+    return count;
+}
+
+std::vector<VkBool32> FeatureSet::Pack() const {
+    std::vector<VkBool32> bools;
+    for (size_t i = 0; i < structsCount; ++i) {
+        bools.insert(bools.end(), GetBools(i), GetBools(i) + featureStructs[i].count);
+    }
+    return bools;
+}
+
+bool FeatureSet::Unpack(const VkBool32* bools, size_t count) {
+    size_t total = 0;
+    for (size_t i = 0; i < structsCount; ++i) {
+        total += featureStructs[i].count;
+    }
+    if (count != total) {
+        return false;
+    }
+    for (size_t i = 0; i < structsCount; ++i) {
+        std::memcpy(GetBools(i), bools, featureStructs[i].count * sizeof(VkBool32));
+        bools += featureStructs[i].count;
+    }
+    return true;
+}
+
+const VkPhysicalDeviceFeatures2* FeatureSet::GetCreateChain() {
+    Link(~0u, true);
+    return &features;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vulkan_app/vk_base.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief
+ * Core device features of Vulkan 1.0-1.3 chained into VkPhysicalDeviceFeatures2.
+ * Every feature struct is handled as a plain array of VkBool32 described by a table,
+ * so required features are matched against the supported ones by SIMD compares
+ * and new feature structs are added with a table entry
+*/
+class FeatureSet {
+
+public:
+
+    FeatureSet();
+    FeatureSet(const FeatureSet& other);
+    FeatureSet& operator=(const FeatureSet& other);
+
+    /**
+     * @brief
+     * Get features supported by a physical device
+     * @param device
+     * physical device
+     * @param deviceVersion
+     * device API version
+     * @param instanceVersion
+     * API version the instance is created with. Only structs of the lower of the two versions are chained,
+     * the ones of the higher versions are left zeroed
+    */
+    void Query(VkPhysicalDevice device, uint32_t deviceVersion, uint32_t instanceVersion);
+
+    /**
+     * @brief
+     * Check if all the features enabled in required are supported by this set
+     * @param required
+     * required features
+     * @param missing
+     * names of the unsupported features like "Vulkan12.timelineSemaphore". Optional
+     * @return
+     * true if all the required features are supported
+    */
+    bool Supports(const FeatureSet& required, std::vector<std::string>* missing = nullptr) const;
+
+    // Count of enabled features
+    uint32_t GetEnabledCount() const;
+
+    // All the features as a flat array, to be stored
+    std::vector<VkBool32> Pack() const;
+    // Restore features from a Pack result. Fails if the count doesn't match
+    bool Unpack(const VkBool32* bools, size_t count);
+
+    /**
+     * @brief
+     * Chain to be passed to VkDeviceCreateInfo::pNext instead of pEnabledFeatures.
+     * Structs without enabled features are skipped, so the chain is valid for older devices
+    */
+    const VkPhysicalDeviceFeatures2* GetCreateChain();
+
+public:
+
+    VkPhysicalDeviceFeatures2 features{};
+    VkPhysicalDeviceVulkan11Features features11{};
+    VkPhysicalDeviceVulkan12Features features12{};
+    VkPhysicalDeviceVulkan13Features features13{};
+
+private:
+
+    static constexpr size_t structsCount = 4;
+
+    // Feature arrays in the order of the description table
+    const VkBool32* GetBools(size_t structIndex) const;
+    VkBool32* GetBools(size_t structIndex);
+    VkBaseOutStructure* GetStruct(size_t structIndex);
+    // Link extended structs into the chain of features
+    void Link(uint32_t apiVersion, bool skipEmpty);
+};
@@ -0,0 +1,189 @@
+#include <vulkan_app/frame_scheduler.h>
+
+#include <logs.h>
+#include <utils/profiler.h>
+
+#include <algorithm>
+#include <chrono>
+
+AppResult FrameScheduler::Init(VkDevice device, uint32_t queueFamily, uint32_t framesInFlight) {
+
+    dev = device;
+    framesInFlight = std::clamp(framesInFlight, 1u, maxFramesInFlight);
+    frames.resize(framesInFlight);
+
+    for (uint32_t i = 0; i < framesInFlight; ++i) {
+        auto& frame = frames[i];
+        frame.index = i;
+
+        // Command buffers are never reset one by one, the whole pool is reset every frame
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        poolInfo.queueFamilyIndex = queueFamily;
+
+        VkResult r = vkCreateCommandPool(dev, &poolInfo, nullptr, &frame.commandPool);
+        if (r != VK_SUCCESS) {
+            PRINT_E("Failed to create frame command pool. Vk error code: %d", r);
+            return APP_CODE_VK_COMMAND_FAIURE;
+        }
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool        = frame.commandPool;
+        allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+
+        r = vkAllocateCommandBuffers(dev, &allocInfo, &frame.commandBuffer);
+        if (r != VK_SUCCESS) {
+            PRINT_E("Failed to allocate frame command buffer. Vk error code: %d", r);
+            return APP_CODE_VK_COMMAND_FAIURE;
+        }
+
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+        r = vkCreateFence(dev, &fenceInfo, nullptr, &frame.fence);
+        if (r != VK_SUCCESS) {
+            PRINT_E("Failed to create frame fence. Vk error code: %d", r);
+            return APP_CODE_VK_COMMAND_FAIURE;
+        }
+
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+        r = vkCreateSemaphore(dev, &semaphoreInfo, nullptr, &frame.imageAcquired);
+        if (r != VK_SUCCESS) {
+            PRINT_E("Failed to create frame semaphore. Vk error code: %d", r);
+            return APP_CODE_VK_COMMAND_FAIURE;
+        }
+    }
+
+    current = 0;
+    submittedFrames = 0;
+    completedFrames = 0;
+    totalCpuWaitTime = 0.0;
+
+    PRINT("Frame scheduler created with %u frames in flight", framesInFlight);
+    return APP_CODE_OK;
+}
+
+FrameScheduler::Frame& FrameScheduler::BeginFrame() {
+
+    auto& frame = frames[current];
+
+    PROFILE_SCOPE("WaitFrameFence");
+    auto start = std::chrono::steady_clock::now();
+    vkWaitForFences(dev, 1, &frame.fence, VK_TRUE, UINT64_MAX);
+    frame.cpuWaitTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    totalCpuWaitTime += frame.cpuWaitTime;
+    // The fence was signaled by the frame framesInFlight frames back
+    if (submittedFrames >= frames.size()) {
+        completedFrames = std::max(completedFrames, submittedFrames - frames.size() + 1);
+    }
+
+    vkResetFences(dev, 1, &frame.fence);
+    vkResetCommandPool(dev, frame.commandPool, 0);
+    frame.number = submittedFrames;
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(frame.commandBuffer, &beginInfo);
+
+    return frame;
+}
+
+AppResult FrameScheduler::EndFrame(VkQueue queue, bool waitImageAcquired, VkSemaphore renderFinished,
+                                   const std::vector<AsyncQueue::SyncPoint>& timelineWaits) {
+
+    auto& frame = frames[current];
+
+    VkResult r = vkEndCommandBuffer(frame.commandBuffer);
+    if (r != VK_SUCCESS) {
+        PRINT_E("Failed to record frame commands. Vk error code: %d", r);
+        return APP_CODE_VK_COMMAND_FAIURE;
+    }
+
+    // Binary and timeline semaphores are waited together, values of binary ones are ignored
+    std::vector<VkSemaphore> waitSemaphores;
+    std::vector<uint64_t> waitValues;
+    std::vector<VkPipelineStageFlags> waitStages;
+    if (waitImageAcquired) {
+        waitSemaphores.push_back(frame.imageAcquired);
+        waitValues.push_back(0);
+        waitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+    }
+    for (const auto& wait : timelineWaits) {
+        waitSemaphores.push_back(wait.semaphore);
+        waitValues.push_back(wait.value);
+        waitStages.push_back(wait.stage);
+    }
+    bool signalRenderFinished = renderFinished != VK_NULL_HANDLE;
+    uint64_t signalValue = 0;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType                     = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount   = static_cast<uint32_t>(waitValues.size());
+    timelineInfo.pWaitSemaphoreValues      = waitValues.data();
+    timelineInfo.signalSemaphoreValueCount = signalRenderFinished ? 1 : 0;
+    timelineInfo.pSignalSemaphoreValues    = &signalValue;
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext                = timelineWaits.empty() ? nullptr : &timelineInfo;
+    submitInfo.waitSemaphoreCount   = static_cast<uint32_t>(waitSemaphores.size());
+    submitInfo.pWaitSemaphores      = waitSemaphores.data();
+    submitInfo.pWaitDstStageMask    = waitStages.data();
+    submitInfo.commandBufferCount   = 1;
+    submitInfo.pCommandBuffers      = &frame.commandBuffer;
+    submitInfo.signalSemaphoreCount = signalRenderFinished ? 1 : 0;
+    submitInfo.pSignalSemaphores    = &renderFinished;
+
+    r = vkQueueSubmit(queue, 1, &submitInfo, frame.fence);
+    if (r != VK_SUCCESS) {
+        PRINT_E("Failed to submit frame. Vk error code: %d", r);
+        return APP_CODE_VK_COMMAND_FAIURE;
+    }
+
+    ++submittedFrames;
+    current = (current + 1) % frames.size();
+    return APP_CODE_OK;
+}
+
+void FrameScheduler::WaitFrame(uint64_t number) {
+    if (number < completedFrames || number >= submittedFrames) {
+        return;
+    }
+    // Frame resources are used in a ring, in submission order
+    auto& frame = frames[number % frames.size()];
+    vkWaitForFences(dev, 1, &frame.fence, VK_TRUE, UINT64_MAX);
+    completedFrames = number + 1;
+}
+
+void FrameScheduler::WaitIdle() {
+    for (auto& frame : frames) {
+        if (frame.fence != VK_NULL_HANDLE) {
+            vkWaitForFences(dev, 1, &frame.fence, VK_TRUE, UINT64_MAX);
+        }
+    }
+    completedFrames = submittedFrames;
+}
+
+double FrameScheduler::GetAverageCpuWaitTime() const {
+    return submittedFrames ? totalCpuWaitTime / submittedFrames : 0.0;
+}
+
+void FrameScheduler::Clear() {
+    if (dev == VK_NULL_HANDLE) {
+        return;
+    }
+    for (auto& frame : frames) {
+        vkDestroySemaphore(dev, frame.imageAcquired, nullptr);
+        vkDestroyFence(dev, frame.fence, nullptr);
+        vkDestroyCommandPool(dev, frame.commandPool, nullptr);
+    }
+    frames.clear();
+    dev = VK_NULL_HANDLE;
+}
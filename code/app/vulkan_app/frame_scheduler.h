@@ -0,0 +1,93 @@
+#pragma once
+
+#include <app_consts.h>
+#include <app_result.h>
+#include <vulkan_app/async_queue.h>
+#include <vulkan_app/vk_base.h>
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief
+ * Keeps N frames in flight. Every frame has its own command pool reset as a whole,
+ * a fence signaled when GPU finishes the frame and a semaphore for swapchain acquire. Present semaphores
+ * belong to the swapchain images, as a present may still wait on one after the frame slot is reused.
+ * CPU records frame N+1 while GPU executes frame N and waits only when it runs N frames ahead
+*/
+class FrameScheduler {
+
+public:
+
+    static constexpr uint32_t maxFramesInFlight = APP_MAX_FRAMES_IN_FLIGHT;
+
+    struct Frame {
+        // Sequential number of the frame
+        uint64_t number = 0;
+        // Index of the frame resources in [0, framesInFlight)
+        uint32_t index  = 0;
+
+        VkCommandPool commandPool     = VK_NULL_HANDLE;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkFence fence                 = VK_NULL_HANDLE;
+        // Signaled by swapchain image acquire
+        VkSemaphore imageAcquired     = VK_NULL_HANDLE;
+
+        // Time CPU waited for the frame resources to be released by GPU, ms
+        double cpuWaitTime = 0.0;
+    };
+
+    AppResult Init(VkDevice device, uint32_t queueFamily, uint32_t framesInFlight);
+    void Clear();
+
+    /**
+     * @brief
+     * Wait for the frame resources to be free and begin recording of the frame command buffer
+     * @return
+     * the frame to record
+    */
+    Frame& BeginFrame();
+    /**
+     * @brief
+     * End recording and submit the frame
+     * @param queue
+     * queue to submit to
+     * @param waitImageAcquired
+     * make submission wait for imageAcquired semaphore
+     * @param renderFinished
+     * semaphore signaled by the submission for present, VK_NULL_HANDLE if nothing is presented
+     * @param timelineWaits
+     * async queues' timeline points the frame depends on, e.g. uploads
+     * @return
+     * AppResult code
+    */
+    AppResult EndFrame(VkQueue queue, bool waitImageAcquired, VkSemaphore renderFinished,
+                       const std::vector<AsyncQueue::SyncPoint>& timelineWaits = {});
+    /**
+     * @brief
+     * Wait for a submitted frame, the later ones keep running. The frame resources must not be reused yet,
+     * so the frame is one of the last framesInFlight submitted ones or an already completed one
+     * @param number
+     * sequential number of the frame
+    */
+    void WaitFrame(uint64_t number);
+    // Wait for all the submitted frames
+    void WaitIdle();
+
+    Frame& GetCurrentFrame() { return frames[current]; }
+    uint32_t GetFramesInFlight() const { return static_cast<uint32_t>(frames.size()); }
+    uint64_t GetSubmittedFramesCount() const { return submittedFrames; }
+    // Frames known to be completed by GPU. Frames complete in submission order
+    uint64_t GetCompletedFramesCount() const { return completedFrames; }
+    // Average time CPU waited for GPU per frame, ms
+    double GetAverageCpuWaitTime() const;
+
+private:
+
+    VkDevice dev = VK_NULL_HANDLE;
+    std::vector<Frame> frames;
+    uint32_t current = 0;
+    uint64_t submittedFrames = 0;
+    uint64_t completedFrames = 0;
+    double totalCpuWaitTime = 0.0;
+};
@@ -0,0 +1,282 @@
+#include <vulkan_app/gpu_culler.h>
+
+#include <app_consts.h>
+#include <logs.h>
+#include <scene/frustum.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// local_size_x of frustum_cull.comp
+constexpr uint32_t cullGroupSize = 64;
+// Scene uploads are split to fit the staging ring
+constexpr VkDeviceSize uploadChunkSize = 4 * 1024 * 1024;
+
+static_assert(sizeof(GpuCuller::Instance) == 96, "Instance must match the std430 layout of frustum_cull.comp");
+static_assert(sizeof(GpuCuller::Mesh) == 16, "Mesh must match the std430 layout of frustum_cull.comp");
+
+} // namespace
+
+AppResult GpuCuller::Init(VkDevice device, const VkPhysicalDeviceLimits& limits,
+                          const std::vector<uint32_t>& queueFamilies, MemoryAllocator& allocator,
+                          PipelineFactory& factory, BindlessTable& bindless, uint32_t framesInFlight,
+                          uint32_t maxInstances, uint32_t maxMeshes) {
+
+    dev            = device;
+    memAllocator   = &allocator;
+    bindlessTable  = &bindless;
+    families       = queueFamilies;
+    maxWorkGroupsX = limits.maxComputeWorkGroupCount[0];
+    stats          = {};
+
+    // Every instance may produce a draw
+    instancesCapacity = std::min(maxInstances, limits.maxDrawIndirectCount);
+    if (instancesCapacity < maxInstances) {
+        PRINT_W("GPU culling is limited to %u instances by maxDrawIndirectCount", instancesCapacity);
+    }
+    instancesCount = 0;
+    meshesCapacity = std::max(maxMeshes, 1u);
+
+    APP_CHECK_CALL(RequestPipeline(factory));
+
+    constexpr VkBufferUsageFlags sceneUsage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    APP_CHECK_CALL(CreateBuffer(VkDeviceSize(instancesCapacity) * sizeof(Instance), sceneUsage,
+                                MemoryAllocator::MemoryUsage::GpuOnly, instances, instancesMemory));
+    APP_CHECK_CALL(CreateBuffer(VkDeviceSize(meshesCapacity) * sizeof(Mesh), sceneUsage,
+                                MemoryAllocator::MemoryUsage::GpuOnly, meshes, meshesMemory));
+    instancesIndex = bindlessTable->AddBuffer(instances, 0, VK_WHOLE_SIZE);
+    meshesIndex    = bindlessTable->AddBuffer(meshes, 0, VK_WHOLE_SIZE);
+
+    frames.resize(framesInFlight);
+    for (auto& frame : frames) {
+        APP_CHECK_CALL(CreateBuffer(VkDeviceSize(instancesCapacity) * sizeof(VkDrawIndexedIndirectCommand),
+                                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                                    MemoryAllocator::MemoryUsage::GpuOnly, frame.draws, frame.drawsMemory));
+        APP_CHECK_CALL(CreateBuffer(sizeof(uint32_t),
+                                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                                    VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                    MemoryAllocator::MemoryUsage::GpuOnly, frame.count, frame.countMemory));
+        APP_CHECK_CALL(CreateBuffer(sizeof(uint32_t), VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                    MemoryAllocator::MemoryUsage::GpuToCpu, frame.readback, frame.readbackMemory));
+        frame.drawsIndex = bindlessTable->AddBuffer(frame.draws, 0, VK_WHOLE_SIZE);
+        frame.countIndex = bindlessTable->AddBuffer(frame.count, 0, VK_WHOLE_SIZE);
+        frame.recorded   = false;
+    }
+
+    if (instancesIndex == BindlessTable::invalidIndex || meshesIndex == BindlessTable::invalidIndex ||
+        std::any_of(frames.begin(), frames.end(), [](const FrameBuffers& frame) {
+            return frame.drawsIndex == BindlessTable::invalidIndex || frame.countIndex == BindlessTable::invalidIndex;
+        })) {
+        return APP_CODE_UNKNOWN;
+    }
+
+    PRINT("GPU culler created for %u instances and %u meshes", instancesCapacity, meshesCapacity);
+    return APP_CODE_OK;
+}
+
+AppResult GpuCuller::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
+                                  MemoryAllocator::MemoryUsage memoryUsage, VkBuffer& buffer,
+                                  MemoryAllocation*& memory) {
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size  = size;
+    bufferInfo.usage = usage;
+    // Scene is uploaded by the transfer queue and read by the compute one, draws are written by the compute
+    // queue and read by the graphics one. Readbacks are only copied to on the compute queue
+    bool shared = memoryUsage == MemoryAllocator::MemoryUsage::GpuOnly;
+    if (shared && families.size() > 1) {
+        bufferInfo.sharingMode           = VK_SHARING_MODE_CONCURRENT;
+        bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(families.size());
+        bufferInfo.pQueueFamilyIndices   = families.data();
+    } else {
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+
+    return memAllocator->CreateBuffer(bufferInfo, memoryUsage, buffer, memory);
+}
+
+AppResult GpuCuller::RequestPipeline(PipelineFactory& factory) {
+
+    PipelineFactory::Key shader = 0;
+    APP_CHECK_CALL(factory.LoadShader("frustum_cull.comp", shader));
+
+    PipelineFactory::ComputeDesc desc;
+    desc.shader    = shader;
+    desc.layout    = bindlessTable->GetPipelineLayout();
+    desc.layoutKey = BindlessTable::pipelineLayoutKey;
+
+    // Compiled in background, frames skip culling until it is ready
+    pipelineFactory = &factory;
+    pipelineKey     = factory.RequestCompute(desc);
+    if (factory.GetState(pipelineKey) == PipelineFactory::State::Failed) {
+        return APP_CODE_VK_COMMAND_FAIURE;
+    }
+
+    return APP_CODE_OK;
+}
+
+AppResult GpuCuller::Upload(StagingRing& staging, const void* data, VkDeviceSize size, VkBuffer dst) {
+
+    auto bytes = static_cast<const uint8_t*>(data);
+    for (VkDeviceSize uploaded = 0; uploaded < size; uploaded += uploadChunkSize) {
+        VkDeviceSize chunk = std::min(uploadChunkSize, size - uploaded);
+        VkDeviceSize offset = 0;
+        void* mapped = staging.Reserve(chunk, 16, offset);
+        if (!mapped) {
+            return APP_CODE_UNKNOWN;
+        }
+        std::memcpy(mapped, bytes + uploaded, static_cast<size_t>(chunk));
+        staging.CopyToBuffer(offset, chunk, dst, uploaded);
+    }
+    return APP_CODE_OK;
+}
+
+AppResult GpuCuller::SetScene(StagingRing& staging, const std::vector<Instance>& sceneInstances,
+                              const std::vector<Mesh>& sceneMeshes) {
+
+    if (sceneInstances.size() > instancesCapacity || sceneMeshes.size() > meshesCapacity) {
+        PRINT_E("Scene of %zu instances and %zu meshes exceeds GPU culler capacity", sceneInstances.size(),
+                sceneMeshes.size());
+        return APP_CODE_INVALID_ARGS;
+    }
+
+    APP_CHECK_CALL(Upload(staging, sceneInstances.data(), sceneInstances.size() * sizeof(Instance), instances));
+    APP_CHECK_CALL(Upload(staging, sceneMeshes.data(), sceneMeshes.size() * sizeof(Mesh), meshes));
+    instancesCount = static_cast<uint32_t>(sceneInstances.size());
+
+    PRINT("GPU culling scene uploaded: %u instances, %zu meshes", instancesCount, sceneMeshes.size());
+    return APP_CODE_OK;
+}
+
+void GpuCuller::BeginFrame(uint32_t frameIndex) {
+    auto& frame = frames[frameIndex];
+    if (!frame.recorded) {
+        return;
+    }
+    // The frame fence is waited, so the copy is finished
+    uint32_t visible = 0;
+    std::memcpy(&visible, frame.readbackMemory->mapped, sizeof(visible));
+    ++stats.culledFrames;
+    stats.visibleTotal += visible;
+    stats.lastVisible   = visible;
+    frame.recorded = false;
+}
+
+bool GpuCuller::RecordCull(VkCommandBuffer cmd, uint32_t frameIndex, const glm::mat4& viewProj) {
+
+    VkPipeline pipeline = pipelineFactory->GetPipeline(pipelineKey);
+    if (pipeline == VK_NULL_HANDLE) {
+        ++stats.skippedFrames;
+        return false;
+    }
+
+    auto& frame = frames[frameIndex];
+
+    vkCmdFillBuffer(cmd, frame.count, 0, sizeof(uint32_t), 0);
+
+    VkMemoryBarrier barrier{};
+    barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                         1, &barrier, 0, nullptr, 0, nullptr);
+
+    CullParams params{};
+    ExtractFrustumPlanes(viewProj, params.planes);
+    params.instanceCount  = instancesCount;
+    params.instancesIndex = instancesIndex;
+    params.meshesIndex    = meshesIndex;
+    params.drawsIndex     = frame.drawsIndex;
+    params.countIndex     = frame.countIndex;
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+    bindlessTable->Bind(cmd, VK_PIPELINE_BIND_POINT_COMPUTE);
+    vkCmdPushConstants(cmd, bindlessTable->GetPipelineLayout(), VK_SHADER_STAGE_ALL, 0, sizeof(params), &params);
+
+    uint32_t groups = (instancesCount + cullGroupSize - 1) / cullGroupSize;
+    if (groups) {
+        uint32_t groupsX = std::min(groups, maxWorkGroupsX);
+        vkCmdDispatch(cmd, groupsX, (groups + groupsX - 1) / groupsX, 1);
+    }
+
+    // The count is copied for the statistics. Readers on other queues are ordered by the timeline
+    // semaphore the submission signals
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                         1, &barrier, 0, nullptr, 0, nullptr);
+
+    VkBufferCopy region{};
+    region.size = sizeof(uint32_t);
+    vkCmdCopyBuffer(cmd, frame.count, frame.readback, 1, &region);
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+                         1, &barrier, 0, nullptr, 0, nullptr);
+
+    frame.recorded = true;
+    return true;
+}
+
+void GpuCuller::PrintStats() const {
+    if (stats.skippedFrames) {
+        PRINT("GPU culling skipped %llu frames while the pipeline was compiling",
+              static_cast<unsigned long long>(stats.skippedFrames));
+    }
+    if (!stats.culledFrames) {
+        return;
+    }
+    double averageVisible = static_cast<double>(stats.visibleTotal) / stats.culledFrames;
+    PRINT("GPU culling: %u instances, %.0f visible on average (%.1f%%) over %llu frames", instancesCount,
+          averageVisible, instancesCount ? 100.0 * averageVisible / instancesCount : 0.0,
+          static_cast<unsigned long long>(stats.culledFrames));
+}
+
+void GpuCuller::Clear() {
+    if (dev == VK_NULL_HANDLE) {
+        return;
+    }
+
+    auto release = [this](uint32_t& index) {
+        if (index != BindlessTable::invalidIndex) {
+            bindlessTable->Release(BindlessTable::Kind::Buffer, index);
+            index = BindlessTable::invalidIndex;
+        }
+    };
+
+    for (auto& frame : frames) {
+        release(frame.drawsIndex);
+        release(frame.countIndex);
+        if (frame.draws != VK_NULL_HANDLE) {
+            memAllocator->DestroyBuffer(frame.draws, frame.drawsMemory);
+        }
+        if (frame.count != VK_NULL_HANDLE) {
+            memAllocator->DestroyBuffer(frame.count, frame.countMemory);
+        }
+        if (frame.readback != VK_NULL_HANDLE) {
+            memAllocator->DestroyBuffer(frame.readback, frame.readbackMemory);
+        }
+    }
+    release(instancesIndex);
+    release(meshesIndex);
+    if (instances != VK_NULL_HANDLE) {
+        memAllocator->DestroyBuffer(instances, instancesMemory);
+    }
+    if (meshes != VK_NULL_HANDLE) {
+        memAllocator->DestroyBuffer(meshes, meshesMemory);
+    }
+
+    frames.clear();
+    instances       = VK_NULL_HANDLE;
+    instancesMemory = nullptr;
+    meshes          = VK_NULL_HANDLE;
+    meshesMemory    = nullptr;
+    pipelineFactory = nullptr;
+    pipelineKey     = 0;
+    instancesCount  = 0;
+    dev             = VK_NULL_HANDLE;
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <app_result.h>
+#include <vulkan_app/bindless_table.h>
+#include <vulkan_app/memory_allocator.h>
+#include <vulkan_app/pipeline_factory.h>
+#include <vulkan_app/staging_ring.h>
+#include <vulkan_app/vk_base.h>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief
+ * GPU-driven instance culling. A compute pass tests instances' bounding spheres against the frustum
+ * and appends a VkDrawIndexedIndirectCommand per visible instance to a compacted buffer, with the count
+ * of the draws next to it for vkCmdDrawIndexedIndirectCount. CPU cost of a frame doesn't depend on the
+ * count of instances.
+ * Buffers are accessed through the bindless table, draw buffers are per frame in flight.
+ * Culling is recorded into a compute queue submission the frame waits for before the draws
+*/
+class GpuCuller {
+
+public:
+
+    // Matches Instance of frustum_cull.comp (std430)
+    struct Instance {
+        glm::mat4 model;
+        // Bounding sphere in model space: xyz is the center, w is the radius
+        glm::vec4 boundingSphere;
+        uint32_t mesh;
+        uint32_t padding[3];
+    };
+
+    // Matches Mesh of frustum_cull.comp (std430)
+    struct Mesh {
+        uint32_t indexCount;
+        uint32_t firstIndex;
+        int32_t  vertexOffset;
+        uint32_t padding;
+    };
+
+    struct Stats {
+        uint64_t culledFrames    = 0;
+        uint64_t visibleTotal    = 0;
+        uint32_t lastVisible     = 0;
+        // Frames not culled while the pipeline was compiling
+        uint64_t skippedFrames   = 0;
+    };
+
+    /**
+     * @brief
+     * Request the culling pipeline and create the buffers
+     * @param device
+     * logical device
+     * @param limits
+     * physical device limits
+     * @param queueFamilies
+     * families accessing the buffers. Graphics, compute and transfer ones
+     * @param allocator
+     * device memory allocator
+     * @param factory
+     * pipeline factory compiling the pipeline in background
+     * @param bindless
+     * bindless table providing the pipeline layout and indexing the buffers
+     * @param framesInFlight
+     * count of the draw buffers
+     * @param maxInstances
+     * capacity of the instance buffer
+     * @param maxMeshes
+     * capacity of the mesh buffer
+     * @return
+     * AppResult code
+    */
+    AppResult Init(VkDevice device, const VkPhysicalDeviceLimits& limits, const std::vector<uint32_t>& queueFamilies,
+                   MemoryAllocator& allocator, PipelineFactory& factory, BindlessTable& bindless,
+                   uint32_t framesInFlight, uint32_t maxInstances, uint32_t maxMeshes);
+    void Clear();
+
+    /**
+     * @brief
+     * Upload the instances and the meshes through the staging ring. Replaces the previous ones.
+     * Frames must wait for the ring uploads before culling
+     * @param staging
+     * staging ring to upload with
+     * @param instances
+     * instances, at most maxInstances
+     * @param meshes
+     * meshes referenced by the instances, at most maxMeshes
+     * @return
+     * AppResult code
+    */
+    AppResult SetScene(StagingRing& staging, const std::vector<Instance>& instances, const std::vector<Mesh>& meshes);
+
+    // Collect the visible count of the frame finished by GPU. Call after the frame resources are acquired
+    void BeginFrame(uint32_t frameIndex);
+    /**
+     * @brief
+     * Cull the instances and fill the draw buffer of the frame
+     * @param cmd
+     * command buffer of a queue with compute support. Submission of it must wait for the scene upload
+     * @return
+     * false if the pipeline is still compiling and nothing is recorded
+    */
+    bool RecordCull(VkCommandBuffer cmd, uint32_t frameIndex, const glm::mat4& viewProj);
+
+    uint32_t GetInstancesCount() const { return instancesCount; }
+    const Stats& GetStats() const { return stats; }
+    void PrintStats() const;
+
+private:
+
+    // Matches CullParams of frustum_cull.comp
+    struct CullParams {
+        glm::vec4 planes[6];
+        uint32_t instanceCount;
+        uint32_t instancesIndex;
+        uint32_t meshesIndex;
+        uint32_t drawsIndex;
+        uint32_t countIndex;
+    };
+    // Aligned GLM types pad the struct to 128 bytes
+    static_assert(sizeof(CullParams) <= BindlessTable::pushConstantsSize, "CullParams exceed the push constants");
+
+    struct FrameBuffers {
+        VkBuffer draws = VK_NULL_HANDLE;
+        MemoryAllocation* drawsMemory = nullptr;
+        uint32_t drawsIndex = BindlessTable::invalidIndex;
+        VkBuffer count = VK_NULL_HANDLE;
+        MemoryAllocation* countMemory = nullptr;
+        uint32_t countIndex = BindlessTable::invalidIndex;
+        // Host visible copy of the count
+        VkBuffer readback = VK_NULL_HANDLE;
+        MemoryAllocation* readbackMemory = nullptr;
+        bool recorded = false;
+    };
+
+    AppResult CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, MemoryAllocator::MemoryUsage memoryUsage,
+                           VkBuffer& buffer, MemoryAllocation*& memory);
+    AppResult RequestPipeline(PipelineFactory& factory);
+    AppResult Upload(StagingRing& staging, const void* data, VkDeviceSize size, VkBuffer dst);
+
+private:
+
+    VkDevice dev = VK_NULL_HANDLE;
+    MemoryAllocator* memAllocator = nullptr;
+    BindlessTable* bindlessTable = nullptr;
+    std::vector<uint32_t> families;
+
+    PipelineFactory* pipelineFactory = nullptr;
+    PipelineFactory::Key pipelineKey = 0;
+    uint32_t maxWorkGroupsX = 0;
+
+    VkBuffer instances = VK_NULL_HANDLE;
+    MemoryAllocation* instancesMemory = nullptr;
+    uint32_t instancesIndex = BindlessTable::invalidIndex;
+    VkBuffer meshes = VK_NULL_HANDLE;
+    MemoryAllocation* meshesMemory = nullptr;
+    uint32_t meshesIndex = BindlessTable::invalidIndex;
+    uint32_t meshesCapacity = 0;
+
+    std::vector<FrameBuffers> frames;
+    uint32_t instancesCapacity = 0;
+    uint32_t instancesCount = 0;
+
+    Stats stats;
+};
@@ -0,0 +1,147 @@
+#include <vulkan_app/gpu_mesh.h>
+
+#include <app_consts.h>
+#include <logs.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+
+AppResult GpuMesh::Load(VkDevice device, const std::vector<uint32_t>& queueFamilies, MemoryAllocator& allocator,
+                        StagingRing& staging, AsyncQueue& transfer, const char* path) {
+
+    Clear();
+
+    dev          = device;
+    memAllocator = &allocator;
+    stagingRing  = &staging;
+    families     = queueFamilies;
+    stats        = {};
+
+    auto start = std::chrono::steady_clock::now();
+    MeshFile file;
+    APP_CHECK_CALL(file.Open(path));
+    header = file.GetHeader();
+    auto opened = std::chrono::steady_clock::now();
+
+    APP_CHECK_CALL(CreateBuffer(file.GetSectionSize(MeshFile::Vertices),
+                                VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                vertexBuffer, vertexMemory));
+    APP_CHECK_CALL(CreateBuffer(file.GetSectionSize(MeshFile::Indices),
+                                VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                indexBuffer, indexMemory));
+
+    auto copyStart = std::chrono::steady_clock::now();
+    APP_CHECK_CALL(UploadSection(file, MeshFile::Vertices, vertexBuffer));
+    APP_CHECK_CALL(UploadSection(file, MeshFile::Indices, indexBuffer));
+    auto copied = std::chrono::steady_clock::now();
+    // The data is in the ring now, the mapping isn't needed
+    file.Close();
+
+    // Loads happen before the first frame, waiting gives the time from the file to device memory
+    uint64_t value = 0;
+    APP_CHECK_CALL(stagingRing->Flush(value));
+    APP_CHECK_CALL(transfer.Wait(value));
+
+    stats.openTime = std::chrono::duration<double, std::milli>(opened - start).count();
+    stats.copyTime = std::chrono::duration<double, std::milli>(copied - copyStart).count();
+    stats.loadTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    double throughput = stats.loadTime > 0.0 ? stats.uploadedBytes / (1024.0 * 1024.0) / (stats.loadTime / 1000.0) : 0.0;
+    PRINT("Mesh %s loaded: %u vertices, %u triangles, %u-bit indices, %.1f KiB in %.3f ms (%.1f MiB/s)",
+          path, header.vertexCount, header.indexCount / 3, header.indexSize * 8, stats.uploadedBytes / 1024.0,
+          stats.loadTime, throughput);
+
+    return APP_CODE_OK;
+}
+
+void GpuMesh::Clear() {
+    if (dev == VK_NULL_HANDLE) {
+        return;
+    }
+
+    if (vertexBuffer != VK_NULL_HANDLE) {
+        memAllocator->DestroyBuffer(vertexBuffer, vertexMemory);
+    }
+    if (indexBuffer != VK_NULL_HANDLE) {
+        memAllocator->DestroyBuffer(indexBuffer, indexMemory);
+    }
+
+    vertexBuffer = VK_NULL_HANDLE;
+    vertexMemory = nullptr;
+    indexBuffer  = VK_NULL_HANDLE;
+    indexMemory  = nullptr;
+    header       = {};
+    families.clear();
+    stagingRing  = nullptr;
+    memAllocator = nullptr;
+    dev          = VK_NULL_HANDLE;
+}
+
+void GpuMesh::GetVertexInput(uint32_t binding, VkVertexInputBindingDescription& bindingDesc,
+                             std::array<VkVertexInputAttributeDescription, 3>& attributes) {
+
+    bindingDesc = {};
+    bindingDesc.binding   = binding;
+    bindingDesc.stride    = sizeof(MeshFile::Vertex);
+    bindingDesc.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+    const VkFormat formats[] = { VK_FORMAT_R16G16B16A16_UNORM, VK_FORMAT_R16G16_SNORM, VK_FORMAT_R16G16_UNORM };
+    const size_t offsets[] = {
+        offsetof(MeshFile::Vertex, position),
+        offsetof(MeshFile::Vertex, normal),
+        offsetof(MeshFile::Vertex, uv),
+    };
+    for (uint32_t i = 0; i < attributes.size(); ++i) {
+        attributes[i].location = i;
+        attributes[i].binding  = binding;
+        attributes[i].format   = formats[i];
+        attributes[i].offset   = static_cast<uint32_t>(offsets[i]);
+    }
+}
+
+void GpuMesh::PrintStats() const {
+    if (!stats.uploadedBytes) {
+        return;
+    }
+    PRINT("Mesh: %.1f KiB uploaded, %.3f ms to map, %.3f ms to copy into the staging ring, %.3f ms until on GPU",
+          stats.uploadedBytes / 1024.0, stats.openTime, stats.copyTime, stats.loadTime);
+}
+
+AppResult GpuMesh::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer,
+                                MemoryAllocation*& memory) {
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size  = size;
+    bufferInfo.usage = usage;
+    // Uploaded by the transfer queue and read by the graphics one
+    if (families.size() > 1) {
+        bufferInfo.sharingMode           = VK_SHARING_MODE_CONCURRENT;
+        bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(families.size());
+        bufferInfo.pQueueFamilyIndices   = families.data();
+    } else {
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+
+    return memAllocator->CreateBuffer(bufferInfo, MemoryAllocator::MemoryUsage::GpuOnly, buffer, memory);
+}
+
+AppResult GpuMesh::UploadSection(const MeshFile& file, MeshFile::Section section, VkBuffer dst) {
+
+    const uint8_t* data = file.GetSectionData(section);
+    uint64_t size = file.GetSectionSize(section);
+    for (uint64_t uploaded = 0; uploaded < size; uploaded += APP_MESH_UPLOAD_CHUNK) {
+        VkDeviceSize chunk = std::min<uint64_t>(APP_MESH_UPLOAD_CHUNK, size - uploaded);
+        VkDeviceSize offset = 0;
+        void* staging = stagingRing->Reserve(chunk, sizeof(uint32_t), offset);
+        if (!staging) {
+            PRINT_E("Mesh upload chunk of %llu bytes exceeds the staging ring", static_cast<unsigned long long>(chunk));
+            return APP_CODE_UNKNOWN;
+        }
+        std::memcpy(staging, data + uploaded, static_cast<size_t>(chunk));
+        stagingRing->CopyToBuffer(offset, chunk, dst, uploaded);
+        stats.uploadedBytes += chunk;
+    }
+    return APP_CODE_OK;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <app_result.h>
+#include <scene/mesh_file.h>
+#include <vulkan_app/async_queue.h>
+#include <vulkan_app/memory_allocator.h>
+#include <vulkan_app/staging_ring.h>
+#include <vulkan_app/vk_base.h>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief
+ * Vertex and index buffers of a MeshFile in device local memory. The file is memory mapped and its sections
+ * are copied from the mapping straight into the staging ring: no parsing and no intermediate heap copies.
+ * Vertices stay quantized on GPU, shaders scale positions and uvs by the bounds of GetHeader
+*/
+class GpuMesh {
+
+public:
+
+    struct Stats {
+        uint64_t uploadedBytes = 0;
+        // Mapping and validating the file
+        double openTime        = 0.0;
+        // Copying the sections into the staging ring, includes page faults of the mapping
+        double copyTime        = 0.0;
+        // From the start of the load until the transfer queue finished the copies
+        double loadTime        = 0.0;
+    };
+
+    GpuMesh() = default;
+    GpuMesh(const GpuMesh&) = delete;
+
+    /**
+     * @brief
+     * Create the buffers and upload the mesh. Waits for the transfer queue to report the whole load time
+     * @param device
+     * logical device
+     * @param queueFamilies
+     * families accessing the buffers. Graphics and transfer ones
+     * @param allocator
+     * device memory allocator
+     * @param staging
+     * staging ring uploading the sections
+     * @param transfer
+     * queue of the staging ring
+     * @param path
+     * mesh file path
+     * @return
+     * AppResult code
+    */
+    AppResult Load(VkDevice device, const std::vector<uint32_t>& queueFamilies, MemoryAllocator& allocator,
+                   StagingRing& staging, AsyncQueue& transfer, const char* path);
+    void Clear();
+
+    /**
+     * @brief
+     * Vertex input of the quantized vertices: position, octahedral normal and uv at locations 0-2
+     * @param binding
+     * binding index of the vertex buffer
+     * @param bindingDesc
+     * binding description of the vertex buffer
+     * @param attributes
+     * attribute descriptions
+    */
+    static void GetVertexInput(uint32_t binding, VkVertexInputBindingDescription& bindingDesc,
+                               std::array<VkVertexInputAttributeDescription, 3>& attributes);
+
+    VkBuffer GetVertexBuffer() const { return vertexBuffer; }
+    VkBuffer GetIndexBuffer() const { return indexBuffer; }
+    VkIndexType GetIndexType() const { return header.indexSize == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32; }
+    uint32_t GetIndexCount() const { return header.indexCount; }
+    // Counts and dequantization bounds
+    const MeshFile::FileHeader& GetHeader() const { return header; }
+
+    const Stats& GetStats() const { return stats; }
+    void PrintStats() const;
+
+private:
+
+    AppResult CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer, MemoryAllocation*& memory);
+    // Copy a section through the staging ring in chunks, so meshes larger than the ring are fine
+    AppResult UploadSection(const MeshFile& file, MeshFile::Section section, VkBuffer dst);
+
+private:
+
+    VkDevice dev = VK_NULL_HANDLE;
+    MemoryAllocator* memAllocator = nullptr;
+    StagingRing* stagingRing = nullptr;
+    std::vector<uint32_t> families;
+
+    MeshFile::FileHeader header{};
+    VkBuffer vertexBuffer = VK_NULL_HANDLE;
+    MemoryAllocation* vertexMemory = nullptr;
+    VkBuffer indexBuffer = VK_NULL_HANDLE;
+    MemoryAllocation* indexMemory = nullptr;
+
+    Stats stats;
+};
@@ -0,0 +1,121 @@
+#include <vulkan_app/gpu_profiler.h>
+
+#include <logs.h>
+
+#include <algorithm>
+
+AppResult GpuProfiler::Init(VkDevice device, const VkPhysicalDeviceProperties& properties, uint32_t timestampValidBits,
+                            uint32_t framesInFlight) {
+
+    dev = device;
+    if (!timestampValidBits || properties.limits.timestampPeriod <= 0.0f) {
+        PRINT_W("Timestamps are not supported by the queue, GPU profiling is disabled");
+        return APP_CODE_OK;
+    }
+    timestampPeriod = properties.limits.timestampPeriod;
+    timestampMask   = (timestampValidBits >= 64) ? ~0ull : ((1ull << timestampValidBits) - 1);
+
+    // Begin and end timestamps of every scope
+    VkQueryPoolCreateInfo poolInfo{};
+    poolInfo.sType      = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType  = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = framesInFlight * maxScopesPerFrame * 2;
+
+    VkResult r = vkCreateQueryPool(dev, &poolInfo, nullptr, &queryPool);
+    if (r != VK_SUCCESS) {
+        PRINT_E("Failed to create timestamp query pool. Vk error code: %d", r);
+        return APP_CODE_VK_COMMAND_FAIURE;
+    }
+
+    frames = std::vector<FrameQueries>(framesInFlight);
+    for (auto& frame : frames) {
+        frame.names.resize(maxScopesPerFrame);
+    }
+
+    return APP_CODE_OK;
+}
+
+void GpuProfiler::BeginFrame(VkCommandBuffer cmd, uint32_t frameIndex) {
+
+    if (!IsEnabled()) {
+        return;
+    }
+    ReadResults(frameIndex);
+
+    currentFrame = frameIndex;
+    frames[frameIndex].cpuStart = Profiler::Now();
+    vkCmdResetQueryPool(cmd, queryPool, frameIndex * maxScopesPerFrame * 2, maxScopesPerFrame * 2);
+}
+
+uint32_t GpuProfiler::BeginScope(VkCommandBuffer cmd, const char* name) {
+
+    if (!IsEnabled()) {
+        return invalidScope;
+    }
+    auto& frame = frames[currentFrame];
+    uint32_t scope = frame.scopesCount.fetch_add(1, std::memory_order_relaxed);
+    if (scope >= maxScopesPerFrame) {
+        return invalidScope;
+    }
+    frame.names[scope] = name;
+
+    uint32_t query = (currentFrame * maxScopesPerFrame + scope) * 2;
+    vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, query);
+    return scope;
+}
+
+void GpuProfiler::EndScope(VkCommandBuffer cmd, uint32_t scope) {
+
+    if (scope == invalidScope) {
+        return;
+    }
+    uint32_t query = (currentFrame * maxScopesPerFrame + scope) * 2 + 1;
+    vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, query);
+}
+
+void GpuProfiler::ReadResults(uint32_t frameIndex) {
+
+    auto& frame = frames[frameIndex];
+    uint32_t scopesCount = std::min(frame.scopesCount.exchange(0, std::memory_order_relaxed), maxScopesPerFrame);
+    if (!scopesCount) {
+        return;
+    }
+
+    std::vector<uint64_t> timestamps(scopesCount * 2);
+    VkResult r = vkGetQueryPoolResults(dev, queryPool, frameIndex * maxScopesPerFrame * 2, scopesCount * 2,
+                                       timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t),
+                                       VK_QUERY_RESULT_64_BIT);
+    if (r != VK_SUCCESS) {
+        // Not ready results are skipped, the frame is lost for GPU statistics
+        return;
+    }
+
+    uint64_t gpuStart = ~0ull;
+    for (uint32_t i = 0; i < scopesCount; ++i) {
+        gpuStart = std::min(gpuStart, timestamps[i * 2] & timestampMask);
+    }
+
+    for (uint32_t i = 0; i < scopesCount; ++i) {
+        uint64_t begin = timestamps[i * 2] & timestampMask;
+        uint64_t end = std::max(begin, timestamps[i * 2 + 1] & timestampMask);
+        uint64_t cpuBegin = frame.cpuStart + static_cast<uint64_t>((begin - gpuStart) * timestampPeriod);
+        uint64_t cpuEnd = frame.cpuStart + static_cast<uint64_t>((end - gpuStart) * timestampPeriod);
+        Profiler::Inst().AddEvent(frame.names[i], cpuBegin, cpuEnd, Profiler::EventKind::Gpu);
+    }
+}
+
+void GpuProfiler::Clear() {
+    if (dev == VK_NULL_HANDLE) {
+        return;
+    }
+    if (queryPool != VK_NULL_HANDLE) {
+        // Results of the last frames. Device must be idle
+        for (uint32_t i = 0; i < frames.size(); ++i) {
+            ReadResults(i);
+        }
+        vkDestroyQueryPool(dev, queryPool, nullptr);
+    }
+    frames.clear();
+    queryPool = VK_NULL_HANDLE;
+    dev       = VK_NULL_HANDLE;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <app_result.h>
+#include <utils/profiler.h>
+#include <vulkan_app/vk_base.h>
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Declare a GPU scope around the commands recorded until the end of the C++ scope
+#define PROFILE_GPU_SCOPE(profiler, cmd, name) \
+    GpuProfileScope _PROFILE_CONCAT(_gpuProfileScope, __LINE__)(profiler, cmd, name)
+
+/**
+ * @brief
+ * GPU scopes measured with timestamp queries. Every frame in flight has its own range of queries,
+ * read back when the frame slot is reused, so reading never waits for GPU.
+ * Results are passed to Profiler with GPU frame start placed at the CPU frame start
+*/
+class GpuProfiler {
+
+public:
+
+    static constexpr uint32_t invalidScope = ~0u;
+    static constexpr uint32_t maxScopesPerFrame = 64;
+
+    /**
+     * @brief
+     * Create the query pool
+     * @param device
+     * logical device
+     * @param properties
+     * physical device properties with timestampPeriod
+     * @param timestampValidBits
+     * timestampValidBits of the queue family. Profiling is disabled if it's zero
+     * @param framesInFlight
+     * count of frames in flight
+     * @return
+     * AppResult code
+    */
+    AppResult Init(VkDevice device, const VkPhysicalDeviceProperties& properties, uint32_t timestampValidBits,
+                   uint32_t framesInFlight);
+    void Clear();
+
+    /**
+     * @brief
+     * Read back the previous results of the frame slot and reset its queries.
+     * Previous submission of the frame must be completed
+     * @param cmd
+     * primary command buffer of the frame in recording state
+     * @param frameIndex
+     * index of the frame in flight
+    */
+    void BeginFrame(VkCommandBuffer cmd, uint32_t frameIndex);
+    // Thread safe. Returns invalidScope if profiling is disabled or the frame has too many scopes
+    uint32_t BeginScope(VkCommandBuffer cmd, const char* name);
+    void EndScope(VkCommandBuffer cmd, uint32_t scope);
+
+    bool IsEnabled() const { return queryPool != VK_NULL_HANDLE; }
+
+private:
+
+    void ReadResults(uint32_t frameIndex);
+
+private:
+
+    struct FrameQueries {
+        std::vector<const char*> names;
+        std::atomic<uint32_t> scopesCount{ 0 };
+        // CPU time of the frame start, GPU times are placed relative to it
+        uint64_t cpuStart = 0;
+    };
+
+    VkDevice dev = VK_NULL_HANDLE;
+    VkQueryPool queryPool = VK_NULL_HANDLE;
+    double timestampPeriod = 1.0;
+    uint64_t timestampMask = ~0ull;
+
+    std::vector<FrameQueries> frames;
+    uint32_t currentFrame = 0;
+};
+
+
+// RAII GPU scope. Use PROFILE_GPU_SCOPE
+class GpuProfileScope {
+
+public:
+
+    GpuProfileScope(GpuProfiler& profiler, VkCommandBuffer cmd, const char* name)
+        : profiler(profiler), cmd(cmd), scope(profiler.BeginScope(cmd, name)) {}
+    ~GpuProfileScope() { profiler.EndScope(cmd, scope); }
+
+    GpuProfileScope(const GpuProfileScope&) = delete;
+
+private:
+
+    GpuProfiler& profiler;
+    VkCommandBuffer cmd;
+    uint32_t scope;
+};
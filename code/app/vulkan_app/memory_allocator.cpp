@@ -0,0 +1,445 @@
+#include <vulkan_app/memory_allocator.h>
+
+#include <logs.h>
+
+#include <algorithm>
+
+namespace {
+
+constexpr VkDeviceSize largeHeapSize        = 1024ull * 1024 * 1024;
+constexpr VkDeviceSize largeHeapBlockSize   = 256ull * 1024 * 1024;
+// Count of attempts to allocate a smaller block if the preferred one doesn't fit into memory
+constexpr uint32_t blockSizeHalvingAttempts = 3;
+
+constexpr VkMemoryPropertyFlags hostMemoryFlags =
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+uint32_t PopCount(uint32_t value) {
+    uint32_t count = 0;
+    for (; value; value &= value - 1) {
+        ++count;
+    }
+    return count;
+}
+
+} // namespace
+
+AppResult MemoryAllocator::Init(VkDevice device, const VkPhysicalDeviceMemoryProperties& memoryProps,
+                                const VkPhysicalDeviceLimits& limits) {
+
+    dev                    = device;
+    memProps               = memoryProps;
+    bufferImageGranularity = std::max<VkDeviceSize>(limits.bufferImageGranularity, 1);
+    maxAllocationsCount    = limits.maxMemoryAllocationCount;
+    deviceAllocationsCount = 0;
+
+    pools.clear();
+    pools.resize(memProps.memoryTypeCount);
+    for (uint32_t i = 0; i < memProps.memoryTypeCount; ++i) {
+        pools[i].preferredBlockSize = GetPreferredBlockSize(i);
+    }
+
+    PRINT("Memory allocator initialized: %u memory types, %u heaps, granularity %llu",
+          memProps.memoryTypeCount, memProps.memoryHeapCount,
+          static_cast<unsigned long long>(bufferImageGranularity));
+    return APP_CODE_OK;
+}
+
+VkDeviceSize MemoryAllocator::GetPreferredBlockSize(uint32_t memoryType) const {
+    auto heapSize = memProps.memoryHeaps[memProps.memoryTypes[memoryType].heapIndex].size;
+    return (heapSize <= largeHeapSize) ? heapSize / 8 : largeHeapBlockSize;
+}
+
+bool MemoryAllocator::FindMemoryType(uint32_t typeBits, MemoryUsage usage, uint32_t& memoryType) const {
+
+    VkMemoryPropertyFlags required   = 0;
+    VkMemoryPropertyFlags preferred  = 0;
+    VkMemoryPropertyFlags unwanted   = 0;
+    switch (usage) {
+        case MemoryUsage::GpuOnly: {
+            preferred = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+            unwanted  = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+        } break;
+        case MemoryUsage::CpuToGpu: {
+            required  = hostMemoryFlags;
+            unwanted  = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+        } break;
+        case MemoryUsage::GpuToCpu: {
+            required  = hostMemoryFlags;
+            preferred = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+        } break;
+    }
+
+    // Choose the type with the least count of missing preferred and present unwanted flags
+    uint32_t bestCost = ~0u;
+    for (uint32_t i = 0; i < memProps.memoryTypeCount; ++i) {
+        auto flags = memProps.memoryTypes[i].propertyFlags;
+        if (!(typeBits & (1u << i)) || (flags & required) != required) {
+            continue;
+        }
+        uint32_t cost = PopCount(preferred & ~flags) + PopCount(unwanted & flags);
+        if (cost < bestCost) {
+            bestCost   = cost;
+            memoryType = i;
+        }
+    }
+    return bestCost != ~0u;
+}
+
+AppResult MemoryAllocator::AllocateDeviceMemory(uint32_t memoryType, VkDeviceSize size,
+                                                VkDeviceMemory& memory, void*& mapped, const void* pNext) {
+
+    if (maxAllocationsCount && deviceAllocationsCount >= maxAllocationsCount) {
+        PRINT_E("Reached maxMemoryAllocationCount limit (%u)", maxAllocationsCount);
+        return APP_CODE_VK_COMMAND_FAIURE;
+    }
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.pNext           = pNext;
+    allocInfo.allocationSize  = size;
+    allocInfo.memoryTypeIndex = memoryType;
+
+    VkResult r = vkAllocateMemory(dev, &allocInfo, nullptr, &memory);
+    if (r != VK_SUCCESS) {
+        return APP_CODE_VK_COMMAND_FAIURE;
+    }
+    ++deviceAllocationsCount;
+
+    // Host visible memory stays persistently mapped
+    mapped = nullptr;
+    if (memProps.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        r = vkMapMemory(dev, memory, 0, VK_WHOLE_SIZE, 0, &mapped);
+        if (r != VK_SUCCESS) {
+            PRINT_E("Failed to map device memory. Vk error code: %d", r);
+            vkFreeMemory(dev, memory, nullptr);
+            --deviceAllocationsCount;
+            return APP_CODE_VK_COMMAND_FAIURE;
+        }
+    }
+
+    return APP_CODE_OK;
+}
+
+bool MemoryAllocator::TryAllocateInBlock(uint32_t memoryType, uint32_t blockIndex,
+                                         const VkMemoryRequirements& requirements,
+                                         TlsfAllocator::ResourceKind kind, MemoryAllocation& allocation) {
+
+    auto& block = pools[memoryType].blocks[blockIndex];
+    if (block.memory == VK_NULL_HANDLE) {
+        return false;
+    }
+
+    uint64_t offset = 0;
+    auto handle = block.allocator->Allocate(requirements.size, requirements.alignment, kind, offset);
+    if (handle == TlsfAllocator::invalidHandle) {
+        return false;
+    }
+
+    allocation.memory     = block.memory;
+    allocation.offset     = offset;
+    allocation.size       = requirements.size;
+    allocation.mapped     = block.mapped ? static_cast<uint8_t*>(block.mapped) + offset : nullptr;
+    allocation.memoryType = memoryType;
+    allocation.dedicated  = false;
+    allocation.block      = blockIndex;
+    allocation.handle     = handle;
+    allocation.kind       = kind;
+    return true;
+}
+
+AppResult MemoryAllocator::AllocateFromBlocks(uint32_t memoryType, const VkMemoryRequirements& requirements,
+                                              TlsfAllocator::ResourceKind kind, MemoryAllocation& allocation) {
+
+    auto& pool = pools[memoryType];
+
+    // Existing blocks, the latest first as it's likely the least filled one
+    for (uint32_t i = static_cast<uint32_t>(pool.blocks.size()); i-- > 0;) {
+        if (TryAllocateInBlock(memoryType, i, requirements, kind, allocation)) {
+            return APP_CODE_OK;
+        }
+    }
+
+    // New block. Try smaller sizes if memory is short
+    VkDeviceSize blockSize = pool.preferredBlockSize;
+    for (uint32_t attempt = 0; attempt <= blockSizeHalvingAttempts && blockSize >= requirements.size; ++attempt) {
+        Block block;
+        if (APP_CHECK_RESULT(AllocateDeviceMemory(memoryType, blockSize, block.memory, block.mapped))) {
+            block.allocator = std::make_unique<TlsfAllocator>(blockSize, bufferImageGranularity);
+
+            // Reuse a slot of a released block to keep indices of other blocks stable
+            auto freeSlot = std::find_if(pool.blocks.begin(), pool.blocks.end(),
+                                         [](const Block& b) { return b.memory == VK_NULL_HANDLE; });
+            uint32_t index = static_cast<uint32_t>(freeSlot - pool.blocks.begin());
+            if (freeSlot != pool.blocks.end()) {
+                *freeSlot = std::move(block);
+            } else {
+                pool.blocks.push_back(std::move(block));
+            }
+
+            if (TryAllocateInBlock(memoryType, index, requirements, kind, allocation)) {
+                return APP_CODE_OK;
+            }
+            break;
+        }
+        blockSize /= 2;
+    }
+
+    return APP_CODE_VK_COMMAND_FAIURE;
+}
+
+AppResult MemoryAllocator::AllocateDedicated(uint32_t memoryType, const VkMemoryRequirements& requirements,
+                                             const AllocationCreateInfo& createInfo, MemoryAllocation& allocation) {
+
+    // Memory of a single resource is told to the driver, others are just separate memory objects
+    VkMemoryDedicatedAllocateInfo dedicatedInfo{};
+    dedicatedInfo.sType  = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+    dedicatedInfo.buffer = createInfo.dedicatedBuffer;
+    dedicatedInfo.image  = createInfo.dedicatedImage;
+    bool forResource = dedicatedInfo.buffer != VK_NULL_HANDLE || dedicatedInfo.image != VK_NULL_HANDLE;
+
+    void* mapped = nullptr;
+    APP_CHECK_CALL(AllocateDeviceMemory(memoryType, requirements.size, allocation.memory, mapped,
+                                        forResource ? &dedicatedInfo : nullptr));
+
+    allocation.offset     = 0;
+    allocation.size       = requirements.size;
+    allocation.mapped     = mapped;
+    allocation.memoryType = memoryType;
+    allocation.dedicated  = true;
+    allocation.handle     = TlsfAllocator::invalidHandle;
+    ++pools[memoryType].dedicatedCount;
+    return APP_CODE_OK;
+}
+
+AppResult MemoryAllocator::Allocate(const VkMemoryRequirements& requirements, const AllocationCreateInfo& createInfo,
+                                    MemoryAllocation*& allocation) {
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    uint32_t memoryType = 0;
+    if (!FindMemoryType(requirements.memoryTypeBits, createInfo.usage, memoryType)) {
+        PRINT_E("No memory type is suitable for the resource");
+        return APP_CODE_VK_COMMAND_FAIURE;
+    }
+
+    auto kind = createInfo.optimalImage ? TlsfAllocator::ResourceKind::Optimal
+                                        : TlsfAllocator::ResourceKind::Linear;
+    auto newAllocation = std::make_unique<MemoryAllocation>();
+
+    // Big resources get their own memory objects not to waste blocks
+    bool dedicated = createInfo.dedicated || requirements.size > pools[memoryType].preferredBlockSize / 2;
+    AppResult r = APP_CODE_VK_COMMAND_FAIURE;
+    if (!dedicated) {
+        r = AllocateFromBlocks(memoryType, requirements, kind, *newAllocation);
+    }
+    if (!APP_CHECK_RESULT(r)) {
+        r = AllocateDedicated(memoryType, requirements, createInfo, *newAllocation);
+    }
+    if (!APP_CHECK_RESULT(r)) {
+        PRINT_E("Failed to allocate %llu bytes of device memory",
+                static_cast<unsigned long long>(requirements.size));
+        return r;
+    }
+
+    allocation = newAllocation.get();
+    allocations.emplace(allocation, std::move(newAllocation));
+    return APP_CODE_OK;
+}
+
+void MemoryAllocator::FreeInternal(MemoryAllocation& allocation) {
+    if (allocation.dedicated) {
+        vkFreeMemory(dev, allocation.memory, nullptr);
+        --deviceAllocationsCount;
+        --pools[allocation.memoryType].dedicatedCount;
+    } else {
+        pools[allocation.memoryType].blocks[allocation.block].allocator->Free(allocation.handle);
+    }
+}
+
+void MemoryAllocator::Free(MemoryAllocation* allocation) {
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = allocations.find(allocation);
+    if (it == allocations.end()) {
+        return;
+    }
+    FreeInternal(*allocation);
+    uint32_t memoryType = allocation->memoryType;
+    allocations.erase(it);
+
+    ReleaseEmptyBlocks(memoryType);
+}
+
+void MemoryAllocator::ReleaseEmptyBlocks(uint32_t memoryType) {
+    // Keep one empty block to not thrash on alloc/free patterns
+    bool kept = false;
+    for (auto& block : pools[memoryType].blocks) {
+        if (block.memory == VK_NULL_HANDLE || !block.allocator->IsEmpty()) {
+            continue;
+        }
+        if (!kept) {
+            kept = true;
+            continue;
+        }
+        vkFreeMemory(dev, block.memory, nullptr);
+        --deviceAllocationsCount;
+        block = {};
+    }
+}
+
+AppResult MemoryAllocator::CreateBuffer(const VkBufferCreateInfo& bufferInfo, MemoryUsage usage,
+                                        VkBuffer& buffer, MemoryAllocation*& allocation) {
+
+    VkResult r = vkCreateBuffer(dev, &bufferInfo, nullptr, &buffer);
+    if (r != VK_SUCCESS) {
+        PRINT_E("Failed to create buffer. Vk error code: %d", r);
+        return APP_CODE_VK_COMMAND_FAIURE;
+    }
+
+    // The driver tells if the buffer is faster or only works with its own memory object
+    VkBufferMemoryRequirementsInfo2 reqsInfo{};
+    reqsInfo.sType  = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2;
+    reqsInfo.buffer = buffer;
+    VkMemoryDedicatedRequirements dedicatedReqs{};
+    dedicatedReqs.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+    VkMemoryRequirements2 memReqs{};
+    memReqs.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+    memReqs.pNext = &dedicatedReqs;
+    vkGetBufferMemoryRequirements2(dev, &reqsInfo, &memReqs);
+
+    AllocationCreateInfo createInfo{};
+    createInfo.usage           = usage;
+    createInfo.dedicated       = dedicatedReqs.prefersDedicatedAllocation || dedicatedReqs.requiresDedicatedAllocation;
+    createInfo.dedicatedBuffer = buffer;
+    AppResult res = Allocate(memReqs.memoryRequirements, createInfo, allocation);
+    if (!APP_CHECK_RESULT(res)) {
+        vkDestroyBuffer(dev, buffer, nullptr);
+        buffer = VK_NULL_HANDLE;
+        return res;
+    }
+    vkBindBufferMemory(dev, buffer, allocation->memory, allocation->offset);
+
+    return APP_CODE_OK;
+}
+
+AppResult MemoryAllocator::CreateImage(const VkImageCreateInfo& imageInfo, MemoryUsage usage,
+                                       VkImage& image, MemoryAllocation*& allocation) {
+
+    VkResult r = vkCreateImage(dev, &imageInfo, nullptr, &image);
+    if (r != VK_SUCCESS) {
+        PRINT_E("Failed to create image. Vk error code: %d", r);
+        return APP_CODE_VK_COMMAND_FAIURE;
+    }
+
+    // Render targets are often preferred to have their own memory object for compression metadata
+    VkImageMemoryRequirementsInfo2 reqsInfo{};
+    reqsInfo.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+    reqsInfo.image = image;
+    VkMemoryDedicatedRequirements dedicatedReqs{};
+    dedicatedReqs.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+    VkMemoryRequirements2 memReqs{};
+    memReqs.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+    memReqs.pNext = &dedicatedReqs;
+    vkGetImageMemoryRequirements2(dev, &reqsInfo, &memReqs);
+
+    AllocationCreateInfo createInfo{};
+    createInfo.usage          = usage;
+    createInfo.optimalImage   = imageInfo.tiling == VK_IMAGE_TILING_OPTIMAL;
+    createInfo.dedicated      = dedicatedReqs.prefersDedicatedAllocation || dedicatedReqs.requiresDedicatedAllocation;
+    createInfo.dedicatedImage = image;
+    AppResult res = Allocate(memReqs.memoryRequirements, createInfo, allocation);
+    if (!APP_CHECK_RESULT(res)) {
+        vkDestroyImage(dev, image, nullptr);
+        image = VK_NULL_HANDLE;
+        return res;
+    }
+    vkBindImageMemory(dev, image, allocation->memory, allocation->offset);
+
+    return APP_CODE_OK;
+}
+
+void MemoryAllocator::DestroyBuffer(VkBuffer buffer, MemoryAllocation* allocation) {
+    vkDestroyBuffer(dev, buffer, nullptr);
+    Free(allocation);
+}
+
+void MemoryAllocator::DestroyImage(VkImage image, MemoryAllocation* allocation) {
+    vkDestroyImage(dev, image, nullptr);
+    Free(allocation);
+}
+
+void MemoryAllocator::GetHeapStats(std::vector<HeapStats>& stats) const {
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    stats.assign(memProps.memoryHeapCount, {});
+    for (uint32_t i = 0; i < memProps.memoryHeapCount; ++i) {
+        stats[i].heapSize = memProps.memoryHeaps[i].size;
+    }
+
+    for (uint32_t type = 0; type < pools.size(); ++type) {
+        auto& heap = stats[memProps.memoryTypes[type].heapIndex];
+        for (auto& block : pools[type].blocks) {
+            if (block.memory == VK_NULL_HANDLE) {
+                continue;
+            }
+            ++heap.blocksCount;
+            heap.allocatedBytes += block.allocator->GetSize();
+        }
+        heap.dedicatedCount += pools[type].dedicatedCount;
+    }
+
+    for (auto& it : allocations) {
+        auto& allocation = *it.second;
+        auto& heap = stats[memProps.memoryTypes[allocation.memoryType].heapIndex];
+        ++heap.allocationsCount;
+        heap.usedBytes += allocation.size;
+        if (allocation.dedicated) {
+            heap.allocatedBytes += allocation.size;
+        }
+    }
+}
+
+void MemoryAllocator::PrintStats() const {
+
+    std::vector<HeapStats> stats;
+    GetHeapStats(stats);
+
+    constexpr double mb = 1024.0 * 1024.0;
+    for (uint32_t i = 0; i < stats.size(); ++i) {
+        auto& heap = stats[i];
+        PRINT("Memory heap %u (%.1f MB): %.2f MB allocated in %u blocks and %u dedicated, %.2f MB used by %u allocations",
+              i, heap.heapSize / mb, heap.allocatedBytes / mb, heap.blocksCount, heap.dedicatedCount,
+              heap.usedBytes / mb, heap.allocationsCount);
+    }
+}
+
+void MemoryAllocator::Clear() {
+
+    if (dev == VK_NULL_HANDLE) {
+        return;
+    }
+
+    if (!allocations.empty()) {
+        PRINT_W("%zu device memory allocations were not freed", allocations.size());
+    }
+    for (auto& it : allocations) {
+        if (it.second->dedicated) {
+            vkFreeMemory(dev, it.second->memory, nullptr);
+        }
+    }
+    allocations.clear();
+
+    for (auto& pool : pools) {
+        for (auto& block : pool.blocks) {
+            if (block.memory != VK_NULL_HANDLE) {
+                vkFreeMemory(dev, block.memory, nullptr);
+            }
+        }
+    }
+    pools.clear();
+    deviceAllocationsCount = 0;
+    dev = VK_NULL_HANDLE;
+}
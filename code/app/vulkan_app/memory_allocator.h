@@ -0,0 +1,141 @@
+#pragma once
+
+#include <app_result.h>
+#include <vulkan_app/tlsf_allocator.h>
+#include <vulkan_app/vk_base.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Sub-allocation of a device memory block or a dedicated device memory object
+struct MemoryAllocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset   = 0;
+    VkDeviceSize size     = 0;
+    // Pointer to the allocation start if memory is host visible
+    void* mapped          = nullptr;
+    uint32_t memoryType   = 0;
+
+    // Allocator internals
+    bool dedicated = false;
+    uint32_t block = 0;
+    TlsfAllocator::Handle handle = TlsfAllocator::invalidHandle;
+    TlsfAllocator::ResourceKind kind = TlsfAllocator::ResourceKind::Linear;
+};
+
+/**
+ * @brief
+ * Device memory allocator. Big device memory blocks are allocated per memory type
+ * and sub-allocated with TlsfAllocator to stay far from maxMemoryAllocationCount
+ * and not to pay vkAllocateMemory cost for every resource
+*/
+class MemoryAllocator {
+
+public:
+
+    enum class MemoryUsage {
+        // Device local, no host access
+        GpuOnly,
+        // Host visible, written by CPU and read by GPU (staging, uniforms)
+        CpuToGpu,
+        // Host visible and preferably cached, written by GPU and read by CPU (readback)
+        GpuToCpu,
+    };
+
+    struct AllocationCreateInfo {
+        MemoryUsage usage = MemoryUsage::GpuOnly;
+        // Resource is an optimal tiling image
+        bool optimalImage = false;
+        // Force separate device memory object
+        bool dedicated = false;
+        // Resource the memory is for. Chained with VkMemoryDedicatedAllocateInfo to a separate memory object,
+        // so the driver can apply the resource specific optimizations. At most one can be set
+        VkBuffer dedicatedBuffer = VK_NULL_HANDLE;
+        VkImage dedicatedImage   = VK_NULL_HANDLE;
+    };
+
+    struct HeapStats {
+        VkDeviceSize heapSize       = 0;
+        // Size of device memory objects allocated from the heap
+        VkDeviceSize allocatedBytes = 0;
+        // Size of the allocations placed to the memory objects
+        VkDeviceSize usedBytes      = 0;
+        uint32_t blocksCount        = 0;
+        uint32_t dedicatedCount     = 0;
+        uint32_t allocationsCount   = 0;
+    };
+
+    AppResult Init(VkDevice device, const VkPhysicalDeviceMemoryProperties& memoryProps,
+                   const VkPhysicalDeviceLimits& limits);
+    void Clear();
+
+    /**
+     * @brief
+     * Allocate memory for a resource
+     * @param requirements
+     * memory requirements of the resource
+     * @param createInfo
+     * allocation parameters
+     * @param allocation
+     * created allocation. Owned by the allocator until Free
+     * @return
+     * AppResult code
+    */
+    AppResult Allocate(const VkMemoryRequirements& requirements, const AllocationCreateInfo& createInfo,
+                       MemoryAllocation*& allocation);
+    void Free(MemoryAllocation* allocation);
+
+    AppResult CreateBuffer(const VkBufferCreateInfo& bufferInfo, MemoryUsage usage,
+                           VkBuffer& buffer, MemoryAllocation*& allocation);
+    AppResult CreateImage(const VkImageCreateInfo& imageInfo, MemoryUsage usage,
+                          VkImage& image, MemoryAllocation*& allocation);
+    void DestroyBuffer(VkBuffer buffer, MemoryAllocation* allocation);
+    void DestroyImage(VkImage image, MemoryAllocation* allocation);
+
+    bool FindMemoryType(uint32_t typeBits, MemoryUsage usage, uint32_t& memoryType) const;
+
+    void GetHeapStats(std::vector<HeapStats>& stats) const;
+    void PrintStats() const;
+
+private:
+
+    struct Block {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        void* mapped          = nullptr;
+        std::unique_ptr<TlsfAllocator> allocator;
+    };
+
+    struct MemoryTypePool {
+        std::vector<Block> blocks;
+        VkDeviceSize preferredBlockSize = 0;
+        uint32_t dedicatedCount = 0;
+    };
+
+    VkDeviceSize GetPreferredBlockSize(uint32_t memoryType) const;
+    AppResult AllocateDeviceMemory(uint32_t memoryType, VkDeviceSize size, VkDeviceMemory& memory, void*& mapped,
+                                   const void* pNext = nullptr);
+    AppResult AllocateFromBlocks(uint32_t memoryType, const VkMemoryRequirements& requirements,
+                                 TlsfAllocator::ResourceKind kind, MemoryAllocation& allocation);
+    AppResult AllocateDedicated(uint32_t memoryType, const VkMemoryRequirements& requirements,
+                                const AllocationCreateInfo& createInfo, MemoryAllocation& allocation);
+    bool TryAllocateInBlock(uint32_t memoryType, uint32_t blockIndex, const VkMemoryRequirements& requirements,
+                            TlsfAllocator::ResourceKind kind, MemoryAllocation& allocation);
+    void FreeInternal(MemoryAllocation& allocation);
+    void ReleaseEmptyBlocks(uint32_t memoryType);
+
+private:
+
+    VkDevice dev = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties memProps{};
+    VkDeviceSize bufferImageGranularity = 1;
+    uint32_t maxAllocationsCount = 0;
+    uint32_t deviceAllocationsCount = 0;
+
+    std::vector<MemoryTypePool> pools;
+    std::unordered_map<MemoryAllocation*, std::unique_ptr<MemoryAllocation>> allocations;
+
+    mutable std::mutex mutex;
+};
@@ -0,0 +1,304 @@
+#include <vulkan_app/multi_gpu.h>
+
+#include <logs.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+AppResult MultiGpuRenderer::Init(VkDevice primaryDevice, MemoryAllocator& primaryAllocator,
+                                 const std::string& primaryName, uint32_t framesInFlight,
+                                 const std::vector<DeviceDesc>& devices, MultiGpuMode mode,
+                                 uint32_t width, uint32_t height) {
+
+    primaryDev             = primaryDevice;
+    this->primaryAllocator = &primaryAllocator;
+    this->primaryName      = primaryName;
+    this->mode             = mode;
+    this->width            = width;
+    this->height           = height;
+
+    // Split frame bands go from the top, the primary device takes the first one
+    uint32_t devicesCount = static_cast<uint32_t>(devices.size()) + 1;
+    uint32_t bandHeight = height / devicesCount;
+    if (mode == MultiGpuMode::Sfr && !bandHeight) {
+        PRINT_E("Frame of height %u can't be split between %u GPUs", height, devicesCount);
+        return APP_CODE_INVALID_ARGS;
+    }
+    auto getArea = [&](uint32_t device) {
+        VkRect2D area{};
+        area.extent.width = width;
+        if (mode == MultiGpuMode::Sfr) {
+            area.offset.y      = static_cast<int32_t>(device * bandHeight);
+            area.extent.height = (device + 1 == devicesCount) ? height - device * bandHeight : bandHeight;
+        } else {
+            area.extent.height = height;
+        }
+        return area;
+    };
+    primaryArea = getArea(0);
+
+    // A node frame of alternate frame rendering is composited before the node gets the next one.
+    // Split frame bands are composited framesInFlight frames later, so every frame in flight needs a target
+    uint32_t nodeFramesInFlight = (mode == MultiGpuMode::Sfr) ? framesInFlight : 1;
+    for (uint32_t i = 0; i < devices.size(); ++i) {
+        nodes.push_back(std::make_unique<Node>());
+        APP_CHECK_CALL(CreateNode(devices[i], getArea(i + 1), nodeFramesInFlight, *nodes.back()));
+    }
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size        = VkDeviceSize(width) * height * OffscreenTarget::bytesPerPixel;
+    bufferInfo.usage       = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    uploadBuffers.resize(framesInFlight);
+    for (auto& upload : uploadBuffers) {
+        APP_CHECK_CALL(this->primaryAllocator->CreateBuffer(bufferInfo, MemoryAllocator::MemoryUsage::CpuToGpu,
+                                                            upload.buffer, upload.memory));
+    }
+
+    if (mode == MultiGpuMode::Sfr) {
+        bufferInfo.size  = VkDeviceSize(primaryArea.extent.width) * primaryArea.extent.height *
+                           OffscreenTarget::bytesPerPixel;
+        bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        APP_CHECK_CALL(this->primaryAllocator->CreateBuffer(bufferInfo, MemoryAllocator::MemoryUsage::GpuOnly,
+                                                            bandBuffer.buffer, bandBuffer.memory));
+    }
+
+    primaryStats = {};
+    startTime = std::chrono::steady_clock::now();
+
+    PRINT("%s rendering on %u GPUs", (mode == MultiGpuMode::Afr) ? "Alternate frame" : "Split frame",
+          devicesCount);
+    return APP_CODE_OK;
+}
+
+AppResult MultiGpuRenderer::CreateNode(const DeviceDesc& desc, const VkRect2D& area, uint32_t framesInFlight,
+                                       Node& node) {
+
+    node.name = desc.name;
+    node.area = area;
+
+    float queuePriority = 1.0f;
+    VkDeviceQueueCreateInfo queueCreateInfo{};
+    queueCreateInfo.sType            = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queueCreateInfo.queueFamilyIndex = desc.graphicsFamily;
+    queueCreateInfo.queueCount       = 1;
+    queueCreateInfo.pQueuePriorities = &queuePriority;
+
+    VkDeviceCreateInfo deviceCreateInfo{};
+    deviceCreateInfo.sType                = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    deviceCreateInfo.pQueueCreateInfos    = &queueCreateInfo;
+    deviceCreateInfo.queueCreateInfoCount = 1;
+
+    VkResult r = vkCreateDevice(desc.physDev, &deviceCreateInfo, nullptr, &node.dev);
+    if (r != VK_SUCCESS) {
+        PRINT_E("Failed to create Vulkan device for GPU \"%s\". Vk error code: %d", desc.name.c_str(), r);
+        return APP_CODE_VK_COMMAND_FAIURE;
+    }
+    vkGetDeviceQueue(node.dev, desc.graphicsFamily, 0, &node.queue);
+
+    APP_CHECK_CALL(node.allocator.Init(node.dev, desc.memoryProps, desc.limits));
+    APP_CHECK_CALL(node.scheduler.Init(node.dev, desc.graphicsFamily, framesInFlight));
+    node.targets.resize(framesInFlight);
+    for (auto& target : node.targets) {
+        APP_CHECK_CALL(target.Init(node.dev, node.allocator, area.extent.width, area.extent.height));
+    }
+    node.collectedFrames = 0;
+
+    PRINT("GPU \"%s\" renders %ux%u at y %d with %u frames in flight", desc.name.c_str(), area.extent.width,
+          area.extent.height, area.offset.y, framesInFlight);
+    return APP_CODE_OK;
+}
+
+AppResult MultiGpuRenderer::BeginFrame(uint64_t frameNumber, uint32_t frameIndex, const VkClearColorValue& color,
+                                       bool& renderPrimary) {
+
+    composites.clear();
+    renderPrimary = true;
+    frameArea = primaryArea;
+
+    uint64_t owner = (mode == MultiGpuMode::Afr) ? frameNumber % (nodes.size() + 1) : 0;
+    if (mode == MultiGpuMode::Sfr) {
+        // The bands submitted framesInFlight frames ago are shown now. Their fences are likely signaled,
+        // the newer frames keep the devices busy. The first frames have no bands, the primary renders all
+        for (auto& node : nodes) {
+            if (GetPendingFrames(*node) == node->scheduler.GetFramesInFlight()) {
+                Collect(*node, frameIndex);
+            } else {
+                frameArea = VkRect2D{ { 0, 0 }, { width, height } };
+            }
+            APP_CHECK_CALL(Kick(*node, color));
+        }
+    } else if (owner) {
+        // The node frame submitted devicesCount frames ago is shown now.
+        // The first frames of the node have nothing to show, the primary renders them
+        auto& node = *nodes[owner - 1];
+        if (GetPendingFrames(node)) {
+            Collect(node, frameIndex);
+            renderPrimary = false;
+        }
+        APP_CHECK_CALL(Kick(node, color));
+    }
+
+    if (renderPrimary) {
+        ++primaryStats.frames;
+        primaryStats.pixels += uint64_t(frameArea.extent.width) * frameArea.extent.height;
+    }
+    return APP_CODE_OK;
+}
+
+AppResult MultiGpuRenderer::RecordComposite(VkCommandBuffer cmd, uint32_t frameIndex, VkImage image) const {
+
+    if (!composites.empty()) {
+        vkCmdCopyBufferToImage(cmd, uploadBuffers[frameIndex].buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                               static_cast<uint32_t>(composites.size()), composites.data());
+    }
+
+    return APP_CODE_OK;
+}
+
+void MultiGpuRenderer::RecordPrimaryClear(VkCommandBuffer cmd, VkImage image, const VkClearColorValue& color) const {
+
+    if (bandBuffer.buffer == VK_NULL_HANDLE || frameArea.extent.height == height) {
+        VkImageSubresourceRange range{};
+        range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        range.levelCount = 1;
+        range.layerCount = 1;
+        vkCmdClearColorImage(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &color, 1, &range);
+        return;
+    }
+
+    // RGBA8 texel of the color, little endian
+    uint32_t texel = 0;
+    for (uint32_t i = 0; i < 4; ++i) {
+        float channel = std::clamp(color.float32[i], 0.0f, 1.0f);
+        texel |= static_cast<uint32_t>(std::lround(channel * 255.0f)) << (i * 8);
+    }
+
+    // Frames in flight share the buffer, the fill waits for the copy of the previous frame
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask       = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.dstAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer              = bandBuffer.buffer;
+    barrier.offset              = 0;
+    barrier.size                = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                         0, nullptr, 1, &barrier, 0, nullptr);
+    vkCmdFillBuffer(cmd, bandBuffer.buffer, 0, VK_WHOLE_SIZE, texel);
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                         0, nullptr, 1, &barrier, 0, nullptr);
+
+    VkBufferImageCopy region{};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset                 = { primaryArea.offset.x, primaryArea.offset.y, 0 };
+    region.imageExtent                 = { primaryArea.extent.width, primaryArea.extent.height, 1 };
+    vkCmdCopyBufferToImage(cmd, bandBuffer.buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+}
+
+AppResult MultiGpuRenderer::Kick(Node& node, const VkClearColorValue& color) {
+
+    // The frame in the same slot is composited already, so the fence wait doesn't block
+    auto& frame = node.scheduler.BeginFrame();
+    node.targets[frame.index].RecordFrame(frame.commandBuffer, color);
+    APP_CHECK_CALL(node.scheduler.EndFrame(node.queue, false, VK_NULL_HANDLE));
+
+    ++node.stats.frames;
+    node.stats.pixels += uint64_t(node.area.extent.width) * node.area.extent.height;
+    return APP_CODE_OK;
+}
+
+uint64_t MultiGpuRenderer::GetPendingFrames(const Node& node) const {
+    return node.scheduler.GetSubmittedFramesCount() - node.collectedFrames;
+}
+
+void MultiGpuRenderer::Collect(Node& node, uint32_t frameIndex) {
+
+    // Only the oldest frame is waited, the device keeps rendering the newer ones
+    uint64_t number = node.collectedFrames++;
+    auto start = std::chrono::steady_clock::now();
+    node.scheduler.WaitFrame(number);
+    node.stats.waitTime +=
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    // Frame slots are used in submission order
+    const auto& target = node.targets[number % node.targets.size()];
+    const void* pixels = target.GetReadbackData();
+    auto* upload = static_cast<uint8_t*>(uploadBuffers[frameIndex].memory->mapped);
+    if (!pixels || !upload) {
+        return;
+    }
+
+    // Compositing buffer has the layout of the whole frame, so bands don't overlap
+    VkDeviceSize offset = VkDeviceSize(node.area.offset.y) * width * OffscreenTarget::bytesPerPixel;
+    VkDeviceSize size = target.GetFrameSize();
+    std::memcpy(upload + offset, pixels, static_cast<size_t>(size));
+    node.stats.copiedBytes += size;
+
+    VkBufferImageCopy region{};
+    region.bufferOffset                    = offset;
+    region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel       = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount     = 1;
+    region.imageOffset                     = { node.area.offset.x, node.area.offset.y, 0 };
+    region.imageExtent                     = { node.area.extent.width, node.area.extent.height, 1 };
+    composites.push_back(region);
+}
+
+void MultiGpuRenderer::PrintStats() const {
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    auto print = [seconds](const std::string& name, const DeviceStats& stats) {
+        PRINT("GPU \"%s\": %llu frames, %.1f Mpix/s, %.1f MiB composited, %.3f ms waited", name.c_str(),
+              static_cast<unsigned long long>(stats.frames), seconds > 0.0 ? stats.pixels / seconds / 1e6 : 0.0,
+              stats.copiedBytes / (1024.0 * 1024.0), stats.waitTime);
+    };
+    print(primaryName, primaryStats);
+    for (const auto& node : nodes) {
+        print(node->name, node->stats);
+    }
+}
+
+void MultiGpuRenderer::DestroyNode(Node& node) {
+    if (node.dev == VK_NULL_HANDLE) {
+        return;
+    }
+    vkDeviceWaitIdle(node.dev);
+    for (auto& target : node.targets) {
+        target.Clear();
+    }
+    node.targets.clear();
+    node.allocator.Clear();
+    node.scheduler.Clear();
+    vkDestroyDevice(node.dev, nullptr);
+    node.dev   = VK_NULL_HANDLE;
+    node.queue = VK_NULL_HANDLE;
+}
+
+void MultiGpuRenderer::Clear() {
+    for (auto& node : nodes) {
+        DestroyNode(*node);
+    }
+    nodes.clear();
+    for (auto& upload : uploadBuffers) {
+        if (upload.buffer != VK_NULL_HANDLE) {
+            primaryAllocator->DestroyBuffer(upload.buffer, upload.memory);
+        }
+    }
+    uploadBuffers.clear();
+    if (bandBuffer.buffer != VK_NULL_HANDLE) {
+        primaryAllocator->DestroyBuffer(bandBuffer.buffer, bandBuffer.memory);
+    }
+    bandBuffer = {};
+    composites.clear();
+    primaryDev = VK_NULL_HANDLE;
+}
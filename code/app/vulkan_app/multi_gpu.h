@@ -0,0 +1,177 @@
+#pragma once
+
+#include <app_options.h>
+#include <app_result.h>
+#include <vulkan_app/frame_scheduler.h>
+#include <vulkan_app/memory_allocator.h>
+#include <vulkan_app/offscreen_target.h>
+#include <vulkan_app/vk_base.h>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief
+ * Spreads headless frames over several GPUs. Every secondary GPU gets its own logical device
+ * rendering into its own target, results are read back to host memory and copied into
+ * the primary target by the primary device (compositing).
+ * Alternate frame rendering: frame N is rendered by device N % devicesCount, a secondary
+ * device result is composited devicesCount frames later, so GPUs don't wait each other.
+ * Split frame rendering: every device renders a horizontal band of the frame and the primary device
+ * renders only its own band. A secondary band is composited framesInFlight frames after it's submitted,
+ * so the devices render in parallel instead of waiting each other every frame. Until the first bands
+ * are ready the primary renders the whole frame.
+ * Results are waited per frame with the fences of the secondary devices, never by idling a device.
+ * Not thread safe, used from the render thread
+*/
+class MultiGpuRenderer {
+
+public:
+
+    struct DeviceDesc {
+        VkPhysicalDevice physDev = VK_NULL_HANDLE;
+        uint32_t graphicsFamily  = 0;
+        VkPhysicalDeviceMemoryProperties memoryProps;
+        VkPhysicalDeviceLimits limits;
+        std::string name;
+    };
+
+    struct DeviceStats {
+        uint64_t frames      = 0;
+        uint64_t pixels      = 0;
+        // Bytes copied from the device into the primary target
+        uint64_t copiedBytes = 0;
+        // CPU time spent waiting for the device results, ms
+        double waitTime      = 0.0;
+    };
+
+    /**
+     * @brief
+     * Create logical devices and render targets of the secondary GPUs
+     * @param primaryDevice
+     * device owning the final target
+     * @param primaryAllocator
+     * allocator of the primary device for the compositing buffers
+     * @param primaryName
+     * name of the primary GPU for the statistics
+     * @param framesInFlight
+     * frames in flight of the primary device
+     * @param devices
+     * secondary GPUs
+     * @param mode
+     * work distribution mode. MultiGpuMode::Off is invalid
+     * @param width
+     * frame width
+     * @param height
+     * frame height
+     * @return
+     * AppResult code
+    */
+    AppResult Init(VkDevice primaryDevice, MemoryAllocator& primaryAllocator, const std::string& primaryName,
+                   uint32_t framesInFlight, const std::vector<DeviceDesc>& devices, MultiGpuMode mode,
+                   uint32_t width, uint32_t height);
+    void Clear();
+
+    /**
+     * @brief
+     * Copy the secondary results ready for the frame to its compositing buffer and submit the frame share
+     * of the secondary devices. Frame resources of the primary must be free
+     * @param frameNumber
+     * sequential number of the primary frame
+     * @param frameIndex
+     * index of the primary frame in flight
+     * @param color
+     * clear color of the frame
+     * @param renderPrimary
+     * true if the primary device has to render the frame content itself
+     * @return
+     * AppResult code
+    */
+    AppResult BeginFrame(uint64_t frameNumber, uint32_t frameIndex, const VkClearColorValue& color,
+                         bool& renderPrimary);
+    /**
+     * @brief
+     * Record copying of the secondary devices results into the primary target
+     * @param cmd
+     * primary command buffer in recording state
+     * @param frameIndex
+     * index of the primary frame in flight
+     * @param image
+     * primary target image in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+     * @return
+     * AppResult code
+    */
+    AppResult RecordComposite(VkCommandBuffer cmd, uint32_t frameIndex, VkImage image) const;
+    /**
+     * @brief
+     * Record the primary device content of the frame: its band with split frame rendering or the whole frame.
+     * Transfers can't clear a part of an image, so a band is filled into a buffer and copied to the image
+     * @param cmd
+     * command buffer in recording state
+     * @param image
+     * primary target image in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+     * @param color
+     * clear color of the frame
+    */
+    void RecordPrimaryClear(VkCommandBuffer cmd, VkImage image, const VkClearColorValue& color) const;
+
+    bool IsEnabled() const { return !nodes.empty(); }
+    void PrintStats() const;
+
+private:
+
+    // Secondary device
+    struct Node {
+        std::string name;
+        VkDevice dev  = VK_NULL_HANDLE;
+        VkQueue queue = VK_NULL_HANDLE;
+        MemoryAllocator allocator;
+        FrameScheduler scheduler;
+        // Target per frame in flight of the device, so a result is read back while the next ones render
+        std::vector<OffscreenTarget> targets;
+        // Part of the frame rendered by the device
+        VkRect2D area{};
+        // Count of the device frames composited so far, in submission order
+        uint64_t collectedFrames = 0;
+        DeviceStats stats;
+    };
+
+    AppResult CreateNode(const DeviceDesc& desc, const VkRect2D& area, uint32_t framesInFlight, Node& node);
+    void DestroyNode(Node& node);
+    AppResult Kick(Node& node, const VkClearColorValue& color);
+    // Frames submitted to the node and not composited yet
+    uint64_t GetPendingFrames(const Node& node) const;
+    // Wait for the oldest not composited node frame and copy its result to the compositing buffer of the primary frame
+    void Collect(Node& node, uint32_t frameIndex);
+
+private:
+
+    struct UploadBuffer {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        MemoryAllocation* memory = nullptr;
+    };
+
+    VkDevice primaryDev = VK_NULL_HANDLE;
+    MemoryAllocator* primaryAllocator = nullptr;
+    MultiGpuMode mode = MultiGpuMode::Off;
+    uint32_t width  = 0;
+    uint32_t height = 0;
+
+    std::vector<std::unique_ptr<Node>> nodes;
+    // Host visible copies of the secondary results per primary frame in flight
+    std::vector<UploadBuffer> uploadBuffers;
+    // Device local buffer of the primary band size filled with the frame color
+    UploadBuffer bandBuffer;
+    // Copies to be recorded into the current primary frame
+    std::vector<VkBufferImageCopy> composites;
+
+    std::string primaryName;
+    VkRect2D primaryArea{};
+    // Part of the current frame rendered by the primary
+    VkRect2D frameArea{};
+    DeviceStats primaryStats;
+    std::chrono::steady_clock::time_point startTime;
+};
@@ -0,0 +1,208 @@
+#include <vulkan_app/offscreen_target.h>
+
+#include <logs.h>
+
+#include <cstring>
+#include <fstream>
+
+AppResult OffscreenTarget::Init(VkDevice device, MemoryAllocator& allocator, uint32_t width, uint32_t height) {
+
+    dev          = device;
+    memAllocator = &allocator;
+    this->width  = width;
+    this->height = height;
+
+    APP_CHECK_CALL(CreateImage());
+    APP_CHECK_CALL(CreateReadbackBuffer());
+
+    PRINT("Offscreen render target %ux%u created", width, height);
+    return APP_CODE_OK;
+}
+
+AppResult OffscreenTarget::CreateImage() {
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType     = VK_IMAGE_TYPE_2D;
+    imageInfo.format        = format;
+    imageInfo.extent        = { width, height, 1 };
+    imageInfo.mipLevels     = 1;
+    imageInfo.arrayLayers   = 1;
+    imageInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage         = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                              VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+                              VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    imageInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    APP_CHECK_CALL(memAllocator->CreateImage(imageInfo, MemoryAllocator::MemoryUsage::GpuOnly, image, imageMemory));
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType                           = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image                           = image;
+    viewInfo.viewType                        = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format                          = format;
+    viewInfo.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.baseMipLevel   = 0;
+    viewInfo.subresourceRange.levelCount     = 1;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount     = 1;
+
+    VkResult r = vkCreateImageView(dev, &viewInfo, nullptr, &imageView);
+    if (r != VK_SUCCESS) {
+        PRINT_E("Failed to create offscreen image view. Vk error code: %d", r);
+        return APP_CODE_VK_COMMAND_FAIURE;
+    }
+
+    return APP_CODE_OK;
+}
+
+AppResult OffscreenTarget::CreateReadbackBuffer() {
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size        = GetFrameSize();
+    bufferInfo.usage       = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    // Memory is host coherent and persistently mapped by the allocator
+    APP_CHECK_CALL(memAllocator->CreateBuffer(bufferInfo, MemoryAllocator::MemoryUsage::GpuToCpu,
+                                              readbackBuffer, readbackMemory));
+
+    return APP_CODE_OK;
+}
+
+void OffscreenTarget::RecordFrame(VkCommandBuffer cmd, const VkClearColorValue& color) {
+    RecordBeginWrite(cmd);
+    RecordClear(cmd, color);
+    RecordReadback(cmd);
+}
+
+void OffscreenTarget::RecordBeginWrite(VkCommandBuffer cmd) {
+
+    VkImageSubresourceRange range{};
+    range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    range.levelCount = 1;
+    range.layerCount = 1;
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask       = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.dstAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image               = image;
+    barrier.subresourceRange    = range;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                         0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void OffscreenTarget::RecordClear(VkCommandBuffer cmd, const VkClearColorValue& color) {
+
+    VkImageSubresourceRange range{};
+    range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    range.levelCount = 1;
+    range.layerCount = 1;
+
+    vkCmdClearColorImage(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &color, 1, &range);
+}
+
+void OffscreenTarget::RecordReadback(VkCommandBuffer cmd) {
+
+    VkImageSubresourceRange range{};
+    range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    range.levelCount = 1;
+    range.layerCount = 1;
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask       = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.oldLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout           = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image               = image;
+    barrier.subresourceRange    = range;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                         0, nullptr, 0, nullptr, 1, &barrier);
+
+    RecordCopyToReadback(cmd);
+
+    // Make the copy visible to the host
+    VkBufferMemoryBarrier bufferBarrier{};
+    bufferBarrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    bufferBarrier.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+    bufferBarrier.dstAccessMask       = VK_ACCESS_HOST_READ_BIT;
+    bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.buffer              = readbackBuffer;
+    bufferBarrier.offset              = 0;
+    bufferBarrier.size                = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+                         0, nullptr, 1, &bufferBarrier, 0, nullptr);
+}
+
+void OffscreenTarget::RecordCopyToReadback(VkCommandBuffer cmd) {
+
+    VkBufferImageCopy region{};
+    region.bufferOffset                    = 0;
+    region.bufferRowLength                 = 0;
+    region.bufferImageHeight               = 0;
+    region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel       = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount     = 1;
+    region.imageOffset                     = { 0, 0, 0 };
+    region.imageExtent                     = { width, height, 1 };
+    vkCmdCopyImageToBuffer(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer, 1, &region);
+}
+
+void OffscreenTarget::ReadFrame(std::vector<uint8_t>& pixels) const {
+    pixels.resize(static_cast<size_t>(GetFrameSize()));
+    if (readbackMemory && readbackMemory->mapped) {
+        std::memcpy(pixels.data(), readbackMemory->mapped, pixels.size());
+    }
+}
+
+AppResult OffscreenTarget::DumpPPM(const char* path) const {
+
+    std::vector<uint8_t> pixels;
+    ReadFrame(pixels);
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        PRINT_E("Failed to open \"%s\" for writing", path);
+        return APP_CODE_IO_FAILURE;
+    }
+    file << "P6\n" << width << " " << height << "\n255\n";
+    for (size_t i = 0; i < pixels.size(); i += bytesPerPixel) {
+        file.write(reinterpret_cast<const char*>(&pixels[i]), 3);
+    }
+
+    PRINT("Frame written to \"%s\"", path);
+    return APP_CODE_OK;
+}
+
+void OffscreenTarget::Clear() {
+    if (dev == VK_NULL_HANDLE) {
+        return;
+    }
+    if (readbackBuffer != VK_NULL_HANDLE) {
+        memAllocator->DestroyBuffer(readbackBuffer, readbackMemory);
+    }
+    vkDestroyImageView(dev, imageView, nullptr);
+    if (image != VK_NULL_HANDLE) {
+        memAllocator->DestroyImage(image, imageMemory);
+    }
+
+    readbackBuffer = VK_NULL_HANDLE;
+    readbackMemory = nullptr;
+    imageView      = VK_NULL_HANDLE;
+    image          = VK_NULL_HANDLE;
+    imageMemory    = nullptr;
+    dev            = VK_NULL_HANDLE;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <app_result.h>
+#include <vulkan_app/memory_allocator.h>
+#include <vulkan_app/vk_base.h>
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief
+ * Color render target living in a VkImage instead of a swapchain image.
+ * Rendered frames are copied to a host visible buffer and could be read back
+*/
+class OffscreenTarget {
+
+public:
+
+    static constexpr VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+    static constexpr uint32_t bytesPerPixel = 4;
+
+    AppResult Init(VkDevice device, MemoryAllocator& allocator, uint32_t width, uint32_t height);
+    void Clear();
+
+    /**
+     * @brief
+     * Record rendering of a frame into the target and copying of it to the readback buffer
+     * @param cmd
+     * command buffer in recording state
+     * @param color
+     * clear color of the frame
+    */
+    void RecordFrame(VkCommandBuffer cmd, const VkClearColorValue& color);
+    // Transition the image for transfer writes. The previous content is discarded
+    void RecordBeginWrite(VkCommandBuffer cmd);
+    // Clear the image in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+    void RecordClear(VkCommandBuffer cmd, const VkClearColorValue& color);
+    // Finish writing and copy the image to the readback buffer
+    void RecordReadback(VkCommandBuffer cmd);
+    // Copy the image in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL to the readback buffer. No barriers are recorded
+    void RecordCopyToReadback(VkCommandBuffer cmd);
+    /**
+     * @brief
+     * Copy the last rendered frame to host memory. Rendering commands must be completed
+     * @param pixels
+     * tightly packed RGBA8 pixels
+    */
+    void ReadFrame(std::vector<uint8_t>& pixels) const;
+    // Mapped readback buffer with the last rendered frame. Rendering commands must be completed
+    const void* GetReadbackData() const { return readbackMemory ? readbackMemory->mapped : nullptr; }
+    AppResult DumpPPM(const char* path) const;
+
+    VkImage GetImage() const { return image; }
+    VkImageView GetImageView() const { return imageView; }
+    VkBuffer GetReadbackBuffer() const { return readbackBuffer; }
+    VkExtent2D GetExtent() const { return { width, height }; }
+    VkDeviceSize GetFrameSize() const { return VkDeviceSize(width) * height * bytesPerPixel; }
+
+private:
+
+    AppResult CreateImage();
+    AppResult CreateReadbackBuffer();
+
+private:
+
+    VkDevice dev = VK_NULL_HANDLE;
+    MemoryAllocator* memAllocator = nullptr;
+    uint32_t width  = 0;
+    uint32_t height = 0;
+
+    VkImage image                 = VK_NULL_HANDLE;
+    MemoryAllocation* imageMemory = nullptr;
+    VkImageView imageView         = VK_NULL_HANDLE;
+
+    VkBuffer readbackBuffer          = VK_NULL_HANDLE;
+    MemoryAllocation* readbackMemory = nullptr;
+};
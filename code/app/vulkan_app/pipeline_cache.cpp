@@ -0,0 +1,243 @@
+#include <vulkan_app/pipeline_cache.h>
+
+#include <logs.h>
+#include <utils/hash.h>
+#include <utils/temp_path.h>
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+
+constexpr uint32_t cacheFileMagic   = 0x4b4e4a50; // "PJNK"
+constexpr uint32_t cacheFileVersion = 1;
+
+double MsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+AppResult PipelineCache::Init(VkDevice device, const VkPhysicalDeviceProperties& properties,
+                              const std::string& path) {
+
+    auto start = std::chrono::steady_clock::now();
+
+    dev      = device;
+    devProps = properties;
+    filePath = path;
+    stats    = {};
+
+    std::vector<uint8_t> data;
+    stats.loadedFromDisk = !filePath.empty() && ReadBlob(data);
+
+    VkPipelineCacheCreateInfo createInfo{};
+    createInfo.sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize = stats.loadedFromDisk ? data.size() : 0;
+    createInfo.pInitialData    = stats.loadedFromDisk ? data.data() : nullptr;
+
+    VkResult r = vkCreatePipelineCache(dev, &createInfo, nullptr, &cache);
+    if (r != VK_SUCCESS && stats.loadedFromDisk) {
+        PRINT_W("Driver rejected pipeline cache blob. Vk error code: %d. Starting with empty cache", r);
+        stats.loadedFromDisk = false;
+        storedKeys.clear();
+        createInfo.initialDataSize = 0;
+        createInfo.pInitialData    = nullptr;
+        r = vkCreatePipelineCache(dev, &createInfo, nullptr, &cache);
+    }
+    if (r != VK_SUCCESS) {
+        PRINT_E("Failed to create pipeline cache. Vk error code: %d", r);
+        return APP_CODE_VK_COMMAND_FAIURE;
+    }
+
+    stats.loadTime = MsSince(start);
+    PRINT("Pipeline cache created (%s, %zu bytes, %.3f ms)",
+          stats.loadedFromDisk ? "warm" : "cold", createInfo.initialDataSize, stats.loadTime);
+
+    return APP_CODE_OK;
+}
+
+bool PipelineCache::ReadBlob(std::vector<uint8_t>& data) {
+
+    std::ifstream file(filePath, std::ios::binary | std::ios::ate);
+    if (!file) {
+        PRINT("Pipeline cache file \"%s\" not found", filePath.c_str());
+        return false;
+    }
+    uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+
+    FileHeader header{};
+    if (fileSize < sizeof(header) || !file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        header.magic != cacheFileMagic ||
+        fileSize != sizeof(header) + uint64_t(header.keysCount) * sizeof(uint64_t) + header.dataSize) {
+        PRINT_W("Pipeline cache file \"%s\" is corrupted", filePath.c_str());
+        return false;
+    }
+
+    std::vector<uint64_t> keys(header.keysCount);
+    data.resize(static_cast<size_t>(header.dataSize));
+    if (!file.read(reinterpret_cast<char*>(keys.data()), keys.size() * sizeof(uint64_t)) ||
+        !file.read(reinterpret_cast<char*>(data.data()), data.size())) {
+        PRINT_W("Failed to read pipeline cache file \"%s\"", filePath.c_str());
+        return false;
+    }
+
+    if (!IsBlobValid(header, data)) {
+        return false;
+    }
+
+    storedKeys.insert(keys.begin(), keys.end());
+    return true;
+}
+
+bool PipelineCache::IsBlobValid(const FileHeader& header, const std::vector<uint8_t>& data) const {
+
+    if (header.version != cacheFileVersion) {
+        PRINT_W("Pipeline cache file has unsupported version %u", header.version);
+        return false;
+    }
+    if (header.vendorID != devProps.vendorID || header.deviceID != devProps.deviceID) {
+        PRINT_W("Pipeline cache was saved for another device. It will be rebuilt");
+        return false;
+    }
+    if (header.driverVersion != devProps.driverVersion ||
+        std::memcmp(header.pipelineCacheUUID, devProps.pipelineCacheUUID, VK_UUID_SIZE)) {
+        PRINT_W("Pipeline cache was saved by another driver. It will be rebuilt");
+        return false;
+    }
+    if (HashBytes(data.data(), data.size()) != header.dataHash) {
+        PRINT_W("Pipeline cache data checksum mismatch. It will be rebuilt");
+        return false;
+    }
+
+    // Check the header written by the driver itself (VkPipelineCacheHeaderVersionOne)
+    constexpr size_t vkHeaderSize = 4 * sizeof(uint32_t) + VK_UUID_SIZE;
+    if (data.size() < vkHeaderSize) {
+        PRINT_W("Pipeline cache data is too small");
+        return false;
+    }
+    uint32_t vkHeader[4];
+    std::memcpy(vkHeader, data.data(), sizeof(vkHeader));
+    if (vkHeader[1] != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+        vkHeader[2] != devProps.vendorID ||
+        vkHeader[3] != devProps.deviceID ||
+        std::memcmp(data.data() + sizeof(vkHeader), devProps.pipelineCacheUUID, VK_UUID_SIZE)) {
+        PRINT_W("Pipeline cache data header doesn't match the device");
+        return false;
+    }
+
+    return true;
+}
+
+AppResult PipelineCache::Save() {
+
+    if (cache == VK_NULL_HANDLE || filePath.empty()) {
+        return APP_CODE_OK;
+    }
+
+    size_t size = 0;
+    VkResult r = vkGetPipelineCacheData(dev, cache, &size, nullptr);
+    std::vector<uint8_t> data(size);
+    if (r == VK_SUCCESS) {
+        r = vkGetPipelineCacheData(dev, cache, &size, data.data());
+    }
+    if (r != VK_SUCCESS) {
+        PRINT_E("Failed to get pipeline cache data. Vk error code: %d", r);
+        return APP_CODE_VK_COMMAND_FAIURE;
+    }
+    data.resize(size);
+
+    std::vector<uint64_t> keys(storedKeys.begin(), storedKeys.end());
+    for (auto key : createdKeys) {
+        if (!storedKeys.count(key)) {
+            keys.push_back(key);
+        }
+    }
+
+    FileHeader header{};
+    header.magic         = cacheFileMagic;
+    header.version       = cacheFileVersion;
+    header.vendorID      = devProps.vendorID;
+    header.deviceID      = devProps.deviceID;
+    header.driverVersion = devProps.driverVersion;
+    std::memcpy(header.pipelineCacheUUID, devProps.pipelineCacheUUID, VK_UUID_SIZE);
+    header.keysCount     = static_cast<uint32_t>(keys.size());
+    header.dataSize      = data.size();
+    header.dataHash      = HashBytes(data.data(), data.size());
+
+    // Write to a temporary file and replace the old one to never leave a partially written cache.
+    // The name is unique, several instances closing together don't write into the same temporary file
+    std::string tmpPath = MakeTempPath(filePath);
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(keys.data()), keys.size() * sizeof(uint64_t));
+        file.write(reinterpret_cast<const char*>(data.data()), data.size());
+        if (!file.flush()) {
+            PRINT_E("Failed to write pipeline cache to \"%s\"", tmpPath.c_str());
+            file.close();
+            std::error_code ec;
+            std::filesystem::remove(tmpPath, ec);
+            return APP_CODE_IO_FAILURE;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, filePath, ec);
+    if (ec) {
+        PRINT_E("Failed to replace pipeline cache file \"%s\": %s", filePath.c_str(), ec.message().c_str());
+        std::filesystem::remove(tmpPath, ec);
+        return APP_CODE_IO_FAILURE;
+    }
+
+    PRINT("Pipeline cache saved to \"%s\" (%zu bytes, %zu pipelines)", filePath.c_str(), data.size(), keys.size());
+    return APP_CODE_OK;
+}
+
+VkResult PipelineCache::CreateGraphicsPipeline(const VkGraphicsPipelineCreateInfo& createInfo, uint64_t key,
+                                               VkPipeline& pipeline) {
+    auto start = std::chrono::steady_clock::now();
+    VkResult r = vkCreateGraphicsPipelines(dev, cache, 1, &createInfo, nullptr, &pipeline);
+    if (r == VK_SUCCESS) {
+        CountCreation(key, MsSince(start));
+    }
+    return r;
+}
+
+VkResult PipelineCache::CreateComputePipeline(const VkComputePipelineCreateInfo& createInfo, uint64_t key,
+                                              VkPipeline& pipeline) {
+    auto start = std::chrono::steady_clock::now();
+    VkResult r = vkCreateComputePipelines(dev, cache, 1, &createInfo, nullptr, &pipeline);
+    if (r == VK_SUCCESS) {
+        CountCreation(key, MsSince(start));
+    }
+    return r;
+}
+
+void PipelineCache::CountCreation(uint64_t key, double time) {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    if (storedKeys.count(key) || createdKeys.count(key)) {
+        ++stats.hits;
+        stats.hitsTime += time;
+    } else {
+        ++stats.misses;
+        stats.missesTime += time;
+    }
+    createdKeys.insert(key);
+}
+
+void PipelineCache::Clear() {
+    if (cache == VK_NULL_HANDLE) {
+        return;
+    }
+    PRINT("Pipeline cache stats: %u hits (%.3f ms), %u misses (%.3f ms)",
+          stats.hits, stats.hitsTime, stats.misses, stats.missesTime);
+    Save();
+    vkDestroyPipelineCache(dev, cache, nullptr);
+    cache = VK_NULL_HANDLE;
+    dev   = VK_NULL_HANDLE;
+    storedKeys.clear();
+    createdKeys.clear();
+}
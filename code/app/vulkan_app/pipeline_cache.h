@@ -0,0 +1,93 @@
+#pragma once
+
+#include <app_result.h>
+#include <vulkan_app/vk_base.h>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * @brief
+ * VkPipelineCache persisted on disk between launches.
+ * The blob is invalidated if the device or the driver differ from the ones it was saved with.
+ * Pipelines are identified with 64-bit keys to count cache hits and misses.
+ * Pipelines may be created from several threads at once
+*/
+class PipelineCache {
+
+public:
+
+    struct Stats {
+        uint32_t hits   = 0;
+        uint32_t misses = 0;
+        // Time spent in pipeline creation, ms
+        double hitsTime   = 0.0;
+        double missesTime = 0.0;
+        // Time spent to load the blob and create the cache, ms
+        double loadTime   = 0.0;
+        bool loadedFromDisk = false;
+    };
+
+    /**
+     * @brief
+     * Create pipeline cache using the blob stored in the file if it is valid
+     * @param device
+     * logical device
+     * @param properties
+     * properties of the physical device the blob must match
+     * @param path
+     * path to the cache file. Empty path disables persistence
+     * @return
+     * AppResult code
+    */
+    AppResult Init(VkDevice device, const VkPhysicalDeviceProperties& properties, const std::string& path);
+    // Atomically write the cache to the file
+    AppResult Save();
+    void Clear();
+
+    VkResult CreateGraphicsPipeline(const VkGraphicsPipelineCreateInfo& createInfo, uint64_t key,
+                                    VkPipeline& pipeline);
+    VkResult CreateComputePipeline(const VkComputePipelineCreateInfo& createInfo, uint64_t key,
+                                   VkPipeline& pipeline);
+
+    VkPipelineCache GetHandle() const { return cache; }
+    const Stats& GetStats() const { return stats; }
+
+private:
+
+    // Prepended to the Vulkan blob to validate it before passing to the driver
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint8_t  pipelineCacheUUID[VK_UUID_SIZE];
+        uint32_t keysCount;
+        uint64_t dataSize;
+        uint64_t dataHash;
+    };
+
+    bool ReadBlob(std::vector<uint8_t>& data);
+    bool IsBlobValid(const FileHeader& header, const std::vector<uint8_t>& data) const;
+    void CountCreation(uint64_t key, double time);
+
+private:
+
+    VkDevice dev = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties devProps{};
+    VkPipelineCache cache = VK_NULL_HANDLE;
+    std::string filePath;
+
+    // Keys of the pipelines stored in the loaded blob
+    std::unordered_set<uint64_t> storedKeys;
+    // Keys of the pipelines created this launch
+    std::unordered_set<uint64_t> createdKeys;
+
+    Stats stats;
+    // Guards the keys and the stats of concurrent creations
+    std::mutex statsMutex;
+};
@@ -0,0 +1,126 @@
+#include <vulkan_app/pipeline_cache_benchmark.h>
+
+#include <logs.h>
+#include <utils/bench_stats.h>
+#include <vulkan_app/pipeline_factory.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+namespace {
+
+/**
+ * @brief
+ * Create a pipeline cache, all the pipelines with it and destroy them
+ * @param initialData
+ * data of the cache, empty for an empty cache
+ * @param cacheData
+ * data of the cache after the creations. Not read if nullptr
+ * @param time
+ * time of the pipelines creation, ms
+*/
+AppResult CreatePipelines(VkDevice device, VkPipelineLayout layout, const std::vector<VkShaderModule>& modules,
+                          const std::vector<uint8_t>& initialData, std::vector<uint8_t>* cacheData, double& time) {
+
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheInfo.initialDataSize = initialData.size();
+    cacheInfo.pInitialData    = initialData.empty() ? nullptr : initialData.data();
+
+    VkPipelineCache cache = VK_NULL_HANDLE;
+    VkResult r = vkCreatePipelineCache(device, &cacheInfo, nullptr, &cache);
+    if (r != VK_SUCCESS) {
+        PRINT_E("Failed to create pipeline cache. Vk error code: %d", r);
+        return APP_CODE_VK_COMMAND_FAIURE;
+    }
+
+    std::vector<VkPipeline> pipelines(modules.size(), VK_NULL_HANDLE);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < modules.size() && r == VK_SUCCESS; ++i) {
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType        = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = modules[i];
+        pipelineInfo.stage.pName  = "main";
+        pipelineInfo.layout       = layout;
+        r = vkCreateComputePipelines(device, cache, 1, &pipelineInfo, nullptr, &pipelines[i]);
+    }
+    time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    if (r == VK_SUCCESS && cacheData) {
+        size_t size = 0;
+        vkGetPipelineCacheData(device, cache, &size, nullptr);
+        cacheData->resize(size);
+        vkGetPipelineCacheData(device, cache, &size, cacheData->data());
+        cacheData->resize(size);
+    }
+
+    for (auto pipeline : pipelines) {
+        vkDestroyPipeline(device, pipeline, nullptr);
+    }
+    vkDestroyPipelineCache(device, cache, nullptr);
+
+    if (r != VK_SUCCESS) {
+        PRINT_E("Failed to create compute pipeline. Vk error code: %d", r);
+        return APP_CODE_VK_COMMAND_FAIURE;
+    }
+    return APP_CODE_OK;
+}
+
+} // namespace
+
+AppResult RunPipelineCacheBenchmark(VkDevice device, VkPipelineLayout layout, const std::vector<std::string>& shaders) {
+
+    std::vector<VkShaderModule> modules;
+    AppResult result = APP_CODE_OK;
+    for (const auto& path : shaders) {
+        std::vector<uint32_t> code;
+        if (!PipelineFactory::ReadSpirv(path, code)) {
+            PRINT_E("Failed to read shader \"%s\"", path.c_str());
+            result = APP_CODE_IO_FAILURE;
+            break;
+        }
+        VkShaderModuleCreateInfo moduleInfo{};
+        moduleInfo.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        moduleInfo.codeSize = code.size() * sizeof(uint32_t);
+        moduleInfo.pCode    = code.data();
+
+        VkShaderModule module = VK_NULL_HANDLE;
+        VkResult r = vkCreateShaderModule(device, &moduleInfo, nullptr, &module);
+        if (r != VK_SUCCESS) {
+            PRINT_E("Failed to create shader module. Vk error code: %d", r);
+            result = APP_CODE_VK_COMMAND_FAIURE;
+            break;
+        }
+        modules.push_back(module);
+    }
+
+    // Every iteration creates new caches, so the pipelines are never found in the previous ones
+    std::vector<uint8_t> warmData;
+    std::vector<double> emptyTimes, warmTimes;
+    for (int i = 0; i < benchIterations && APP_CHECK_RESULT(result); ++i) {
+        double time = 0.0;
+        result = CreatePipelines(device, layout, modules, {}, warmData.empty() ? &warmData : nullptr, time);
+        emptyTimes.push_back(time);
+        if (APP_CHECK_RESULT(result)) {
+            result = CreatePipelines(device, layout, modules, warmData, nullptr, time);
+            warmTimes.push_back(time);
+        }
+    }
+
+    for (auto module : modules) {
+        vkDestroyShaderModule(device, module, nullptr);
+    }
+    if (!APP_CHECK_RESULT(result)) {
+        return result;
+    }
+
+    double emptyTime = Median(emptyTimes);
+    double warmTime  = Median(warmTimes);
+    PRINT("Pipeline cache benchmark: %zu compute pipelines, %zu bytes of cache data", modules.size(), warmData.size());
+    PRINT("  empty cache %.3f ms, warm cache %.3f ms (x%.2f)", emptyTime, warmTime,
+          warmTime > 0.0 ? emptyTime / warmTime : 0.0);
+    return APP_CODE_OK;
+}
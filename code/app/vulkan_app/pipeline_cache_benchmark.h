@@ -0,0 +1,23 @@
+#pragma once
+
+#include <app_result.h>
+#include <vulkan_app/vk_base.h>
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief
+ * Benchmark compute pipeline creation with an empty VkPipelineCache against a warm one created from
+ * the data of an empty cache run. Drivers keeping their own shader cache on disk make the empty cache
+ * runs faster too, disable it to see the cold creation time
+ * @param device
+ * logical device
+ * @param layout
+ * pipeline layout of the shaders
+ * @param shaders
+ * paths of the compute shaders SPIR-V
+ * @return
+ * AppResult code
+*/
+AppResult RunPipelineCacheBenchmark(VkDevice device, VkPipelineLayout layout, const std::vector<std::string>& shaders);
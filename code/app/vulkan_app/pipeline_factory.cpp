@@ -0,0 +1,438 @@
+#include <vulkan_app/pipeline_factory.h>
+
+#include <logs.h>
+#include <utils/executable_dir.h>
+#include <utils/hash.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <string>
+
+namespace {
+
+double MsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+uint64_t HashValues(const std::vector<uint64_t>& values) {
+    return HashBytes(values.data(), values.size() * sizeof(uint64_t));
+}
+
+// Handles aren't hashed, the keys stay the same between launches
+PipelineFactory::Key GetComputeKey(const PipelineFactory::ComputeDesc& desc) {
+    std::vector<uint64_t> values = { HashString("compute"), desc.shader, desc.layoutKey };
+    values.insert(values.end(), desc.specialization.begin(), desc.specialization.end());
+    return HashValues(values);
+}
+
+PipelineFactory::Key GetGraphicsKey(const PipelineFactory::GraphicsDesc& desc) {
+    std::vector<uint64_t> values = {
+        HashString("graphics"), desc.vertexShader, desc.fragmentShader, desc.layoutKey, desc.renderPassKey,
+        desc.subpass, desc.topology, desc.polygonMode, desc.cullMode, desc.frontFace, desc.samples,
+        desc.depthTest, desc.depthWrite, desc.depthCompare, desc.colorAttachments, desc.blend,
+    };
+    for (const auto& binding : desc.vertexBindings) {
+        values.insert(values.end(), { binding.binding, binding.stride, binding.inputRate });
+    }
+    for (const auto& attribute : desc.vertexAttributes) {
+        values.insert(values.end(), { attribute.location, attribute.binding, attribute.format, attribute.offset });
+    }
+    values.insert(values.end(), desc.specialization.begin(), desc.specialization.end());
+    return HashValues(values);
+}
+
+// Constant i of the values gets id i
+void FillSpecialization(const std::vector<uint32_t>& values, std::vector<VkSpecializationMapEntry>& entries,
+                        VkSpecializationInfo& info) {
+    entries.resize(values.size());
+    for (uint32_t i = 0; i < values.size(); ++i) {
+        entries[i].constantID = i;
+        entries[i].offset     = i * sizeof(uint32_t);
+        entries[i].size       = sizeof(uint32_t);
+    }
+    info.mapEntryCount = static_cast<uint32_t>(entries.size());
+    info.pMapEntries   = entries.data();
+    info.dataSize      = values.size() * sizeof(uint32_t);
+    info.pData         = values.data();
+}
+
+} // namespace
+
+AppResult PipelineFactory::Init(VkDevice device, PipelineCache& cache, uint32_t threadsCount) {
+
+    dev           = device;
+    pipelineCache = &cache;
+    stats         = {};
+    stopping      = false;
+
+    if (!threadsCount) {
+        threadsCount = std::max(std::thread::hardware_concurrency() / 2, 1u);
+    }
+    threads.reserve(threadsCount);
+    for (uint32_t i = 0; i < threadsCount; ++i) {
+        threads.emplace_back(&PipelineFactory::WorkerFunc, this);
+    }
+
+    PRINT("Pipeline factory started %u compile threads", threadsCount);
+    return APP_CODE_OK;
+}
+
+AppResult PipelineFactory::AddShader(const std::vector<uint32_t>& code, Key& key) {
+
+    key = HashBytes(code.data(), code.size() * sizeof(uint32_t));
+    if (modules.count(key)) {
+        ++stats.shaderDuplicates;
+        return APP_CODE_OK;
+    }
+
+    VkShaderModuleCreateInfo moduleInfo{};
+    moduleInfo.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    moduleInfo.codeSize = code.size() * sizeof(uint32_t);
+    moduleInfo.pCode    = code.data();
+
+    VkShaderModule module = VK_NULL_HANDLE;
+    VkResult r = vkCreateShaderModule(dev, &moduleInfo, nullptr, &module);
+    if (r != VK_SUCCESS) {
+        PRINT_E("Failed to create shader module. Vk error code: %d", r);
+        return APP_CODE_VK_COMMAND_FAIURE;
+    }
+    modules[key] = module;
+    ++stats.shaderModules;
+    return APP_CODE_OK;
+}
+
+std::string PipelineFactory::GetShaderPath(const char* name) {
+    return GetExecutableDir() + "/" + APP_SHADERS_DIR + "/" + name + ".spv";
+}
+
+bool PipelineFactory::ReadSpirv(const std::string& path, std::vector<uint32_t>& code) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return false;
+    }
+    size_t size = static_cast<size_t>(file.tellg());
+    if (!size || size % sizeof(uint32_t)) {
+        return false;
+    }
+    code.resize(size / sizeof(uint32_t));
+    file.seekg(0);
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(code.data()), size));
+}
+
+AppResult PipelineFactory::LoadShader(const char* name, Key& key) {
+
+    std::string path = GetShaderPath(name);
+    std::vector<uint32_t> code;
+    if (!ReadSpirv(path, code)) {
+        PRINT_E("Failed to read shader \"%s\"", path.c_str());
+        return APP_CODE_IO_FAILURE;
+    }
+    return AddShader(code, key);
+}
+
+bool PipelineFactory::BeginRequest(Key key) {
+    ++stats.requests;
+    if (entries.count(key)) {
+        ++stats.duplicates;
+        return false;
+    }
+    entries[key] = Entry();
+    return true;
+}
+
+PipelineFactory::Key PipelineFactory::RequestCompute(const ComputeDesc& desc) {
+
+    Key key = GetComputeKey(desc);
+    if (!BeginRequest(key)) {
+        return key;
+    }
+
+    auto module = modules.find(desc.shader);
+    if (module == modules.end()) {
+        PRINT_E("Compute pipeline %016llx uses an unknown shader", static_cast<unsigned long long>(key));
+        entries[key].state = State::Failed;
+        ++stats.failed;
+        return key;
+    }
+
+    Job job;
+    job.key        = key;
+    job.compute    = desc;
+    job.modules[0] = module->second;
+    Enqueue(std::move(job));
+    return key;
+}
+
+PipelineFactory::Key PipelineFactory::RequestGraphics(const GraphicsDesc& desc) {
+
+    Key key = GetGraphicsKey(desc);
+    if (!BeginRequest(key)) {
+        return key;
+    }
+
+    auto vertex   = modules.find(desc.vertexShader);
+    auto fragment = modules.find(desc.fragmentShader);
+    if (vertex == modules.end() || (desc.fragmentShader && fragment == modules.end())) {
+        PRINT_E("Graphics pipeline %016llx uses an unknown shader", static_cast<unsigned long long>(key));
+        entries[key].state = State::Failed;
+        ++stats.failed;
+        return key;
+    }
+
+    Job job;
+    job.key          = key;
+    job.graphics     = true;
+    job.graphicsDesc = desc;
+    job.modules[0]   = vertex->second;
+    job.modules[1]   = fragment != modules.end() ? fragment->second : VK_NULL_HANDLE;
+    Enqueue(std::move(job));
+    return key;
+}
+
+void PipelineFactory::Enqueue(Job&& job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    jobCondition.notify_one();
+}
+
+void PipelineFactory::WorkerFunc() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            jobCondition.wait(lock, [this]() { return stopping || !jobs.empty(); });
+            if (stopping) {
+                return;
+            }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+
+        Result result = Compile(job);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.push_back(result);
+        }
+        finishedCondition.notify_all();
+    }
+}
+
+PipelineFactory::Result PipelineFactory::Compile(const Job& job) {
+
+    auto start = std::chrono::steady_clock::now();
+    Result result{ job.key, VK_NULL_HANDLE, VK_SUCCESS, 0.0 };
+
+    VkSpecializationInfo specialization{};
+    std::vector<VkSpecializationMapEntry> specializationEntries;
+
+    if (!job.graphics) {
+        const auto& desc = job.compute;
+        FillSpecialization(desc.specialization, specializationEntries, specialization);
+
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType        = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = job.modules[0];
+        pipelineInfo.stage.pName  = "main";
+        pipelineInfo.stage.pSpecializationInfo = desc.specialization.empty() ? nullptr : &specialization;
+        pipelineInfo.layout       = desc.layout;
+
+        result.result = pipelineCache->CreateComputePipeline(pipelineInfo, job.key, result.pipeline);
+        result.time   = MsSince(start);
+        return result;
+    }
+
+    const auto& desc = job.graphicsDesc;
+    FillSpecialization(desc.specialization, specializationEntries, specialization);
+
+    VkPipelineShaderStageCreateInfo stages[2]{};
+    uint32_t stagesCount = 0;
+    for (int i = 0; i < 2; ++i) {
+        if (job.modules[i] == VK_NULL_HANDLE) {
+            continue;
+        }
+        auto& stage = stages[stagesCount++];
+        stage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        stage.stage  = i == 0 ? VK_SHADER_STAGE_VERTEX_BIT : VK_SHADER_STAGE_FRAGMENT_BIT;
+        stage.module = job.modules[i];
+        stage.pName  = "main";
+        stage.pSpecializationInfo = desc.specialization.empty() ? nullptr : &specialization;
+    }
+
+    VkPipelineVertexInputStateCreateInfo vertexInput{};
+    vertexInput.sType                           = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInput.vertexBindingDescriptionCount   = static_cast<uint32_t>(desc.vertexBindings.size());
+    vertexInput.pVertexBindingDescriptions      = desc.vertexBindings.data();
+    vertexInput.vertexAttributeDescriptionCount = static_cast<uint32_t>(desc.vertexAttributes.size());
+    vertexInput.pVertexAttributeDescriptions    = desc.vertexAttributes.data();
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType    = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = desc.topology;
+
+    VkPipelineViewportStateCreateInfo viewport{};
+    viewport.sType         = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewport.viewportCount = 1;
+    viewport.scissorCount  = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterization{};
+    rasterization.sType       = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterization.polygonMode = desc.polygonMode;
+    rasterization.cullMode    = desc.cullMode;
+    rasterization.frontFace   = desc.frontFace;
+    rasterization.lineWidth   = 1.0f;
+
+    VkPipelineMultisampleStateCreateInfo multisample{};
+    multisample.sType                = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisample.rasterizationSamples = desc.samples;
+
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    depthStencil.sType            = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable  = desc.depthTest;
+    depthStencil.depthWriteEnable = desc.depthWrite;
+    depthStencil.depthCompareOp   = desc.depthCompare;
+
+    VkPipelineColorBlendAttachmentState attachment{};
+    attachment.blendEnable         = desc.blend;
+    attachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    attachment.colorBlendOp        = VK_BLEND_OP_ADD;
+    attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    attachment.alphaBlendOp        = VK_BLEND_OP_ADD;
+    attachment.colorWriteMask      = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                                     VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    std::vector<VkPipelineColorBlendAttachmentState> attachments(desc.colorAttachments, attachment);
+
+    VkPipelineColorBlendStateCreateInfo colorBlend{};
+    colorBlend.sType           = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlend.attachmentCount = static_cast<uint32_t>(attachments.size());
+    colorBlend.pAttachments    = attachments.data();
+
+    VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dynamic{};
+    dynamic.sType             = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamic.dynamicStateCount = 2;
+    dynamic.pDynamicStates    = dynamicStates;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount          = stagesCount;
+    pipelineInfo.pStages             = stages;
+    pipelineInfo.pVertexInputState   = &vertexInput;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState      = &viewport;
+    pipelineInfo.pRasterizationState = &rasterization;
+    pipelineInfo.pMultisampleState   = &multisample;
+    pipelineInfo.pDepthStencilState  = &depthStencil;
+    pipelineInfo.pColorBlendState    = &colorBlend;
+    pipelineInfo.pDynamicState       = &dynamic;
+    pipelineInfo.layout              = desc.layout;
+    pipelineInfo.renderPass          = desc.renderPass;
+    pipelineInfo.subpass             = desc.subpass;
+
+    result.result = pipelineCache->CreateGraphicsPipeline(pipelineInfo, job.key, result.pipeline);
+    result.time   = MsSince(start);
+    return result;
+}
+
+uint32_t PipelineFactory::Poll() {
+
+    std::vector<Result> results;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (finished.empty()) {
+            return 0;
+        }
+        results.swap(finished);
+    }
+
+    uint32_t ready = 0;
+    for (const auto& result : results) {
+        auto& entry = entries[result.key];
+        stats.compileTime   += result.time;
+        stats.maxCompileTime = std::max(stats.maxCompileTime, result.time);
+        if (result.result != VK_SUCCESS) {
+            PRINT_E("Failed to compile pipeline %016llx. Vk error code: %d",
+                    static_cast<unsigned long long>(result.key), result.result);
+            entry.state = State::Failed;
+            ++stats.failed;
+            continue;
+        }
+        PRINT_V("Pipeline %016llx compiled in %.3f ms", static_cast<unsigned long long>(result.key), result.time);
+        entry.state    = State::Ready;
+        entry.pipeline = result.pipeline;
+        ++stats.compiled;
+        ++ready;
+    }
+    return ready;
+}
+
+VkPipeline PipelineFactory::GetPipeline(Key key) const {
+    auto entry = entries.find(key);
+    return entry != entries.end() ? entry->second.pipeline : VK_NULL_HANDLE;
+}
+
+PipelineFactory::State PipelineFactory::GetState(Key key) const {
+    auto entry = entries.find(key);
+    return entry != entries.end() ? entry->second.state : State::Unknown;
+}
+
+VkPipeline PipelineFactory::WaitPipeline(Key key) {
+
+    auto start = std::chrono::steady_clock::now();
+    while (GetState(key) == State::Compiling) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            finishedCondition.wait(lock, [this]() { return !finished.empty(); });
+        }
+        Poll();
+    }
+    stats.waitTime += MsSince(start);
+    return GetPipeline(key);
+}
+
+void PipelineFactory::PrintStats() const {
+    if (!stats.requests) {
+        return;
+    }
+    PRINT("Pipeline factory: %u shader modules (%u duplicates), %u pipeline requests (%u duplicates)",
+          stats.shaderModules, stats.shaderDuplicates, stats.requests, stats.duplicates);
+    PRINT("Pipeline factory: %u compiled, %u failed, background compilation %.3f ms (max %.3f ms), waited %.3f ms",
+          stats.compiled, stats.failed, stats.compileTime, stats.maxCompileTime, stats.waitTime);
+}
+
+void PipelineFactory::Clear() {
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    jobCondition.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    threads.clear();
+
+    // Pipelines finished after the last Poll are destroyed with the rest
+    Poll();
+    for (const auto& entry : entries) {
+        if (entry.second.pipeline != VK_NULL_HANDLE) {
+            vkDestroyPipeline(dev, entry.second.pipeline, nullptr);
+        }
+    }
+    for (const auto& module : modules) {
+        vkDestroyShaderModule(dev, module.second, nullptr);
+    }
+
+    entries.clear();
+    modules.clear();
+    jobs.clear();
+    finished.clear();
+    pipelineCache = nullptr;
+    dev           = VK_NULL_HANDLE;
+}
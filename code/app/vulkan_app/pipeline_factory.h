@@ -0,0 +1,193 @@
+#pragma once
+
+#include <app_consts.h>
+#include <app_result.h>
+#include <vulkan_app/pipeline_cache.h>
+#include <vulkan_app/vk_base.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief
+ * Deduplicating pipeline factory. Shader modules are keyed by the hash of their SPIR-V and
+ * pipelines by the hash of the shader keys and the pipeline state, so equal requests share
+ * one object. Missing pipelines are compiled by background threads through the pipeline cache.
+ * The render thread requests pipelines and polls for them once per frame without blocking.
+ * Besides the compile threads, only the thread called Init may use the factory
+*/
+class PipelineFactory {
+
+public:
+
+    typedef uint64_t Key;
+
+    enum class State {
+        Unknown,
+        Compiling,
+        Ready,
+        Failed,
+    };
+
+    // Compute pipeline. Specialization constants get ids 0..N-1
+    struct ComputeDesc {
+        Key shader = 0;
+        VkPipelineLayout layout = VK_NULL_HANDLE;
+        // Identifies the layout in keys, handles differ between launches
+        uint64_t layoutKey = 0;
+        std::vector<uint32_t> specialization;
+    };
+
+    // Graphics pipeline with dynamic viewport and scissor. Specialization constants get ids 0..N-1
+    struct GraphicsDesc {
+        Key vertexShader   = 0;
+        Key fragmentShader = 0;
+        VkPipelineLayout layout = VK_NULL_HANDLE;
+        uint64_t layoutKey = 0;
+        VkRenderPass renderPass = VK_NULL_HANDLE;
+        uint64_t renderPassKey = 0;
+        uint32_t subpass = 0;
+        std::vector<VkVertexInputBindingDescription> vertexBindings;
+        std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+        VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        VkPolygonMode polygonMode    = VK_POLYGON_MODE_FILL;
+        VkCullModeFlags cullMode     = VK_CULL_MODE_BACK_BIT;
+        VkFrontFace frontFace        = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+        VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+        bool depthTest  = true;
+        bool depthWrite = true;
+        VkCompareOp depthCompare = VK_COMPARE_OP_LESS;
+        uint32_t colorAttachments = 1;
+        bool blend = false;
+        std::vector<uint32_t> specialization;
+    };
+
+    struct Stats {
+        uint32_t shaderModules   = 0;
+        // Shaders added again with the same SPIR-V
+        uint32_t shaderDuplicates = 0;
+        uint32_t requests        = 0;
+        // Requests of pipelines already compiled or compiling
+        uint32_t duplicates      = 0;
+        uint32_t compiled        = 0;
+        uint32_t failed          = 0;
+        // Background compilation time, ms
+        double compileTime       = 0.0;
+        double maxCompileTime    = 0.0;
+        // Render thread time blocked in WaitPipeline, ms
+        double waitTime          = 0.0;
+    };
+
+    PipelineFactory() = default;
+    PipelineFactory(const PipelineFactory&) = delete;
+    ~PipelineFactory() { Clear(); }
+
+    /**
+     * @brief
+     * Start the compile threads
+     * @param device
+     * logical device
+     * @param cache
+     * pipeline cache the pipelines are created with
+     * @param threadsCount
+     * count of compile threads. 0 to use half of the hardware threads
+     * @return
+     * AppResult code
+    */
+    AppResult Init(VkDevice device, PipelineCache& cache, uint32_t threadsCount);
+    // Stop the threads and destroy the pipelines and the shader modules
+    void Clear();
+
+    /**
+     * @brief
+     * Create a shader module or find the one with the same SPIR-V
+     * @param code
+     * SPIR-V words
+     * @param key
+     * key of the shader
+     * @return
+     * AppResult code
+    */
+    AppResult AddShader(const std::vector<uint32_t>& code, Key& key);
+    // Add a shader compiled to SPIR-V by the build, name is like "frustum_cull.comp"
+    AppResult LoadShader(const char* name, Key& key);
+    // Path of a shader compiled by the build. Shaders are next to the executable, not in the working directory
+    static std::string GetShaderPath(const char* name);
+    // Read SPIR-V words of a file
+    static bool ReadSpirv(const std::string& path, std::vector<uint32_t>& code);
+
+    // Start compiling a pipeline unless an equal one is compiled or compiling. Returns its key
+    Key RequestCompute(const ComputeDesc& desc);
+    Key RequestGraphics(const GraphicsDesc& desc);
+
+    /**
+     * @brief
+     * Take the pipelines finished by the compile threads. Call once per frame
+     * @return
+     * count of pipelines which became ready
+    */
+    uint32_t Poll();
+    // VK_NULL_HANDLE until the pipeline is ready
+    VkPipeline GetPipeline(Key key) const;
+    State GetState(Key key) const;
+    // Block until the pipeline is compiled. For loading, not for frames
+    VkPipeline WaitPipeline(Key key);
+
+    uint32_t GetThreadsCount() const { return static_cast<uint32_t>(threads.size()); }
+    const Stats& GetStats() const { return stats; }
+    void PrintStats() const;
+
+private:
+
+    struct Entry {
+        State state = State::Compiling;
+        VkPipeline pipeline = VK_NULL_HANDLE;
+    };
+
+    struct Job {
+        Key key = 0;
+        bool graphics = false;
+        ComputeDesc compute;
+        GraphicsDesc graphicsDesc;
+        // Modules are resolved on the render thread and live until Clear
+        VkShaderModule modules[2] = { VK_NULL_HANDLE, VK_NULL_HANDLE };
+    };
+
+    struct Result {
+        Key key;
+        VkPipeline pipeline;
+        VkResult result;
+        double time;
+    };
+
+    // Register a request, returns false if the pipeline is known already
+    bool BeginRequest(Key key);
+    void Enqueue(Job&& job);
+    void WorkerFunc();
+    Result Compile(const Job& job);
+
+private:
+
+    VkDevice dev = VK_NULL_HANDLE;
+    PipelineCache* pipelineCache = nullptr;
+
+    // Render thread only
+    std::unordered_map<Key, VkShaderModule> modules;
+    std::unordered_map<Key, Entry> entries;
+    Stats stats;
+
+    // Shared with the compile threads
+    std::vector<std::thread> threads;
+    std::deque<Job> jobs;
+    std::vector<Result> finished;
+    std::mutex mutex;
+    std::condition_variable jobCondition;
+    std::condition_variable finishedCondition;
+    bool stopping = false;
+};
@@ -0,0 +1,70 @@
+#include <vulkan_app/record_benchmark.h>
+
+#include <logs.h>
+#include <utils/bench_stats.h>
+#include <vulkan_app/command_recorder.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Commands recorded by a job, like the draws of a mesh batch
+constexpr uint32_t commandsPerJob = 64;
+constexpr VkDeviceSize fillSize   = 256;
+
+} // namespace
+
+AppResult RunRecordBenchmark(VkDevice device, uint32_t queueFamily, VkBuffer buffer, uint32_t jobsCount) {
+
+    std::vector<CommandRecorder::RecordJob> jobs;
+    jobs.reserve(jobsCount);
+    for (uint32_t i = 0; i < jobsCount; ++i) {
+        jobs.push_back([buffer, i](VkCommandBuffer cmd) {
+            for (uint32_t command = 0; command < commandsPerJob; ++command) {
+                VkDeviceSize offset = (VkDeviceSize(i) * commandsPerJob + command) * fillSize % recordBenchBufferSize;
+                vkCmdFillBuffer(cmd, buffer, offset, fillSize, i);
+            }
+        });
+    }
+
+    VkCommandBufferInheritanceInfo inheritance{};
+    inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+
+    uint32_t hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    std::vector<uint32_t> threadCounts;
+    for (uint32_t threads = 1; threads < hardwareThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(hardwareThreads);
+
+    PRINT("Record benchmark: %u jobs of %u commands", jobsCount, commandsPerJob);
+
+    double baseTime = 0.0;
+    for (auto threads : threadCounts) {
+        CommandRecorder recorder;
+        APP_CHECK_CALL(recorder.Init(device, queueFamily, 1, threads));
+
+        // Buffers are never submitted, so the pool is reset right away
+        std::vector<VkCommandBuffer> commandBuffers;
+        std::vector<double> times;
+        for (int i = 0; i < benchIterations; ++i) {
+            recorder.BeginFrame(0);
+            auto start = std::chrono::steady_clock::now();
+            APP_CHECK_CALL(recorder.Record(jobs, inheritance, commandBuffers));
+            times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        recorder.BeginFrame(0);
+
+        double time = Median(times);
+        if (!baseTime) {
+            baseTime = time;
+        }
+        PRINT("  %2u threads: %.3f ms, %zu secondary buffers (x%.2f)", threads, time, commandBuffers.size(),
+              time > 0.0 ? baseTime / time : 0.0);
+    }
+
+    return APP_CODE_OK;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <app_result.h>
+#include <vulkan_app/vk_base.h>
+
+#include <cstdint>
+
+// Size of the buffer written by the recorded commands
+constexpr VkDeviceSize recordBenchBufferSize = 64 * 1024;
+
+/**
+ * @brief
+ * Benchmark CommandRecorder with 1 to all hardware threads. Every job records a batch of transfer commands
+ * into its secondary command buffer, only the CPU recording time is measured and nothing is submitted
+ * @param device
+ * logical device
+ * @param queueFamily
+ * family of the graphics queue
+ * @param buffer
+ * buffer of at least recordBenchBufferSize bytes with VK_BUFFER_USAGE_TRANSFER_DST_BIT written by the jobs
+ * @param jobsCount
+ * count of jobs recorded per frame
+ * @return
+ * AppResult code
+*/
+AppResult RunRecordBenchmark(VkDevice device, uint32_t queueFamily, VkBuffer buffer, uint32_t jobsCount);
@@ -0,0 +1,848 @@
+#include <vulkan_app/render_graph.h>
+
+#include <logs.h>
+#include <utils/hash.h>
+
+#include <algorithm>
+
+namespace {
+
+struct AccessInfo {
+    VkPipelineStageFlags stages;
+    VkAccessFlags access;
+    VkImageLayout layout;
+    VkImageUsageFlags imageUsage;
+    VkBufferUsageFlags bufferUsage;
+};
+
+// Indexed by RenderGraph::Access
+constexpr AccessInfo accessInfos[] = {
+    // TransferRead
+    { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+      VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_BUFFER_USAGE_TRANSFER_SRC_BIT },
+    // TransferWrite
+    { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_BUFFER_USAGE_TRANSFER_DST_BIT },
+    // ColorAttachmentWrite
+    { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+      VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+      VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, 0 },
+    // DepthAttachmentWrite
+    { VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+      VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+      VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, 0 },
+    // DepthAttachmentRead
+    { VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+      VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+      VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, 0 },
+    // SampledRead
+    { VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+      VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT, VK_BUFFER_USAGE_UNIFORM_TEXEL_BUFFER_BIT },
+    // StorageRead
+    { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL,
+      VK_IMAGE_USAGE_STORAGE_BIT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT },
+    // StorageWrite
+    { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+      VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT },
+    // IndirectRead
+    { VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+      0, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT },
+    // VertexRead
+    { VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT,
+      VK_IMAGE_LAYOUT_UNDEFINED, 0, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT },
+    // UniformRead
+    { VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_UNIFORM_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+      0, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT },
+    // HostRead
+    { VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, 0, 0 },
+};
+static_assert(sizeof(accessInfos) / sizeof(accessInfos[0]) == static_cast<size_t>(RenderGraph::Access::Count),
+              "Every access must be described");
+
+// Accesses which have to be made available by a barrier
+constexpr VkAccessFlags writeAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                                          VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT |
+                                          VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+// Typical alignment of optimal images and buffers to estimate requirements without a device
+constexpr VkDeviceSize estimatedImageAlignment  = 64 * 1024;
+constexpr VkDeviceSize estimatedBufferAlignment = 256;
+
+// Merged description of a set of accesses
+struct CombinedAccess {
+    VkPipelineStageFlags stages = 0;
+    VkAccessFlags access = 0;
+    VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkImageUsageFlags imageUsage = 0;
+    VkBufferUsageFlags bufferUsage = 0;
+    // Accesses need different image layouts
+    bool conflict = false;
+};
+
+CombinedAccess CombineAccesses(uint32_t accesses) {
+    CombinedAccess combined;
+    for (uint32_t i = 0; i < static_cast<uint32_t>(RenderGraph::Access::Count); ++i) {
+        if (!(accesses & (1u << i))) {
+            continue;
+        }
+        const auto& info = accessInfos[i];
+        combined.stages      |= info.stages;
+        combined.access      |= info.access;
+        combined.imageUsage  |= info.imageUsage;
+        combined.bufferUsage |= info.bufferUsage;
+        if (info.layout != VK_IMAGE_LAYOUT_UNDEFINED) {
+            combined.conflict |= combined.layout != VK_IMAGE_LAYOUT_UNDEFINED && combined.layout != info.layout;
+            combined.layout = info.layout;
+        }
+    }
+    return combined;
+}
+
+uint32_t GetFormatSize(VkFormat format) {
+    switch (format) {
+    case VK_FORMAT_R8_UNORM:
+    case VK_FORMAT_R8_UINT:
+        return 1;
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+    case VK_FORMAT_R32G32_SFLOAT:
+        return 8;
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+        return 16;
+    default:
+        // 32-bit color and depth formats
+        return 4;
+    }
+}
+
+VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+bool LifetimesOverlap(const RenderGraph::Placement& left, const RenderGraph::Placement& right) {
+    return left.firstPass <= right.lastPass && right.firstPass <= left.lastPass;
+}
+
+bool RangesOverlap(const RenderGraph::Placement& left, const RenderGraph::Placement& right) {
+    return left.offset < right.offset + right.size && right.offset < left.offset + left.size;
+}
+
+uint64_t HashDesc(const RenderGraph::TransientDesc& desc) {
+    // Fields are hashed one by one to skip the padding
+    uint64_t values[] = { desc.image, desc.imageDesc.format, desc.imageDesc.width, desc.imageDesc.height,
+                          desc.imageDesc.mipLevels, desc.imageDesc.aspect, desc.bufferDesc.size, desc.usage };
+    return HashBytes(values, sizeof(values));
+}
+
+} // namespace
+
+AppResult RenderGraph::Init(VkDevice device, MemoryAllocator& allocator, uint32_t framesInFlight,
+                            VkDeviceSize bufferImageGranularity) {
+
+    dev          = device;
+    memAllocator = &allocator;
+    SetBufferImageGranularity(bufferImageGranularity);
+    frames.resize(framesInFlight ? framesInFlight : 1);
+
+    return APP_CODE_OK;
+}
+
+void RenderGraph::SetRequirementsQuery(RequirementsFunc query) {
+    requirementsQuery = std::move(query);
+    requirementsCache.clear();
+}
+
+void RenderGraph::Reset() {
+    passes.clear();
+    resources.clear();
+    schedule.clear();
+    barriers.clear();
+    finalBarriers = {};
+    heaps.clear();
+    invalid  = false;
+    compiled = false;
+}
+
+RenderGraph::ResourceId RenderGraph::CreateImage(const char* name, const ImageDesc& desc) {
+    Resource resource;
+    resource.name      = name;
+    resource.image     = true;
+    resource.imageDesc = desc;
+    resources.push_back(resource);
+    return static_cast<ResourceId>(resources.size() - 1);
+}
+
+RenderGraph::ResourceId RenderGraph::CreateBuffer(const char* name, const BufferDesc& desc) {
+    Resource resource;
+    resource.name       = name;
+    resource.bufferDesc = desc;
+    resources.push_back(resource);
+    return static_cast<ResourceId>(resources.size() - 1);
+}
+
+RenderGraph::ResourceId RenderGraph::ImportImage(const char* name, VkImage image, const ImageDesc& desc,
+                                                 const ExternalState& initial, const ExternalState& final) {
+    Resource resource;
+    resource.name          = name;
+    resource.image         = true;
+    resource.imported      = true;
+    resource.imageDesc     = desc;
+    resource.importedImage = image;
+    resource.initial       = initial;
+    resource.final         = final;
+    resources.push_back(resource);
+    return static_cast<ResourceId>(resources.size() - 1);
+}
+
+RenderGraph::ResourceId RenderGraph::ImportBuffer(const char* name, VkBuffer buffer, const BufferDesc& desc,
+                                                  const ExternalState& initial, const ExternalState& final) {
+    Resource resource;
+    resource.name           = name;
+    resource.imported       = true;
+    resource.bufferDesc     = desc;
+    resource.importedBuffer = buffer;
+    resource.initial        = initial;
+    resource.final          = final;
+    resources.push_back(resource);
+    return static_cast<ResourceId>(resources.size() - 1);
+}
+
+RenderGraph::PassId RenderGraph::AddPass(const char* name, ExecuteFunc execute) {
+    Pass pass;
+    pass.name    = name;
+    pass.execute = std::move(execute);
+    passes.push_back(std::move(pass));
+    return static_cast<PassId>(passes.size() - 1);
+}
+
+void RenderGraph::Read(PassId pass, ResourceId resource, Access access) {
+    AddUse(pass, resource, access, false);
+}
+
+void RenderGraph::Write(PassId pass, ResourceId resource, Access access) {
+    AddUse(pass, resource, access, true);
+}
+
+void RenderGraph::SetSideEffects(PassId pass) {
+    passes[pass].sideEffects = true;
+}
+
+void RenderGraph::AddUse(PassId pass, ResourceId resource, Access access, bool write) {
+
+    auto& uses = passes[pass].uses;
+    auto use = std::find_if(uses.begin(), uses.end(), [resource](const Use& use) {
+        return use.resource == resource;
+    });
+    if (use == uses.end()) {
+        uses.push_back({ resource, 0, false, false });
+        use = uses.end() - 1;
+    }
+    use->accesses |= 1u << static_cast<uint32_t>(access);
+    use->read  |= !write;
+    use->write |= write;
+
+    if (resources[resource].image && CombineAccesses(use->accesses).conflict) {
+        PRINT_E("Render graph pass \"%s\" uses image \"%s\" in different layouts",
+                passes[pass].name.c_str(), resources[resource].name.c_str());
+        invalid = true;
+    }
+}
+
+AppResult RenderGraph::Compile() {
+
+    if (invalid) {
+        return APP_CODE_INVALID_ARGS;
+    }
+
+    stats = {};
+    stats.passes = static_cast<uint32_t>(passes.size());
+
+    CullPasses();
+    // Declaration order already puts producers before consumers
+    schedule.clear();
+    for (PassId pass = 0; pass < passes.size(); ++pass) {
+        if (!passes[pass].culled) {
+            schedule.push_back(pass);
+        }
+    }
+    stats.culledPasses = stats.passes - static_cast<uint32_t>(schedule.size());
+
+    CollectLifetimes();
+    PlanMemory();
+    PlanBarriers();
+    compiled = true;
+
+    PRINT_V("Render graph: %u passes (%u culled), %u barriers in %u calls, transients %llu KiB in %llu KiB",
+            stats.passes, stats.culledPasses, stats.dependencies, stats.barrierCalls,
+            static_cast<unsigned long long>(stats.transientBytes / 1024),
+            static_cast<unsigned long long>(stats.heapBytes / 1024));
+    return APP_CODE_OK;
+}
+
+void RenderGraph::CullPasses() {
+
+    // Walk backwards tracking the resources whose current content is read later.
+    // A pass is alive if it writes such a resource, an imported one or has side effects
+    std::vector<uint8_t> needed(resources.size(), 0);
+    for (size_t i = passes.size(); i-- > 0;) {
+        auto& pass = passes[i];
+        bool alive = pass.sideEffects;
+        for (const auto& use : pass.uses) {
+            if (use.write && (resources[use.resource].imported || needed[use.resource])) {
+                alive = true;
+            }
+        }
+        pass.culled = !alive;
+        if (!alive) {
+            continue;
+        }
+        for (const auto& use : pass.uses) {
+            if (use.write && !use.read) {
+                // Overwritten, earlier content is never seen
+                needed[use.resource] = 0;
+            }
+        }
+        for (const auto& use : pass.uses) {
+            if (use.read) {
+                needed[use.resource] = 1;
+            }
+        }
+    }
+}
+
+void RenderGraph::CollectLifetimes() {
+
+    for (auto& resource : resources) {
+        resource.usage     = 0;
+        resource.placement = {};
+    }
+    for (uint32_t position = 0; position < schedule.size(); ++position) {
+        for (const auto& use : passes[schedule[position]].uses) {
+            auto& resource = resources[use.resource];
+            auto& placement = resource.placement;
+            if (placement.firstPass == invalidId) {
+                placement.firstPass = position;
+                if (!resource.imported && !use.write) {
+                    PRINT_W("Render graph resource \"%s\" is read by \"%s\" before it is written",
+                            resource.name.c_str(), passes[schedule[position]].name.c_str());
+                }
+            }
+            placement.lastPass = position;
+            auto combined = CombineAccesses(use.accesses);
+            resource.usage |= resource.image ? combined.imageUsage : combined.bufferUsage;
+        }
+    }
+}
+
+VkMemoryRequirements RenderGraph::GetRequirements(const TransientDesc& desc) {
+
+    uint64_t key = HashDesc(desc);
+    auto cached = requirementsCache.find(key);
+    if (cached != requirementsCache.end()) {
+        return cached->second;
+    }
+
+    VkMemoryRequirements requirements{};
+    if (requirementsQuery) {
+        requirements = requirementsQuery(desc);
+    } else if (dev != VK_NULL_HANDLE) {
+        requirements = QueryDeviceRequirements(desc);
+    } else if (desc.image) {
+        VkDeviceSize size = 0;
+        uint32_t width  = desc.imageDesc.width;
+        uint32_t height = desc.imageDesc.height;
+        for (uint32_t mip = 0; mip < desc.imageDesc.mipLevels; ++mip) {
+            size += VkDeviceSize(width) * height * GetFormatSize(desc.imageDesc.format);
+            width  = std::max(width / 2, 1u);
+            height = std::max(height / 2, 1u);
+        }
+        requirements.size           = AlignUp(size, estimatedImageAlignment);
+        requirements.alignment      = estimatedImageAlignment;
+        requirements.memoryTypeBits = ~0u;
+    } else {
+        requirements.size           = AlignUp(desc.bufferDesc.size, estimatedBufferAlignment);
+        requirements.alignment      = estimatedBufferAlignment;
+        requirements.memoryTypeBits = ~0u;
+    }
+
+    requirementsCache[key] = requirements;
+    return requirements;
+}
+
+VkMemoryRequirements RenderGraph::QueryDeviceRequirements(const TransientDesc& desc) const {
+
+    // Identical create infos give identical requirements, so a temporary resource answers for all frames
+    VkMemoryRequirements requirements{};
+    if (desc.image) {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType     = VK_IMAGE_TYPE_2D;
+        imageInfo.format        = desc.imageDesc.format;
+        imageInfo.extent        = { desc.imageDesc.width, desc.imageDesc.height, 1 };
+        imageInfo.mipLevels     = desc.imageDesc.mipLevels;
+        imageInfo.arrayLayers   = 1;
+        imageInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage         = desc.usage;
+        imageInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        VkImage image = VK_NULL_HANDLE;
+        VkResult r = vkCreateImage(dev, &imageInfo, nullptr, &image);
+        if (r != VK_SUCCESS) {
+            PRINT_E("Failed to create render graph image to query its requirements. Vk error code: %d", r);
+            return requirements;
+        }
+        vkGetImageMemoryRequirements(dev, image, &requirements);
+        vkDestroyImage(dev, image, nullptr);
+    } else {
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size        = desc.bufferDesc.size;
+        bufferInfo.usage       = desc.usage;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkResult r = vkCreateBuffer(dev, &bufferInfo, nullptr, &buffer);
+        if (r != VK_SUCCESS) {
+            PRINT_E("Failed to create render graph buffer to query its requirements. Vk error code: %d", r);
+            return requirements;
+        }
+        vkGetBufferMemoryRequirements(dev, buffer, &requirements);
+        vkDestroyBuffer(dev, buffer, nullptr);
+    }
+    return requirements;
+}
+
+void RenderGraph::PlanMemory() {
+
+    std::vector<ResourceId> transients;
+    for (ResourceId id = 0; id < resources.size(); ++id) {
+        auto& resource = resources[id];
+        if (resource.imported || resource.placement.firstPass == invalidId) {
+            continue;
+        }
+        TransientDesc desc;
+        desc.image      = resource.image;
+        desc.imageDesc  = resource.imageDesc;
+        desc.bufferDesc = resource.bufferDesc;
+        desc.usage      = resource.usage;
+        resource.requirements   = GetRequirements(desc);
+        resource.placement.size = resource.requirements.size;
+        stats.transientBytes += resource.requirements.size;
+        transients.push_back(id);
+    }
+    stats.transients = static_cast<uint32_t>(transients.size());
+
+    // Greedy placement of the largest resources first. A resource goes to the lowest offset
+    // not used by the resources alive at the same time
+    std::stable_sort(transients.begin(), transients.end(), [this](ResourceId left, ResourceId right) {
+        return resources[left].placement.size > resources[right].placement.size;
+    });
+
+    std::vector<ResourceId> placed;
+    std::vector<VkDeviceSize> candidates;
+    for (ResourceId id : transients) {
+        auto& resource  = resources[id];
+        auto& placement = resource.placement;
+        const auto& requirements = resource.requirements;
+
+        // Linear and optimal resources may share a heap, so both are kept apart by the granularity
+        VkDeviceSize alignment = std::max(std::max(requirements.alignment, granularity), VkDeviceSize(1));
+
+        uint32_t heap = 0;
+        while (heap < heaps.size() && !(heaps[heap].memoryTypeBits & requirements.memoryTypeBits)) {
+            ++heap;
+        }
+        if (heap == heaps.size()) {
+            heaps.emplace_back();
+        }
+        placement.heap = heap;
+
+        candidates.assign(1, 0);
+        for (ResourceId other : placed) {
+            const auto& otherPlacement = resources[other].placement;
+            if (otherPlacement.heap == heap && LifetimesOverlap(placement, otherPlacement)) {
+                candidates.push_back(AlignUp(otherPlacement.offset + otherPlacement.size, alignment));
+            }
+        }
+        std::sort(candidates.begin(), candidates.end());
+        for (VkDeviceSize offset : candidates) {
+            placement.offset = offset;
+            bool free = std::none_of(placed.begin(), placed.end(), [&](ResourceId other) {
+                const auto& otherPlacement = resources[other].placement;
+                return otherPlacement.heap == heap && LifetimesOverlap(placement, otherPlacement) &&
+                       RangesOverlap(placement, otherPlacement);
+            });
+            if (free) {
+                break;
+            }
+        }
+
+        auto& target = heaps[heap];
+        target.memoryTypeBits &= requirements.memoryTypeBits;
+        target.size      = std::max(target.size, placement.offset + placement.size);
+        target.alignment = std::max(target.alignment, alignment);
+        target.images   |= resource.image;
+        placed.push_back(id);
+    }
+
+    for (const auto& heap : heaps) {
+        stats.heapBytes += heap.size;
+    }
+}
+
+void RenderGraph::AddDependency(ResourceId resource, ResourceState& state, VkPipelineStageFlags stages,
+                                VkAccessFlags access, VkImageLayout layout, bool write, BarrierBatch& batch) {
+
+    if (resources[resource].image && layout != VK_IMAGE_LAYOUT_UNDEFINED && layout != state.layout) {
+        // Layout transition waits for every previous access
+        batch.transitions.push_back({ resource, state.layout, layout, state.writeAccess, access });
+        batch.srcStages |= state.writeStages | state.readStages;
+        batch.dstStages |= stages;
+        ++batch.dependencies;
+        ++stats.transitions;
+
+        state.layout = layout;
+        if (write) {
+            state.writeStages   = stages;
+            state.writeAccess   = access & writeAccessMask;
+            state.readStages    = 0;
+            state.visibleStages = 0;
+            state.visibleAccess = 0;
+        } else {
+            // The transition is a write already visible to the reader. Later readers chain after it
+            state.writeStages   = stages;
+            state.writeAccess   = 0;
+            state.readStages    = stages;
+            state.visibleStages = stages;
+            state.visibleAccess = access;
+        }
+        return;
+    }
+
+    if (write) {
+        // Write after write needs the previous write available, write after read only waits for the reads
+        if (state.writeStages || state.readStages) {
+            batch.srcStages |= state.writeStages | state.readStages;
+            batch.srcAccess |= state.writeAccess;
+            batch.dstStages |= stages;
+            batch.dstAccess |= state.writeAccess ? access : 0;
+            ++batch.dependencies;
+        }
+        state.writeStages   = stages;
+        state.writeAccess   = access & writeAccessMask;
+        state.readStages    = 0;
+        state.visibleStages = 0;
+        state.visibleAccess = 0;
+        return;
+    }
+
+    if (state.writeStages && ((stages & ~state.visibleStages) || (access & ~state.visibleAccess))) {
+        batch.srcStages |= state.writeStages;
+        batch.srcAccess |= state.writeAccess;
+        batch.dstStages |= stages;
+        batch.dstAccess |= access;
+        ++batch.dependencies;
+        state.visibleStages |= stages;
+        state.visibleAccess |= access;
+    }
+    state.readStages |= stages;
+}
+
+void RenderGraph::PlanBarriers() {
+
+    std::vector<ResourceState> states(resources.size());
+    for (ResourceId id = 0; id < resources.size(); ++id) {
+        const auto& resource = resources[id];
+        if (!resource.imported) {
+            continue;
+        }
+        auto& state = states[id];
+        state.layout = resource.initial.layout;
+        if (resource.initial.access & writeAccessMask) {
+            state.writeStages = resource.initial.stages;
+            state.writeAccess = resource.initial.access & writeAccessMask;
+        } else {
+            state.readStages  = resource.initial.stages;
+        }
+    }
+
+    barriers.assign(schedule.size(), BarrierBatch{});
+    for (uint32_t position = 0; position < schedule.size(); ++position) {
+        auto& batch = barriers[position];
+        for (const auto& use : passes[schedule[position]].uses) {
+            const auto& resource = resources[use.resource];
+            auto& state = states[use.resource];
+
+            if (!resource.imported && resource.placement.firstPass == position) {
+                // Memory may still be accessed through the aliases which lived in it before
+                for (ResourceId other = 0; other < resources.size(); ++other) {
+                    const auto& otherPlacement = resources[other].placement;
+                    if (other == use.resource || resources[other].imported ||
+                        otherPlacement.heap != resource.placement.heap || otherPlacement.lastPass >= position ||
+                        !RangesOverlap(resource.placement, otherPlacement)) {
+                        continue;
+                    }
+                    state.writeStages |= states[other].writeStages | states[other].readStages;
+                    state.writeAccess |= states[other].writeAccess;
+                }
+            }
+
+            auto combined = CombineAccesses(use.accesses);
+            AddDependency(use.resource, state, combined.stages, combined.access, combined.layout, use.write, batch);
+        }
+        stats.dependencies += batch.dependencies;
+        stats.barrierCalls += batch.IsEmpty() ? 0 : 1;
+    }
+
+    // Imported resources are left in the state expected after the graph
+    finalBarriers = {};
+    for (ResourceId id = 0; id < resources.size(); ++id) {
+        const auto& resource = resources[id];
+        if (!resource.imported || (!resource.final.stages && resource.final.layout == VK_IMAGE_LAYOUT_UNDEFINED)) {
+            continue;
+        }
+        VkPipelineStageFlags stages = resource.final.stages;
+        if (!stages) {
+            stages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+        }
+        AddDependency(id, states[id], stages, resource.final.access, resource.final.layout, false, finalBarriers);
+    }
+    stats.dependencies += finalBarriers.dependencies;
+    stats.barrierCalls += finalBarriers.IsEmpty() ? 0 : 1;
+}
+
+uint64_t RenderGraph::GetSignature() const {
+
+    uint64_t signature = hashFnvOffsetBasis;
+    for (ResourceId id = 0; id < resources.size(); ++id) {
+        const auto& resource = resources[id];
+        if (resource.imported || resource.placement.heap == invalidId) {
+            continue;
+        }
+        TransientDesc desc;
+        desc.image      = resource.image;
+        desc.imageDesc  = resource.imageDesc;
+        desc.bufferDesc = resource.bufferDesc;
+        desc.usage      = resource.usage;
+        uint64_t values[] = { id, HashDesc(desc), resource.placement.heap, resource.placement.offset };
+        signature = HashBytes(values, sizeof(values), signature);
+    }
+    for (const auto& heap : heaps) {
+        uint64_t values[] = { heap.memoryTypeBits, heap.size, heap.alignment };
+        signature = HashBytes(values, sizeof(values), signature);
+    }
+    return signature;
+}
+
+AppResult RenderGraph::RealizeFrame(FrameResources& frameResources) {
+
+    // The frame in flight slot is idle here, so its resources can be recreated right away
+    uint64_t signature = GetSignature();
+    if (frameResources.signature == signature) {
+        return APP_CODE_OK;
+    }
+    ReleaseFrame(frameResources);
+
+    for (const auto& heap : heaps) {
+        VkMemoryRequirements requirements{};
+        requirements.size           = heap.size;
+        requirements.alignment      = heap.alignment;
+        requirements.memoryTypeBits = heap.memoryTypeBits;
+        MemoryAllocator::AllocationCreateInfo allocInfo{};
+        allocInfo.usage        = MemoryAllocator::MemoryUsage::GpuOnly;
+        allocInfo.optimalImage = heap.images;
+        MemoryAllocation* allocation = nullptr;
+        APP_CHECK_CALL(memAllocator->Allocate(requirements, allocInfo, allocation));
+        frameResources.heaps.push_back(allocation);
+    }
+
+    frameResources.images.assign(resources.size(), VK_NULL_HANDLE);
+    frameResources.buffers.assign(resources.size(), VK_NULL_HANDLE);
+    for (ResourceId id = 0; id < resources.size(); ++id) {
+        const auto& resource = resources[id];
+        if (resource.imported || resource.placement.heap == invalidId) {
+            continue;
+        }
+        const auto* heap = frameResources.heaps[resource.placement.heap];
+        VkDeviceSize offset = heap->offset + resource.placement.offset;
+
+        VkResult r = VK_SUCCESS;
+        if (resource.image) {
+            VkImageCreateInfo imageInfo{};
+            imageInfo.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            imageInfo.imageType     = VK_IMAGE_TYPE_2D;
+            imageInfo.format        = resource.imageDesc.format;
+            imageInfo.extent        = { resource.imageDesc.width, resource.imageDesc.height, 1 };
+            imageInfo.mipLevels     = resource.imageDesc.mipLevels;
+            imageInfo.arrayLayers   = 1;
+            imageInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
+            imageInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
+            imageInfo.usage         = resource.usage;
+            imageInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+            imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+            r = vkCreateImage(dev, &imageInfo, nullptr, &frameResources.images[id]);
+            if (r == VK_SUCCESS) {
+                r = vkBindImageMemory(dev, frameResources.images[id], heap->memory, offset);
+            }
+        } else {
+            VkBufferCreateInfo bufferInfo{};
+            bufferInfo.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+            bufferInfo.size        = resource.bufferDesc.size;
+            bufferInfo.usage       = resource.usage;
+            bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+            r = vkCreateBuffer(dev, &bufferInfo, nullptr, &frameResources.buffers[id]);
+            if (r == VK_SUCCESS) {
+                r = vkBindBufferMemory(dev, frameResources.buffers[id], heap->memory, offset);
+            }
+        }
+        if (r != VK_SUCCESS) {
+            PRINT_E("Failed to create render graph resource \"%s\". Vk error code: %d", resource.name.c_str(), r);
+            ReleaseFrame(frameResources);
+            return APP_CODE_VK_COMMAND_FAIURE;
+        }
+    }
+
+    frameResources.signature = signature;
+    return APP_CODE_OK;
+}
+
+void RenderGraph::ReleaseFrame(FrameResources& frameResources) {
+    for (VkImage image : frameResources.images) {
+        if (image != VK_NULL_HANDLE) {
+            vkDestroyImage(dev, image, nullptr);
+        }
+    }
+    for (VkBuffer buffer : frameResources.buffers) {
+        if (buffer != VK_NULL_HANDLE) {
+            vkDestroyBuffer(dev, buffer, nullptr);
+        }
+    }
+    for (auto* heap : frameResources.heaps) {
+        memAllocator->Free(heap);
+    }
+    frameResources = {};
+}
+
+AppResult RenderGraph::Execute(VkCommandBuffer cmd, uint32_t frameIndex) {
+
+    if (!compiled || frameIndex >= frames.size()) {
+        PRINT_E("Render graph must be compiled and initialized with frame %u in flight", frameIndex);
+        return APP_CODE_INVALID_ARGS;
+    }
+
+    currentFrame = &frames[frameIndex];
+    APP_CHECK_CALL(RealizeFrame(*currentFrame));
+
+    for (uint32_t position = 0; position < schedule.size(); ++position) {
+        RecordBarriers(cmd, barriers[position]);
+        const auto& pass = passes[schedule[position]];
+        if (pass.execute) {
+            pass.execute(cmd, *this);
+        }
+    }
+    RecordBarriers(cmd, finalBarriers);
+    currentFrame = nullptr;
+
+    ++executedFrames;
+    totalDependencies += stats.dependencies;
+    totalBarrierCalls += stats.barrierCalls;
+    return APP_CODE_OK;
+}
+
+void RenderGraph::RecordBarriers(VkCommandBuffer cmd, const BarrierBatch& batch) const {
+
+    if (batch.IsEmpty()) {
+        return;
+    }
+
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = batch.srcAccess;
+    memoryBarrier.dstAccessMask = batch.dstAccess;
+    uint32_t memoryBarriersCount = (batch.srcAccess || batch.dstAccess) ? 1 : 0;
+
+    std::vector<VkImageMemoryBarrier> imageBarriers;
+    imageBarriers.reserve(batch.transitions.size());
+    for (const auto& transition : batch.transitions) {
+        const auto& desc = resources[transition.resource].imageDesc;
+        VkImageMemoryBarrier barrier{};
+        barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask                   = transition.srcAccess;
+        barrier.dstAccessMask                   = transition.dstAccess;
+        barrier.oldLayout                       = transition.oldLayout;
+        barrier.newLayout                       = transition.newLayout;
+        barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image                           = GetImage(transition.resource);
+        barrier.subresourceRange.aspectMask     = desc.aspect;
+        barrier.subresourceRange.baseMipLevel   = 0;
+        barrier.subresourceRange.levelCount     = desc.mipLevels;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount     = 1;
+        imageBarriers.push_back(barrier);
+    }
+
+    // Dependencies without previous accesses wait for nothing
+    VkPipelineStageFlags srcStages = batch.srcStages;
+    if (!srcStages) {
+        srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    }
+    vkCmdPipelineBarrier(cmd, srcStages, batch.dstStages, 0,
+                         memoryBarriersCount, &memoryBarrier, 0, nullptr,
+                         static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+}
+
+VkImage RenderGraph::GetImage(ResourceId resource) const {
+    const auto& desc = resources[resource];
+    if (desc.imported) {
+        return desc.importedImage;
+    }
+    return currentFrame && resource < currentFrame->images.size() ? currentFrame->images[resource] : VK_NULL_HANDLE;
+}
+
+VkBuffer RenderGraph::GetBuffer(ResourceId resource) const {
+    const auto& desc = resources[resource];
+    if (desc.imported) {
+        return desc.importedBuffer;
+    }
+    return currentFrame && resource < currentFrame->buffers.size() ? currentFrame->buffers[resource] : VK_NULL_HANDLE;
+}
+
+void RenderGraph::PrintStats() const {
+    if (!executedFrames) {
+        return;
+    }
+    PRINT("Render graph: last frame %u passes (%u culled), %u barriers batched into %u vkCmdPipelineBarrier calls",
+          stats.passes, stats.culledPasses, stats.dependencies, stats.barrierCalls);
+    PRINT("Render graph transients: %u resources of %llu KiB aliased into %llu KiB, %llu KiB saved per frame",
+          stats.transients, static_cast<unsigned long long>(stats.transientBytes / 1024),
+          static_cast<unsigned long long>(stats.heapBytes / 1024),
+          static_cast<unsigned long long>((stats.transientBytes - stats.heapBytes) / 1024));
+    PRINT("Render graph average per frame: %.1f barriers in %.1f calls",
+          static_cast<double>(totalDependencies) / executedFrames,
+          static_cast<double>(totalBarrierCalls) / executedFrames);
+}
+
+void RenderGraph::Clear() {
+    if (dev != VK_NULL_HANDLE) {
+        for (auto& frameResources : frames) {
+            ReleaseFrame(frameResources);
+        }
+    }
+    frames.clear();
+    Reset();
+    requirementsCache.clear();
+    requirementsQuery = nullptr;
+    currentFrame      = nullptr;
+    stats             = {};
+    executedFrames    = 0;
+    totalDependencies = 0;
+    totalBarrierCalls = 0;
+    memAllocator      = nullptr;
+    granularity       = 1;
+    dev               = VK_NULL_HANDLE;
+}
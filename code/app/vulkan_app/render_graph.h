@@ -0,0 +1,317 @@
+#pragma once
+
+#include <app_result.h>
+#include <vulkan_app/memory_allocator.h>
+#include <vulkan_app/vk_base.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief
+ * Frame render graph. Passes declare the resources they read and write, and Compile turns
+ * the declarations into an ordered schedule: passes whose results are never read are culled,
+ * hazards of a pass are merged into one vkCmdPipelineBarrier and transient resources with
+ * non-overlapping lifetimes share memory. Compile doesn't touch the device, so graphs may be
+ * compiled and inspected without one. Execute creates the transient resources per frame in flight
+ * and records the passes. The graph is rebuilt every frame: Reset, declare, Compile, Execute
+*/
+class RenderGraph {
+
+public:
+
+    typedef uint32_t ResourceId;
+    typedef uint32_t PassId;
+    static constexpr uint32_t invalidId = ~0u;
+
+    // How a pass uses a resource
+    enum class Access : uint8_t {
+        TransferRead,
+        TransferWrite,
+        ColorAttachmentWrite,
+        DepthAttachmentWrite,
+        DepthAttachmentRead,
+        // Sampled image read by fragment and compute shaders
+        SampledRead,
+        // Storage image or buffer accessed by compute shaders
+        StorageRead,
+        StorageWrite,
+        IndirectRead,
+        // Vertex and index buffers
+        VertexRead,
+        UniformRead,
+        HostRead,
+        Count,
+    };
+
+    struct ImageDesc {
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        uint32_t width  = 0;
+        uint32_t height = 0;
+        uint32_t mipLevels = 1;
+        VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+    };
+
+    struct BufferDesc {
+        VkDeviceSize size = 0;
+    };
+
+    // State of an imported resource before and after the graph
+    struct ExternalState {
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags stages = 0;
+        VkAccessFlags access = 0;
+    };
+
+    // Transient resource as it is created. Usage is collected from the accesses of the live passes
+    struct TransientDesc {
+        bool image = false;
+        ImageDesc imageDesc;
+        BufferDesc bufferDesc;
+        VkFlags usage = 0;
+    };
+
+    typedef std::function<void(VkCommandBuffer cmd, const RenderGraph& graph)> ExecuteFunc;
+    typedef std::function<VkMemoryRequirements(const TransientDesc& desc)> RequirementsFunc;
+
+    // Image layout transition recorded before a pass
+    struct ImageTransition {
+        ResourceId resource;
+        VkImageLayout oldLayout;
+        VkImageLayout newLayout;
+        VkAccessFlags srcAccess;
+        VkAccessFlags dstAccess;
+    };
+
+    // Hazards resolved by one vkCmdPipelineBarrier. Resources keeping their layout share one memory barrier
+    struct BarrierBatch {
+        VkPipelineStageFlags srcStages = 0;
+        VkPipelineStageFlags dstStages = 0;
+        VkAccessFlags srcAccess = 0;
+        VkAccessFlags dstAccess = 0;
+        std::vector<ImageTransition> transitions;
+        // Count of the resources synchronized by the batch
+        uint32_t dependencies = 0;
+
+        bool IsEmpty() const { return !dependencies; }
+    };
+
+    // Memory of a transient resource in a shared heap
+    struct Placement {
+        uint32_t heap = invalidId;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        // Schedule positions of the first and the last use
+        uint32_t firstPass = invalidId;
+        uint32_t lastPass  = 0;
+    };
+
+    struct Stats {
+        uint32_t passes        = 0;
+        uint32_t culledPasses  = 0;
+        // Barriers needed without batching and vkCmdPipelineBarrier calls with it
+        uint32_t dependencies  = 0;
+        uint32_t barrierCalls  = 0;
+        uint32_t transitions   = 0;
+        uint32_t transients    = 0;
+        // Sum of the transient resources' sizes and size of the heaps they are aliased in
+        VkDeviceSize transientBytes = 0;
+        VkDeviceSize heapBytes      = 0;
+    };
+
+    RenderGraph() = default;
+    RenderGraph(const RenderGraph&) = delete;
+
+    /**
+     * @brief
+     * Bind the graph to a device. Not needed to only compile graphs
+     * @param device
+     * logical device
+     * @param allocator
+     * allocator of the transient heaps
+     * @param framesInFlight
+     * count of the transient resource sets
+     * @param bufferImageGranularity
+     * limit separating linear and optimal resources aliased in a heap
+     * @return
+     * AppResult code
+    */
+    AppResult Init(VkDevice device, MemoryAllocator& allocator, uint32_t framesInFlight,
+                   VkDeviceSize bufferImageGranularity);
+    void Clear();
+
+    // Replace the memory requirements query. Sizes are estimated by the formats if there is no device
+    void SetRequirementsQuery(RequirementsFunc query);
+    void SetBufferImageGranularity(VkDeviceSize limit) { granularity = limit ? limit : 1; }
+
+    // Drop the declarations of the previous frame
+    void Reset();
+
+    // Resources living within the frame. Their content is undefined before the first write
+    ResourceId CreateImage(const char* name, const ImageDesc& desc);
+    ResourceId CreateBuffer(const char* name, const BufferDesc& desc);
+    /**
+     * @brief
+     * Use a resource owned outside the graph. Writes of imported resources are never culled
+     * @param initial
+     * state the resource is left in by the previous commands
+     * @param final
+     * state the resource is transitioned to after the graph. Undefined layout keeps the last one
+    */
+    ResourceId ImportImage(const char* name, VkImage image, const ImageDesc& desc,
+                           const ExternalState& initial, const ExternalState& final);
+    ResourceId ImportBuffer(const char* name, VkBuffer buffer, const BufferDesc& desc,
+                            const ExternalState& initial, const ExternalState& final);
+
+    PassId AddPass(const char* name, ExecuteFunc execute);
+    void Read(PassId pass, ResourceId resource, Access access);
+    // A write without a read of the resource in the same pass discards its previous content
+    void Write(PassId pass, ResourceId resource, Access access);
+    // Keep a pass having effects outside the graph even if nobody reads what it writes
+    void SetSideEffects(PassId pass);
+
+    /**
+     * @brief
+     * Cull, schedule and synchronize the declared passes and plan the transient memory
+     * @return
+     * APP_CODE_INVALID_ARGS if a pass accesses a resource in conflicting layouts
+    */
+    AppResult Compile();
+
+    /**
+     * @brief
+     * Create the transient resources of the frame and record the compiled passes
+     * @param cmd
+     * command buffer in recording state
+     * @param frameIndex
+     * index of the frame in flight owning the transient resources
+     * @return
+     * AppResult code
+    */
+    AppResult Execute(VkCommandBuffer cmd, uint32_t frameIndex);
+
+    // Resources of the executing frame to be used by the passes
+    VkImage GetImage(ResourceId resource) const;
+    VkBuffer GetBuffer(ResourceId resource) const;
+
+    // Compiled graph
+    const std::vector<PassId>& GetSchedule() const { return schedule; }
+    const BarrierBatch& GetBarriers(uint32_t position) const { return barriers[position]; }
+    const BarrierBatch& GetFinalBarriers() const { return finalBarriers; }
+    const Placement& GetPlacement(ResourceId resource) const { return resources[resource].placement; }
+    const char* GetPassName(PassId pass) const { return passes[pass].name.c_str(); }
+    bool IsPassCulled(PassId pass) const { return passes[pass].culled; }
+
+    const Stats& GetStats() const { return stats; }
+    void PrintStats() const;
+
+private:
+
+    // Accesses of a resource by a pass merged together
+    struct Use {
+        ResourceId resource;
+        // Bit per Access value
+        uint32_t accesses;
+        bool read;
+        bool write;
+    };
+
+    struct Pass {
+        std::string name;
+        ExecuteFunc execute;
+        std::vector<Use> uses;
+        bool sideEffects = false;
+        bool culled = false;
+    };
+
+    struct Resource {
+        std::string name;
+        bool image = false;
+        bool imported = false;
+        ImageDesc imageDesc;
+        BufferDesc bufferDesc;
+        VkImage importedImage = VK_NULL_HANDLE;
+        VkBuffer importedBuffer = VK_NULL_HANDLE;
+        ExternalState initial;
+        ExternalState final;
+
+        // Compile results
+        VkFlags usage = 0;
+        VkMemoryRequirements requirements{};
+        Placement placement;
+    };
+
+    // Synchronization state of a resource while the schedule is walked
+    struct ResourceState {
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags writeStages = 0;
+        VkAccessFlags writeAccess = 0;
+        // Stages reading since the last write and the accesses the write is visible to
+        VkPipelineStageFlags readStages = 0;
+        VkPipelineStageFlags visibleStages = 0;
+        VkAccessFlags visibleAccess = 0;
+    };
+
+    struct Heap {
+        uint32_t memoryTypeBits = ~0u;
+        VkDeviceSize size = 0;
+        VkDeviceSize alignment = 1;
+        bool images = false;
+    };
+
+    // Transient resources and heaps of a frame in flight
+    struct FrameResources {
+        uint64_t signature = 0;
+        std::vector<MemoryAllocation*> heaps;
+        std::vector<VkImage> images;
+        std::vector<VkBuffer> buffers;
+    };
+
+    void AddUse(PassId pass, ResourceId resource, Access access, bool write);
+    void CullPasses();
+    void CollectLifetimes();
+    void PlanMemory();
+    void PlanBarriers();
+    // Add the hazard of an access to the batch and advance the state
+    void AddDependency(ResourceId resource, ResourceState& state, VkPipelineStageFlags stages,
+                       VkAccessFlags access, VkImageLayout layout, bool write, BarrierBatch& batch);
+
+    VkMemoryRequirements GetRequirements(const TransientDesc& desc);
+    VkMemoryRequirements QueryDeviceRequirements(const TransientDesc& desc) const;
+    uint64_t GetSignature() const;
+    AppResult RealizeFrame(FrameResources& frameResources);
+    void ReleaseFrame(FrameResources& frameResources);
+    void RecordBarriers(VkCommandBuffer cmd, const BarrierBatch& batch) const;
+
+private:
+
+    VkDevice dev = VK_NULL_HANDLE;
+    MemoryAllocator* memAllocator = nullptr;
+    VkDeviceSize granularity = 1;
+    RequirementsFunc requirementsQuery;
+    // Requirements by hash of the transient descriptions. Queried once per description
+    std::unordered_map<uint64_t, VkMemoryRequirements> requirementsCache;
+
+    std::vector<Pass> passes;
+    std::vector<Resource> resources;
+
+    std::vector<PassId> schedule;
+    std::vector<BarrierBatch> barriers;
+    BarrierBatch finalBarriers;
+    std::vector<Heap> heaps;
+    // A pass accessed a resource in conflicting layouts
+    bool invalid = false;
+    bool compiled = false;
+
+    std::vector<FrameResources> frames;
+    // Frame being executed to resolve the transient resources
+    FrameResources* currentFrame = nullptr;
+
+    Stats stats;
+    uint64_t executedFrames = 0;
+    uint64_t totalDependencies = 0;
+    uint64_t totalBarrierCalls = 0;
+};
@@ -0,0 +1,214 @@
+#include <vulkan_app/staging_ring.h>
+
+#include <logs.h>
+
+#include <algorithm>
+
+namespace {
+
+uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+AppResult StagingRing::Init(VkDevice device, MemoryAllocator& allocator, AsyncQueue& queue, VkDeviceSize size,
+                            VkDeviceSize copyOffsetAlignment) {
+
+    dev           = device;
+    memAllocator  = &allocator;
+    transferQueue = &queue;
+    ringSize      = size;
+    copyAlignment = std::max<VkDeviceSize>(copyOffsetAlignment, 4);
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size        = ringSize;
+    bufferInfo.usage       = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    // Host visible and coherent, mapped for the whole lifetime by the allocator
+    APP_CHECK_CALL(memAllocator->CreateBuffer(bufferInfo, MemoryAllocator::MemoryUsage::CpuToGpu, buffer, memory));
+    mapped = static_cast<uint8_t*>(memory->mapped);
+
+    head = tail = batchStart = 0;
+    lastValue = 0;
+    stats = {};
+    startTime = std::chrono::steady_clock::now();
+
+    PRINT("Staging ring of %llu KiB created", static_cast<unsigned long long>(ringSize / 1024));
+    return APP_CODE_OK;
+}
+
+void* StagingRing::Reserve(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset) {
+
+    alignment = std::max(alignment, copyAlignment);
+    if (size > ringSize) {
+        PRINT_E("Upload of %llu bytes doesn't fit staging ring of %llu bytes",
+                static_cast<unsigned long long>(size), static_cast<unsigned long long>(ringSize));
+        return nullptr;
+    }
+
+    Reclaim();
+
+    bool stalled = false;
+    auto stallStart = std::chrono::steady_clock::now();
+    uint64_t start = 0;
+    for (;;) {
+        if (head == tail) {
+            // Empty ring, restart from its beginning to avoid wrapping
+            head = tail = batchStart = AlignUp(head, ringSize);
+        }
+
+        // Data is never split by the ring end
+        uint64_t lapStart = head - head % ringSize;
+        start = lapStart + AlignUp(head % ringSize, alignment);
+        if (start + size > lapStart + ringSize) {
+            start = lapStart + ringSize;
+        }
+        if (start + size - tail <= ringSize) {
+            break;
+        }
+
+        if (!stalled) {
+            stalled = true;
+            ++stats.stalls;
+        }
+        if (batchStart != head) {
+            // Data written but not submitted yet can't be reclaimed
+            uint64_t value = 0;
+            if (!APP_CHECK_RESULT(SubmitBatch(value))) {
+                return nullptr;
+            }
+        } else {
+            transferQueue->Wait(batches.front().value);
+            Reclaim();
+        }
+    }
+    if (stalled) {
+        stats.stallsTime +=
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - stallStart).count();
+    }
+
+    head = start + size;
+    offset = start % ringSize;
+    return mapped + offset;
+}
+
+void StagingRing::CopyToBuffer(VkDeviceSize srcOffset, VkDeviceSize size, VkBuffer dst, VkDeviceSize dstOffset) {
+
+    stats.uploadedBytes += size;
+    auto& copies = bufferCopies[dst];
+
+    // Merge with the previous copy if both source and destination continue it
+    if (!copies.empty()) {
+        auto& last = copies.back();
+        if (last.srcOffset + last.size == srcOffset && last.dstOffset + last.size == dstOffset) {
+            last.size += size;
+            ++stats.mergedRegions;
+            return;
+        }
+    }
+
+    VkBufferCopy region{};
+    region.srcOffset = srcOffset;
+    region.dstOffset = dstOffset;
+    region.size      = size;
+    copies.push_back(region);
+}
+
+void StagingRing::CopyToImage(VkDeviceSize srcOffset, VkDeviceSize size, VkImage dst, const VkBufferImageCopy& region,
+                              VkImageLayout layout) {
+
+    stats.uploadedBytes += size;
+
+    VkBufferImageCopy copy = region;
+    copy.bufferOffset += srcOffset;
+    auto& copies = imageCopies[dst];
+    copies.layout = layout;
+    copies.regions.push_back(copy);
+}
+
+AppResult StagingRing::Flush(uint64_t& value) {
+    APP_CHECK_CALL(SubmitBatch(value));
+    waits.clear();
+    return APP_CODE_OK;
+}
+
+AppResult StagingRing::SubmitBatch(uint64_t& value) {
+
+    if (bufferCopies.empty() && imageCopies.empty()) {
+        // Reserved space without copies is released together with the previous batch
+        if (batchStart != head) {
+            batches.push_back({ head, lastValue });
+            batchStart = head;
+        }
+        value = lastValue;
+        return APP_CODE_OK;
+    }
+
+    auto record = [this](VkCommandBuffer cmd) {
+        for (auto& copies : bufferCopies) {
+            vkCmdCopyBuffer(cmd, buffer, copies.first, static_cast<uint32_t>(copies.second.size()), copies.second.data());
+        }
+        for (auto& copies : imageCopies) {
+            vkCmdCopyBufferToImage(cmd, buffer, copies.first, copies.second.layout,
+                                   static_cast<uint32_t>(copies.second.regions.size()),
+                                   copies.second.regions.data());
+        }
+    };
+    APP_CHECK_CALL(transferQueue->Submit(record, waits, value));
+
+    for (auto& copies : bufferCopies) {
+        stats.copyRegions += copies.second.size();
+    }
+    for (auto& copies : imageCopies) {
+        stats.copyRegions += copies.second.regions.size();
+    }
+    ++stats.batches;
+    bufferCopies.clear();
+    imageCopies.clear();
+
+    batches.push_back({ head, value });
+    batchStart = head;
+    lastValue  = value;
+    return APP_CODE_OK;
+}
+
+void StagingRing::Reclaim() {
+    while (!batches.empty() && transferQueue->IsCompleted(batches.front().value)) {
+        tail = batches.front().end;
+        batches.pop_front();
+    }
+}
+
+void StagingRing::PrintStats() const {
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    double megabytes = stats.uploadedBytes / (1024.0 * 1024.0);
+    PRINT("Staging ring: %.1f MiB uploaded (%.1f MiB/s) in %llu batches, %llu copy regions (%llu merged)",
+          megabytes, seconds > 0.0 ? megabytes / seconds : 0.0, static_cast<unsigned long long>(stats.batches),
+          static_cast<unsigned long long>(stats.copyRegions), static_cast<unsigned long long>(stats.mergedRegions));
+    PRINT("Staging ring: %llu stalls on full ring, %.3f ms waited",
+          static_cast<unsigned long long>(stats.stalls), stats.stallsTime);
+}
+
+void StagingRing::Clear() {
+    if (dev == VK_NULL_HANDLE) {
+        return;
+    }
+    if (!batches.empty()) {
+        transferQueue->Wait(batches.back().value);
+    }
+    if (buffer != VK_NULL_HANDLE) {
+        memAllocator->DestroyBuffer(buffer, memory);
+    }
+
+    batches.clear();
+    bufferCopies.clear();
+    imageCopies.clear();
+    waits.clear();
+    buffer = VK_NULL_HANDLE;
+    memory = nullptr;
+    mapped = nullptr;
+    dev    = VK_NULL_HANDLE;
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <app_result.h>
+#include <vulkan_app/async_queue.h>
+#include <vulkan_app/memory_allocator.h>
+#include <vulkan_app/vk_base.h>
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <vector>
+
+/**
+ * @brief
+ * Persistently mapped host visible ring buffer for streaming uploads.
+ * Data is written by the caller right into the mapped ring, copies are collected
+ * and submitted to the transfer queue once per Flush. Ring space is reclaimed
+ * when the transfer queue timeline reaches the value of the flushed batch.
+ * Not thread safe, used from the render thread
+*/
+class StagingRing {
+
+public:
+
+    struct Stats {
+        uint64_t uploadedBytes = 0;
+        uint64_t copyRegions   = 0;
+        // Regions merged into a previous one because of contiguous source and destination
+        uint64_t mergedRegions = 0;
+        uint64_t batches       = 0;
+        // Reservations that had to wait for GPU because the ring was full
+        uint64_t stalls        = 0;
+        double stallsTime      = 0.0;
+    };
+
+    AppResult Init(VkDevice device, MemoryAllocator& allocator, AsyncQueue& queue, VkDeviceSize size,
+                   VkDeviceSize copyOffsetAlignment);
+    void Clear();
+
+    /**
+     * @brief
+     * Reserve ring space for the data to be uploaded. Waits for GPU if the ring is full
+     * @param size
+     * size of the data
+     * @param alignment
+     * required alignment of the data in the ring
+     * @param offset
+     * offset of the reserved space in the ring buffer, source offset of the copies
+     * @return
+     * pointer to the mapped space to write the data to. nullptr if size exceeds the ring
+    */
+    void* Reserve(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+    // Queue a copy of the reserved data to a buffer
+    void CopyToBuffer(VkDeviceSize srcOffset, VkDeviceSize size, VkBuffer dst, VkDeviceSize dstOffset);
+    /**
+     * @brief
+     * Queue a copy of the reserved data to an image
+     * @param srcOffset
+     * offset of the data in the ring
+     * @param size
+     * size of the data
+     * @param dst
+     * image to copy to
+     * @param region
+     * copy region. bufferOffset is relative to srcOffset
+     * @param layout
+     * layout of the image when the batch is executed. TRANSFER_DST_OPTIMAL or GENERAL
+    */
+    void CopyToImage(VkDeviceSize srcOffset, VkDeviceSize size, VkImage dst, const VkBufferImageCopy& region,
+                     VkImageLayout layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    // Make the batches submitted until the next Flush wait for a timeline point, e.g. for sparse binds
+    void AddWait(const AsyncQueue::SyncPoint& wait) { waits.push_back(wait); }
+    /**
+     * @brief
+     * Submit all the queued copies with a single command buffer
+     * @param value
+     * transfer queue timeline value to be waited before using the uploaded data
+     * @return
+     * AppResult code
+    */
+    AppResult Flush(uint64_t& value);
+
+    VkBuffer GetBuffer() const { return buffer; }
+    const Stats& GetStats() const { return stats; }
+    void PrintStats() const;
+
+private:
+
+    // Submit the queued copies. Called by Flush and by Reserve when the ring is full
+    AppResult SubmitBatch(uint64_t& value);
+    // Move the tail past the batches completed by GPU
+    void Reclaim();
+
+private:
+
+    struct Batch {
+        // Ring position right after the batch data
+        uint64_t end;
+        uint64_t value;
+    };
+
+    VkDevice dev = VK_NULL_HANDLE;
+    MemoryAllocator* memAllocator = nullptr;
+    AsyncQueue* transferQueue = nullptr;
+
+    VkBuffer buffer = VK_NULL_HANDLE;
+    MemoryAllocation* memory = nullptr;
+    uint8_t* mapped = nullptr;
+    VkDeviceSize ringSize = 0;
+    VkDeviceSize copyAlignment = 1;
+
+    // Monotonic ring positions, buffer offset is position % ringSize
+    uint64_t head = 0;
+    uint64_t tail = 0;
+    uint64_t batchStart = 0;
+    std::deque<Batch> batches;
+    uint64_t lastValue = 0;
+
+    // Copies of the current batch grouped by destination
+    std::map<VkBuffer, std::vector<VkBufferCopy>> bufferCopies;
+    struct ImageCopies {
+        VkImageLayout layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        std::vector<VkBufferImageCopy> regions;
+    };
+    std::map<VkImage, ImageCopies> imageCopies;
+    // Timeline points the batches wait for until the next Flush
+    std::vector<AsyncQueue::SyncPoint> waits;
+
+    Stats stats;
+    std::chrono::steady_clock::time_point startTime;
+};
@@ -0,0 +1,350 @@
+#include <vulkan_app/swapchain.h>
+
+#include <logs.h>
+#include <utils/profiler.h>
+
+#include <algorithm>
+
+namespace {
+
+const char* PresentModeName(VkPresentModeKHR mode) {
+    switch (mode) {
+    case VK_PRESENT_MODE_IMMEDIATE_KHR:
+        return "immediate";
+    case VK_PRESENT_MODE_MAILBOX_KHR:
+        return "mailbox";
+    case VK_PRESENT_MODE_FIFO_KHR:
+        return "fifo";
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+        return "fifo-relaxed";
+    default:
+        return "unknown";
+    }
+}
+
+} // namespace
+
+AppResult Swapchain::Init(VkPhysicalDevice physicalDevice, VkDevice device, VkSurfaceKHR surface,
+                          PresentPolicy policy, VkExtent2D extent) {
+
+    physDev         = physicalDevice;
+    dev             = device;
+    surf            = surface;
+    presentPolicy   = policy;
+    requestedExtent = extent;
+    stats           = {};
+
+    uint32_t modesCount = 0;
+    vkGetPhysicalDeviceSurfacePresentModesKHR(physDev, surf, &modesCount, nullptr);
+    supportedModes.resize(modesCount);
+    vkGetPhysicalDeviceSurfacePresentModesKHR(physDev, surf, &modesCount, supportedModes.data());
+
+    uint32_t formatsCount = 0;
+    vkGetPhysicalDeviceSurfaceFormatsKHR(physDev, surf, &formatsCount, nullptr);
+    std::vector<VkSurfaceFormatKHR> formats(formatsCount);
+    vkGetPhysicalDeviceSurfaceFormatsKHR(physDev, surf, &formatsCount, formats.data());
+    if (formats.empty()) {
+        PRINT_E("Surface has no formats");
+        return APP_CODE_VK_INIT_FAIURE;
+    }
+    // Frames are written with transfers, so the format must be UNORM to keep the written values
+    format = formats.front();
+    for (const auto& candidate : formats) {
+        if ((candidate.format == VK_FORMAT_B8G8R8A8_UNORM || candidate.format == VK_FORMAT_R8G8B8A8_UNORM) &&
+            candidate.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
+            format = candidate;
+            break;
+        }
+    }
+
+    APP_CHECK_CALL(Create(0));
+    PRINT("Swapchain created: %ux%u, %u images, %s present mode", GetExtent().width, GetExtent().height,
+          GetImagesCount(), PresentModeName(presentMode));
+    return APP_CODE_OK;
+}
+
+void Swapchain::RequestRecreate(VkExtent2D extent) {
+    requestedExtent   = extent;
+    recreateRequested = true;
+}
+
+void Swapchain::SetPolicy(PresentPolicy policy) {
+    if (policy == presentPolicy) {
+        return;
+    }
+    presentPolicy = policy;
+    if (ChoosePresentMode() != presentMode) {
+        recreateRequested = true;
+    }
+}
+
+VkPresentModeKHR Swapchain::ChoosePresentMode() const {
+
+    // FIFO is the only mode every surface supports
+    std::vector<VkPresentModeKHR> preferred;
+    switch (presentPolicy) {
+    case PresentPolicy::LowLatency:
+        // The newest frame replaces the queued one without tearing
+        preferred = { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR };
+        break;
+    case PresentPolicy::Throughput:
+        // Never wait for the vertical blank, tearing is allowed
+        preferred = { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR };
+        break;
+    case PresentPolicy::Vsync:
+        // Every frame is shown, late ones tear instead of waiting for one more blank
+        preferred = { VK_PRESENT_MODE_FIFO_RELAXED_KHR };
+        break;
+    }
+
+    for (auto mode : preferred) {
+        if (std::find(supportedModes.begin(), supportedModes.end(), mode) != supportedModes.end()) {
+            return mode;
+        }
+    }
+    return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+uint32_t Swapchain::ChooseImagesCount(const VkSurfaceCapabilitiesKHR& caps) const {
+
+    // FIFO queues every image, so the shortest queue has the lowest latency.
+    // Other modes need a spare image to never wait for the presentation engine
+    bool queued = presentMode == VK_PRESENT_MODE_FIFO_KHR || presentMode == VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+    uint32_t count = caps.minImageCount;
+    if (!(queued && presentPolicy == PresentPolicy::LowLatency)) {
+        ++count;
+    }
+    // 0 means no limit
+    if (caps.maxImageCount) {
+        count = std::min(count, caps.maxImageCount);
+    }
+    return count;
+}
+
+AppResult Swapchain::Create(uint64_t submittedFrames) {
+
+    PROFILE_SCOPE("CreateSwapchain");
+    auto start = std::chrono::steady_clock::now();
+
+    VkSurfaceCapabilitiesKHR caps{};
+    VkResult r = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physDev, surf, &caps);
+    if (r != VK_SUCCESS) {
+        PRINT_E("Failed to get surface capabilities. Vk error code: %d", r);
+        return APP_CODE_VK_COMMAND_FAIURE;
+    }
+    if (!(caps.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT)) {
+        PRINT_E("Surface images can't be written with transfers");
+        return APP_CODE_VK_INIT_FAIURE;
+    }
+
+    // Special value 0xFFFFFFFF means the size is defined by the swapchain
+    VkExtent2D newExtent = caps.currentExtent;
+    if (newExtent.width == UINT32_MAX) {
+        newExtent.width  = std::clamp(requestedExtent.width, caps.minImageExtent.width, caps.maxImageExtent.width);
+        newExtent.height = std::clamp(requestedExtent.height, caps.minImageExtent.height, caps.maxImageExtent.height);
+    }
+    if (!newExtent.width || !newExtent.height) {
+        // Minimized window. Keep the request until it gets a size
+        recreateRequested = true;
+        return APP_CODE_OK;
+    }
+
+    presentMode = ChoosePresentMode();
+
+    VkCompositeAlphaFlagBitsKHR compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+    if (!(caps.supportedCompositeAlpha & compositeAlpha)) {
+        // The lowest supported bit
+        compositeAlpha = static_cast<VkCompositeAlphaFlagBitsKHR>(caps.supportedCompositeAlpha &
+                                                                  (~caps.supportedCompositeAlpha + 1));
+    }
+
+    VkSwapchainCreateInfoKHR createInfo{};
+    createInfo.sType            = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+    createInfo.surface          = surf;
+    createInfo.minImageCount    = ChooseImagesCount(caps);
+    createInfo.imageFormat      = format.format;
+    createInfo.imageColorSpace  = format.colorSpace;
+    createInfo.imageExtent      = newExtent;
+    createInfo.imageArrayLayers = 1;
+    createInfo.imageUsage       = VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+                                  (caps.supportedUsageFlags & VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
+    // Rendered and presented by the same queue
+    createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    createInfo.preTransform     = caps.currentTransform;
+    createInfo.compositeAlpha   = compositeAlpha;
+    createInfo.presentMode      = presentMode;
+    createInfo.clipped          = VK_TRUE;
+    // Lets the driver reuse resources and keeps presents to the old swapchain valid
+    createInfo.oldSwapchain     = swapchain;
+
+    VkSwapchainKHR newSwapchain = VK_NULL_HANDLE;
+    r = vkCreateSwapchainKHR(dev, &createInfo, nullptr, &newSwapchain);
+
+    // The old swapchain is retired even if the creation fails. Frames submitted so far may still
+    // present to it, so it's destroyed after them instead of waiting for the device to be idle
+    if (swapchain != VK_NULL_HANDLE) {
+        retired.push_back({ swapchain, std::move(renderFinished), submittedFrames });
+        swapchain = VK_NULL_HANDLE;
+        images.clear();
+        renderFinished.clear();
+    }
+    if (r != VK_SUCCESS) {
+        PRINT_E("Failed to create swapchain. Vk error code: %d", r);
+        return APP_CODE_VK_COMMAND_FAIURE;
+    }
+    swapchain = newSwapchain;
+    extent    = newExtent;
+
+    uint32_t imagesCount = 0;
+    vkGetSwapchainImagesKHR(dev, swapchain, &imagesCount, nullptr);
+    images.resize(imagesCount);
+    vkGetSwapchainImagesKHR(dev, swapchain, &imagesCount, images.data());
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    renderFinished.assign(imagesCount, VK_NULL_HANDLE);
+    for (auto& semaphore : renderFinished) {
+        r = vkCreateSemaphore(dev, &semaphoreInfo, nullptr, &semaphore);
+        if (r != VK_SUCCESS) {
+            PRINT_E("Failed to create swapchain image semaphore. Vk error code: %d", r);
+            return APP_CODE_VK_COMMAND_FAIURE;
+        }
+    }
+
+    recreateRequested = false;
+    stats.recreateTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return APP_CODE_OK;
+}
+
+void Swapchain::DestroyRetired(uint64_t completedFrames) {
+    auto end = std::remove_if(retired.begin(), retired.end(), [this, completedFrames](const Retired& old) {
+        if (old.framesCount > completedFrames) {
+            return false;
+        }
+        vkDestroySwapchainKHR(dev, old.swapchain, nullptr);
+        DestroySemaphores(old.renderFinished);
+        return true;
+    });
+    retired.erase(end, retired.end());
+}
+
+void Swapchain::DestroySemaphores(const std::vector<VkSemaphore>& semaphores) {
+    for (auto semaphore : semaphores) {
+        if (semaphore != VK_NULL_HANDLE) {
+            vkDestroySemaphore(dev, semaphore, nullptr);
+        }
+    }
+}
+
+bool Swapchain::Acquire(VkSemaphore imageAcquired, uint64_t completedFrames, uint64_t submittedFrames,
+                        uint32_t& imageIndex) {
+
+    PROFILE_SCOPE("AcquireImage");
+    DestroyRetired(completedFrames);
+
+    // An out of date swapchain is rebuilt and acquired once more
+    for (uint32_t attempt = 0; attempt < 2; ++attempt) {
+        if (recreateRequested || swapchain == VK_NULL_HANDLE) {
+            if (IsMinimized()) {
+                break;
+            }
+            bool wasValid = swapchain != VK_NULL_HANDLE;
+            if (!APP_CHECK_RESULT(Create(submittedFrames)) || swapchain == VK_NULL_HANDLE || recreateRequested) {
+                break;
+            }
+            if (wasValid) {
+                ++stats.recreations;
+                PRINT_V("Swapchain recreated: %ux%u, %u images, %s present mode", extent.width, extent.height,
+                        GetImagesCount(), PresentModeName(presentMode));
+            }
+        }
+
+        VkResult r = vkAcquireNextImageKHR(dev, swapchain, UINT64_MAX, imageAcquired, VK_NULL_HANDLE, &imageIndex);
+        if (r == VK_SUCCESS) {
+            return true;
+        }
+        if (r == VK_SUBOPTIMAL_KHR) {
+            // The image is acquired and the semaphore will be signaled, so the frame is presented first
+            ++stats.suboptimal;
+            recreateRequested = true;
+            return true;
+        }
+        if (r == VK_ERROR_OUT_OF_DATE_KHR) {
+            ++stats.outOfDate;
+            recreateRequested = true;
+            continue;
+        }
+        PRINT_E("Failed to acquire swapchain image. Vk error code: %d", r);
+        break;
+    }
+
+    ++stats.skippedFrames;
+    return false;
+}
+
+AppResult Swapchain::Present(VkQueue queue, uint32_t imageIndex, std::chrono::steady_clock::time_point inputTime) {
+
+    PROFILE_SCOPE("Present");
+
+    VkPresentInfoKHR presentInfo{};
+    presentInfo.sType              = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+    presentInfo.waitSemaphoreCount = 1;
+    presentInfo.pWaitSemaphores    = &renderFinished[imageIndex];
+    presentInfo.swapchainCount     = 1;
+    presentInfo.pSwapchains        = &swapchain;
+    presentInfo.pImageIndices      = &imageIndex;
+
+    VkResult r = vkQueuePresentKHR(queue, &presentInfo);
+    if (r == VK_ERROR_OUT_OF_DATE_KHR) {
+        ++stats.outOfDate;
+        recreateRequested = true;
+        return APP_CODE_OK;
+    }
+    if (r == VK_SUBOPTIMAL_KHR) {
+        ++stats.suboptimal;
+        recreateRequested = true;
+    } else if (r != VK_SUCCESS) {
+        PRINT_E("Failed to present swapchain image. Vk error code: %d", r);
+        return APP_CODE_VK_COMMAND_FAIURE;
+    }
+
+    double latency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - inputTime).count();
+    stats.lastLatency   = latency;
+    stats.minLatency    = stats.presents ? std::min(stats.minLatency, latency) : latency;
+    stats.maxLatency    = std::max(stats.maxLatency, latency);
+    stats.totalLatency += latency;
+    ++stats.presents;
+    return APP_CODE_OK;
+}
+
+void Swapchain::PrintStats() const {
+    if (!stats.presents && !stats.recreations) {
+        return;
+    }
+    PRINT("Swapchain: %llu presents in %s mode with %u images, %u skipped frames",
+          static_cast<unsigned long long>(stats.presents), PresentModeName(presentMode), GetImagesCount(),
+          stats.skippedFrames);
+    PRINT("Swapchain: %u recreations (%.3f ms total), %u out of date, %u suboptimal",
+          stats.recreations, stats.recreateTime, stats.outOfDate, stats.suboptimal);
+    PRINT("Swapchain: input to present latency %.3f ms average, %.3f ms min, %.3f ms max",
+          stats.GetAverageLatency(), stats.minLatency, stats.maxLatency);
+}
+
+void Swapchain::Clear() {
+    if (dev == VK_NULL_HANDLE) {
+        return;
+    }
+    // Every frame is completed
+    DestroyRetired(UINT64_MAX);
+    if (swapchain != VK_NULL_HANDLE) {
+        vkDestroySwapchainKHR(dev, swapchain, nullptr);
+        swapchain = VK_NULL_HANDLE;
+    }
+    DestroySemaphores(renderFinished);
+    renderFinished.clear();
+    images.clear();
+    supportedModes.clear();
+    recreateRequested = false;
+    dev  = VK_NULL_HANDLE;
+    surf = VK_NULL_HANDLE;
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <app_options.h>
+#include <app_result.h>
+#include <vulkan_app/vk_base.h>
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief
+ * Swapchain of the window surface. Present mode and image count follow a latency or throughput policy.
+ * The swapchain is rebuilt on resize and on VK_ERROR_OUT_OF_DATE_KHR without waiting for the device:
+ * the old one is passed to the new one and destroyed once the frames presenting to it complete.
+ * Every image has its own render finished semaphore: a present may still wait on it when the next frame
+ * is submitted, and only the next acquire of the same image guarantees that wait is over.
+ * Latency from the input sample of a frame to its present is measured
+*/
+class Swapchain {
+
+public:
+
+    struct Stats {
+        uint64_t presents     = 0;
+        uint32_t recreations  = 0;
+        uint32_t outOfDate    = 0;
+        uint32_t suboptimal   = 0;
+        // Frames skipped because the window was minimized or the swapchain couldn't be acquired
+        uint32_t skippedFrames = 0;
+        // Time spent to create swapchains, ms
+        double recreateTime   = 0.0;
+        // Input sample to vkQueuePresentKHR return, ms
+        double lastLatency    = 0.0;
+        double minLatency     = 0.0;
+        double maxLatency     = 0.0;
+        double totalLatency   = 0.0;
+
+        double GetAverageLatency() const { return presents ? totalLatency / presents : 0.0; }
+    };
+
+    Swapchain() = default;
+    Swapchain(const Swapchain&) = delete;
+
+    /**
+     * @brief
+     * Create the swapchain of the surface
+     * @param physicalDevice
+     * GPU presenting the images
+     * @param device
+     * logical device
+     * @param surface
+     * window surface
+     * @param policy
+     * present mode and image count policy
+     * @param extent
+     * framebuffer size of the window used if the surface doesn't define it
+     * @return
+     * AppResult code
+    */
+    AppResult Init(VkPhysicalDevice physicalDevice, VkDevice device, VkSurfaceKHR surface,
+                   PresentPolicy policy, VkExtent2D extent);
+    // Destroy all the swapchains. The device must be idle
+    void Clear();
+
+    // Rebuild the swapchain before the next acquire, e.g. on window resize
+    void RequestRecreate(VkExtent2D extent);
+    // Switch the present mode policy. Rebuilds the swapchain if the mode changes
+    void SetPolicy(PresentPolicy policy);
+
+    /**
+     * @brief
+     * Destroy the retired swapchains no frame presents to anymore and acquire the next image.
+     * The swapchain is rebuilt first if it was requested or is out of date
+     * @param imageAcquired
+     * semaphore signaled when the image is ready to be written
+     * @param completedFrames
+     * count of frames completed by GPU
+     * @param submittedFrames
+     * count of frames submitted to GPU, the frame being recorded is the next one
+     * @param imageIndex
+     * index of the acquired image
+     * @return
+     * true if the image is acquired. The frame has to be skipped otherwise
+    */
+    bool Acquire(VkSemaphore imageAcquired, uint64_t completedFrames, uint64_t submittedFrames,
+                 uint32_t& imageIndex);
+    /**
+     * @brief
+     * Present the acquired image once its GetRenderFinished semaphore is signaled
+     * @param queue
+     * queue supporting present to the surface
+     * @param imageIndex
+     * index of the acquired image
+     * @param inputTime
+     * time the input of the frame was sampled
+     * @return
+     * AppResult code
+    */
+    AppResult Present(VkQueue queue, uint32_t imageIndex, std::chrono::steady_clock::time_point inputTime);
+
+    bool IsValid() const { return swapchain != VK_NULL_HANDLE; }
+    // Zero-sized surfaces (minimized windows) can't have a swapchain
+    bool IsMinimized() const { return !requestedExtent.width || !requestedExtent.height; }
+    VkImage GetImage(uint32_t imageIndex) const { return images[imageIndex]; }
+    // Semaphore the frame rendering to the image signals and the present waits
+    VkSemaphore GetRenderFinished(uint32_t imageIndex) const { return renderFinished[imageIndex]; }
+    VkFormat GetFormat() const { return format.format; }
+    VkExtent2D GetExtent() const { return extent; }
+    VkPresentModeKHR GetPresentMode() const { return presentMode; }
+    uint32_t GetImagesCount() const { return static_cast<uint32_t>(images.size()); }
+
+    const Stats& GetStats() const { return stats; }
+    void PrintStats() const;
+
+private:
+
+    // Swapchain replaced by a newer one but maybe still used by frames in flight
+    struct Retired {
+        VkSwapchainKHR swapchain;
+        std::vector<VkSemaphore> renderFinished;
+        // Frames with smaller numbers may present to the swapchain
+        uint64_t framesCount;
+    };
+
+    AppResult Create(uint64_t submittedFrames);
+    VkPresentModeKHR ChoosePresentMode() const;
+    uint32_t ChooseImagesCount(const VkSurfaceCapabilitiesKHR& caps) const;
+    void DestroyRetired(uint64_t completedFrames);
+    void DestroySemaphores(const std::vector<VkSemaphore>& semaphores);
+
+private:
+
+    VkPhysicalDevice physDev = VK_NULL_HANDLE;
+    VkDevice dev = VK_NULL_HANDLE;
+    VkSurfaceKHR surf = VK_NULL_HANDLE;
+    PresentPolicy presentPolicy = PresentPolicy::LowLatency;
+
+    VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+    std::vector<VkImage> images;
+    // Per image, recreated with the images
+    std::vector<VkSemaphore> renderFinished;
+    VkSurfaceFormatKHR format{};
+    VkExtent2D extent{};
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    std::vector<VkPresentModeKHR> supportedModes;
+
+    std::vector<Retired> retired;
+    VkExtent2D requestedExtent{};
+    bool recreateRequested = false;
+
+    Stats stats;
+};
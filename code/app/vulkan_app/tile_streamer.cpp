@@ -0,0 +1,224 @@
+#include <vulkan_app/tile_streamer.h>
+
+#include <logs.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+namespace {
+
+// Level tints of the generated texture, coarse levels repeat the palette
+const uint8_t levelColors[][3] = {
+    { 230,  80,  70 }, { 240, 160,  60 }, { 230, 220,  80 }, { 120, 200,  90 },
+    {  70, 190, 190 }, {  80, 130, 230 }, { 150,  90, 220 }, { 220, 110, 190 },
+};
+constexpr uint32_t levelColorsCount = sizeof(levelColors) / sizeof(levelColors[0]);
+// Checkerboard cell of the generated texture in finest level texels
+constexpr uint32_t checkerCellSize = 64;
+
+} // namespace
+
+uint64_t TileStreamer::BuildLayout(const FileHeader& header, std::vector<Level>& levels, std::vector<Page>& pages) {
+
+    levels.clear();
+    pages.clear();
+    uint64_t offset = sizeof(FileHeader);
+    for (uint32_t level = 0; level < header.levelsCount; ++level) {
+        Level info{};
+        info.width     = std::max(header.width >> level, 1u);
+        info.height    = std::max(header.height >> level, 1u);
+        info.pagesX    = (info.width + header.tileSize - 1) / header.tileSize;
+        info.pagesY    = (info.height + header.tileSize - 1) / header.tileSize;
+        info.firstPage = static_cast<uint32_t>(pages.size());
+        levels.push_back(info);
+
+        for (uint32_t y = 0; y < info.pagesY; ++y) {
+            for (uint32_t x = 0; x < info.pagesX; ++x) {
+                Page page{};
+                page.offset = offset;
+                page.level  = level;
+                page.x      = x;
+                page.y      = y;
+                page.width  = std::min(header.tileSize, info.width - x * header.tileSize);
+                page.height = std::min(header.tileSize, info.height - y * header.tileSize);
+                pages.push_back(page);
+                offset += page.GetSize();
+            }
+        }
+    }
+    return offset - sizeof(FileHeader);
+}
+
+AppResult TileStreamer::GenerateFile(const char* path, uint32_t size, uint32_t tileSize) {
+
+    if (!size || !tileSize) {
+        return APP_CODE_INVALID_ARGS;
+    }
+
+    FileHeader header{};
+    header.magic     = fileMagic;
+    header.version   = fileVersion;
+    header.width     = size;
+    header.height    = size;
+    header.tileSize  = tileSize;
+    header.texelSize = texelSize;
+    while (header.levelsCount < maxLevels && (size >> header.levelsCount)) {
+        ++header.levelsCount;
+    }
+
+    std::vector<Level> levels;
+    std::vector<Page> pages;
+    BuildLayout(header, levels, pages);
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        PRINT_E("Failed to create virtual texture file %s", path);
+        return APP_CODE_IO_FAILURE;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    std::vector<uint8_t> texels;
+    for (const auto& page : pages) {
+        texels.resize(page.GetSize());
+        const uint8_t* color = levelColors[page.level % levelColorsCount];
+        uint32_t cell = std::max(checkerCellSize >> page.level, 1u);
+        uint8_t* texel = texels.data();
+        for (uint32_t y = 0; y < page.height; ++y) {
+            for (uint32_t x = 0; x < page.width; ++x, texel += texelSize) {
+                uint32_t levelX = page.x * tileSize + x;
+                uint32_t levelY = page.y * tileSize + y;
+                bool border = !x || !y;
+                uint32_t shade = border ? 64 : (((levelX / cell) ^ (levelY / cell)) & 1) ? 255 : 160;
+                texel[0] = static_cast<uint8_t>(color[0] * shade / 255);
+                texel[1] = static_cast<uint8_t>(color[1] * shade / 255);
+                texel[2] = static_cast<uint8_t>(color[2] * shade / 255);
+                texel[3] = 255;
+            }
+        }
+        file.write(reinterpret_cast<const char*>(texels.data()), texels.size());
+    }
+    if (!file) {
+        PRINT_E("Failed to write virtual texture file %s", path);
+        return APP_CODE_IO_FAILURE;
+    }
+
+    PRINT("Virtual texture %s generated: %ux%u, %u levels, %zu pages", path, size, size, header.levelsCount,
+          pages.size());
+    return APP_CODE_OK;
+}
+
+AppResult TileStreamer::Open(const char* path) {
+
+    Close();
+
+    if (!file.Open(path)) {
+        PRINT_E("Failed to open virtual texture file %s", path);
+        return APP_CODE_IO_FAILURE;
+    }
+    if (file.GetSize() < sizeof(FileHeader)) {
+        PRINT_E("Virtual texture file %s is truncated", path);
+        file.Close();
+        return APP_CODE_IO_FAILURE;
+    }
+    std::memcpy(&header, file.GetData(), sizeof(header));
+    if (header.magic != fileMagic || header.version != fileVersion || header.texelSize != texelSize ||
+        !header.width || !header.height || !header.tileSize || !header.levelsCount ||
+        header.levelsCount > maxLevels) {
+        PRINT_E("Virtual texture file %s has unsupported header", path);
+        file.Close();
+        return APP_CODE_IO_FAILURE;
+    }
+    uint64_t texelsSize = BuildLayout(header, levels, pages);
+    if (file.GetSize() < sizeof(FileHeader) + texelsSize) {
+        PRINT_E("Virtual texture file %s is truncated", path);
+        file.Close();
+        return APP_CODE_IO_FAILURE;
+    }
+
+    stats = {};
+    stop  = false;
+    thread = std::thread(&TileStreamer::ThreadFunc, this);
+
+    PRINT("Virtual texture %s: %ux%u, %u levels of %u texels tiles, %zu pages", path, header.width, header.height,
+          header.levelsCount, header.tileSize, pages.size());
+    return APP_CODE_OK;
+}
+
+void TileStreamer::Close() {
+    if (thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        wakeUp.notify_all();
+        thread.join();
+    }
+    requests.clear();
+    loaded.clear();
+    freeBuffers.clear();
+    levels.clear();
+    pages.clear();
+    file.Close();
+}
+
+void TileStreamer::Request(uint32_t page) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        requests.push_back(page);
+        ++stats.requestedTiles;
+    }
+    wakeUp.notify_one();
+}
+
+void TileStreamer::TakeLoaded(std::vector<Tile>& tiles, size_t maxCount) {
+    std::lock_guard<std::mutex> lock(mutex);
+    while (!loaded.empty() && maxCount--) {
+        tiles.push_back(std::move(loaded.front()));
+        loaded.pop_front();
+    }
+}
+
+void TileStreamer::Recycle(std::vector<uint8_t>&& data) {
+    std::lock_guard<std::mutex> lock(mutex);
+    freeBuffers.push_back(std::move(data));
+}
+
+TileStreamer::Stats TileStreamer::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void TileStreamer::ThreadFunc() {
+
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wakeUp.wait(lock, [this]() { return stop || !requests.empty(); });
+        if (stop) {
+            return;
+        }
+
+        Tile tile;
+        tile.page = requests.front();
+        requests.pop_front();
+        if (!freeBuffers.empty()) {
+            tile.data = std::move(freeBuffers.back());
+            freeBuffers.pop_back();
+        }
+
+        // Reading the mapping may fault in pages from disk, the render thread must not wait for it
+        lock.unlock();
+        auto start = std::chrono::steady_clock::now();
+        const auto& page = pages[tile.page];
+        tile.data.resize(page.GetSize());
+        std::memcpy(tile.data.data(), file.GetData() + page.offset, tile.data.size());
+        double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        lock.lock();
+
+        ++stats.loadedTiles;
+        stats.loadedBytes += tile.data.size();
+        stats.loadTime    += time;
+        loaded.push_back(std::move(tile));
+    }
+}
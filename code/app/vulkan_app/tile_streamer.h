@@ -0,0 +1,146 @@
+#pragma once
+
+#include <app_result.h>
+#include <utils/mapped_file.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief
+ * Tiled mip chain of a virtual texture stored on disk, and the thread loading its pages.
+ * The file is a header followed by RGBA8 pages of every level, finest first, row by row.
+ * Pages are tileSize x tileSize texels cut at the level edges, levels smaller than a tile are a single page.
+ * The file is memory mapped, the loader thread copies requested pages out of the mapping,
+ * so disk reads happen on it and not on the render thread
+*/
+class TileStreamer {
+
+public:
+
+    static constexpr uint32_t fileMagic   = 0x58455456; // "VTEX"
+    static constexpr uint32_t fileVersion = 1;
+    static constexpr uint32_t texelSize   = 4;
+    // Levels of a 32768 texels wide texture
+    static constexpr uint32_t maxLevels   = 16;
+
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t width;
+        uint32_t height;
+        uint32_t tileSize;
+        uint32_t levelsCount;
+        uint32_t texelSize;
+        uint32_t reserved;
+    };
+
+    struct Level {
+        uint32_t width;
+        uint32_t height;
+        uint32_t pagesX;
+        uint32_t pagesY;
+        // Index of the level's first page, pages of all levels are numbered together
+        uint32_t firstPage;
+    };
+
+    struct Page {
+        // Offset of the texels in the file
+        uint64_t offset;
+        uint32_t level;
+        // Position in pages inside the level
+        uint32_t x;
+        uint32_t y;
+        // Size in texels, smaller than the tile at the level edges
+        uint32_t width;
+        uint32_t height;
+
+        size_t GetSize() const { return size_t(width) * height * texelSize; }
+    };
+
+    // Page loaded by the thread
+    struct Tile {
+        uint32_t page;
+        std::vector<uint8_t> data;
+    };
+
+    struct Stats {
+        uint64_t requestedTiles = 0;
+        uint64_t loadedTiles    = 0;
+        uint64_t loadedBytes    = 0;
+        // Time the loader thread spent copying out of the mapping, includes page faults
+        double loadTime         = 0.0;
+    };
+
+    TileStreamer() = default;
+    TileStreamer(const TileStreamer&) = delete;
+    ~TileStreamer() { Close(); }
+
+    /**
+     * @brief
+     * Write a procedural texture file: a checkerboard colored by level with the page borders marked
+     * @param path
+     * file path
+     * @param size
+     * width and height of the finest level
+     * @param tileSize
+     * page size in texels
+     * @return
+     * AppResult code
+    */
+    static AppResult GenerateFile(const char* path, uint32_t size, uint32_t tileSize);
+
+    // Map the file, validate it and start the loader thread
+    AppResult Open(const char* path);
+    // Stop the thread and unmap the file. Loaded tiles not taken are dropped
+    void Close();
+
+    // Queue a page to be loaded. Pages are loaded in the request order
+    void Request(uint32_t page);
+    /**
+     * @brief
+     * Take tiles loaded since the last call
+     * @param tiles
+     * vector the tiles are appended to
+     * @param maxCount
+     * count of tiles to take at most, the rest stay for the next calls
+    */
+    void TakeLoaded(std::vector<Tile>& tiles, size_t maxCount);
+    // Return the tile data buffer for reuse by next loads
+    void Recycle(std::vector<uint8_t>&& data);
+    // Texels of a page right in the mapping. Synchronous, for the pages needed before the first frame
+    const uint8_t* GetPageData(uint32_t page) const { return file.GetData() + pages[page].offset; }
+
+    const FileHeader& GetHeader() const { return header; }
+    const std::vector<Level>& GetLevels() const { return levels; }
+    const Page& GetPage(uint32_t page) const { return pages[page]; }
+    uint32_t GetPagesCount() const { return static_cast<uint32_t>(pages.size()); }
+    Stats GetStats() const;
+
+private:
+
+    // Fill levels and pages from the header. Returns the size of the texels
+    static uint64_t BuildLayout(const FileHeader& header, std::vector<Level>& levels, std::vector<Page>& pages);
+    void ThreadFunc();
+
+private:
+
+    MappedFile file;
+    FileHeader header{};
+    std::vector<Level> levels;
+    std::vector<Page> pages;
+
+    std::thread thread;
+    mutable std::mutex mutex;
+    std::condition_variable wakeUp;
+    bool stop = false;
+    std::deque<uint32_t> requests;
+    std::deque<Tile> loaded;
+    std::vector<std::vector<uint8_t>> freeBuffers;
+
+    Stats stats;
+};
@@ -0,0 +1,373 @@
+#include <vulkan_app/tlsf_allocator.h>
+
+#include <algorithm>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+
+// Index of the least significant set bit. Value must not be 0
+uint32_t Lsb(uint64_t value) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return static_cast<uint32_t>(index);
+#else
+    return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+}
+
+// Index of the most significant set bit. Value must not be 0
+uint32_t Msb(uint64_t value) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return static_cast<uint32_t>(index);
+#else
+    return 63u - static_cast<uint32_t>(__builtin_clzll(value));
+#endif
+}
+
+uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+} // namespace
+
+TlsfAllocator::TlsfAllocator(uint64_t size, uint64_t granularity)
+    : size(size), granularity(std::max<uint64_t>(granularity, 1)) {
+
+    for (auto& lists : freeLists) {
+        std::fill(std::begin(lists), std::end(lists), nullIndex);
+    }
+
+    firstBlock = NewBlock();
+    auto& block    = blocks[firstBlock];
+    block.offset   = 0;
+    block.size     = size;
+    block.prevPhys = nullIndex;
+    block.nextPhys = nullIndex;
+    InsertFree(firstBlock);
+}
+
+void TlsfAllocator::Mapping(uint64_t size, uint32_t& fl, uint32_t& sl) {
+    if (size < smallRangeSize) {
+        fl = 0;
+        sl = static_cast<uint32_t>(size / (smallRangeSize / slCount));
+    } else {
+        uint32_t msb = Msb(size);
+        fl = msb - (flShift - 1);
+        sl = static_cast<uint32_t>(size >> (msb - slLog2)) ^ slCount;
+    }
+}
+
+uint32_t TlsfAllocator::NewBlock() {
+    if (!unusedBlocks.empty()) {
+        uint32_t index = unusedBlocks.back();
+        unusedBlocks.pop_back();
+        blocks[index] = {};
+        return index;
+    }
+    blocks.push_back({});
+    return static_cast<uint32_t>(blocks.size() - 1);
+}
+
+void TlsfAllocator::ReleaseBlock(uint32_t index) {
+    unusedBlocks.push_back(index);
+}
+
+void TlsfAllocator::InsertFree(uint32_t index) {
+    auto& block = blocks[index];
+    block.kind = ResourceKind::Free;
+
+    uint32_t fl, sl;
+    Mapping(block.size, fl, sl);
+
+    uint32_t head  = freeLists[fl][sl];
+    block.prevFree = nullIndex;
+    block.nextFree = head;
+    if (head != nullIndex) {
+        blocks[head].prevFree = index;
+    }
+    freeLists[fl][sl] = index;
+    flBitmap     |= 1ull << fl;
+    slBitmaps[fl] |= 1u << sl;
+}
+
+void TlsfAllocator::RemoveFree(uint32_t index) {
+    auto& block = blocks[index];
+
+    uint32_t fl, sl;
+    Mapping(block.size, fl, sl);
+
+    if (block.prevFree != nullIndex) {
+        blocks[block.prevFree].nextFree = block.nextFree;
+    } else {
+        freeLists[fl][sl] = block.nextFree;
+    }
+    if (block.nextFree != nullIndex) {
+        blocks[block.nextFree].prevFree = block.prevFree;
+    }
+
+    if (freeLists[fl][sl] == nullIndex) {
+        slBitmaps[fl] &= ~(1u << sl);
+        if (!slBitmaps[fl]) {
+            flBitmap &= ~(1ull << fl);
+        }
+    }
+}
+
+bool TlsfAllocator::IsConflict(ResourceKind a, ResourceKind b) const {
+    return granularity > 1 &&
+           a != ResourceKind::Free && b != ResourceKind::Free &&
+           a != b;
+}
+
+bool TlsfAllocator::IsOnSamePage(uint64_t a, uint64_t b) const {
+    return (a & ~(granularity - 1)) == (b & ~(granularity - 1));
+}
+
+bool TlsfAllocator::CheckFit(uint32_t index, uint64_t size, uint64_t alignment, ResourceKind kind,
+                             uint64_t& alignedOffset) const {
+
+    auto& block = blocks[index];
+    alignedOffset = AlignUp(block.offset, alignment);
+
+    // Move to the next page if the previous resource conflicts with this one
+    if (block.prevPhys != nullIndex) {
+        auto& prev = blocks[block.prevPhys];
+        if (IsConflict(prev.kind, kind) && IsOnSamePage(prev.offset + prev.size - 1, alignedOffset)) {
+            alignedOffset = AlignUp(alignedOffset, granularity);
+        }
+    }
+
+    uint64_t end = alignedOffset + size;
+    if (end > block.offset + block.size) {
+        return false;
+    }
+
+    // The next resource can't be moved, so the range must end on an earlier page
+    if (block.nextPhys != nullIndex) {
+        auto& next = blocks[block.nextPhys];
+        if (IsConflict(next.kind, kind) && IsOnSamePage(end - 1, next.offset)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+uint32_t TlsfAllocator::FindFitFrom(uint32_t fl, uint32_t sl, uint64_t size, uint64_t alignment,
+                                    ResourceKind kind, uint64_t& alignedOffset) const {
+
+    // Lists of the first level fl starting from sl and then all the lists of bigger first levels
+    uint64_t slMask = (sl < slCount) ? slBitmaps[fl] & (~0u << sl) : 0;
+    while (true) {
+        if (!slMask) {
+            uint64_t flMask = (fl + 1 < 64) ? flBitmap & (~0ull << (fl + 1)) : 0;
+            if (!flMask) {
+                return nullIndex;
+            }
+            fl = Lsb(flMask);
+            slMask = slBitmaps[fl];
+        }
+        sl = Lsb(slMask);
+        slMask &= slMask - 1;
+
+        for (uint32_t i = freeLists[fl][sl]; i != nullIndex; i = blocks[i].nextFree) {
+            if (CheckFit(i, size, alignment, kind, alignedOffset)) {
+                return i;
+            }
+        }
+    }
+}
+
+uint32_t TlsfAllocator::FindFit(uint64_t size, uint64_t alignment, ResourceKind kind,
+                                uint64_t& alignedOffset) const {
+
+    // Good fit: every range in the rounded up class is big enough even with the alignment padding
+    uint64_t searchSize = size + alignment - 1;
+    if (searchSize >= smallRangeSize) {
+        searchSize += (1ull << (Msb(searchSize) - slLog2)) - 1;
+    }
+    uint32_t fl, sl;
+    Mapping(searchSize, fl, sl);
+    if (fl < flCount) {
+        uint32_t index = FindFitFrom(fl, sl, size, alignment, kind, alignedOffset);
+        if (index != nullIndex) {
+            return index;
+        }
+    }
+
+    // Fall back to the ranges of the exact class which may still fit
+    Mapping(size, fl, sl);
+    for (uint32_t i = freeLists[fl][sl]; i != nullIndex; i = blocks[i].nextFree) {
+        if (CheckFit(i, size, alignment, kind, alignedOffset)) {
+            return i;
+        }
+    }
+    return nullIndex;
+}
+
+TlsfAllocator::Handle TlsfAllocator::Allocate(uint64_t size, uint64_t alignment, ResourceKind kind,
+                                              uint64_t& offset) {
+
+    if (!size || size > this->size || kind == ResourceKind::Free) {
+        return invalidHandle;
+    }
+    alignment = std::max<uint64_t>(alignment, 1);
+
+    uint64_t alignedOffset = 0;
+    uint32_t index = FindFit(size, alignment, kind, alignedOffset);
+    if (index == nullIndex) {
+        return invalidHandle;
+    }
+    RemoveFree(index);
+
+    // Split the alignment padding to a separate free range
+    uint64_t padding = alignedOffset - blocks[index].offset;
+    if (padding) {
+        uint32_t padIndex = NewBlock();
+        auto& block = blocks[index];
+        auto& pad   = blocks[padIndex];
+        pad.offset   = block.offset;
+        pad.size     = padding;
+        pad.prevPhys = block.prevPhys;
+        pad.nextPhys = index;
+        if (block.prevPhys != nullIndex) {
+            blocks[block.prevPhys].nextPhys = padIndex;
+        } else {
+            firstBlock = padIndex;
+        }
+        block.prevPhys = padIndex;
+        block.offset   = alignedOffset;
+        block.size    -= padding;
+        InsertFree(padIndex);
+    }
+
+    // Split the rest of the range
+    uint64_t remainder = blocks[index].size - size;
+    if (remainder) {
+        uint32_t restIndex = NewBlock();
+        auto& block = blocks[index];
+        auto& rest  = blocks[restIndex];
+        rest.offset   = block.offset + size;
+        rest.size     = remainder;
+        rest.prevPhys = index;
+        rest.nextPhys = block.nextPhys;
+        if (block.nextPhys != nullIndex) {
+            blocks[block.nextPhys].prevPhys = restIndex;
+        }
+        block.nextPhys = restIndex;
+        block.size     = size;
+        InsertFree(restIndex);
+    }
+
+    auto& block = blocks[index];
+    block.kind = kind;
+    usedSize += block.size;
+    ++allocationsCount;
+
+    offset = block.offset;
+    return index;
+}
+
+void TlsfAllocator::Free(Handle handle) {
+
+    if (handle >= blocks.size() || blocks[handle].kind == ResourceKind::Free) {
+        return;
+    }
+
+    uint32_t index = handle;
+    usedSize -= blocks[index].size;
+    --allocationsCount;
+    blocks[index].kind = ResourceKind::Free;
+
+    // Merge with the next free range
+    uint32_t nextIndex = blocks[index].nextPhys;
+    if (nextIndex != nullIndex && blocks[nextIndex].kind == ResourceKind::Free) {
+        RemoveFree(nextIndex);
+        auto& block = blocks[index];
+        auto& next  = blocks[nextIndex];
+        block.size    += next.size;
+        block.nextPhys = next.nextPhys;
+        if (next.nextPhys != nullIndex) {
+            blocks[next.nextPhys].prevPhys = index;
+        }
+        ReleaseBlock(nextIndex);
+    }
+
+    // Merge with the previous free range
+    uint32_t prevIndex = blocks[index].prevPhys;
+    if (prevIndex != nullIndex && blocks[prevIndex].kind == ResourceKind::Free) {
+        RemoveFree(prevIndex);
+        auto& block = blocks[index];
+        auto& prev  = blocks[prevIndex];
+        prev.size    += block.size;
+        prev.nextPhys = block.nextPhys;
+        if (block.nextPhys != nullIndex) {
+            blocks[block.nextPhys].prevPhys = prevIndex;
+        }
+        ReleaseBlock(index);
+        index = prevIndex;
+    }
+
+    InsertFree(index);
+}
+
+uint64_t TlsfAllocator::GetLargestFreeRange() const {
+    if (!flBitmap) {
+        return 0;
+    }
+    uint32_t fl = Msb(flBitmap);
+    uint32_t sl = Msb(slBitmaps[fl]);
+    uint64_t largest = 0;
+    for (uint32_t i = freeLists[fl][sl]; i != nullIndex; i = blocks[i].nextFree) {
+        largest = std::max(largest, blocks[i].size);
+    }
+    return largest;
+}
+
+bool TlsfAllocator::Validate() const {
+
+    uint64_t offset = 0;
+    uint64_t used = 0;
+    uint32_t count = 0;
+    uint32_t prev = nullIndex;
+    uint32_t prevUsed = nullIndex;
+    bool prevFree = false;
+
+    for (uint32_t i = firstBlock; i != nullIndex; i = blocks[i].nextPhys) {
+        auto& block = blocks[i];
+        if (block.offset != offset || block.prevPhys != prev || !block.size) {
+            return false;
+        }
+        bool isFree = block.kind == ResourceKind::Free;
+        // Free ranges must be merged
+        if (isFree && prevFree) {
+            return false;
+        }
+        if (isFree) {
+            uint32_t fl, sl;
+            Mapping(block.size, fl, sl);
+            if (!(slBitmaps[fl] & (1u << sl)) || !(flBitmap & (1ull << fl))) {
+                return false;
+            }
+        } else {
+            used += block.size;
+            ++count;
+            if (prevUsed != nullIndex && IsConflict(blocks[prevUsed].kind, block.kind) &&
+                IsOnSamePage(blocks[prevUsed].offset + blocks[prevUsed].size - 1, block.offset)) {
+                return false;
+            }
+            prevUsed = i;
+        }
+        offset += block.size;
+        prev = i;
+        prevFree = isFree;
+    }
+
+    return offset == size && used == usedSize && count == allocationsCount;
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief
+ * Two-level segregated fit sub-allocator of a linear range [0, size).
+ * It doesn't touch any memory itself, so it could be used for any kind of memory and run without a device.
+ * Allocation and freeing are O(1) in the common case.
+ * Neighbour linear and optimal resources are kept on different pages of the specified granularity
+ * (see bufferImageGranularity)
+*/
+class TlsfAllocator {
+
+public:
+
+    typedef uint32_t Handle;
+    static constexpr Handle invalidHandle = ~Handle(0);
+
+    enum class ResourceKind : uint8_t {
+        Free = 0,
+        // Buffers and linear images
+        Linear,
+        // Optimal tiling images
+        Optimal,
+    };
+
+    /**
+     * @brief
+     * @param size
+     * size of the managed range
+     * @param granularity
+     * power of 2 page size linear and optimal resources can't share
+    */
+    explicit TlsfAllocator(uint64_t size, uint64_t granularity = 1);
+
+    /**
+     * @brief
+     * Allocate a range
+     * @param size
+     * size of the range
+     * @param alignment
+     * power of 2 alignment of the range offset
+     * @param kind
+     * kind of the resource to be placed in the range
+     * @param offset
+     * offset of the allocated range
+     * @return
+     * handle of the allocation or invalidHandle if there is no free range big enough
+    */
+    Handle Allocate(uint64_t size, uint64_t alignment, ResourceKind kind, uint64_t& offset);
+    void Free(Handle handle);
+
+    uint64_t GetOffset(Handle handle) const { return blocks[handle].offset; }
+    uint64_t GetAllocationSize(Handle handle) const { return blocks[handle].size; }
+
+    uint64_t GetSize() const { return size; }
+    uint64_t GetUsedSize() const { return usedSize; }
+    uint32_t GetAllocationsCount() const { return allocationsCount; }
+    uint64_t GetLargestFreeRange() const;
+    bool IsEmpty() const { return allocationsCount == 0; }
+
+    // Call the functor as f(handle, offset, size, kind) for every allocation in address order
+    template<class Func>
+    void ForEachAllocation(Func f) const {
+        for (uint32_t i = firstBlock; i != nullIndex; i = blocks[i].nextPhys) {
+            auto& block = blocks[i];
+            if (block.kind != ResourceKind::Free) {
+                f(i, block.offset, block.size, block.kind);
+            }
+        }
+    }
+
+    // Check internal invariants. For debugging
+    bool Validate() const;
+
+private:
+
+    static constexpr uint32_t nullIndex = ~uint32_t(0);
+
+    // Second level has 2^slLog2 lists per first level
+    static constexpr uint32_t slLog2  = 4;
+    static constexpr uint32_t slCount = 1u << slLog2;
+    // Ranges smaller than this are linearly mapped to the first level 0
+    static constexpr uint32_t flShift        = slLog2 + 2;
+    static constexpr uint64_t smallRangeSize = 1ull << flShift;
+    static constexpr uint32_t flCount        = 64 - flShift + 1;
+
+    struct Block {
+        uint64_t offset;
+        uint64_t size;
+        uint32_t prevPhys;
+        uint32_t nextPhys;
+        uint32_t prevFree;
+        uint32_t nextFree;
+        ResourceKind kind;
+    };
+
+    static void Mapping(uint64_t size, uint32_t& fl, uint32_t& sl);
+
+    uint32_t NewBlock();
+    void ReleaseBlock(uint32_t index);
+    void InsertFree(uint32_t index);
+    void RemoveFree(uint32_t index);
+
+    bool IsConflict(ResourceKind a, ResourceKind b) const;
+    bool IsOnSamePage(uint64_t a, uint64_t b) const;
+    bool CheckFit(uint32_t index, uint64_t size, uint64_t alignment, ResourceKind kind,
+                  uint64_t& alignedOffset) const;
+    uint32_t FindFit(uint64_t size, uint64_t alignment, ResourceKind kind, uint64_t& alignedOffset) const;
+    uint32_t FindFitFrom(uint32_t fl, uint32_t sl, uint64_t size, uint64_t alignment, ResourceKind kind,
+                         uint64_t& alignedOffset) const;
+
+private:
+
+    uint64_t size;
+    uint64_t granularity;
+
+    std::vector<Block> blocks;
+    std::vector<uint32_t> unusedBlocks;
+    uint32_t firstBlock = nullIndex;
+
+    uint64_t flBitmap = 0;
+    uint32_t slBitmaps[flCount] = {};
+    uint32_t freeLists[flCount][slCount];
+
+    uint64_t usedSize         = 0;
+    uint32_t allocationsCount = 0;
+};
@@ -0,0 +1,852 @@
+#include <vulkan_app/virtual_texture.h>
+
+#include <app_consts.h>
+#include <logs.h>
+
+#include <glm/matrix.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr VkFormat textureFormat = VK_FORMAT_R8G8B8A8_UNORM;
+constexpr VkImageUsageFlags textureUsage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+// local_size_x and local_size_y of vt_feedback.comp
+constexpr uint32_t feedbackGroupSize = 8;
+// Atlas slot index bits of a page table entry
+constexpr uint32_t maxAtlasSlots = 1u << 24;
+
+} // namespace
+
+AppResult VirtualTexture::Init(VkPhysicalDevice physicalDevice, VkDevice device, const VkPhysicalDeviceLimits& limits,
+                               const std::vector<uint32_t>& queueFamilies, MemoryAllocator& allocator,
+                               StagingRing& staging, AsyncQueue& transfer, AsyncQueue* sparse,
+                               PipelineFactory& factory, BindlessTable& bindless, uint32_t framesCount,
+                               const char* path, VkDeviceSize budget) {
+
+    dev              = device;
+    memAllocator     = &allocator;
+    stagingRing      = &staging;
+    transferQueue    = &transfer;
+    bindlessTable    = &bindless;
+    families         = queueFamilies;
+    framesInFlight   = framesCount;
+    maxWorkGroups[0] = limits.maxComputeWorkGroupCount[0];
+    maxWorkGroups[1] = limits.maxComputeWorkGroupCount[1];
+    stats            = {};
+
+    APP_CHECK_CALL(streamer.Open(path));
+    pageStates.assign(streamer.GetPagesCount(), PageState{});
+
+    // Levels of a single page are pinned: every page has a resident ancestor to fall back to
+    const auto& levels = streamer.GetLevels();
+    pinnedLevel = static_cast<uint32_t>(levels.size()) - 1;
+    while (pinnedLevel > 0 && levels[pinnedLevel - 1].pagesX == 1 && levels[pinnedLevel - 1].pagesY == 1) {
+        --pinnedLevel;
+    }
+    mipTailLevel = static_cast<uint32_t>(levels.size());
+
+    if (sparse) {
+        bool supported = false;
+        APP_CHECK_CALL(CreateSparseImage(physicalDevice, budget, supported));
+        sparseQueue = supported ? sparse : nullptr;
+    }
+    if (!sparseQueue) {
+        APP_CHECK_CALL(CreateAtlasImage(limits, budget));
+    }
+
+    APP_CHECK_CALL(CreateResources());
+    APP_CHECK_CALL(RequestPipeline(factory));
+    APP_CHECK_CALL(MakeTailResident());
+
+    PRINT("Virtual texture streams into %s: %u page slots of %llu KiB, %u pinned pages",
+          sparseQueue ? "sparse image" : "atlas", slotsCount,
+          static_cast<unsigned long long>(pageMemorySize / 1024), stats.pinnedPages);
+    return APP_CODE_OK;
+}
+
+AppResult VirtualTexture::CreateSparseImage(VkPhysicalDevice physicalDevice, VkDeviceSize budget, bool& supported) {
+
+    const auto& header = streamer.GetHeader();
+    supported = false;
+
+    // Sparse blocks must match the file pages to bind every page on its own
+    uint32_t propsCount = 0;
+    vkGetPhysicalDeviceSparseImageFormatProperties(physicalDevice, textureFormat, VK_IMAGE_TYPE_2D,
+                                                   VK_SAMPLE_COUNT_1_BIT, textureUsage, VK_IMAGE_TILING_OPTIMAL,
+                                                   &propsCount, nullptr);
+    std::vector<VkSparseImageFormatProperties> formatProps(propsCount);
+    vkGetPhysicalDeviceSparseImageFormatProperties(physicalDevice, textureFormat, VK_IMAGE_TYPE_2D,
+                                                   VK_SAMPLE_COUNT_1_BIT, textureUsage, VK_IMAGE_TILING_OPTIMAL,
+                                                   &propsCount, formatProps.data());
+    auto colorProps = std::find_if(formatProps.begin(), formatProps.end(), [](const VkSparseImageFormatProperties& p) {
+        return (p.aspectMask & VK_IMAGE_ASPECT_COLOR_BIT) != 0;
+    });
+    if (colorProps == formatProps.end()) {
+        PRINT_W("Sparse residency isn't supported for the virtual texture format, the atlas is used");
+        return APP_CODE_OK;
+    }
+    if (colorProps->imageGranularity.width != header.tileSize ||
+        colorProps->imageGranularity.height != header.tileSize) {
+        PRINT_W("Sparse block of %ux%u texels doesn't match %u texels virtual texture tiles, the atlas is used",
+                colorProps->imageGranularity.width, colorProps->imageGranularity.height, header.tileSize);
+        return APP_CODE_OK;
+    }
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.flags         = VK_IMAGE_CREATE_SPARSE_BINDING_BIT | VK_IMAGE_CREATE_SPARSE_RESIDENCY_BIT;
+    imageInfo.imageType     = VK_IMAGE_TYPE_2D;
+    imageInfo.format        = textureFormat;
+    imageInfo.extent        = { header.width, header.height, 1 };
+    imageInfo.mipLevels     = header.levelsCount;
+    imageInfo.arrayLayers   = 1;
+    imageInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage         = textureUsage;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    // Pages are uploaded by the transfer queue and sampled by the graphics one
+    if (families.size() > 1) {
+        imageInfo.sharingMode           = VK_SHARING_MODE_CONCURRENT;
+        imageInfo.queueFamilyIndexCount = static_cast<uint32_t>(families.size());
+        imageInfo.pQueueFamilyIndices   = families.data();
+    } else {
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+
+    VkResult r = vkCreateImage(dev, &imageInfo, nullptr, &image);
+    if (r != VK_SUCCESS) {
+        PRINT_E("Failed to create sparse virtual texture image. Vk error code: %d", r);
+        return APP_CODE_VK_COMMAND_FAIURE;
+    }
+
+    VkMemoryRequirements memoryReqs{};
+    vkGetImageMemoryRequirements(dev, image, &memoryReqs);
+    uint32_t sparseReqsCount = 0;
+    vkGetImageSparseMemoryRequirements(dev, image, &sparseReqsCount, nullptr);
+    std::vector<VkSparseImageMemoryRequirements> sparseReqs(sparseReqsCount);
+    vkGetImageSparseMemoryRequirements(dev, image, &sparseReqsCount, sparseReqs.data());
+    auto colorReqs = std::find_if(sparseReqs.begin(), sparseReqs.end(), [](const VkSparseImageMemoryRequirements& req) {
+        return (req.formatProperties.aspectMask & VK_IMAGE_ASPECT_COLOR_BIT) != 0;
+    });
+    if (colorReqs == sparseReqs.end()) {
+        PRINT_E("Sparse virtual texture image has no color memory requirements");
+        return APP_CODE_VK_INIT_FAIURE;
+    }
+
+    // Every page is one sparse block
+    pageMemorySize = memoryReqs.alignment;
+    slotsCount     = static_cast<uint32_t>(std::min<VkDeviceSize>(budget / pageMemorySize, maxAtlasSlots));
+    mipTailLevel   = std::min(colorReqs->imageMipTailFirstLod, header.levelsCount);
+    pinnedLevel    = std::min(pinnedLevel, mipTailLevel);
+
+    MemoryAllocator::AllocationCreateInfo allocInfo;
+    allocInfo.usage        = MemoryAllocator::MemoryUsage::GpuOnly;
+    allocInfo.optimalImage = true;
+    allocInfo.dedicated    = true;
+
+    VkMemoryRequirements poolReqs = memoryReqs;
+    poolReqs.size = VkDeviceSize(slotsCount) * pageMemorySize;
+    if (slotsCount) {
+        APP_CHECK_CALL(memAllocator->Allocate(poolReqs, allocInfo, pagePool));
+    }
+
+    // Levels of the mip tail are bound as a whole and never evicted
+    if (mipTailLevel < header.levelsCount && colorReqs->imageMipTailSize) {
+        VkMemoryRequirements tailReqs = memoryReqs;
+        tailReqs.size       = colorReqs->imageMipTailSize;
+        allocInfo.dedicated = false;
+        APP_CHECK_CALL(memAllocator->Allocate(tailReqs, allocInfo, tailMemory));
+        tailBind.resourceOffset = colorReqs->imageMipTailOffset;
+        tailBind.size           = colorReqs->imageMipTailSize;
+        tailBind.memory         = tailMemory->memory;
+        tailBind.memoryOffset   = tailMemory->offset;
+        tailBind.flags          = 0;
+    }
+
+    supported = true;
+    return APP_CODE_OK;
+}
+
+AppResult VirtualTexture::CreateAtlasImage(const VkPhysicalDeviceLimits& limits, VkDeviceSize budget) {
+
+    uint32_t tileSize = streamer.GetHeader().tileSize;
+    pageMemorySize = VkDeviceSize(tileSize) * tileSize * TileStreamer::texelSize;
+
+    uint32_t maxSlotsSide = limits.maxImageDimension2D / tileSize;
+    slotsCount  = static_cast<uint32_t>(std::min<VkDeviceSize>(budget / pageMemorySize,
+                                                               VkDeviceSize(maxSlotsSide) * maxSlotsSide));
+    slotsCount  = std::min(slotsCount, maxAtlasSlots);
+    atlasSlotsX = std::max(std::min(slotsCount, maxSlotsSide), 1u);
+    uint32_t atlasSlotsY = std::max((slotsCount + atlasSlotsX - 1) / atlasSlotsX, 1u);
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType     = VK_IMAGE_TYPE_2D;
+    imageInfo.format        = textureFormat;
+    imageInfo.extent        = { atlasSlotsX * tileSize, atlasSlotsY * tileSize, 1 };
+    imageInfo.mipLevels     = 1;
+    imageInfo.arrayLayers   = 1;
+    imageInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage         = textureUsage;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    if (families.size() > 1) {
+        imageInfo.sharingMode           = VK_SHARING_MODE_CONCURRENT;
+        imageInfo.queueFamilyIndexCount = static_cast<uint32_t>(families.size());
+        imageInfo.pQueueFamilyIndices   = families.data();
+    } else {
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+
+    return memAllocator->CreateImage(imageInfo, MemoryAllocator::MemoryUsage::GpuOnly, image, imageMemory);
+}
+
+AppResult VirtualTexture::CreateResources() {
+
+    // Pinned pages below the mip tail take slots for the whole lifetime
+    const auto& levels = streamer.GetLevels();
+    uint32_t pinnedSlots = 0;
+    for (uint32_t level = pinnedLevel; level < mipTailLevel; ++level) {
+        pinnedSlots += levels[level].pagesX * levels[level].pagesY;
+    }
+    if (slotsCount < pinnedSlots + APP_VT_UPLOADS_PER_FRAME) {
+        PRINT_E("Virtual texture budget of %u pages is too small, at least %u pages are needed", slotsCount,
+                pinnedSlots + APP_VT_UPLOADS_PER_FRAME);
+        return APP_CODE_INVALID_ARGS;
+    }
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType                           = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image                           = image;
+    viewInfo.viewType                        = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format                          = textureFormat;
+    viewInfo.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.baseMipLevel   = 0;
+    viewInfo.subresourceRange.levelCount     = sparseQueue ? streamer.GetHeader().levelsCount : 1;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount     = 1;
+
+    VkResult r = vkCreateImageView(dev, &viewInfo, nullptr, &imageView);
+    if (r != VK_SUCCESS) {
+        PRINT_E("Failed to create virtual texture image view. Vk error code: %d", r);
+        return APP_CODE_VK_COMMAND_FAIURE;
+    }
+
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType        = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter    = VK_FILTER_LINEAR;
+    samplerInfo.minFilter    = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode   = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod       = VK_LOD_CLAMP_NONE;
+
+    r = vkCreateSampler(dev, &samplerInfo, nullptr, &sampler);
+    if (r != VK_SUCCESS) {
+        PRINT_E("Failed to create virtual texture sampler. Vk error code: %d", r);
+        return APP_CODE_VK_COMMAND_FAIURE;
+    }
+
+    textureIndex = bindlessTable->AddTexture(imageView, VK_IMAGE_LAYOUT_GENERAL);
+    samplerIndex = bindlessTable->AddSampler(sampler);
+
+    slotPages.assign(slotsCount, noPage);
+    lruPrev.assign(slotsCount, noSlot);
+    lruNext.assign(slotsCount, noSlot);
+    lruHead = lruTail = noSlot;
+    freeSlots.clear();
+    // Lower slots are taken first
+    for (uint32_t slot = slotsCount; slot > 0; --slot) {
+        freeSlots.push_back(slot - 1);
+    }
+
+    const auto& header = streamer.GetHeader();
+    pageTable.assign(tableHeaderSize + streamer.GetPagesCount(), 0);
+    pageTable[0] = header.levelsCount;
+    pageTable[1] = header.tileSize;
+    pageTable[2] = header.width;
+    pageTable[3] = header.height;
+    pageTable[4] = atlasSlotsX;
+    pageTable[5] = sparseQueue ? 1 : 0;
+    for (uint32_t level = 0; level < levels.size(); ++level) {
+        pageTable[8 + level * 4 + 0] = levels[level].firstPage;
+        pageTable[8 + level * 4 + 1] = levels[level].pagesX;
+        pageTable[8 + level * 4 + 2] = levels[level].pagesY;
+    }
+    tableVersion = 0;
+
+    frames.resize(framesInFlight);
+    for (auto& frame : frames) {
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size  = pageTable.size() * sizeof(uint32_t);
+        bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        // Uploaded by the transfer queue and read by the graphics one
+        if (families.size() > 1) {
+            bufferInfo.sharingMode           = VK_SHARING_MODE_CONCURRENT;
+            bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(families.size());
+            bufferInfo.pQueueFamilyIndices   = families.data();
+        } else {
+            bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        }
+        APP_CHECK_CALL(memAllocator->CreateBuffer(bufferInfo, MemoryAllocator::MemoryUsage::GpuOnly,
+                                                  frame.pageTable, frame.pageTableMemory));
+
+        // Written by GPU and read right from the mapping
+        bufferInfo.size                  = VkDeviceSize(streamer.GetPagesCount()) * sizeof(uint32_t);
+        bufferInfo.sharingMode           = VK_SHARING_MODE_EXCLUSIVE;
+        bufferInfo.queueFamilyIndexCount = 0;
+        bufferInfo.pQueueFamilyIndices   = nullptr;
+        APP_CHECK_CALL(memAllocator->CreateBuffer(bufferInfo, MemoryAllocator::MemoryUsage::GpuToCpu,
+                                                  frame.feedback, frame.feedbackMemory));
+
+        frame.pageTableIndex = bindlessTable->AddBuffer(frame.pageTable, 0, VK_WHOLE_SIZE);
+        frame.feedbackIndex  = bindlessTable->AddBuffer(frame.feedback, 0, VK_WHOLE_SIZE);
+        frame.tableVersion   = 0;
+        frame.recorded       = false;
+    }
+
+    if (textureIndex == BindlessTable::invalidIndex || samplerIndex == BindlessTable::invalidIndex ||
+        std::any_of(frames.begin(), frames.end(), [](const FrameResources& frame) {
+            return frame.pageTableIndex == BindlessTable::invalidIndex ||
+                   frame.feedbackIndex == BindlessTable::invalidIndex;
+        })) {
+        return APP_CODE_UNKNOWN;
+    }
+    return APP_CODE_OK;
+}
+
+AppResult VirtualTexture::RequestPipeline(PipelineFactory& factory) {
+
+    PipelineFactory::Key shader = 0;
+    APP_CHECK_CALL(factory.LoadShader("vt_feedback.comp", shader));
+
+    PipelineFactory::ComputeDesc desc;
+    desc.shader    = shader;
+    desc.layout    = bindlessTable->GetPipelineLayout();
+    desc.layoutKey = BindlessTable::pipelineLayoutKey;
+
+    // Compiled in background, frames don't report feedback until it is ready
+    pipelineFactory = &factory;
+    pipelineKey     = factory.RequestCompute(desc);
+    if (factory.GetState(pipelineKey) == PipelineFactory::State::Failed) {
+        return APP_CODE_VK_COMMAND_FAIURE;
+    }
+
+    return APP_CODE_OK;
+}
+
+AppResult VirtualTexture::MakeTailResident() {
+
+    std::vector<AsyncQueue::SyncPoint> waits;
+    if (sparseQueue && tailBind.size) {
+        VkSparseImageOpaqueMemoryBindInfo opaqueInfo{};
+        opaqueInfo.image     = image;
+        opaqueInfo.bindCount = 1;
+        opaqueInfo.pBinds    = &tailBind;
+        uint64_t value = 0;
+        APP_CHECK_CALL(sparseQueue->BindSparse({}, { opaqueInfo }, {}, value));
+        ++stats.bindCalls;
+        waits.push_back(sparseQueue->GetSyncPoint(value, VK_PIPELINE_STAGE_TRANSFER_BIT));
+    }
+
+    // The image stays in the general layout: pages are written by the transfer queue while others are sampled.
+    // Later uploads of the transfer queue are ordered after the transition by the barrier
+    auto record = [this](VkCommandBuffer cmd) {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask                   = 0;
+        barrier.dstAccessMask                   = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.oldLayout                       = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout                       = VK_IMAGE_LAYOUT_GENERAL;
+        barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image                           = image;
+        barrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel   = 0;
+        barrier.subresourceRange.levelCount     = VK_REMAINING_MIP_LEVELS;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount     = 1;
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                             0, nullptr, 0, nullptr, 1, &barrier);
+    };
+    uint64_t value = 0;
+    APP_CHECK_CALL(transferQueue->Submit(record, waits, value));
+
+    // Pages of the mip tail are in the bound tail memory, the others get slots like streamed ones
+    std::vector<uint32_t> pinnedPages;
+    for (uint32_t page = streamer.GetLevels()[pinnedLevel].firstPage; page < streamer.GetPagesCount(); ++page) {
+        auto& state = pageStates[page];
+        state.pinned   = true;
+        state.resident = true;
+        if (streamer.GetPage(page).level < mipTailLevel) {
+            state.slot = freeSlots.back();
+            freeSlots.pop_back();
+            slotPages[state.slot] = page;
+            BindPage(page, state.slot);
+        }
+        pinnedPages.push_back(page);
+    }
+    APP_CHECK_CALL(SubmitBinds());
+    for (auto page : pinnedPages) {
+        APP_CHECK_CALL(UploadPage(page, streamer.GetPageData(page)));
+    }
+
+    stats.pinnedPages   = static_cast<uint32_t>(pinnedPages.size());
+    stats.residentPages = stats.pinnedPages;
+    stats.peakResident  = stats.residentPages;
+    RebuildPageTable();
+    return APP_CODE_OK;
+}
+
+void VirtualTexture::BindPage(uint32_t page, uint32_t slot) {
+
+    if (!sparseQueue) {
+        return;
+    }
+    const auto& info = streamer.GetPage(page);
+    uint32_t tileSize = streamer.GetHeader().tileSize;
+
+    VkSparseImageMemoryBind bind{};
+    bind.subresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    bind.subresource.mipLevel   = info.level;
+    bind.subresource.arrayLayer = 0;
+    bind.offset                 = { static_cast<int32_t>(info.x * tileSize), static_cast<int32_t>(info.y * tileSize), 0 };
+    bind.extent                 = { info.width, info.height, 1 };
+    if (slot != noSlot) {
+        bind.memory       = pagePool->memory;
+        bind.memoryOffset = pagePool->offset + VkDeviceSize(slot) * pageMemorySize;
+        pendingBinds.push_back(bind);
+    } else {
+        bind.memory = VK_NULL_HANDLE;
+        pendingUnbinds.push_back(bind);
+    }
+    pageStates[page].boundSlot = slot;
+}
+
+AppResult VirtualTexture::UploadPage(uint32_t page, const uint8_t* data) {
+
+    const auto& info = streamer.GetPage(page);
+    uint32_t tileSize = streamer.GetHeader().tileSize;
+    uint32_t slot = pageStates[page].slot;
+
+    VkDeviceSize size = info.GetSize();
+    VkDeviceSize offset = 0;
+    void* mapped = stagingRing->Reserve(size, TileStreamer::texelSize, offset);
+    if (!mapped) {
+        return APP_CODE_UNKNOWN;
+    }
+    std::memcpy(mapped, data, static_cast<size_t>(size));
+
+    VkBufferImageCopy region{};
+    region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount     = 1;
+    region.imageExtent                     = { info.width, info.height, 1 };
+    if (sparseQueue) {
+        region.imageSubresource.mipLevel = info.level;
+        region.imageOffset = { static_cast<int32_t>(info.x * tileSize), static_cast<int32_t>(info.y * tileSize), 0 };
+    } else {
+        region.imageSubresource.mipLevel = 0;
+        region.imageOffset = { static_cast<int32_t>(slot % atlasSlotsX * tileSize),
+                               static_cast<int32_t>(slot / atlasSlotsX * tileSize), 0 };
+    }
+    stagingRing->CopyToImage(offset, size, image, region, VK_IMAGE_LAYOUT_GENERAL);
+    return APP_CODE_OK;
+}
+
+AppResult VirtualTexture::SubmitBinds() {
+
+    if (!sparseQueue || (pendingUnbinds.empty() && pendingBinds.empty())) {
+        return APP_CODE_OK;
+    }
+
+    uint64_t value = 0;
+    std::vector<AsyncQueue::SyncPoint> waits;
+    if (!pendingUnbinds.empty()) {
+        VkSparseImageMemoryBindInfo unbindInfo{};
+        unbindInfo.image     = image;
+        unbindInfo.bindCount = static_cast<uint32_t>(pendingUnbinds.size());
+        unbindInfo.pBinds    = pendingUnbinds.data();
+        APP_CHECK_CALL(sparseQueue->BindSparse({ unbindInfo }, {}, {}, value));
+        ++stats.bindCalls;
+        // Slots of the unbound pages are bound to the new ones only after that
+        waits.push_back(sparseQueue->GetSyncPoint(value, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
+    }
+    if (!pendingBinds.empty()) {
+        VkSparseImageMemoryBindInfo bindInfo{};
+        bindInfo.image     = image;
+        bindInfo.bindCount = static_cast<uint32_t>(pendingBinds.size());
+        bindInfo.pBinds    = pendingBinds.data();
+        APP_CHECK_CALL(sparseQueue->BindSparse({ bindInfo }, {}, waits, value));
+        ++stats.bindCalls;
+    }
+    // Uploads of the pages wait for their memory, frames wait for the uploads
+    stagingRing->AddWait(sparseQueue->GetSyncPoint(value, VK_PIPELINE_STAGE_TRANSFER_BIT));
+
+    pendingUnbinds.clear();
+    pendingBinds.clear();
+    return APP_CODE_OK;
+}
+
+AppResult VirtualTexture::BeginFrame(uint64_t frameNumber, uint32_t frameIndex, uint64_t completedFrames) {
+
+    auto& frame = frames[frameIndex];
+    if (frame.recorded) {
+        // The frame fence is waited, so the feedback is written
+        ReadFeedback(frame, frameNumber);
+        frame.recorded = false;
+    }
+
+    RecycleSlots(completedFrames);
+
+    std::vector<TileStreamer::Tile> loaded;
+    streamer.TakeLoaded(loaded, APP_VT_MAX_PENDING_PAGES);
+    for (auto& tile : loaded) {
+        waitingTiles.push_back(std::move(tile));
+    }
+    EvictPages(frameNumber);
+
+    // Slots are bound before any upload reserves the ring: a full ring flushes the copies early
+    std::vector<TileStreamer::Tile> placed;
+    while (!waitingTiles.empty() && !freeSlots.empty() && placed.size() < APP_VT_UPLOADS_PER_FRAME) {
+        auto tile = std::move(waitingTiles.front());
+        waitingTiles.pop_front();
+        --inFlightRequests;
+
+        auto& state = pageStates[tile.page];
+        state.pending  = false;
+        state.resident = true;
+        state.slot     = freeSlots.back();
+        freeSlots.pop_back();
+        slotPages[state.slot] = tile.page;
+        LruPushFront(state.slot);
+        BindPage(tile.page, state.slot);
+        placed.push_back(std::move(tile));
+    }
+    APP_CHECK_CALL(SubmitBinds());
+    for (auto& tile : placed) {
+        APP_CHECK_CALL(UploadPage(tile.page, tile.data.data()));
+        streamer.Recycle(std::move(tile.data));
+    }
+
+    if (!placed.empty()) {
+        stats.uploadedPages += placed.size();
+        stats.residentPages += static_cast<uint32_t>(placed.size());
+        stats.peakResident   = std::max(stats.peakResident, stats.residentPages);
+        tableDirty = true;
+    }
+    stats.waitingPages += waitingTiles.size();
+
+    if (tableDirty) {
+        RebuildPageTable();
+    }
+    return UploadPageTable(frame);
+}
+
+void VirtualTexture::ReadFeedback(FrameResources& frame, uint64_t frameNumber) {
+
+    const auto* requested = static_cast<const uint32_t*>(frame.feedbackMemory->mapped);
+    std::vector<uint32_t> missing;
+    uint32_t requestedCount = 0;
+    for (uint32_t page = 0; page < streamer.GetPagesCount(); ++page) {
+        if (!requested[page]) {
+            continue;
+        }
+        ++requestedCount;
+        Touch(page, frameNumber);
+        const auto& state = pageStates[page];
+        if (!state.resident && !state.pending) {
+            missing.push_back(page);
+        }
+    }
+
+    // Coarse pages first: they cover more of the screen and are the fallback of the fine ones
+    std::stable_sort(missing.begin(), missing.end(), [this](uint32_t a, uint32_t b) {
+        return streamer.GetPage(a).level > streamer.GetPage(b).level;
+    });
+    for (auto page : missing) {
+        if (inFlightRequests >= APP_VT_MAX_PENDING_PAGES) {
+            break;
+        }
+        pageStates[page].pending = true;
+        ++inFlightRequests;
+        streamer.Request(page);
+    }
+
+    ++stats.feedbackFrames;
+    stats.requestedPages += requestedCount;
+    stats.lastRequested   = requestedCount;
+}
+
+void VirtualTexture::Touch(uint32_t page, uint64_t frameNumber) {
+
+    const auto& levels = streamer.GetLevels();
+    for (;;) {
+        auto& state = pageStates[page];
+        if (state.lastUsed == frameNumber) {
+            // Ancestors are touched already
+            return;
+        }
+        state.lastUsed = frameNumber;
+        if (state.resident && !state.pinned) {
+            LruRemove(state.slot);
+            LruPushFront(state.slot);
+        }
+
+        const auto& info = streamer.GetPage(page);
+        if (info.level + 1 >= levels.size()) {
+            return;
+        }
+        const auto& parent = levels[info.level + 1];
+        page = parent.firstPage + std::min(info.y / 2, parent.pagesY - 1) * parent.pagesX +
+               std::min(info.x / 2, parent.pagesX - 1);
+    }
+}
+
+void VirtualTexture::RecycleSlots(uint64_t completedFrames) {
+
+    while (!retiredSlots.empty() && retiredSlots.front().frame < completedFrames) {
+        const auto& retired = retiredSlots.front();
+        // Reloaded pages are bound to their new slots already
+        if (pageStates[retired.page].boundSlot == retired.slot) {
+            BindPage(retired.page, noSlot);
+        }
+        freeSlots.push_back(retired.slot);
+        retiredSlots.pop_front();
+    }
+}
+
+void VirtualTexture::EvictPages(uint64_t frameNumber) {
+
+    // Pages used by the frames whose feedback may not be read yet are kept
+    size_t needed = std::min<size_t>(waitingTiles.size(), APP_VT_UPLOADS_PER_FRAME);
+    while (freeSlots.size() + retiredSlots.size() < needed && lruTail != noSlot) {
+        uint32_t slot = lruTail;
+        uint32_t page = slotPages[slot];
+        auto& state = pageStates[page];
+        if (state.lastUsed + framesInFlight >= frameNumber) {
+            // The working set exceeds the budget, waiting pages get slots when it shrinks
+            return;
+        }
+
+        LruRemove(slot);
+        state.resident = false;
+        state.slot     = noSlot;
+        slotPages[slot] = noPage;
+        retiredSlots.push_back({ slot, page, frameNumber });
+        --stats.residentPages;
+        ++stats.evictions;
+        tableDirty = true;
+    }
+}
+
+void VirtualTexture::RebuildPageTable() {
+
+    // Coarse to fine: a missing page takes the entry of its parent
+    const auto& levels = streamer.GetLevels();
+    for (uint32_t level = static_cast<uint32_t>(levels.size()); level-- > 0;) {
+        const auto& info = levels[level];
+        for (uint32_t y = 0; y < info.pagesY; ++y) {
+            for (uint32_t x = 0; x < info.pagesX; ++x) {
+                uint32_t page = info.firstPage + y * info.pagesX + x;
+                const auto& state = pageStates[page];
+                uint32_t entry = 0;
+                if (state.resident) {
+                    entry = entryValid | (level << entryLevelShift) | (state.slot == noSlot ? 0 : state.slot);
+                } else if (level + 1 < levels.size()) {
+                    const auto& parent = levels[level + 1];
+                    uint32_t parentPage = parent.firstPage + std::min(y / 2, parent.pagesY - 1) * parent.pagesX +
+                                          std::min(x / 2, parent.pagesX - 1);
+                    entry = pageTable[tableHeaderSize + parentPage];
+                }
+                pageTable[tableHeaderSize + page] = entry;
+            }
+        }
+    }
+    ++tableVersion;
+    tableDirty = false;
+}
+
+AppResult VirtualTexture::UploadPageTable(FrameResources& frame) {
+
+    if (frame.tableVersion == tableVersion) {
+        return APP_CODE_OK;
+    }
+    VkDeviceSize size = pageTable.size() * sizeof(uint32_t);
+    VkDeviceSize offset = 0;
+    void* mapped = stagingRing->Reserve(size, sizeof(uint32_t), offset);
+    if (!mapped) {
+        return APP_CODE_UNKNOWN;
+    }
+    std::memcpy(mapped, pageTable.data(), static_cast<size_t>(size));
+    stagingRing->CopyToBuffer(offset, size, frame.pageTable, 0);
+    frame.tableVersion = tableVersion;
+    return APP_CODE_OK;
+}
+
+bool VirtualTexture::RecordFeedback(VkCommandBuffer cmd, uint32_t frameIndex, const glm::mat4& viewProj,
+                                    const glm::vec3& eye, float planeSize, VkExtent2D viewport) {
+
+    VkPipeline pipeline = pipelineFactory->GetPipeline(pipelineKey);
+    if (pipeline == VK_NULL_HANDLE) {
+        ++stats.skippedFrames;
+        return false;
+    }
+
+    auto& frame = frames[frameIndex];
+
+    vkCmdFillBuffer(cmd, frame.feedback, 0, VK_WHOLE_SIZE, 0);
+
+    VkMemoryBarrier barrier{};
+    barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                         1, &barrier, 0, nullptr, 0, nullptr);
+
+    FeedbackParams params{};
+    params.invViewProj    = glm::inverse(viewProj);
+    params.eye            = glm::vec4(eye, planeSize);
+    params.gridWidth      = std::max(viewport.width / APP_VT_FEEDBACK_CELL, 1u);
+    params.gridHeight     = std::max(viewport.height / APP_VT_FEEDBACK_CELL, 1u);
+    params.cellPixels     = static_cast<float>(APP_VT_FEEDBACK_CELL);
+    params.pageTableIndex = frame.pageTableIndex;
+    params.feedbackIndex  = frame.feedbackIndex;
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+    bindlessTable->Bind(cmd, VK_PIPELINE_BIND_POINT_COMPUTE);
+    vkCmdPushConstants(cmd, bindlessTable->GetPipelineLayout(), VK_SHADER_STAGE_ALL, 0, sizeof(params), &params);
+    vkCmdDispatch(cmd, std::min((params.gridWidth + feedbackGroupSize - 1) / feedbackGroupSize, maxWorkGroups[0]),
+                  std::min((params.gridHeight + feedbackGroupSize - 1) / feedbackGroupSize, maxWorkGroups[1]), 1);
+
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+                         1, &barrier, 0, nullptr, 0, nullptr);
+
+    frame.recorded = true;
+    return true;
+}
+
+void VirtualTexture::LruPushFront(uint32_t slot) {
+    lruPrev[slot] = noSlot;
+    lruNext[slot] = lruHead;
+    if (lruHead != noSlot) {
+        lruPrev[lruHead] = slot;
+    }
+    lruHead = slot;
+    if (lruTail == noSlot) {
+        lruTail = slot;
+    }
+}
+
+void VirtualTexture::LruRemove(uint32_t slot) {
+    if (lruPrev[slot] != noSlot) {
+        lruNext[lruPrev[slot]] = lruNext[slot];
+    } else {
+        lruHead = lruNext[slot];
+    }
+    if (lruNext[slot] != noSlot) {
+        lruPrev[lruNext[slot]] = lruPrev[slot];
+    } else {
+        lruTail = lruPrev[slot];
+    }
+    lruPrev[slot] = lruNext[slot] = noSlot;
+}
+
+void VirtualTexture::PrintStats() const {
+    if (dev == VK_NULL_HANDLE) {
+        return;
+    }
+    auto loader = streamer.GetStats();
+    PRINT("Virtual texture (%s): %u pages resident at the end, %u at peak, %u pinned, %u page slots",
+          sparseQueue ? "sparse" : "atlas", stats.residentPages, stats.peakResident, stats.pinnedPages, slotsCount);
+    PRINT("Virtual texture: %llu feedback frames, %.1f pages requested per frame, %llu uploaded, %llu evicted, "
+          "%llu sparse bind calls", static_cast<unsigned long long>(stats.feedbackFrames),
+          stats.feedbackFrames ? static_cast<double>(stats.requestedPages) / stats.feedbackFrames : 0.0,
+          static_cast<unsigned long long>(stats.uploadedPages), static_cast<unsigned long long>(stats.evictions),
+          static_cast<unsigned long long>(stats.bindCalls));
+    PRINT("Virtual texture loader: %llu tiles, %.1f MiB read in %.3f ms, %.1f pages waited for slots per frame",
+          static_cast<unsigned long long>(loader.loadedTiles), loader.loadedBytes / (1024.0 * 1024.0),
+          loader.loadTime, stats.feedbackFrames ? static_cast<double>(stats.waitingPages) / stats.feedbackFrames : 0.0);
+    if (stats.skippedFrames) {
+        PRINT("Virtual texture feedback skipped %llu frames while the pipeline was compiling",
+              static_cast<unsigned long long>(stats.skippedFrames));
+    }
+}
+
+void VirtualTexture::Clear() {
+    if (dev == VK_NULL_HANDLE) {
+        return;
+    }
+
+    streamer.Close();
+
+    auto release = [this](BindlessTable::Kind kind, uint32_t& index) {
+        if (index != BindlessTable::invalidIndex) {
+            bindlessTable->Release(kind, index);
+            index = BindlessTable::invalidIndex;
+        }
+    };
+
+    for (auto& frame : frames) {
+        release(BindlessTable::Kind::Buffer, frame.pageTableIndex);
+        release(BindlessTable::Kind::Buffer, frame.feedbackIndex);
+        if (frame.pageTable != VK_NULL_HANDLE) {
+            memAllocator->DestroyBuffer(frame.pageTable, frame.pageTableMemory);
+        }
+        if (frame.feedback != VK_NULL_HANDLE) {
+            memAllocator->DestroyBuffer(frame.feedback, frame.feedbackMemory);
+        }
+    }
+    release(BindlessTable::Kind::Texture, textureIndex);
+    release(BindlessTable::Kind::Sampler, samplerIndex);
+    if (sampler != VK_NULL_HANDLE) {
+        vkDestroySampler(dev, sampler, nullptr);
+    }
+    if (imageView != VK_NULL_HANDLE) {
+        vkDestroyImageView(dev, imageView, nullptr);
+    }
+    // Sparse image memory is bound by the queue, not by the allocator
+    if (imageMemory) {
+        memAllocator->DestroyImage(image, imageMemory);
+    } else if (image != VK_NULL_HANDLE) {
+        vkDestroyImage(dev, image, nullptr);
+    }
+    if (pagePool) {
+        memAllocator->Free(pagePool);
+    }
+    if (tailMemory) {
+        memAllocator->Free(tailMemory);
+    }
+
+    frames.clear();
+    pageStates.clear();
+    slotPages.clear();
+    freeSlots.clear();
+    retiredSlots.clear();
+    lruPrev.clear();
+    lruNext.clear();
+    waitingTiles.clear();
+    pendingUnbinds.clear();
+    pendingBinds.clear();
+    pageTable.clear();
+    lruHead          = lruTail = noSlot;
+    inFlightRequests = 0;
+    tailBind         = {};
+    image            = VK_NULL_HANDLE;
+    imageMemory      = nullptr;
+    imageView        = VK_NULL_HANDLE;
+    sampler          = VK_NULL_HANDLE;
+    pagePool         = nullptr;
+    tailMemory       = nullptr;
+    sparseQueue      = nullptr;
+    pipelineFactory  = nullptr;
+    pipelineKey      = 0;
+    slotsCount       = 0;
+    dev              = VK_NULL_HANDLE;
+}
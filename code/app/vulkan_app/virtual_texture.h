@@ -0,0 +1,281 @@
+#pragma once
+
+#include <app_result.h>
+#include <vulkan_app/async_queue.h>
+#include <vulkan_app/bindless_table.h>
+#include <vulkan_app/memory_allocator.h>
+#include <vulkan_app/pipeline_factory.h>
+#include <vulkan_app/staging_ring.h>
+#include <vulkan_app/tile_streamer.h>
+#include <vulkan_app/vk_base.h>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+/**
+ * @brief
+ * Streamed texture larger than the memory budget. Only the pages GPU asks for are resident:
+ * a feedback pass writes the pages the frame needs, they are loaded from disk in background,
+ * uploaded through the staging ring and replace the least recently used ones when the budget is full.
+ * With sparse residency the pages are bound to a sparse image with vkQueueBindSparse and the mip tail
+ * stays bound. Otherwise they are copied into slots of an atlas image.
+ * Either way a page table per frame in flight maps every page to the finest resident level covering it,
+ * shaders clamp the LOD (sparse) or remap the coordinates (atlas) with it
+*/
+class VirtualTexture {
+
+public:
+
+    struct Stats {
+        uint64_t feedbackFrames  = 0;
+        // Pages requested by the feedback, summed over frames
+        uint64_t requestedPages  = 0;
+        uint32_t lastRequested   = 0;
+        uint64_t uploadedPages   = 0;
+        uint64_t evictions       = 0;
+        uint64_t bindCalls       = 0;
+        // Loaded pages waiting for a free slot at the frames' start
+        uint64_t waitingPages    = 0;
+        uint32_t residentPages   = 0;
+        uint32_t peakResident    = 0;
+        uint32_t pinnedPages     = 0;
+        // Frames not reporting feedback while the pipeline was compiling
+        uint64_t skippedFrames   = 0;
+    };
+
+    VirtualTexture() = default;
+    VirtualTexture(const VirtualTexture&) = delete;
+
+    /**
+     * @brief
+     * Open the texture file, create the image and the page tables and make the coarsest levels resident
+     * @param physicalDevice
+     * GPU the texture is created on
+     * @param device
+     * logical device
+     * @param limits
+     * physical device limits
+     * @param queueFamilies
+     * families accessing the texture. Graphics and transfer ones
+     * @param allocator
+     * device memory allocator
+     * @param staging
+     * staging ring uploading the pages
+     * @param transfer
+     * queue of the staging ring
+     * @param sparse
+     * queue binding the sparse memory or nullptr to use the atlas
+     * @param factory
+     * pipeline factory compiling the feedback pipeline
+     * @param bindless
+     * bindless table indexing the image and the buffers
+     * @param framesCount
+     * count of the page tables and feedback buffers, frames in flight
+     * @param path
+     * texture file path
+     * @param budget
+     * device memory for the pages, bytes
+     * @return
+     * AppResult code
+    */
+    AppResult Init(VkPhysicalDevice physicalDevice, VkDevice device, const VkPhysicalDeviceLimits& limits,
+                   const std::vector<uint32_t>& queueFamilies, MemoryAllocator& allocator, StagingRing& staging,
+                   AsyncQueue& transfer, AsyncQueue* sparse, PipelineFactory& factory, BindlessTable& bindless,
+                   uint32_t framesCount, const char* path, VkDeviceSize budget);
+    void Clear();
+
+    /**
+     * @brief
+     * Read the feedback of the frame finished by GPU, request the missing pages and make the loaded ones
+     * resident. Uploads go to the staging ring, the frame must wait for its flush.
+     * Call after the frame resources are acquired
+     * @param frameNumber
+     * number of the frame being recorded
+     * @param frameIndex
+     * index of the frame resources
+     * @param completedFrames
+     * count of frames completed by GPU
+     * @return
+     * AppResult code
+    */
+    AppResult BeginFrame(uint64_t frameNumber, uint32_t frameIndex, uint64_t completedFrames);
+    /**
+     * @brief
+     * Record the feedback pass: a ground plane textured with the virtual texture seen by the camera
+     * @param cmd
+     * frame command buffer
+     * @param frameIndex
+     * index of the frame resources
+     * @param viewProj
+     * camera view projection matrix
+     * @param eye
+     * camera position
+     * @param planeSize
+     * side of the square plane at y = 0 the texture is mapped to
+     * @param viewport
+     * size of the rendered image
+     * @return
+     * false if the pipeline is still compiling and nothing is recorded
+    */
+    bool RecordFeedback(VkCommandBuffer cmd, uint32_t frameIndex, const glm::mat4& viewProj, const glm::vec3& eye,
+                        float planeSize, VkExtent2D viewport);
+
+    bool IsSparse() const { return sparseQueue != nullptr; }
+    // Bindless indices for shaders sampling with virtual_texture.glsl
+    uint32_t GetTextureIndex() const { return textureIndex; }
+    uint32_t GetSamplerIndex() const { return samplerIndex; }
+    uint32_t GetPageTableIndex(uint32_t frameIndex) const { return frames[frameIndex].pageTableIndex; }
+
+    const Stats& GetStats() const { return stats; }
+    void PrintStats() const;
+
+private:
+
+    static constexpr uint32_t noSlot = ~0u;
+    static constexpr uint32_t noPage = ~0u;
+    // Page table entry: 0-23 bits are the atlas slot, 24-27 bits are the resident level
+    static constexpr uint32_t entryValid      = 1u << 31;
+    static constexpr uint32_t entryLevelShift = 24;
+    // Page table header: levelsCount, tileSize, width, height, atlasSlotsX, sparse, 2 paddings
+    // and firstPage, pagesX, pagesY, padding of every level
+    static constexpr uint32_t tableHeaderSize = 8 + TileStreamer::maxLevels * 4;
+
+    struct PageState {
+        uint32_t slot = noSlot;
+        // Slot whose memory is bound to the page region. Stays bound after eviction until the slot is released
+        uint32_t boundSlot = noSlot;
+        // Last frame the feedback asked for the page or its descendants
+        uint64_t lastUsed = 0;
+        // Requested from the loader or waiting for a slot
+        bool pending = false;
+        bool resident = false;
+        // Coarsest levels are always resident
+        bool pinned = false;
+    };
+
+    // Evicted slot maybe still sampled by frames in flight
+    struct RetiredSlot {
+        uint32_t slot;
+        uint32_t page;
+        // Frames with this number and smaller may use the slot
+        uint64_t frame;
+    };
+
+    // Matches FeedbackParams of vt_feedback.comp
+    struct FeedbackParams {
+        glm::mat4 invViewProj;
+        // xyz is the camera position, w is the plane side
+        glm::vec4 eye;
+        uint32_t gridWidth;
+        uint32_t gridHeight;
+        // Screen pixels per feedback cell side
+        float cellPixels;
+        uint32_t pageTableIndex;
+        uint32_t feedbackIndex;
+    };
+    static_assert(sizeof(FeedbackParams) <= BindlessTable::pushConstantsSize, "FeedbackParams exceed the push constants");
+
+    struct FrameResources {
+        VkBuffer pageTable = VK_NULL_HANDLE;
+        MemoryAllocation* pageTableMemory = nullptr;
+        uint32_t pageTableIndex = BindlessTable::invalidIndex;
+        uint64_t tableVersion = 0;
+        // One uint per page written by the feedback pass
+        VkBuffer feedback = VK_NULL_HANDLE;
+        MemoryAllocation* feedbackMemory = nullptr;
+        uint32_t feedbackIndex = BindlessTable::invalidIndex;
+        bool recorded = false;
+    };
+
+    AppResult CreateSparseImage(VkPhysicalDevice physicalDevice, VkDeviceSize budget, bool& supported);
+    AppResult CreateAtlasImage(const VkPhysicalDeviceLimits& limits, VkDeviceSize budget);
+    AppResult CreateResources();
+    AppResult RequestPipeline(PipelineFactory& factory);
+    // Bind and upload the coarsest levels before the first frame
+    AppResult MakeTailResident();
+
+    // Mark the feedback pages and their resident ancestors used, request the missing ones
+    void ReadFeedback(FrameResources& frame, uint64_t frameNumber);
+    void Touch(uint32_t page, uint64_t frameNumber);
+    // Free the slots of evicted pages no frame in flight uses. Sparse pages are unbound
+    void RecycleSlots(uint64_t completedFrames);
+    // Evict least recently used pages until enough slots are free or being released
+    void EvictPages(uint64_t frameNumber);
+    // Queue a bind of the slot memory to the page region. noSlot unbinds it. No-op for the atlas
+    void BindPage(uint32_t page, uint32_t slot);
+    // Copy the page texels to its region or atlas slot through the staging ring
+    AppResult UploadPage(uint32_t page, const uint8_t* data);
+    // Submit the queued unbinds, then the binds. The next staging batches wait for them
+    AppResult SubmitBinds();
+    void RebuildPageTable();
+    AppResult UploadPageTable(FrameResources& frame);
+
+    void LruPushFront(uint32_t slot);
+    void LruRemove(uint32_t slot);
+
+private:
+
+    VkDevice dev = VK_NULL_HANDLE;
+    MemoryAllocator* memAllocator = nullptr;
+    StagingRing* stagingRing = nullptr;
+    AsyncQueue* transferQueue = nullptr;
+    AsyncQueue* sparseQueue = nullptr;
+    BindlessTable* bindlessTable = nullptr;
+    std::vector<uint32_t> families;
+
+    PipelineFactory* pipelineFactory = nullptr;
+    PipelineFactory::Key pipelineKey = 0;
+
+    TileStreamer streamer;
+    std::vector<PageState> pageStates;
+    // Levels from this one are pinned
+    uint32_t pinnedLevel = 0;
+    // Levels from this one are in the sparse mip tail. Count of levels for the atlas
+    uint32_t mipTailLevel = 0;
+
+    VkImage image = VK_NULL_HANDLE;
+    // Atlas image memory
+    MemoryAllocation* imageMemory = nullptr;
+    VkImageView imageView = VK_NULL_HANDLE;
+    VkSampler sampler = VK_NULL_HANDLE;
+    uint32_t textureIndex = BindlessTable::invalidIndex;
+    uint32_t samplerIndex = BindlessTable::invalidIndex;
+    uint32_t atlasSlotsX = 0;
+
+    // Sparse pages share one allocation split into slots of pageMemorySize bytes
+    MemoryAllocation* pagePool = nullptr;
+    VkDeviceSize pageMemorySize = 0;
+    MemoryAllocation* tailMemory = nullptr;
+    VkSparseMemoryBind tailBind{};
+
+    uint32_t slotsCount = 0;
+    std::vector<uint32_t> slotPages;
+    std::vector<uint32_t> freeSlots;
+    std::deque<RetiredSlot> retiredSlots;
+    // Doubly linked LRU list of the slots of evictable resident pages, the head is the most recent
+    std::vector<uint32_t> lruPrev;
+    std::vector<uint32_t> lruNext;
+    uint32_t lruHead = noSlot;
+    uint32_t lruTail = noSlot;
+
+    // Loaded pages waiting for a slot
+    std::deque<TileStreamer::Tile> waitingTiles;
+    uint32_t inFlightRequests = 0;
+    std::vector<VkSparseImageMemoryBind> pendingUnbinds;
+    std::vector<VkSparseImageMemoryBind> pendingBinds;
+
+    std::vector<uint32_t> pageTable;
+    uint64_t tableVersion = 0;
+    bool tableDirty = false;
+
+    std::vector<FrameResources> frames;
+    uint32_t maxWorkGroups[2] = {};
+    uint64_t framesInFlight = 0;
+
+    Stats stats;
+};
@@ -1,14 +1,130 @@
 #include <vulkan_app/vulkan_app.h>
 #include <app_consts.h>
+#include <scene/mesh_builder.h>
+#include <utils/bench_stats.h>
+#include <utils/temp_path.h>
+#include <vulkan_app/pipeline_cache_benchmark.h>
+#include <vulkan_app/record_benchmark.h>
+
+#include <glm/gtc/matrix_transform.hpp>
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <future>
 #include <map>
+#include <string>
 #include <string_view>
 
+namespace {
+
+// 8-4-4-4-12 hex digits like the drivers' tools print it
+std::string FormatUUID(const uint8_t (&uuid)[VK_UUID_SIZE]) {
+    std::string str;
+    char byte[3];
+    for (uint32_t i = 0; i < VK_UUID_SIZE; ++i) {
+        if (i == 4 || i == 6 || i == 8 || i == 10) {
+            str += '-';
+        }
+        std::snprintf(byte, sizeof(byte), "%02x", uuid[i]);
+        str += byte;
+    }
+    return str;
+}
+
+// Dashes are optional
+bool ParseUUID(std::string_view str, uint8_t (&uuid)[VK_UUID_SIZE]) {
+    uint32_t digits = 0;
+    for (char c : str) {
+        if (c == '-') {
+            continue;
+        }
+        int value = (c >= '0' && c <= '9') ? c - '0'
+                  : (c >= 'a' && c <= 'f') ? c - 'a' + 10
+                  : (c >= 'A' && c <= 'F') ? c - 'A' + 10
+                  : -1;
+        if (value < 0 || digits >= VK_UUID_SIZE * 2) {
+            return false;
+        }
+        uuid[digits / 2] = static_cast<uint8_t>((digits % 2) ? (uuid[digits / 2] << 4) | value : value);
+        ++digits;
+    }
+    return digits == VK_UUID_SIZE * 2;
+}
+
+const char* DeviceTypeName(VkPhysicalDeviceType type) {
+    switch (type) {
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+        return "discrete";
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+        return "integrated";
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+        return "virtual";
+    case VK_PHYSICAL_DEVICE_TYPE_CPU:
+        return "cpu";
+    default:
+        return "uncknown-type";
+    }
+}
+
+/**
+ * @brief
+ * Fill a cubic grid of unit cubes for the GPU culling stress test
+ * @return
+ * radius of the sphere enclosing the grid
+*/
+float BuildCullingScene(uint32_t count, std::vector<GpuCuller::Instance>& instances,
+                        std::vector<GpuCuller::Mesh>& meshes) {
+
+    constexpr float spacing = 3.0f;
+    uint32_t side = static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<double>(count))));
+    float offset = (side - 1) * spacing * 0.5f;
+
+    instances.resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        glm::vec3 position(static_cast<float>(i % side), static_cast<float>(i / side % side),
+                           static_cast<float>(i / (side * side)));
+        auto& instance = instances[i];
+        instance.model          = glm::translate(glm::mat4(1.0f), position * spacing - glm::vec3(offset));
+        instance.boundingSphere = glm::vec4(0.0f, 0.0f, 0.0f, 0.87f);
+        instance.mesh           = 0;
+    }
+
+    // Cube of 12 triangles
+    meshes.assign(1, GpuCuller::Mesh{ 36, 0, 0, 0 });
+
+    return offset * 1.8f + spacing;
+}
+
+// Async queues and the staging ring are synchronized with timeline semaphores
+void RequestTimelineFeatures(FeatureSet& features) {
+    features.features12.timelineSemaphore = VK_TRUE;
+}
+
+// Bindless table: partially bound runtime arrays updated while bound
+void RequestBindlessFeatures(FeatureSet& features) {
+    features.features.features.shaderStorageBufferArrayDynamicIndexing = VK_TRUE;
+    auto& features12 = features.features12;
+    features12.descriptorIndexing                            = VK_TRUE;
+    features12.runtimeDescriptorArray                        = VK_TRUE;
+    features12.descriptorBindingPartiallyBound               = VK_TRUE;
+    features12.descriptorBindingUpdateUnusedWhilePending     = VK_TRUE;
+    features12.descriptorBindingSampledImageUpdateAfterBind  = VK_TRUE;
+    features12.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    features12.shaderSampledImageArrayNonUniformIndexing     = VK_TRUE;
+    features12.shaderStorageBufferArrayNonUniformIndexing    = VK_TRUE;
+}
+
+} // namespace
+
 VulkanApp::VulkanApp() {
     requiredParams.instanseExtensions = {};
     requiredParams.deviceExtensions = {};
-    requiredParams.deviceFeatures.geometryShader = true;
+    requiredParams.deviceFeatures.features.features.geometryShader = VK_TRUE;
+    // Timeline semaphores and descriptor indexing are enabled by CreateLogicalDevice for the options using them
     requiredParams.validationLayers.reserve(vulkanValidationLayers.size());
     for (auto layer : vulkanValidationLayers) {
         requiredParams.validationLayers.push_back(layer);
@@ -21,13 +137,48 @@ VulkanApp::~VulkanApp() {
 
 AppResult VulkanApp::Init() {
 
+    if (!options.profilePath.empty()) {
+        Profiler::Inst().StartCapture(APP_PROFILER_CAPTURE_EVENTS);
+    }
+
+    auto startupStart = std::chrono::steady_clock::now();
+
     // Create Vk instanse
     APP_CHECK_CALL(CreateVkInstance());
     setupDebugMessenger();
+    // The surface is needed to choose a GPU able to present
+    if (!options.headless) {
+        APP_CHECK_CALL(CreateSurface(vkInst, surface));
+    }
     // Find physical device
     APP_CHECK_CALL(FindPhysicalDevice());
+    PRINT("Vulkan instanse created and GPU chosen in %.3f ms",
+          std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startupStart).count());
     // Create logical device
     APP_CHECK_CALL(CreateLogicalDevice());
+    APP_CHECK_CALL(memoryAllocator.Init(dev, physDevInfo.memoryProps, physDevInfo.properties.limits));
+    APP_CHECK_CALL(frameScheduler.Init(dev, physDevInfo.familiesIndicies.graphics.value(), options.framesInFlight));
+    APP_CHECK_CALL(gpuProfiler.Init(dev, physDevInfo.properties,
+                                    physDevInfo.familiesProps[physDevInfo.familiesIndicies.graphics.value()].timestampValidBits,
+                                    frameScheduler.GetFramesInFlight()));
+    APP_CHECK_CALL(commandRecorder.Init(dev, physDevInfo.familiesIndicies.graphics.value(),
+                                        frameScheduler.GetFramesInFlight(), options.recordThreads));
+    jobSystem.Init(options.jobThreads);
+    if (timelineSemaphores) {
+        APP_CHECK_CALL(stagingRing.Init(dev, memoryAllocator, transferQueue, APP_STAGING_RING_SIZE,
+                                        physDevInfo.properties.limits.optimalBufferCopyOffsetAlignment));
+    }
+    APP_CHECK_CALL(pipelineCache.Init(dev, physDevInfo.properties, options.pipelineCachePath));
+    APP_CHECK_CALL(pipelineFactory.Init(dev, pipelineCache, options.pipelineThreads));
+    if (descriptorIndexing) {
+        APP_CHECK_CALL(bindlessTable.Init(physDev, dev, frameScheduler.GetFramesInFlight()));
+    }
+
+    if (options.headless) {
+        APP_CHECK_CALL(InitHeadless());
+    } else {
+        APP_CHECK_CALL(InitWindowed());
+    }
 
     return APP_CODE_OK;
 }
@@ -40,7 +191,10 @@ AppResult VulkanApp::CreateVkInstance() {
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName        = "No Engine";
     appInfo.engineVersion      = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion         = VK_API_VERSION_1_0;
+    appInfo.apiVersion         = APP_VK_API_VERSION;
+
+    // Instance extensions and layers are enumerated once and looked up by hash later
+    APP_CHECK_CALL(capabilities.Init());
 
     // Get required instance layers
 #if VALIDATION_LAYERS_ENABLED
@@ -67,8 +221,9 @@ AppResult VulkanApp::CreateVkInstance() {
 #endif
 
     // Get required Vk extensions
+    requiredParams.instanseExtensions.clear();
+    if (!options.headless) {
 #if defined(WIN32) || defined(LINUX) || defined(MAC_OS)
-    {
         uint32_t extensionCount = 0;
         glfwGetRequiredInstanceExtensions(&extensionCount);
         const char** glfwExts = glfwGetRequiredInstanceExtensions(&extensionCount);
@@ -79,13 +234,13 @@ AppResult VulkanApp::CreateVkInstance() {
 #if defined(MAC_OS)
         extensions.push_back("VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME");
 #endif
-#if VALIDATION_LAYERS_ENABLED
-        requiredParams.instanseExtensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+#else
+        PRINT_E("Your OS is not supported yet");
+        return APP_CODE_UNSUPPORTED_OS;
 #endif
     }
-#else
-    PRINT_E("Your OS is not supported yet");
-    return APP_CODE_UNSUPPORTED_OS;
+#if VALIDATION_LAYERS_ENABLED
+    requiredParams.instanseExtensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 #endif
 
     // Check for instance extensions support
@@ -140,75 +295,250 @@ AppResult VulkanApp::CreateVkInstance() {
 AppResult VulkanApp::FindPhysicalDevice() {
 
     PhysDevList devices;
-    GetPhysicalDevicesInfos(devices);
+    APP_CHECK_CALL(GetPhysicalDevicesInfos(devices));
+    for (const auto& d : devices) {
+        PRINT("Found %s GPU \"%s\", UUID %s", DeviceTypeName(d.second.properties.deviceType),
+              d.second.properties.deviceName, FormatUUID(d.second.idProps.deviceUUID).c_str());
+    }
+
+    // Presentation needs the swapchain, headless rendering needs no extensions
+    requiredParams.deviceExtensions.clear();
+    if (!options.headless) {
+        requiredParams.deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    }
 
     // Filter appropriate devices
     std::vector<VkPhysicalDevice> unsuitableDevices;
-    requiredParams.deviceFeatures.geometryShader = true;
     CheckSuitablePhysDevices(devices, unsuitableDevices);
     for (auto device : unsuitableDevices) {
         devices.erase(device);
     }
 
-    // Prefer to use more or less efficient GPU
-    for (auto d : devices) {
-        if (d.second.properties.deviceType == 
-#if POWER_SAVE
-            VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU
-#else
-            VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU
-#endif
-        ) {
-            physDev = d.first;
+    if (devices.empty()) {
+        PRINT_E("None of your GPUs is appropriate. You must buy an expensive cool adapter");
+        return APP_CODE_VK_INIT_FAIURE;
+    }
+
+    if (!options.deviceUUID.empty()) {
+        // Pinned device
+        uint8_t uuid[VK_UUID_SIZE]{};
+        if (!ParseUUID(options.deviceUUID, uuid)) {
+            PRINT_E("Invalid GPU UUID: \"%s\"", options.deviceUUID.c_str());
+            return APP_CODE_INVALID_ARGS;
+        }
+        for (const auto& d : devices) {
+            if (std::memcmp(d.second.idProps.deviceUUID, uuid, VK_UUID_SIZE) == 0) {
+                physDev = d.first;
+                break;
+            }
+        }
+        if (physDev == VK_NULL_HANDLE) {
+            PRINT_E("GPU with UUID %s is not found or is not appropriate", options.deviceUUID.c_str());
+            return APP_CODE_VK_INIT_FAIURE;
+        }
+    } else {
+        double bestScore = 0.0;
+        for (const auto& d : devices) {
+            double score = ScorePhysDevice(d.second);
+            PRINT("GPU \"%s\" score: %.1f", d.second.properties.deviceName, score);
+            if (physDev == VK_NULL_HANDLE || score > bestScore) {
+                physDev   = d.first;
+                bestScore = score;
+            }
         }
     }
 
-    if (physDev == VK_NULL_HANDLE) {
-        physDev = devices.begin()->first;
+    physDevInfo = devices[physDev];
+
+    PRINT("Using %s GPU: \"%s\"", DeviceTypeName(physDevInfo.properties.deviceType),
+          physDevInfo.properties.deviceName);
+
+    if (options.multiGpuMode != MultiGpuMode::Off) {
+        for (const auto& d : devices) {
+            if (d.first == physDev) {
+                continue;
+            }
+            MultiGpuRenderer::DeviceDesc desc;
+            desc.physDev        = d.first;
+            desc.graphicsFamily = d.second.familiesIndicies.graphics.value();
+            desc.memoryProps    = d.second.memoryProps;
+            desc.limits         = d.second.properties.limits;
+            desc.name           = d.second.properties.deviceName;
+            secondaryDevices.push_back(desc);
+        }
+
+        // GPUs of a device group are still driven by separate devices: compositing goes through the host
+        uint32_t groupsCount = 0;
+        vkEnumeratePhysicalDeviceGroups(vkInst, &groupsCount, nullptr);
+        std::vector<VkPhysicalDeviceGroupProperties> groups(groupsCount);
+        for (auto& group : groups) {
+            group.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GROUP_PROPERTIES;
+        }
+        vkEnumeratePhysicalDeviceGroups(vkInst, &groupsCount, groups.data());
+        for (const auto& group : groups) {
+            if (group.physicalDeviceCount > 1) {
+                PRINT("Device group of %u GPUs found", group.physicalDeviceCount);
+            }
+        }
     }
 
-    if (physDev == VK_NULL_HANDLE) {
-        PRINT_E("None of your GPUs is appropriate. You must buy an expensive cool adapter");
-        return APP_CODE_VK_INIT_FAIURE;
+    return APP_CODE_OK;
+}
+
+double VulkanApp::ScorePhysDevice(const PhysDevInfo& devInfo) const {
+
+    constexpr double gibibyte = 1024.0 * 1024.0 * 1024.0;
+
+    // Device local memory. Free memory is known only with VK_EXT_memory_budget
+    bool hasBudget = devInfo.memoryBudget.sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+    double vram = 0.0;
+    double freeVram = 0.0;
+    for (uint32_t i = 0; i < devInfo.memoryProps.memoryHeapCount; ++i) {
+        const auto& heap = devInfo.memoryProps.memoryHeaps[i];
+        if (!(heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)) {
+            continue;
+        }
+        vram += heap.size / gibibyte;
+        if (hasBudget) {
+            auto budget = devInfo.memoryBudget.heapBudget[i];
+            auto usage = devInfo.memoryBudget.heapUsage[i];
+            freeVram += (budget > usage) ? (budget - usage) / gibibyte : 0.0;
+        } else {
+            freeVram += heap.size / gibibyte;
+        }
     }
 
-    physDevInfo = devices[physDev];
+    bool powerSave = options.devicePolicy == DevicePolicy::PowerSave;
+    double typeScore = 0.0;
+    switch (devInfo.properties.deviceType) {
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+        typeScore = powerSave ? 2.0 : 3.0;
+        break;
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+        typeScore = powerSave ? 3.0 : 2.0;
+        break;
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+        typeScore = 1.0;
+        break;
+    default:
+        break;
+    }
 
-    PRINT("Using %s GPU: \"%s\"",
-        (physDevInfo.properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
-        ? "discrete"
-        : (physDevInfo.properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU)
-            ? "integrated"
-            : (physDevInfo.properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU)
-            ? "virtual"
-            : "uncknown-type",
-        physDevInfo.properties.deviceName);
+    // Separate compute and transfer families run async work in parallel with rendering
+    const auto& families = devInfo.familiesIndicies;
+    double queuesScore = 0.0;
+    if (families.compute.has_value() && families.compute != families.graphics) {
+        queuesScore += 1.0;
+    }
+    if (families.transfer.has_value() && families.transfer != families.graphics &&
+        families.transfer != families.compute) {
+        queuesScore += 1.0;
+    }
 
-    return APP_CODE_OK;
+    const auto& limits = devInfo.properties.limits;
+    double limitsScore = limits.maxImageDimension2D / 16384.0 +
+                         limits.maxComputeSharedMemorySize / 65536.0 +
+                         limits.maxBoundDescriptorSets / 32.0;
+
+    double extensionsScore = std::min(devInfo.extensions.GetSize(), size_t(256)) / 256.0;
+
+    if (options.devicePolicy == DevicePolicy::LeastLoaded) {
+        // Free memory dominates, the rest only breaks ties
+        return freeVram * 1000.0 + typeScore * 10.0 + queuesScore + limitsScore + extensionsScore;
+    }
+    // Adapter type dominates, a device of the same type wins by memory and capabilities
+    return typeScore * 1000.0 + vram * 10.0 + queuesScore * 20.0 + limitsScore * 10.0 + extensionsScore * 10.0;
 }
 
 AppResult VulkanApp::CreateLogicalDevice() {
 
-    // Create device queue family
-    VkDeviceQueueCreateInfo queueCreateInfo;
-    queueCreateInfo.sType            = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-    queueCreateInfo.pNext            = nullptr;
-    queueCreateInfo.flags            = 0;
-    if (!physDevInfo.familiesIndicies.graphics.has_value()) {
+    auto& indicies = physDevInfo.familiesIndicies;
+    if (!indicies.graphics.has_value()) {
         return APP_CODE_UNKNOWN;
     }
-    queueCreateInfo.queueFamilyIndex = physDevInfo.familiesIndicies.graphics.value();
-    queueCreateInfo.queueCount       = 1;
-    float queuePriority = 1.0;
-    queueCreateInfo.pQueuePriorities = &queuePriority;
+
+    // Uploads and async compute of the headless scene go through the async queues
+    bool uploads = options.headless && (options.gpuCullInstances || !options.virtualTexturePath.empty() ||
+                                        !options.meshPath.empty() || options.stagingStressSize);
+    FeatureSet timelineFeatures;
+    RequestTimelineFeatures(timelineFeatures);
+    timelineSemaphores = uploads && physDevInfo.features.Supports(timelineFeatures);
+    if (timelineSemaphores) {
+        RequestTimelineFeatures(requiredParams.deviceFeatures);
+    } else if (uploads) {
+        PRINT_W("GPU has no timeline semaphores, GPU culling, virtual texture, mesh and staging stress are disabled");
+        options.gpuCullInstances  = 0;
+        options.virtualTexturePath.clear();
+        options.meshPath.clear();
+        options.stagingStressSize = 0;
+    }
+
+    // Shaders of the GPU culling, the virtual texture and the pipeline cache benchmark index the bindless table
+    bool bindless = options.pipelineCacheBench ||
+                    (options.headless && (options.gpuCullInstances || !options.virtualTexturePath.empty()));
+    FeatureSet bindlessFeatures;
+    RequestBindlessFeatures(bindlessFeatures);
+    descriptorIndexing = bindless && physDevInfo.features.Supports(bindlessFeatures);
+    if (descriptorIndexing) {
+        RequestBindlessFeatures(requiredParams.deviceFeatures);
+    } else if (bindless) {
+        PRINT_W("GPU has no descriptor indexing, GPU culling, virtual texture and pipeline cache benchmark "
+                "are disabled");
+        options.gpuCullInstances = 0;
+        options.virtualTexturePath.clear();
+    }
+
+    // Virtual texture streams into a sparse image if the GPU supports sparse residency
+    const auto& supported = physDevInfo.features.features.features;
+    bool sparseResidency = options.headless && !options.virtualTexturePath.empty() &&
+                           !options.virtualTextureSoftware && indicies.sparseBinding.has_value() &&
+                           supported.sparseBinding && supported.sparseResidencyImage2D;
+    if (sparseResidency) {
+        requiredParams.deviceFeatures.features.features.sparseBinding          = VK_TRUE;
+        requiredParams.deviceFeatures.features.features.sparseResidencyImage2D = VK_TRUE;
+    } else if (options.headless && !options.virtualTexturePath.empty() && !options.virtualTextureSoftware) {
+        PRINT_W("GPU has no sparse residency, the virtual texture is streamed into an atlas");
+    }
+
+    // Graphics, compute, transfer and sparse binding queues in this order. Queues of a shared family
+    // get separate indicies while the family has enough of them
+    std::vector<uint32_t> queueFamilies = {
+        indicies.graphics.value(),
+        indicies.compute.value_or(indicies.graphics.value()),
+        indicies.transfer.value_or(indicies.graphics.value()),
+    };
+    if (sparseResidency) {
+        queueFamilies.push_back(indicies.sparseBinding.value());
+    }
+    std::vector<uint32_t> queueIndicies;
+    std::map<uint32_t, uint32_t> familyQueuesCount;
+    for (auto family : queueFamilies) {
+        auto& count = familyQueuesCount[family];
+        queueIndicies.push_back(std::min(count, physDevInfo.familiesProps[family].queueCount - 1));
+        count = std::min(count + 1, physDevInfo.familiesProps[family].queueCount);
+    }
+
+    // Create device queue families
+    std::vector<float> queuePriorities(queueFamilies.size(), 1.0f);
+    std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
+    for (auto& familyCount : familyQueuesCount) {
+        VkDeviceQueueCreateInfo queueCreateInfo;
+        queueCreateInfo.sType            = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+        queueCreateInfo.pNext            = nullptr;
+        queueCreateInfo.flags            = 0;
+        queueCreateInfo.queueFamilyIndex = familyCount.first;
+        queueCreateInfo.queueCount       = familyCount.second;
+        queueCreateInfo.pQueuePriorities = queuePriorities.data();
+        queueCreateInfos.push_back(queueCreateInfo);
+    }
 
     VkDeviceCreateInfo deviceCreateInfo;
     deviceCreateInfo.sType                   = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-    deviceCreateInfo.pNext                   = nullptr;
+    deviceCreateInfo.pNext                   = requiredParams.deviceFeatures.GetCreateChain();
     deviceCreateInfo.flags                   = 0;
-    deviceCreateInfo.pQueueCreateInfos       = &queueCreateInfo;
-    deviceCreateInfo.queueCreateInfoCount    = 1;
-    deviceCreateInfo.pEnabledFeatures        = &requiredParams.deviceFeatures;
+    deviceCreateInfo.pQueueCreateInfos       = queueCreateInfos.data();
+    deviceCreateInfo.queueCreateInfoCount    = static_cast<uint32_t>(queueCreateInfos.size());
+    deviceCreateInfo.pEnabledFeatures        = nullptr;
     deviceCreateInfo.enabledExtensionCount   = static_cast<uint32_t>(requiredParams.deviceExtensions.size());
     deviceCreateInfo.ppEnabledExtensionNames = requiredParams.deviceExtensions.data();
 #if VALIDATION_LAYERS_ENABLED
@@ -225,72 +555,181 @@ AppResult VulkanApp::CreateLogicalDevice() {
     }
     PRINT("Vulkan logical device created");
 
+    vkGetDeviceQueue(dev, queueFamilies[0], queueIndicies[0], &graphicsQueue);
+    if (timelineSemaphores) {
+        APP_CHECK_CALL(computeQueue.Init(dev, queueFamilies[1], queueIndicies[1], "Compute"));
+        APP_CHECK_CALL(transferQueue.Init(dev, queueFamilies[2], queueIndicies[2], "Transfer"));
+    }
+    if (sparseResidency) {
+        APP_CHECK_CALL(sparseQueue.Init(dev, queueFamilies[3], queueIndicies[3], "Sparse binding"));
+    }
+
     return APP_CODE_OK;
 }
 
-AppResult VulkanApp::CheckSupportedInstanceExtensions(const VulkanApp::ExtensionsList& exts,
-                                                      VulkanApp::ExtensionsList& unsupportedExts,
-                                                      const char* layer) {
+AppResult VulkanApp::InitHeadless() {
 
-    unsupportedExts.clear();
+    APP_CHECK_CALL(offscreenTarget.Init(dev, memoryAllocator, options.width, options.height));
+    APP_CHECK_CALL(renderGraph.Init(dev, memoryAllocator, frameScheduler.GetFramesInFlight(),
+                                    physDevInfo.properties.limits.bufferImageGranularity));
 
-    // Get supported extensios
-    uint32_t extCount = 0;
-    std::vector<VkExtensionProperties> extProps;
-    vkEnumerateInstanceExtensionProperties(layer, &extCount, nullptr);
-    extProps.resize(extCount);
-    VkResult r = vkEnumerateInstanceExtensionProperties(layer, &extCount, extProps.data());
-    if (r != VK_SUCCESS) {
-        PRINT_E("Can't get supported extensions list. Vk error code: %d", r);
-        return APP_CODE_VK_COMMAND_FAIURE;
+    if (options.multiGpuMode != MultiGpuMode::Off) {
+        if (secondaryDevices.empty()) {
+            PRINT_W("Only one suitable GPU, multi-GPU rendering is disabled");
+        } else {
+            APP_CHECK_CALL(multiGpu.Init(dev, memoryAllocator, physDevInfo.properties.deviceName,
+                                         frameScheduler.GetFramesInFlight(), secondaryDevices,
+                                         options.multiGpuMode, options.width, options.height));
+        }
     }
 
-    // Check specified list
-    for (auto ext : exts) {
-        bool isStated = false;
-        for (auto supportedExt : extProps) {
-            if (ext && std::string_view(ext) == supportedExt.extensionName) {
-                isStated = true;
-                break;
+    if (options.gpuCullInstances) {
+        // Culled on the compute queue, drawn on the graphics one
+        std::vector<uint32_t> families = { physDevInfo.familiesIndicies.graphics.value() };
+        for (uint32_t family : { computeQueue.GetFamily(), transferQueue.GetFamily() }) {
+            if (std::find(families.begin(), families.end(), family) == families.end()) {
+                families.push_back(family);
+            }
+        }
+        std::vector<GpuCuller::Instance> instances;
+        std::vector<GpuCuller::Mesh> meshes;
+        cullingSceneRadius = BuildCullingScene(options.gpuCullInstances, instances, meshes);
+        APP_CHECK_CALL(gpuCuller.Init(dev, physDevInfo.properties.limits, families, memoryAllocator, pipelineFactory,
+                                      bindlessTable, frameScheduler.GetFramesInFlight(),
+                                      static_cast<uint32_t>(instances.size()), static_cast<uint32_t>(meshes.size())));
+        APP_CHECK_CALL(gpuCuller.SetScene(stagingRing, instances, meshes));
+
+        if (options.cpuCullMode != CpuCullMode::Off) {
+            // Instances are unit cubes filling their boxes, so all of them may occlude
+            cpuCuller.Reserve(instances.size());
+            for (const auto& instance : instances) {
+                glm::vec3 position(instance.model[3].x, instance.model[3].y, instance.model[3].z);
+                cpuCuller.AddBox(position - glm::vec3(0.5f), position + glm::vec3(0.5f), true);
             }
+            if (options.cpuCullMode == CpuCullMode::Occlusion) {
+                cpuCuller.SetOcclusion(APP_OCCLUSION_BUFFER_WIDTH,
+                                       std::max(APP_OCCLUSION_BUFFER_WIDTH * options.height / options.width, 1u),
+                                       APP_OCCLUSION_MAX_OCCLUDERS);
+            }
+            PRINT("CPU culling of %zu instances on %u job threads", cpuCuller.GetObjectsCount(),
+                  jobSystem.GetThreadsCount());
+        }
+    } else if (options.cpuCullMode != CpuCullMode::Off) {
+        PRINT_W("CPU culling needs the --gpu-cull scene, it is disabled");
+    }
+
+    if (!options.virtualTexturePath.empty()) {
+        const char* path = options.virtualTexturePath.c_str();
+        if (!std::ifstream(path, std::ios::binary)) {
+            APP_CHECK_CALL(TileStreamer::GenerateFile(path, APP_VT_GENERATED_SIZE, APP_VT_GENERATED_TILE));
         }
-        if (!isStated) {
-            unsupportedExts.push_back(ext);
+        std::vector<uint32_t> families = { physDevInfo.familiesIndicies.graphics.value() };
+        if (transferQueue.GetFamily() != families[0]) {
+            families.push_back(transferQueue.GetFamily());
         }
+        AsyncQueue* sparse = sparseQueue.GetQueue() != VK_NULL_HANDLE ? &sparseQueue : nullptr;
+        APP_CHECK_CALL(virtualTexture.Init(physDev, dev, physDevInfo.properties.limits, families, memoryAllocator,
+                                           stagingRing, transferQueue, sparse, pipelineFactory, bindlessTable,
+                                           frameScheduler.GetFramesInFlight(), path,
+                                           VkDeviceSize(options.virtualTextureBudget) * 1024 * 1024));
     }
 
+    if (!options.meshPath.empty()) {
+        const char* path = options.meshPath.c_str();
+        if (!std::ifstream(path, std::ios::binary)) {
+            MeshData mesh;
+            GenerateTestMesh(APP_MESH_GENERATED_SEGMENTS, mesh);
+            MeshBuildStats buildStats;
+            APP_CHECK_CALL(BuildMeshFile(mesh, path, APP_MESH_VERTEX_CACHE_SIZE, buildStats));
+            PRINT("Test mesh %s converted: ACMR %.3f -> %.3f", path, buildStats.cacheBefore.acmr,
+                  buildStats.cacheAfter.acmr);
+        }
+        std::vector<uint32_t> families = { physDevInfo.familiesIndicies.graphics.value() };
+        if (transferQueue.GetFamily() != families[0]) {
+            families.push_back(transferQueue.GetFamily());
+        }
+        APP_CHECK_CALL(gpuMesh.Load(dev, families, memoryAllocator, stagingRing, transferQueue, path));
+    }
+
+    if (options.stagingStressSize) {
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size        = options.stagingStressSize;
+        bufferInfo.usage       = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        APP_CHECK_CALL(memoryAllocator.CreateBuffer(bufferInfo, MemoryAllocator::MemoryUsage::GpuOnly,
+                                                    stressBuffer, stressMemory));
+        PRINT("Streaming %llu KiB per frame through the staging ring",
+              static_cast<unsigned long long>(options.stagingStressSize / 1024));
+    }
+
+    renderedFrames = 0;
+    renderStart = std::chrono::steady_clock::now();
+    PRINT("Headless rendering mode. No window and surface will be created");
+
     return APP_CODE_OK;
 }
 
-AppResult VulkanApp::CheckSupportedInstanceLayers(const VulkanApp::LayersList& layers,
-                                                  VulkanApp::LayersList& unsupportedLayers) {
+AppResult VulkanApp::InitWindowed() {
 
-    unsupportedLayers.clear();
+    APP_CHECK_CALL(renderGraph.Init(dev, memoryAllocator, frameScheduler.GetFramesInFlight(),
+                                    physDevInfo.properties.limits.bufferImageGranularity));
+    // The graphics queue presents, CheckSuitablePhysDevices made sure it can
+    APP_CHECK_CALL(swapchain.Init(physDev, dev, surface, options.presentPolicy, GetFramebufferExtent()));
+    inputTime = std::chrono::steady_clock::now();
 
-    // Get supported extensios
-    uint32_t layersCount = 0;
-    std::vector<VkLayerProperties> layersProps;
-    vkEnumerateInstanceLayerProperties(&layersCount, nullptr);
-    layersProps.resize(layersCount);
-    VkResult r = vkEnumerateInstanceLayerProperties(&layersCount, layersProps.data());
-    if (r != VK_SUCCESS) {
-        PRINT_E("Can't get available layers list. Vk error code: %d", r);
-        return APP_CODE_VK_COMMAND_FAIURE;
+    return APP_CODE_OK;
+}
+
+AppResult VulkanApp::CreateSurface(VkInstance, VkSurfaceKHR&) {
+    PRINT_E("Window rendering needs an app with a window");
+    return APP_CODE_WND_INIT_FAIURE;
+}
+
+VkExtent2D VulkanApp::GetFramebufferExtent() const {
+    return { options.width, options.height };
+}
+
+void VulkanApp::OnFramebufferResize(uint32_t width, uint32_t height) {
+    swapchain.RequestRecreate({ width, height });
+}
+
+void VulkanApp::CyclePresentPolicy() {
+    switch (options.presentPolicy) {
+    case PresentPolicy::LowLatency:
+        options.presentPolicy = PresentPolicy::Throughput;
+        PRINT("Present mode policy: throughput");
+        break;
+    case PresentPolicy::Throughput:
+        options.presentPolicy = PresentPolicy::Vsync;
+        PRINT("Present mode policy: vsync");
+        break;
+    case PresentPolicy::Vsync:
+        options.presentPolicy = PresentPolicy::LowLatency;
+        PRINT("Present mode policy: low latency");
+        break;
     }
+    swapchain.SetPolicy(options.presentPolicy);
+}
 
-    // Check specified list
-    for (auto layer : layers) {
-        bool isStated = false;
-        for (auto supportedExt : layersProps) {
-            if (layer && std::string_view(layer) == std::string_view(supportedExt.layerName)) {
-                isStated = true;
-                break;
-            }
-        }
-        if (!isStated) {
-            unsupportedLayers.push_back(layer);
-        }
+AppResult VulkanApp::CheckSupportedInstanceExtensions(const VulkanApp::ExtensionsList& exts,
+                                                      VulkanApp::ExtensionsList& unsupportedExts,
+                                                      const char* layer) {
+
+    if (layer && !capabilities.HasLayer(layer)) {
+        PRINT_E("Can't get extensions of unavailable layer \"%s\"", layer);
+        return APP_CODE_VK_COMMAND_FAIURE;
     }
+    const auto& supported = layer ? capabilities.GetLayerExtensions(layer) : capabilities.GetInstanceExtensions();
+    CapabilityRegistry::FindMissing(exts, supported, unsupportedExts);
+
+    return APP_CODE_OK;
+}
+
+AppResult VulkanApp::CheckSupportedInstanceLayers(const VulkanApp::LayersList& layers,
+                                                  VulkanApp::LayersList& unsupportedLayers) {
+
+    CapabilityRegistry::FindMissing(layers, capabilities.GetLayers(), unsupportedLayers);
 
     return APP_CODE_OK;
 }
@@ -307,23 +746,111 @@ AppResult VulkanApp::GetPhysicalDevicesInfos(PhysDevList& physDevList) {
     devices.resize(count);
     vkEnumeratePhysicalDevices(vkInst, &count, devices.data());
 
-    for (auto& device : devices) {
-        auto& devInfo = physDevList[device];
+    auto start = std::chrono::steady_clock::now();
 
-        vkGetPhysicalDeviceFeatures(device, &devInfo.features);
+    CapabilitySnapshot snapshot;
+    bool snapshotLoaded = !options.capsSnapshotPath.empty() && snapshot.Load(options.capsSnapshotPath);
+
+    // Drivers may take milliseconds per device, so devices are probed in parallel
+    std::vector<PhysDevInfo> infos(devices.size());
+    std::vector<std::future<bool>> probes;
+    probes.reserve(devices.size());
+    for (size_t i = 0; i < devices.size(); ++i) {
+        probes.push_back(std::async(std::launch::async, &VulkanApp::ProbePhysDevice, devices[i],
+                                    snapshotLoaded ? &snapshot : nullptr, std::ref(infos[i])));
+    }
+    size_t cachedCount = 0;
+    for (auto& probe : probes) {
+        cachedCount += probe.get() ? 1 : 0;
+    }
+    size_t storedCount = snapshot.GetDevicesCount();
+    // Unmap before the file is replaced
+    snapshot.Clear();
+
+    PRINT("Probed %zu GPUs in %.3f ms (%zu from the capabilities snapshot)", devices.size(),
+          std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(), cachedCount);
+
+    // Devices without Vulkan 1.1 have no UUID to be identified with
+    auto isIdentifiable = [](const PhysDevInfo& info) { return info.properties.apiVersion >= VK_API_VERSION_1_1; };
+    size_t identifiableCount = std::count_if(infos.begin(), infos.end(), isIdentifiable);
+
+    // Rewrite the snapshot if a device is new, changed its driver or is gone
+    if (!options.capsSnapshotPath.empty() && (cachedCount != identifiableCount || storedCount != identifiableCount)) {
+        std::vector<CapabilitySnapshot::Device> snapshotDevices;
+        for (const auto& info : infos) {
+            if (!isIdentifiable(info)) {
+                continue;
+            }
+            CapabilitySnapshot::Device device{};
+            std::memcpy(device.deviceUUID, info.idProps.deviceUUID, VK_UUID_SIZE);
+            device.vendorID      = info.properties.vendorID;
+            device.deviceID      = info.properties.deviceID;
+            device.driverVersion = info.properties.driverVersion;
+            device.apiVersion    = info.properties.apiVersion;
+            device.memoryProps   = info.memoryProps;
+            device.familiesProps = info.familiesProps;
+            device.features      = info.features;
+            device.extensions    = info.extensions;
+            snapshotDevices.push_back(std::move(device));
+        }
+        // Startup still works without the snapshot
+        CapabilitySnapshot::Save(options.capsSnapshotPath, snapshotDevices);
+    }
+
+    for (size_t i = 0; i < devices.size(); ++i) {
+        physDevList[devices[i]] = std::move(infos[i]);
+    }
+
+    return APP_CODE_OK;
+}
+
+bool VulkanApp::ProbePhysDevice(VkPhysicalDevice device, const CapabilitySnapshot* snapshot, PhysDevInfo& devInfo) {
+
+    // Properties identify the device in the snapshot, so they are always queried
+    vkGetPhysicalDeviceProperties(device, &devInfo.properties);
+    devInfo.idProps = {};
+    if (devInfo.properties.apiVersion >= VK_API_VERSION_1_1) {
+        devInfo.idProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+        VkPhysicalDeviceProperties2 properties2{};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext = &devInfo.idProps;
+        vkGetPhysicalDeviceProperties2(device, &properties2);
+        devInfo.idProps.pNext = nullptr;
+    }
+
+    CapabilitySnapshot::Device cached{};
+    bool fromSnapshot = snapshot && devInfo.properties.apiVersion >= VK_API_VERSION_1_1 &&
+                        snapshot->Find(devInfo.properties, devInfo.idProps.deviceUUID, cached);
+    if (fromSnapshot) {
+        devInfo.familiesProps = std::move(cached.familiesProps);
+        devInfo.features      = cached.features;
+        devInfo.extensions    = std::move(cached.extensions);
+        devInfo.memoryProps   = cached.memoryProps;
+    } else {
+        uint32_t count = 0;
         vkGetPhysicalDeviceQueueFamilyProperties(device, &count, nullptr);
         devInfo.familiesProps.resize(count);
         vkGetPhysicalDeviceQueueFamilyProperties(device, &count, devInfo.familiesProps.data());
-        vkGetPhysicalDeviceProperties(device, &devInfo.properties);
-        vkEnumerateDeviceExtensionProperties(device, nullptr, &count, nullptr);
-        devInfo.familiesProps.resize(count);
-        vkEnumerateDeviceExtensionProperties(device, nullptr, &count, devInfo.extensions.data());
+        devInfo.features.Query(device, devInfo.properties.apiVersion, APP_VK_API_VERSION);
+        CapabilityRegistry::EnumerateDeviceExtensions(device, devInfo.extensions);
         // @remind can also get from layers
         vkGetPhysicalDeviceMemoryProperties(device, &devInfo.memoryProps);
-        GetQueueFamIndicies(devInfo.familiesProps, devInfo.familiesIndicies);
     }
 
-    return APP_CODE_OK;
+    // Current memory usage, to choose the least loaded device
+    devInfo.memoryBudget = {};
+    constexpr uint64_t memoryBudgetExt = HashString(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    if (devInfo.extensions.Contains(memoryBudgetExt) && devInfo.properties.apiVersion >= VK_API_VERSION_1_1) {
+        devInfo.memoryBudget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+        VkPhysicalDeviceMemoryProperties2 memoryProps2{};
+        memoryProps2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        memoryProps2.pNext = &devInfo.memoryBudget;
+        vkGetPhysicalDeviceMemoryProperties2(device, &memoryProps2);
+        devInfo.memoryBudget.pNext = nullptr;
+    }
+
+    GetQueueFamIndicies(devInfo.familiesProps, devInfo.familiesIndicies);
+    return fromSnapshot;
 }
 
 void VulkanApp::CheckSuitablePhysDevices(const PhysDevList& devices,
@@ -331,94 +858,78 @@ void VulkanApp::CheckSuitablePhysDevices(const PhysDevList& devices,
 
     unsuitableDevices.clear();
 
-    for (auto device : devices) {
+    for (const auto& device : devices) {
         bool hasGraphicsQFamily    = false;
         bool doesSupportFeatures   = false;
         bool doesSupportExtensions = false;
+        bool canPresent            = true;
 
         // Check for support of graphics family
         hasGraphicsQFamily = device.second.familiesIndicies.graphics.has_value();
 
+        // Check for present support of the graphics family
+        if (surface != VK_NULL_HANDLE && hasGraphicsQFamily) {
+            VkBool32 supported = VK_FALSE;
+            vkGetPhysicalDeviceSurfaceSupportKHR(device.first, device.second.familiesIndicies.graphics.value(),
+                                                 surface, &supported);
+            canPresent = supported == VK_TRUE;
+            if (!canPresent) {
+                PRINT_W("GPU \"%s\" can't present to the window", device.second.properties.deviceName);
+            }
+        }
+
         // Check for support of features
-        {
-            auto& devFeatures = device.second.features;
-            auto& features = requiredParams.deviceFeatures;
-            doesSupportFeatures = 
-                (features.robustBufferAccess)                      ? devFeatures.robustBufferAccess                      : true &&
-                (features.fullDrawIndexUint32)                     ? devFeatures.fullDrawIndexUint32                     : true &&
-                (features.imageCubeArray)                          ? devFeatures.imageCubeArray                          : true &&
-                (features.independentBlend)                        ? devFeatures.independentBlend                        : true &&
-                (features.geometryShader)                          ? devFeatures.geometryShader                          : true &&
-                (features.tessellationShader)                      ? devFeatures.tessellationShader                      : true &&
-                (features.sampleRateShading)                       ? devFeatures.sampleRateShading                       : true &&
-                (features.dualSrcBlend)                            ? devFeatures.dualSrcBlend                            : true &&
-                (features.logicOp)                                 ? devFeatures.logicOp                                 : true &&
-                (features.multiDrawIndirect)                       ? devFeatures.multiDrawIndirect                       : true &&
-                (features.drawIndirectFirstInstance)               ? devFeatures.drawIndirectFirstInstance               : true &&
-                (features.depthClamp)                              ? devFeatures.depthClamp                              : true &&
-                (features.depthBiasClamp)                          ? devFeatures.depthBiasClamp                          : true &&
-                (features.fillModeNonSolid)                        ? devFeatures.fillModeNonSolid                        : true &&
-                (features.depthBounds)                             ? devFeatures.depthBounds                             : true &&
-                (features.wideLines)                               ? devFeatures.wideLines                               : true &&
-                (features.largePoints)                             ? devFeatures.largePoints                             : true &&
-                (features.alphaToOne)                              ? devFeatures.alphaToOne                              : true &&
-                (features.multiViewport)                           ? devFeatures.multiViewport                           : true &&
-                (features.samplerAnisotropy)                       ? devFeatures.samplerAnisotropy                       : true &&
-                (features.textureCompressionETC2)                  ? devFeatures.textureCompressionETC2                  : true &&
-                (features.textureCompressionASTC_LDR)              ? devFeatures.textureCompressionASTC_LDR              : true &&
-                (features.textureCompressionBC)                    ? devFeatures.textureCompressionBC                    : true &&
-                (features.occlusionQueryPrecise)                   ? devFeatures.occlusionQueryPrecise                   : true &&
-                (features.pipelineStatisticsQuery)                 ? devFeatures.pipelineStatisticsQuery                 : true &&
-                (features.vertexPipelineStoresAndAtomics)          ? devFeatures.vertexPipelineStoresAndAtomics          : true &&
-                (features.fragmentStoresAndAtomics)                ? devFeatures.fragmentStoresAndAtomics                : true &&
-                (features.shaderTessellationAndGeometryPointSize)  ? devFeatures.shaderTessellationAndGeometryPointSize  : true &&
-                (features.shaderImageGatherExtended)               ? devFeatures.shaderImageGatherExtended               : true &&
-                (features.shaderStorageImageExtendedFormats)       ? devFeatures.shaderStorageImageExtendedFormats       : true &&
-                (features.shaderStorageImageMultisample)           ? devFeatures.shaderStorageImageMultisample           : true &&
-                (features.shaderStorageImageReadWithoutFormat)     ? devFeatures.shaderStorageImageReadWithoutFormat     : true &&
-                (features.shaderStorageImageWriteWithoutFormat)    ? devFeatures.shaderStorageImageWriteWithoutFormat    : true &&
-                (features.shaderUniformBufferArrayDynamicIndexing) ? devFeatures.shaderUniformBufferArrayDynamicIndexing : true &&
-                (features.shaderSampledImageArrayDynamicIndexing)  ? devFeatures.shaderSampledImageArrayDynamicIndexing  : true &&
-                (features.shaderStorageBufferArrayDynamicIndexing) ? devFeatures.shaderStorageBufferArrayDynamicIndexing : true &&
-                (features.shaderStorageImageArrayDynamicIndexing)  ? devFeatures.shaderStorageImageArrayDynamicIndexing  : true &&
-                (features.shaderClipDistance)                      ? devFeatures.shaderClipDistance                      : true &&
-                (features.shaderCullDistance)                      ? devFeatures.shaderCullDistance                      : true &&
-                (features.shaderFloat64)                           ? devFeatures.shaderFloat64                           : true &&
-                (features.shaderInt64)                             ? devFeatures.shaderInt64                             : true &&
-                (features.shaderInt16)                             ? devFeatures.shaderInt16                             : true &&
-                (features.shaderResourceResidency)                 ? devFeatures.shaderResourceResidency                 : true &&
-                (features.shaderResourceMinLod)                    ? devFeatures.shaderResourceMinLod                    : true &&
-                (features.sparseBinding)                           ? devFeatures.sparseBinding                           : true &&
-                (features.sparseResidencyBuffer)                   ? devFeatures.sparseResidencyBuffer                   : true &&
-                (features.sparseResidencyImage2D)                  ? devFeatures.sparseResidencyImage2D                  : true &&
-                (features.sparseResidencyImage3D)                  ? devFeatures.sparseResidencyImage3D                  : true &&
-                (features.sparseResidency2Samples)                 ? devFeatures.sparseResidency2Samples                 : true &&
-                (features.sparseResidency4Samples)                 ? devFeatures.sparseResidency4Samples                 : true &&
-                (features.sparseResidency8Samples)                 ? devFeatures.sparseResidency8Samples                 : true &&
-                (features.sparseResidency16Samples)                ? devFeatures.sparseResidency16Samples                : true &&
-                (features.sparseResidencyAliased)                  ? devFeatures.sparseResidencyAliased                  : true &&
-                (features.variableMultisampleRate)                 ? devFeatures.variableMultisampleRate                 : true &&
-                (features.inheritedQueries)                        ? devFeatures.inheritedQueries                        : true;
-        }
-
-        // @remind Check for support of device extensions
-        doesSupportExtensions = true;
-
-        if (!(doesSupportFeatures && hasGraphicsQFamily && doesSupportExtensions)) {
+        std::vector<std::string> missingFeatures;
+        doesSupportFeatures = device.second.features.Supports(requiredParams.deviceFeatures, &missingFeatures);
+        for (const auto& feature : missingFeatures) {
+            PRINT_W("GPU \"%s\" doesn't support feature %s", device.second.properties.deviceName, feature.c_str());
+        }
+
+        // Check for support of device extensions
+        ExtensionsList missingExtensions;
+        CapabilityRegistry::FindMissing(requiredParams.deviceExtensions, device.second.extensions, missingExtensions);
+        doesSupportExtensions = missingExtensions.empty();
+        for (auto ext : missingExtensions) {
+            PRINT_W("GPU \"%s\" doesn't support extension %s", device.second.properties.deviceName, ext);
+        }
+
+        if (!(doesSupportFeatures && hasGraphicsQFamily && doesSupportExtensions && canPresent)) {
             unsuitableDevices.push_back(device.first);
         }
     }
 }
 
 void VulkanApp::GetQueueFamIndicies(const std::vector<VkQueueFamilyProperties>& familiesProps, QueueFamIndicies& indicies) {
-    for (uint32_t i = 0u; i < familiesProps.size(); ++i) {
-        auto& family = familiesProps[i];
-        if (family.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-            indicies.graphics = i;
-            return;
+
+    // Pick the family having the required flags and as few of the avoided ones as possible
+    auto findFamily = [&familiesProps](VkQueueFlags required, VkQueueFlags avoided) -> std::optional<uint32_t> {
+        std::optional<uint32_t> found;
+        uint32_t foundAvoided = UINT32_MAX;
+        for (uint32_t i = 0u; i < familiesProps.size(); ++i) {
+            auto flags = familiesProps[i].queueFlags;
+            if (!familiesProps[i].queueCount || (flags & required) != required) {
+                continue;
+            }
+            uint32_t avoidedCount = 0;
+            for (auto bits = flags & avoided; bits; bits &= bits - 1) {
+                ++avoidedCount;
+            }
+            if (avoidedCount < foundAvoided) {
+                found        = i;
+                foundAvoided = avoidedCount;
+            }
         }
-        // @remind think what to do with others
+        return found;
+    };
+
+    indicies.graphics = findFamily(VK_QUEUE_GRAPHICS_BIT, 0);
+    indicies.compute  = findFamily(VK_QUEUE_COMPUTE_BIT, VK_QUEUE_GRAPHICS_BIT);
+    // Every graphics or compute family supports transfers even without the bit
+    indicies.transfer = findFamily(VK_QUEUE_TRANSFER_BIT, VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT);
+    if (!indicies.transfer.has_value()) {
+        indicies.transfer = indicies.compute.has_value() ? indicies.compute : indicies.graphics;
     }
+    indicies.sparseBinding = findFamily(VK_QUEUE_SPARSE_BINDING_BIT, VK_QUEUE_GRAPHICS_BIT);
 }
 
 void VulkanApp::populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo) {
@@ -465,12 +976,470 @@ VKAPI_ATTR VkBool32 VKAPI_CALL VulkanApp::debugCallback(VkDebugUtilsMessageSever
 
 AppResult VulkanApp::LoopFunc() {
 
-    // Now do nothing
+    // Pipelines compiled in background since the last frame become usable
+    pipelineFactory.Poll();
+
+    if (options.headless) {
+        APP_CHECK_CALL(RenderHeadlessFrame());
+    } else {
+        APP_CHECK_CALL(RenderWindowFrame());
+    }
+
+    Profiler::Inst().EndFrame();
+    return APP_CODE_OK;
+}
+
+AppResult VulkanApp::RenderHeadlessFrame() {
+
+    PROFILE_SCOPE("HeadlessFrame");
+
+    // Blocks only if GPU is framesInFlight frames behind
+    auto& frame = frameScheduler.BeginFrame();
+    commandRecorder.BeginFrame(frame.index);
+    bindlessTable.BeginFrame(frame.number);
+    gpuCuller.BeginFrame(frame.index);
+    if (!options.virtualTexturePath.empty()) {
+        PROFILE_SCOPE("VirtualTextureUpdate");
+        APP_CHECK_CALL(virtualTexture.BeginFrame(frame.number, frame.index, frameScheduler.GetCompletedFramesCount()));
+    }
+    gpuProfiler.BeginFrame(frame.commandBuffer, frame.index);
+
+    // Animate clear color to make frames distinguishable
+    float t = static_cast<float>(frame.number % 256) / 255.0f;
+    VkClearColorValue color{};
+    color.float32[0] = t;
+    color.float32[1] = 1.0f - t;
+    color.float32[2] = 0.5f;
+    color.float32[3] = 1.0f;
+
+    // Other GPUs get their share of the frame first to run in parallel with the recording
+    bool renderPrimary = true;
+    if (multiGpu.IsEnabled()) {
+        APP_CHECK_CALL(multiGpu.BeginFrame(frame.number, frame.index, color, renderPrimary));
+    }
+
+    // Frame content is recorded by the worker threads into secondary command buffers
+    std::vector<CommandRecorder::RecordJob> jobs;
+    if (renderPrimary) {
+        // The image is transitioned by the render graph before the secondaries are executed.
+        // With split frame rendering the primary writes only its band, others are composited
+        jobs.push_back([this, color](VkCommandBuffer cmd) {
+            if (multiGpu.IsEnabled()) {
+                multiGpu.RecordPrimaryClear(cmd, offscreenTarget.GetImage(), color);
+            } else {
+                offscreenTarget.RecordClear(cmd, color);
+            }
+        });
+    }
+
+    VkCommandBufferInheritanceInfo inheritance{};
+    inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+
+    std::vector<VkCommandBuffer> secondaryBuffers;
+    {
+        PROFILE_SCOPE("RecordCommands");
+        APP_CHECK_CALL(commandRecorder.Record(jobs, inheritance, secondaryBuffers));
+    }
+    glm::mat4 cullViewProj(1.0f);
+    if (gpuCuller.GetInstancesCount()) {
+        // Camera orbits the instance grid
+        float angle = static_cast<float>(frame.number) * 0.01f;
+        glm::vec3 eye(std::cos(angle) * cullingSceneRadius, cullingSceneRadius * 0.25f,
+                      std::sin(angle) * cullingSceneRadius);
+        glm::mat4 view = glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        glm::mat4 proj = glm::perspective(glm::radians(60.0f),
+                                          static_cast<float>(options.width) / options.height, 0.1f, 1000.0f);
+        cullViewProj = proj * view;
+        if (cpuCuller.GetObjectsCount()) {
+            PROFILE_SCOPE("CpuCull");
+            cpuCuller.Cull(jobSystem, cullViewProj, eye);
+        }
+    }
+    if (!options.virtualTexturePath.empty()) {
+        // Camera flies low over the textured plane, so levels and pages in view keep changing
+        constexpr float planeSize = 256.0f;
+        float angle = static_cast<float>(frame.number) * 0.003f;
+        glm::vec3 eye(std::cos(angle) * planeSize * 0.3f, 4.0f + 3.0f * std::sin(angle * 5.0f),
+                      std::sin(angle) * planeSize * 0.3f);
+        glm::vec3 target(-std::sin(angle) * planeSize * 0.25f, 0.0f, std::cos(angle) * planeSize * 0.25f);
+        glm::mat4 view = glm::lookAt(eye, eye + target, glm::vec3(0.0f, 1.0f, 0.0f));
+        glm::mat4 proj = glm::perspective(glm::radians(60.0f),
+                                          static_cast<float>(options.width) / options.height, 0.1f, 1000.0f);
+        PROFILE_GPU_SCOPE(gpuProfiler, frame.commandBuffer, "VirtualTextureFeedback");
+        virtualTexture.RecordFeedback(frame.commandBuffer, frame.index, proj * view, eye, planeSize,
+                                      { options.width, options.height });
+    }
+    {
+        PROFILE_GPU_SCOPE(gpuProfiler, frame.commandBuffer, "OffscreenPass");
+        APP_CHECK_CALL(RecordOffscreenGraph(frame.commandBuffer, frame.index, secondaryBuffers));
+    }
+
+    if (stressBuffer != VK_NULL_HANDLE) {
+        PROFILE_SCOPE("UploadStressData");
+        APP_CHECK_CALL(UploadStressData());
+    }
+
+    // Uploads of the frame are submitted at once and waited by the frame on GPU
+    uint64_t uploadValue = 0;
+    APP_CHECK_CALL(stagingRing.Flush(uploadValue));
+    std::vector<AsyncQueue::SyncPoint> timelineWaits;
+    if (uploadValue) {
+        // Uploads are read by copies and compute passes of the frame
+        timelineWaits.push_back(transferQueue.GetSyncPoint(uploadValue, VK_PIPELINE_STAGE_TRANSFER_BIT |
+                                                                        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT));
+    }
+
+    // Resources added while recording become visible to the submitted commands
+    bindlessTable.Flush();
+
+    if (gpuCuller.GetInstancesCount()) {
+        // Culling overlaps the previous frames on the compute queue, the frame waits for it only at the draws.
+        // The frame fence then covers the culling too, so the draw buffers of the frame index are free to reuse
+        PROFILE_SCOPE("SubmitCull");
+        std::vector<AsyncQueue::SyncPoint> cullWaits;
+        if (uploadValue) {
+            cullWaits.push_back(transferQueue.GetSyncPoint(uploadValue, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT));
+        }
+        uint64_t cullValue = 0;
+        APP_CHECK_CALL(computeQueue.Submit([this, &frame, &cullViewProj](VkCommandBuffer cmd) {
+            gpuCuller.RecordCull(cmd, frame.index, cullViewProj);
+        }, cullWaits, cullValue));
+        timelineWaits.push_back(computeQueue.GetSyncPoint(cullValue, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT));
+    }
+
+    // No swapchain, so nothing to wait and signal
+    APP_CHECK_CALL(frameScheduler.EndFrame(graphicsQueue, false, VK_NULL_HANDLE, timelineWaits));
+    ++renderedFrames;
+
+    return APP_CODE_OK;
+}
+
+AppResult VulkanApp::RecordOffscreenGraph(VkCommandBuffer cmd, uint32_t frameIndex,
+                                          const std::vector<VkCommandBuffer>& secondaryBuffers) {
+
+    PROFILE_SCOPE("RenderGraph");
+    renderGraph.Reset();
+
+    RenderGraph::ImageDesc targetDesc;
+    targetDesc.format = OffscreenTarget::format;
+    targetDesc.width  = offscreenTarget.GetExtent().width;
+    targetDesc.height = offscreenTarget.GetExtent().height;
+    // The previous frame's copy must finish before the content is discarded
+    RenderGraph::ExternalState targetInitial;
+    targetInitial.stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    RenderGraph::ExternalState targetFinal;
+    targetFinal.layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    targetFinal.stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    auto target = renderGraph.ImportImage("OffscreenTarget", offscreenTarget.GetImage(), targetDesc,
+                                          targetInitial, targetFinal);
+
+    RenderGraph::BufferDesc readbackDesc;
+    readbackDesc.size = offscreenTarget.GetFrameSize();
+    // Mapped memory is read by the host after the frame fence
+    RenderGraph::ExternalState readbackFinal;
+    readbackFinal.stages = VK_PIPELINE_STAGE_HOST_BIT;
+    readbackFinal.access = VK_ACCESS_HOST_READ_BIT;
+    auto readback = renderGraph.ImportBuffer("Readback", offscreenTarget.GetReadbackBuffer(), readbackDesc,
+                                             RenderGraph::ExternalState(), readbackFinal);
+
+    if (!secondaryBuffers.empty()) {
+        auto content = renderGraph.AddPass("Content", [&secondaryBuffers](VkCommandBuffer cmd, const RenderGraph&) {
+            vkCmdExecuteCommands(cmd, static_cast<uint32_t>(secondaryBuffers.size()), secondaryBuffers.data());
+        });
+        renderGraph.Write(content, target, RenderGraph::Access::TransferWrite);
+    }
+    AppResult compositeResult = APP_CODE_OK;
+    if (multiGpu.IsEnabled()) {
+        auto composite = renderGraph.AddPass("MultiGpuComposite",
+                                             [this, frameIndex, &compositeResult](VkCommandBuffer cmd,
+                                                                                  const RenderGraph&) {
+            PROFILE_SCOPE("MultiGpuComposite");
+            compositeResult = multiGpu.RecordComposite(cmd, frameIndex, offscreenTarget.GetImage());
+        });
+        renderGraph.Write(composite, target, RenderGraph::Access::TransferWrite);
+    }
+    auto copy = renderGraph.AddPass("Readback", [this](VkCommandBuffer cmd, const RenderGraph&) {
+        offscreenTarget.RecordCopyToReadback(cmd);
+    });
+    renderGraph.Read(copy, target, RenderGraph::Access::TransferRead);
+    renderGraph.Write(copy, readback, RenderGraph::Access::TransferWrite);
+
+    APP_CHECK_CALL(renderGraph.Compile());
+    APP_CHECK_CALL(renderGraph.Execute(cmd, frameIndex));
+    return compositeResult;
+}
+
+AppResult VulkanApp::RenderWindowFrame() {
+
+    PROFILE_SCOPE("WindowFrame");
+
+    // Nothing to present to until the window is restored
+    if (swapchain.IsMinimized()) {
+        return APP_CODE_OK;
+    }
+
+    auto& frame = frameScheduler.BeginFrame();
+    gpuProfiler.BeginFrame(frame.commandBuffer, frame.index);
+
+    // Retired swapchains are released once the frames presenting to them complete
+    uint32_t imageIndex = 0;
+    bool acquired = swapchain.Acquire(frame.imageAcquired, frameScheduler.GetCompletedFramesCount(),
+                                      frameScheduler.GetSubmittedFramesCount(), imageIndex);
+    if (acquired) {
+        float t = static_cast<float>(frame.number % 256) / 255.0f;
+        VkClearColorValue color{};
+        color.float32[0] = t;
+        color.float32[1] = 1.0f - t;
+        color.float32[2] = 0.5f;
+        color.float32[3] = 1.0f;
+
+        PROFILE_GPU_SCOPE(gpuProfiler, frame.commandBuffer, "PresentPass");
+        APP_CHECK_CALL(RecordPresentGraph(frame.commandBuffer, frame.index, imageIndex, color));
+    }
+
+    // A frame without an image is submitted empty to keep the fence cycle
+    VkSemaphore renderFinished = acquired ? swapchain.GetRenderFinished(imageIndex) : VK_NULL_HANDLE;
+    APP_CHECK_CALL(frameScheduler.EndFrame(graphicsQueue, acquired, renderFinished));
+    if (acquired) {
+        APP_CHECK_CALL(swapchain.Present(graphicsQueue, imageIndex, inputTime));
+    }
+
+    return APP_CODE_OK;
+}
+
+AppResult VulkanApp::RecordPresentGraph(VkCommandBuffer cmd, uint32_t frameIndex, uint32_t imageIndex,
+                                        const VkClearColorValue& color) {
+
+    PROFILE_SCOPE("RenderGraph");
+    renderGraph.Reset();
+
+    RenderGraph::ImageDesc imageDesc;
+    imageDesc.format = swapchain.GetFormat();
+    imageDesc.width  = swapchain.GetExtent().width;
+    imageDesc.height = swapchain.GetExtent().height;
+    // Submission waits for the acquire at the color output stage, the first barrier chains to it
+    RenderGraph::ExternalState imageInitial;
+    imageInitial.stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    RenderGraph::ExternalState imageFinal;
+    imageFinal.layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    imageFinal.stages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+    auto image = renderGraph.ImportImage("SwapchainImage", swapchain.GetImage(imageIndex), imageDesc,
+                                         imageInitial, imageFinal);
+
+    auto clear = renderGraph.AddPass("Clear", [image, color](VkCommandBuffer cmd, const RenderGraph& graph) {
+        VkImageSubresourceRange range{};
+        range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        range.levelCount = 1;
+        range.layerCount = 1;
+        vkCmdClearColorImage(cmd, graph.GetImage(image), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &color, 1, &range);
+    });
+    renderGraph.Write(clear, image, RenderGraph::Access::TransferWrite);
+
+    APP_CHECK_CALL(renderGraph.Compile());
+    return renderGraph.Execute(cmd, frameIndex);
+}
+
+AppResult VulkanApp::UploadStressData() {
+
+    // Upload in small chunks like separate assets do. Contiguous chunks are merged into one copy
+    constexpr VkDeviceSize chunkSize = 64 * 1024;
+    uint8_t pattern = static_cast<uint8_t>(renderedFrames);
+
+    for (VkDeviceSize uploaded = 0; uploaded < options.stagingStressSize; uploaded += chunkSize) {
+        VkDeviceSize size = std::min(chunkSize, options.stagingStressSize - uploaded);
+        VkDeviceSize offset = 0;
+        void* data = stagingRing.Reserve(size, 4, offset);
+        if (!data) {
+            return APP_CODE_UNKNOWN;
+        }
+        std::memset(data, pattern, static_cast<size_t>(size));
+        stagingRing.CopyToBuffer(offset, size, stressBuffer, uploaded);
+    }
+
+    return APP_CODE_OK;
+}
+
+AppResult VulkanApp::FinishHeadlessRendering() {
+
+    if (dev == VK_NULL_HANDLE) {
+        return APP_CODE_OK;
+    }
+    frameScheduler.WaitIdle();
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - renderStart;
+    if (renderedFrames && elapsed.count() > 0.0) {
+        PRINT("Rendered %llu headless frames in %.3f s (%.1f FPS)",
+              static_cast<unsigned long long>(renderedFrames), elapsed.count(),
+              renderedFrames / elapsed.count());
+        PRINT("Frames in flight: %u, average CPU wait for GPU: %.3f ms per frame",
+              frameScheduler.GetFramesInFlight(), frameScheduler.GetAverageCpuWaitTime());
+    }
+
+    if (!options.dumpPath.empty()) {
+        APP_CHECK_CALL(offscreenTarget.DumpPPM(options.dumpPath.c_str()));
+    }
+
+    return APP_CODE_OK;
+}
+
+bool VulkanApp::IsBenchmarkRequested() const {
+    return options.pipelineCacheBench || options.recordBenchJobs || options.capsBench;
+}
+
+AppResult VulkanApp::RunBenchmark() {
+
+    if (options.pipelineCacheBench && !descriptorIndexing) {
+        PRINT_W("Pipeline cache benchmark is skipped, its shaders need descriptor indexing");
+    } else if (options.pipelineCacheBench) {
+        // Startup lasts until the first pipeline of the app is usable. It is warm if the cache was loaded from disk
+        PipelineFactory::Key shader = 0;
+        APP_CHECK_CALL(pipelineFactory.LoadShader("frustum_cull.comp", shader));
+        PipelineFactory::ComputeDesc desc;
+        desc.shader    = shader;
+        desc.layout    = bindlessTable.GetPipelineLayout();
+        desc.layoutKey = BindlessTable::pipelineLayoutKey;
+        if (pipelineFactory.WaitPipeline(pipelineFactory.RequestCompute(desc)) == VK_NULL_HANDLE) {
+            PRINT_E("Failed to create the first pipeline");
+            return APP_CODE_VK_COMMAND_FAIURE;
+        }
+        double startupTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                                                                       initStart).count();
+        PRINT("Startup benchmark: %.3f ms from the app init to the first pipeline, %s start (%.3f ms cache load)",
+              startupTime, pipelineCache.GetStats().loadedFromDisk ? "warm" : "cold",
+              pipelineCache.GetStats().loadTime);
+
+        // Compute shaders of the app, with the layout they are used with
+        std::vector<std::string> shaders = {
+            PipelineFactory::GetShaderPath("frustum_cull.comp"),
+            PipelineFactory::GetShaderPath("vt_feedback.comp"),
+        };
+        APP_CHECK_CALL(RunPipelineCacheBenchmark(dev, bindlessTable.GetPipelineLayout(), shaders));
+    }
+    if (options.recordBenchJobs) {
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size        = recordBenchBufferSize;
+        bufferInfo.usage       = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VkBuffer buffer = VK_NULL_HANDLE;
+        MemoryAllocation* allocation = nullptr;
+        APP_CHECK_CALL(memoryAllocator.CreateBuffer(bufferInfo, MemoryAllocator::MemoryUsage::GpuOnly, buffer,
+                                                    allocation));
+        AppResult result = RunRecordBenchmark(dev, physDevInfo.familiesIndicies.graphics.value(), buffer,
+                                              options.recordBenchJobs);
+        memoryAllocator.DestroyBuffer(buffer, allocation);
+        APP_CHECK_CALL(result);
+    }
+    if (options.capsBench) {
+        APP_CHECK_CALL(RunCapabilitySnapshotBenchmark());
+    }
+
+    return APP_CODE_OK;
+}
+
+AppResult VulkanApp::RunCapabilitySnapshotBenchmark() {
+
+    // Own file, the snapshot of the app stays untouched
+    std::string appSnapshotPath = options.capsSnapshotPath;
+    options.capsSnapshotPath = MakeTempPath(appSnapshotPath.empty() ? APP_DEFAULT_CAPS_SNAPSHOT_PATH : appSnapshotPath);
+
+    // Cold runs query the driver and write the snapshot, warm runs load it
+    AppResult result = APP_CODE_OK;
+    std::vector<double> coldTimes, warmTimes;
+    for (int i = 0; i < benchIterations && APP_CHECK_RESULT(result); ++i) {
+        for (bool cold : { true, false }) {
+            if (cold) {
+                std::remove(options.capsSnapshotPath.c_str());
+            }
+            PhysDevList devices;
+            auto start = std::chrono::steady_clock::now();
+            result = GetPhysicalDevicesInfos(devices);
+            (cold ? coldTimes : warmTimes).push_back(
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+            if (!APP_CHECK_RESULT(result)) {
+                break;
+            }
+        }
+    }
+
+    std::remove(options.capsSnapshotPath.c_str());
+    options.capsSnapshotPath = appSnapshotPath;
+    if (!APP_CHECK_RESULT(result)) {
+        return result;
+    }
+
+    double coldTime = Median(coldTimes);
+    double warmTime = Median(warmTimes);
+    PRINT("Capabilities snapshot benchmark:");
+    PRINT("  cold snapshot %.3f ms, warm snapshot %.3f ms (x%.2f)", coldTime, warmTime,
+          warmTime > 0.0 ? coldTime / warmTime : 0.0);
     return APP_CODE_OK;
 }
 
 void VulkanApp::Clear() {
-    VkExt::DestroyDebugUtilsMessengerEXT(vkInst, debugMessenger, nullptr);
-    vkDestroyDevice(dev, nullptr);
-    vkDestroyInstance(vkInst, nullptr);
+    if (dev != VK_NULL_HANDLE) {
+        vkDeviceWaitIdle(dev);
+        if (multiGpu.IsEnabled()) {
+            multiGpu.PrintStats();
+        }
+        multiGpu.Clear();
+        gpuCuller.PrintStats();
+        gpuCuller.Clear();
+        cpuCuller.PrintStats();
+        cpuCuller.Clear();
+        virtualTexture.PrintStats();
+        virtualTexture.Clear();
+        gpuMesh.PrintStats();
+        gpuMesh.Clear();
+        renderGraph.PrintStats();
+        renderGraph.Clear();
+        swapchain.PrintStats();
+        swapchain.Clear();
+        offscreenTarget.Clear();
+        if (stressBuffer != VK_NULL_HANDLE) {
+            memoryAllocator.DestroyBuffer(stressBuffer, stressMemory);
+            stressBuffer = VK_NULL_HANDLE;
+            stressMemory = nullptr;
+        }
+        stagingRing.PrintStats();
+        stagingRing.Clear();
+        pipelineFactory.PrintStats();
+        pipelineFactory.Clear();
+        pipelineCache.Clear();
+        bindlessTable.PrintStats();
+        bindlessTable.Clear();
+        memoryAllocator.PrintStats();
+        memoryAllocator.Clear();
+        sparseQueue.Clear();
+        transferQueue.Clear();
+        computeQueue.Clear();
+        commandRecorder.PrintStats();
+        commandRecorder.Clear();
+        jobSystem.PrintStats();
+        jobSystem.Clear();
+        // Collects GPU scopes of the last frames
+        gpuProfiler.Clear();
+        frameScheduler.Clear();
+        if (!options.profilePath.empty()) {
+            Profiler::Inst().SaveChromeTrace(options.profilePath.c_str());
+        }
+        Profiler::Inst().PrintStats();
+        vkDestroyDevice(dev, nullptr);
+        graphicsQueue = VK_NULL_HANDLE;
+        dev           = VK_NULL_HANDLE;
+    }
+    if (vkInst != VK_NULL_HANDLE) {
+        if (debugMessenger != VK_NULL_HANDLE) {
+            VkExt::DestroyDebugUtilsMessengerEXT(vkInst, debugMessenger, nullptr);
+            debugMessenger = VK_NULL_HANDLE;
+        }
+        if (surface != VK_NULL_HANDLE) {
+            vkDestroySurfaceKHR(vkInst, surface, nullptr);
+            surface = VK_NULL_HANDLE;
+        }
+        vkDestroyInstance(vkInst, nullptr);
+        vkInst = VK_NULL_HANDLE;
+        capabilities.Clear();
+    }
 }
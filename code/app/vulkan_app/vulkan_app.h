@@ -1,9 +1,32 @@
 #pragma once
 
+#include <app_options.h>
 #include <app_result.h>
 #include <logs.h>
+#include <scene/cpu_culler.h>
+#include <utils/job_system.h>
+#include <vulkan_app/async_queue.h>
+#include <vulkan_app/bindless_table.h>
+#include <vulkan_app/capability_registry.h>
+#include <vulkan_app/capability_snapshot.h>
+#include <vulkan_app/command_recorder.h>
+#include <vulkan_app/feature_set.h>
+#include <vulkan_app/frame_scheduler.h>
+#include <vulkan_app/gpu_culler.h>
+#include <vulkan_app/gpu_mesh.h>
+#include <vulkan_app/gpu_profiler.h>
+#include <vulkan_app/memory_allocator.h>
+#include <vulkan_app/multi_gpu.h>
+#include <vulkan_app/offscreen_target.h>
+#include <vulkan_app/pipeline_cache.h>
+#include <vulkan_app/pipeline_factory.h>
+#include <vulkan_app/render_graph.h>
+#include <vulkan_app/staging_ring.h>
+#include <vulkan_app/swapchain.h>
+#include <vulkan_app/virtual_texture.h>
 #include <vulkan_app/vk_base.h>
 
+#include <chrono>
 #include <map>
 #include <optional>
 #include <vector>
@@ -19,14 +42,46 @@ protected:
     AppResult LoopFunc();
     virtual void Clear();
 
+    // Wait for the rendered frames and report headless statistics
+    AppResult FinishHeadlessRendering();
+    // Benchmark of a device subsystem is requested by the options, it runs instead of the frames
+    bool IsBenchmarkRequested() const;
+    AppResult RunBenchmark();
+
+    // Window hooks implemented by the app owning the window
+    virtual AppResult CreateSurface(VkInstance instance, VkSurfaceKHR& surface);
+    virtual VkExtent2D GetFramebufferExtent() const;
+
+    // Rebuild the swapchain for the new window size before the next frame
+    void OnFramebufferResize(uint32_t width, uint32_t height);
+    // Switch to the next present mode policy
+    void CyclePresentPolicy();
+    uint64_t GetPresentedFramesCount() const { return swapchain.GetStats().presents; }
+
 // App init Private methods
 private:
 
     AppResult CreateVkInstance();
     AppResult FindPhysicalDevice();
     AppResult CreateLogicalDevice();
+    AppResult InitHeadless();
+    AppResult InitWindowed();
 
-    typedef std::vector<const char*> NamesList;
+// Frame rendering Private methods
+private:
+
+    AppResult RenderHeadlessFrame();
+    AppResult RenderWindowFrame();
+    // Record the swapchain image passes through the render graph
+    AppResult RecordPresentGraph(VkCommandBuffer cmd, uint32_t frameIndex, uint32_t imageIndex,
+                                 const VkClearColorValue& color);
+    // Record the offscreen passes through the render graph: content, multi-GPU composite and readback
+    AppResult RecordOffscreenGraph(VkCommandBuffer cmd, uint32_t frameIndex,
+                                   const std::vector<VkCommandBuffer>& secondaryBuffers);
+    // Stream options.stagingStressSize bytes through the staging ring
+    AppResult UploadStressData();
+
+    typedef CapabilityRegistry::NamesList NamesList;
 
     // Vulkan extensions' list
     typedef NamesList ExtensionsList;
@@ -51,28 +106,62 @@ private:
 
     struct QueueFamIndicies {
         std::optional<uint32_t> graphics;
-        // std::optional<uint32_t> compute;
-        // std::optional<uint32_t> transfer;
-        // std::optional<uint32_t> sparseBinding;
+        // Prefers a family without graphics to run asynchronously, falls back to the graphics one
+        std::optional<uint32_t> compute;
+        // Prefers a transfer only family (DMA engine), falls back to the compute and graphics ones
+        std::optional<uint32_t> transfer;
+        // Prefers a family without graphics, so binds don't wait behind the frames
+        std::optional<uint32_t> sparseBinding;
         // std::optional<uint32_t> videoEncode;
         // std::optional<uint32_t> opticalFlow;
     };
 
     struct PhysDevInfo {
-        std::vector<VkExtensionProperties> extensions;
+        NameSet extensions;
         std::vector<VkQueueFamilyProperties> familiesProps;
         QueueFamIndicies familiesIndicies;
-        VkPhysicalDeviceFeatures features;
+        // Structs of the versions unsupported by device are zeroed
+        FeatureSet features;
         VkPhysicalDeviceMemoryProperties memoryProps;
+        // Filled if device supports VK_EXT_memory_budget, zeroed otherwise
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT memoryBudget;
         VkPhysicalDeviceProperties properties;
+        // Filled if device supports Vulkan 1.1, zeroed otherwise
+        VkPhysicalDeviceIDProperties idProps;
     };
 
     typedef std::map<VkPhysicalDevice, PhysDevInfo> PhysDevList;
 
+    // Devices are probed concurrently. Known devices are taken from the capabilities snapshot
     AppResult GetPhysicalDevicesInfos(PhysDevList& physDevList);
+    // Time GetPhysicalDevicesInfos without a snapshot file against a loaded one. Doesn't touch the app snapshot
+    AppResult RunCapabilitySnapshotBenchmark();
     /**
      * @brief
-     * Check if physical evices support specified features and have a graphics family
+     * Get device capabilities
+     * @param device
+     * physical device
+     * @param snapshot
+     * loaded snapshot to take the capabilities from or nullptr to query all of them
+     * @param devInfo
+     * device capabilities
+     * @return
+     * true if the capabilities were found in the snapshot
+    */
+    static bool ProbePhysDevice(VkPhysicalDevice device, const CapabilitySnapshot* snapshot, PhysDevInfo& devInfo);
+    /**
+     * @brief
+     * Rank a suitable device by options.devicePolicy
+     * @param devInfo
+     * device properties
+     * @return
+     * score of the device. The highest one is used
+    */
+    double ScorePhysDevice(const PhysDevInfo& devInfo) const;
+    /**
+     * @brief
+     * Check if physical evices support specified features and have a graphics family.
+     * The graphics family must present to the surface if there is one
      * @param devices
      * list of devices with treir properties
      * @param unsuitableDevices
@@ -123,19 +212,79 @@ class VkExt {
 // Vulkan objects
 private:
 
-    VkInstance vkInst;
-    VkPhysicalDevice physDev;
+    VkInstance vkInst = VK_NULL_HANDLE;
+    CapabilityRegistry capabilities;
+    VkPhysicalDevice physDev = VK_NULL_HANDLE;
     PhysDevInfo physDevInfo;
-    VkDevice dev;
+    // Suitable GPUs besides physDev used by multi-GPU rendering
+    std::vector<MultiGpuRenderer::DeviceDesc> secondaryDevices;
+    VkDevice dev = VK_NULL_HANDLE;
+    VkQueue graphicsQueue = VK_NULL_HANDLE;
+    // Optional features enabled by CreateLogicalDevice when the options use them and the GPU supports them
+    bool timelineSemaphores = false;
+    bool descriptorIndexing = false;
+    // Created with timeline semaphores
+    AsyncQueue computeQueue;
+    AsyncQueue transferQueue;
+    // Created if the virtual texture uses sparse residency
+    AsyncQueue sparseQueue;
+
+    FrameScheduler frameScheduler;
+    CommandRecorder commandRecorder;
+    GpuProfiler gpuProfiler;
+    // CPU work of the frames split into jobs
+    JobSystem jobSystem;
 
     struct RequiredParams {
         ExtensionsList instanseExtensions;
         ExtensionsList deviceExtensions;
-        VkPhysicalDeviceFeatures deviceFeatures;
+        FeatureSet deviceFeatures;
         LayersList validationLayers;
     } requiredParams;
 
-    VkDebugUtilsMessengerEXT debugMessenger;
+    VkDebugUtilsMessengerEXT debugMessenger = VK_NULL_HANDLE;
+
+    MemoryAllocator memoryAllocator;
+    PipelineCache pipelineCache;
+    PipelineFactory pipelineFactory;
+    StagingRing stagingRing;
+    BindlessTable bindlessTable;
+
+
+// Headless rendering objects
+private:
+
+    OffscreenTarget offscreenTarget;
+    // Passes of the offscreen frame and their barriers
+    RenderGraph renderGraph;
+    GpuCuller gpuCuller;
+    CpuCuller cpuCuller;
+    VirtualTexture virtualTexture;
+    GpuMesh gpuMesh;
+    // Distance of the camera orbiting the culling scene
+    float cullingSceneRadius = 0.0f;
+    MultiGpuRenderer multiGpu;
+    VkBuffer stressBuffer = VK_NULL_HANDLE;
+    MemoryAllocation* stressMemory = nullptr;
+    uint64_t renderedFrames = 0;
+    std::chrono::steady_clock::time_point renderStart;
+
+
+// Window rendering objects
+private:
+
+    VkSurfaceKHR surface = VK_NULL_HANDLE;
+    Swapchain swapchain;
+
+
+// Runtime options
+protected:
+
+    AppOptions options;
+    // Time the input of the next frame was sampled. Set by the app polling the window events
+    std::chrono::steady_clock::time_point inputTime;
+    // Start of the app initialization. Set by the app, startup is measured from it
+    std::chrono::steady_clock::time_point initStart;
 
 
 // friend class App;
@@ -0,0 +1,156 @@
+#include <log_benchmark.h>
+
+#include <logs.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#if defined(WIN32) || defined(_WIN32)
+#include <io.h>
+#define close  _close
+#define dup    _dup
+#define dup2   _dup2
+#define fileno _fileno
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+#if defined(WIN32) || defined(_WIN32)
+constexpr const char* nullDevice = "NUL";
+#else
+constexpr const char* nullDevice = "/dev/null";
+#endif
+
+// Tag and location of the benchmark messages, the same for both paths
+constexpr const char* benchTag = "LogBench";
+// Async messages are logged in bursts fitting the thread ring, a message takes less than 256 bytes
+constexpr uint32_t asyncBurst = LOGS_RING_SIZE / 256;
+
+// Latencies and throughput of a logging path
+struct PathStats {
+    double messagesPerSecond = 0.0;
+    // Call latencies, ns
+    double p50 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+};
+
+/**
+ * @brief
+ * Point stdout to the null device for the lifetime of the object and restore it after
+*/
+class NullStdout {
+
+public:
+
+    NullStdout() {
+        std::fflush(stdout);
+        savedFd = dup(fileno(stdout));
+        if (savedFd >= 0 && !std::freopen(nullDevice, "w", stdout)) {
+            savedFd = -1;
+        }
+    }
+
+    ~NullStdout() {
+        std::fflush(stdout);
+        if (savedFd >= 0) {
+            dup2(savedFd, fileno(stdout));
+            close(savedFd);
+        }
+    }
+
+    bool IsRedirected() const { return savedFd >= 0; }
+
+private:
+
+    int savedFd = -1;
+};
+
+double Percentile(std::vector<double>& values, double percentile) {
+    size_t index = std::min(values.size() - 1, static_cast<size_t>(percentile * values.size()));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+/**
+ * @brief
+ * Log the messages with the callable and measure every call
+ * @param burst
+ * count of messages logged before waiting for them to be written
+ * @param log
+ * callable taking the message index
+ * @param flush
+ * callable returning when all the messages are written
+*/
+template<class Log, class Flush>
+PathStats MeasurePath(uint32_t messagesCount, uint32_t burst, Log&& log, Flush&& flush) {
+
+    std::vector<double> latencies;
+    latencies.reserve(messagesCount);
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < messagesCount; ++i) {
+        auto callStart = std::chrono::steady_clock::now();
+        log(i);
+        latencies.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - callStart).count());
+        if ((i + 1) % burst == 0) {
+            flush();
+        }
+    }
+    flush();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    PathStats stats;
+    stats.messagesPerSecond = seconds > 0.0 ? messagesCount / seconds : 0.0;
+    stats.max = *std::max_element(latencies.begin(), latencies.end());
+    stats.p99 = Percentile(latencies, 0.99);
+    stats.p50 = Percentile(latencies, 0.50);
+    return stats;
+}
+
+} // namespace
+
+AppResult RunLogBenchmark(uint32_t messagesCount) {
+
+    // Arguments of a typical message: integers, a string and a float
+    const char* fmt = "Frame %u of %u: pass %s took %.3f ms";
+    const char* pass = "opaque";
+    auto time = [](uint32_t i) { return 0.5 + (i % 100) * 0.01; };
+
+    // Logger thread is started before the measurement
+    auto& logger = logs::Logger::Inst();
+    uint64_t droppedBefore = logger.GetDroppedCount();
+
+    PathStats syncStats, asyncStats;
+    {
+        NullStdout nullStdout;
+        if (!nullStdout.IsRedirected()) {
+            PRINT_E("Failed to redirect stdout to %s", nullDevice);
+            return APP_CODE_IO_FAILURE;
+        }
+        syncStats = MeasurePath(messagesCount, messagesCount, [&](uint32_t i) {
+            _app_log_print(LOGS_LVL_INFO, benchTag, __FILE__, __LINE__, fmt, i, messagesCount, pass, time(i));
+        }, [] { std::fflush(stdout); });
+        asyncStats = MeasurePath(messagesCount, asyncBurst, [&](uint32_t i) {
+            logger.Log(LOGS_LVL_INFO, benchTag, __FILE__, __LINE__, fmt, i, messagesCount, pass, time(i));
+        }, [&] { logger.Flush(); });
+    }
+    // Dropped messages are not written
+    uint64_t dropped = logger.GetDroppedCount() - droppedBefore;
+    asyncStats.messagesPerSecond *= static_cast<double>(messagesCount - dropped) / messagesCount;
+
+    PRINT("Log benchmark: %u messages", messagesCount);
+    PRINT("  sync : %.0f messages/s, call p50 %.0f ns, p99 %.0f ns, max %.0f ns",
+          syncStats.messagesPerSecond, syncStats.p50, syncStats.p99, syncStats.max);
+    PRINT("  async: %.0f messages/s, call p50 %.0f ns, p99 %.0f ns, max %.0f ns, %llu dropped",
+          asyncStats.messagesPerSecond, asyncStats.p50, asyncStats.p99, asyncStats.max,
+          static_cast<unsigned long long>(dropped));
+    if (dropped) {
+        PRINT_W("Async messages were dropped by the full ring, increase LOGS_RING_SIZE to measure all of them");
+    }
+    return APP_CODE_OK;
+}
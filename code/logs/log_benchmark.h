@@ -0,0 +1,18 @@
+#pragma once
+
+#include <app_result.h>
+
+#include <cstdint>
+
+/**
+ * @brief
+ * Benchmark printing messages right on the calling thread against the asynchronous Logger.
+ * Reports the throughput until the messages are written and the latency of the logging call.
+ * Async messages are logged in bursts fitting the thread ring and written before the next burst, so none are dropped.
+ * Messages are written to the null device, so the terminal speed doesn't hide the difference
+ * @param messagesCount
+ * count of messages logged by every path
+ * @return
+ * AppResult code
+*/
+AppResult RunLogBenchmark(uint32_t messagesCount);
@@ -0,0 +1,32 @@
+#include <log_filter.h>
+
+namespace logs {
+
+// Constant initialized, so levels are valid for the messages of static constructors too
+static_assert(tagsCount == 2, "runtime levels of new tags must be initialized");
+std::atomic<int> runtimeLevels[tagsCount + 1] = {
+    { tagsConfigs[0].defaultLevel },
+    { tagsConfigs[1].defaultLevel },
+    { LOGS_COMPILED_LEVEL },
+};
+
+void SetTagLevel(std::string_view tag, int level) {
+    runtimeLevels[TagIndex(tag)].store(level, std::memory_order_relaxed);
+}
+
+int GetTagLevel(std::string_view tag) {
+    return runtimeLevels[TagIndex(tag)].load(std::memory_order_relaxed);
+}
+
+bool ParseLevel(std::string_view name, int& level) {
+    constexpr std::string_view names[] = { "error", "warning", "info", "verbose" };
+    for (int i = 0; i < static_cast<int>(std::size(names)); ++i) {
+        if (name == names[i]) {
+            level = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace logs
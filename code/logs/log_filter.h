@@ -0,0 +1,79 @@
+#pragma once
+
+#include <app_consts.h>
+
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <string_view>
+
+#define LOGS_DEFAULT_TAG "JNK"
+#define LOGS_LAYER_TAG "validation layer"
+
+// Log levels. Message is printed if its level is not greater than the level of its tag
+
+#define LOGS_LEVEL_ERROR   0
+#define LOGS_LEVEL_WARNING 1
+#define LOGS_LEVEL_INFO    2
+#define LOGS_LEVEL_VERBOSE 3
+
+namespace logs {
+
+struct TagConfig {
+    const char* tag;
+    // Messages of greater levels are not compiled
+    int compiledLevel;
+    // Runtime level of the tag at startup
+    int defaultLevel;
+};
+
+// Tags with their own levels. Other tags use LOGS_COMPILED_LEVEL
+constexpr TagConfig tagsConfigs[] = {
+    { LOGS_DEFAULT_TAG, LOGS_COMPILED_LEVEL, LOGS_COMPILED_LEVEL },
+    // Verbose layer messages are compiled in whatever DEBUG_LOGS is, but must be switched on at runtime
+    { LOGS_LAYER_TAG,   LOGS_LEVEL_VERBOSE,  LOGS_LEVEL_WARNING  },
+};
+constexpr size_t tagsCount = std::size(tagsConfigs);
+
+constexpr size_t TagIndex(std::string_view tag) {
+    for (size_t i = 0; i < tagsCount; ++i) {
+        if (tag == tagsConfigs[i].tag) {
+            return i;
+        }
+    }
+    // Slot shared by the unlisted tags
+    return tagsCount;
+}
+
+constexpr int CompiledLevel(std::string_view tag) {
+    size_t index = TagIndex(tag);
+    return (index < tagsCount) ? tagsConfigs[index].compiledLevel : LOGS_COMPILED_LEVEL;
+}
+
+// Runtime levels of the tags, the last one is for the unlisted tags
+extern std::atomic<int> runtimeLevels[tagsCount + 1];
+
+inline bool IsEnabled(size_t tagIndex, int level) {
+    return level <= runtimeLevels[tagIndex].load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief
+ * Change runtime level of a tag. Levels above the compiled one have no effect
+ * @param tag
+ * tag from tagsConfigs. Any other changes level of all the unlisted tags
+ * @param level
+ * new level
+*/
+void SetTagLevel(std::string_view tag, int level);
+int GetTagLevel(std::string_view tag);
+
+/**
+ * @brief
+ * Parse a level name: "error", "warning", "info" or "verbose"
+ * @return
+ * false if the name is unknown
+*/
+bool ParseLevel(std::string_view name, int& level);
+
+} // namespace logs
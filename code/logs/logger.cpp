@@ -0,0 +1,294 @@
+#include <logger.h>
+
+#include <log_color.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <string_view>
+
+namespace logs {
+
+namespace {
+
+// Holds the ring of a thread and releases it for reuse when the thread exits
+struct ThreadRingHolder {
+    LogRing* ring = nullptr;
+    ~ThreadRingHolder() {
+        if (ring) {
+            ring->owned.store(false, std::memory_order_release);
+        }
+    }
+};
+
+thread_local ThreadRingHolder threadRing;
+
+/**
+ * @brief
+ * Format a single printf conversion with a decoded argument
+ * @param spec
+ * conversion specification from the format string, '%' to the conversion character inclusive
+ * @param type
+ * type of the argument
+ * @param bits
+ * argument value for scalar types
+ * @param str
+ * argument value for strings
+ * @param out
+ * string to append to
+*/
+void FormatArg(std::string_view spec, ArgType type, uint64_t bits, const std::string& str, std::string& out) {
+
+    // Rebuild the specification with a length modifier matching the stored type
+    char conversion = spec.back();
+    std::string fmt;
+    for (char c : spec.substr(0, spec.size() - 1)) {
+        if (!std::strchr("hljztL", c)) {
+            fmt += c;
+        }
+    }
+
+    char buffer[512];
+    int length = -1;
+    switch (conversion) {
+        case 'd': case 'i': {
+            fmt += "lld";
+            long long value = static_cast<long long>(static_cast<int64_t>(bits));
+            length = std::snprintf(buffer, sizeof(buffer), fmt.c_str(), value);
+        } break;
+        case 'u': case 'o': case 'x': case 'X': {
+            fmt += "ll";
+            fmt += conversion;
+            unsigned long long value = static_cast<unsigned long long>(bits);
+            length = std::snprintf(buffer, sizeof(buffer), fmt.c_str(), value);
+        } break;
+        case 'c': {
+            fmt += conversion;
+            length = std::snprintf(buffer, sizeof(buffer), fmt.c_str(), static_cast<int>(bits));
+        } break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A': {
+            fmt += conversion;
+            double value = 0.0;
+            if (type == ArgType::Double) {
+                std::memcpy(&value, &bits, sizeof(value));
+            } else {
+                value = static_cast<double>(static_cast<int64_t>(bits));
+            }
+            length = std::snprintf(buffer, sizeof(buffer), fmt.c_str(), value);
+        } break;
+        case 's': {
+            if (type == ArgType::String) {
+                // Long strings are appended as is, width and precision are ignored for them
+                if (str.size() >= sizeof(buffer) / 2) {
+                    out += str;
+                    return;
+                }
+                fmt += conversion;
+                length = std::snprintf(buffer, sizeof(buffer), fmt.c_str(), str.c_str());
+            }
+        } break;
+        case 'p': {
+            fmt += conversion;
+            length = std::snprintf(buffer, sizeof(buffer), fmt.c_str(), reinterpret_cast<void*>(static_cast<uintptr_t>(bits)));
+        } break;
+        default:
+            break;
+    }
+
+    if (length < 0) {
+        out += "<bad arg>";
+        return;
+    }
+    out.append(buffer, std::min<size_t>(static_cast<size_t>(length), sizeof(buffer) - 1));
+}
+
+} // namespace
+
+
+LogRing::LogRing(uint32_t capacity)
+    : data(new uint8_t[capacity])
+    , capacity(capacity) {}
+
+uint8_t* LogRing::Reserve(uint32_t size) {
+
+    uint64_t writePos = head.load(std::memory_order_relaxed);
+    uint64_t readPos = tail.load(std::memory_order_acquire);
+    uint32_t pos = static_cast<uint32_t>(writePos % capacity);
+
+    // Record doesn't fit before the ring end, skip the rest
+    uint32_t padding = (pos + size > capacity) ? capacity - pos : 0;
+    if (uint64_t(padding) + size > capacity - (writePos - readPos)) {
+        return nullptr;
+    }
+
+    if (padding) {
+        std::memcpy(&data[pos], &padding, sizeof(padding));
+        std::memcpy(&data[pos + sizeof(padding)], &paddingMark, sizeof(paddingMark));
+        pos = 0;
+    }
+    pendingPadding = padding;
+    return &data[pos];
+}
+
+void LogRing::Commit(uint32_t size) {
+    uint64_t writePos = head.load(std::memory_order_relaxed);
+    head.store(writePos + pendingPadding + size, std::memory_order_release);
+    pendingPadding = 0;
+}
+
+
+std::atomic<bool> Logger::destroyed{ false };
+
+Logger& Logger::Inst() {
+    static Logger inst;
+    return inst;
+}
+
+Logger::Logger() {
+    worker = std::thread(&Logger::WorkerFunc, this);
+}
+
+Logger::~Logger() {
+    stopping.store(true, std::memory_order_release);
+    if (worker.joinable()) {
+        worker.join();
+    }
+    Flush();
+
+    auto droppedCount = GetDroppedCount();
+    if (droppedCount) {
+        std::printf("Logger dropped %" PRIu64 " of %" PRIu64 " messages. Increase LOGS_RING_SIZE\n",
+                    droppedCount, droppedCount + GetWrittenCount());
+        std::fflush(stdout);
+    }
+    destroyed.store(true, std::memory_order_release);
+}
+
+LogRing* Logger::GetThreadRing() {
+
+    if (threadRing.ring) {
+        return threadRing.ring;
+    }
+
+    std::lock_guard<std::mutex> lock(registerMutex);
+
+    // Reuse a ring of an exited thread
+    uint32_t count = ringsCount.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < count; ++i) {
+        bool expected = false;
+        if (rings[i]->owned.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            threadRing.ring = rings[i].get();
+            return threadRing.ring;
+        }
+    }
+
+    if (count == LOGS_MAX_THREAD_RINGS) {
+        // Memory budget is exhausted, messages of the thread are dropped
+        return nullptr;
+    }
+    rings[count] = std::make_unique<LogRing>(LOGS_RING_SIZE);
+    rings[count]->owned.store(true, std::memory_order_relaxed);
+    ringsCount.store(count + 1, std::memory_order_release);
+
+    threadRing.ring = rings[count].get();
+    return threadRing.ring;
+}
+
+void Logger::WorkerFunc() {
+    while (!stopping.load(std::memory_order_acquire)) {
+        uint32_t printed = 0;
+        {
+            std::lock_guard<std::mutex> lock(drainMutex);
+            printed = Drain();
+        }
+        if (!printed) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(LOGS_FLUSH_PERIOD_MS));
+        }
+    }
+}
+
+void Logger::Flush() {
+    std::lock_guard<std::mutex> lock(drainMutex);
+    Drain();
+}
+
+uint32_t Logger::Drain() {
+
+    std::string out;
+    uint32_t printed = 0;
+    uint32_t count = ringsCount.load(std::memory_order_acquire);
+
+    for (uint32_t i = 0; i < count; ++i) {
+        printed += rings[i]->Consume([this, &out](const uint8_t* record) { FormatRecord(record, out); });
+    }
+
+    if (!out.empty()) {
+        std::fwrite(out.data(), 1, out.size(), stdout);
+        std::fflush(stdout);
+    }
+    return printed;
+}
+
+void Logger::FormatRecord(const uint8_t* record, std::string& out) const {
+
+    RecordHeader header;
+    std::memcpy(&header, record, sizeof(header));
+
+    char prefix[256];
+    int length = std::snprintf(prefix, sizeof(prefix), "%s  (%s:%d)\t%s\t: ", header.tag, header.file, header.line, header.lvl);
+    out.append(prefix, std::min<size_t>(static_cast<size_t>(std::max(length, 0)), sizeof(prefix) - 1));
+
+    const uint8_t* argPtr = record + sizeof(header);
+    uint32_t argsLeft = header.argsCount;
+    std::string str;
+
+    for (const char* c = header.fmt; *c; ++c) {
+        if (*c != '%') {
+            out += *c;
+            continue;
+        }
+        if (c[1] == '%') {
+            out += '%';
+            ++c;
+            continue;
+        }
+
+        // Find the conversion character
+        const char* specEnd = c + 1;
+        while (*specEnd && !std::strchr("diouxXcfFeEgGaAsp", *specEnd)) {
+            ++specEnd;
+        }
+        if (!*specEnd || !argsLeft) {
+            out.append(c, *specEnd ? specEnd - c + 1 : specEnd - c);
+            if (!*specEnd) {
+                break;
+            }
+            c = specEnd;
+            continue;
+        }
+        std::string_view spec(c, specEnd - c + 1);
+
+        // Decode the next argument
+        ArgType type = static_cast<ArgType>(*argPtr++);
+        uint64_t bits = 0;
+        if (type == ArgType::String) {
+            uint32_t strLength;
+            std::memcpy(&strLength, argPtr, sizeof(strLength));
+            argPtr += sizeof(strLength);
+            str.assign(reinterpret_cast<const char*>(argPtr), strLength);
+            argPtr += strLength;
+        } else {
+            std::memcpy(&bits, argPtr, sizeof(bits));
+            argPtr += sizeof(bits);
+        }
+        --argsLeft;
+
+        FormatArg(spec, type, bits, str, out);
+        c = specEnd;
+    }
+
+    out += "\n" COLOR_RESET;
+}
+
+} // namespace logs
@@ -0,0 +1,248 @@
+#pragma once
+
+#include <app_consts.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+namespace logs {
+
+/**
+ * @brief
+ * Single producer single consumer ring of variable sized records. Producer is the logging thread,
+ * consumer is the logger thread. Records never wrap: the ring end is filled with a padding record
+*/
+class LogRing {
+
+public:
+
+    explicit LogRing(uint32_t capacity);
+
+    // Producer. Get space for a record or nullptr if the ring is full
+    uint8_t* Reserve(uint32_t size);
+    // Producer. Publish the reserved record
+    void Commit(uint32_t size);
+
+    /**
+     * @brief
+     * Consumer. Process all the published records
+     * @param func
+     * callable taking const uint8_t* of a record
+     * @return
+     * count of processed records
+    */
+    template<class Func>
+    uint32_t Consume(Func&& func);
+
+    bool IsEmpty() const { return head.load(std::memory_order_acquire) == tail.load(std::memory_order_relaxed); }
+
+    // Ring is used by a living thread
+    std::atomic<bool> owned{ false };
+
+private:
+
+    // Marks the padding before the ring end
+    static constexpr uint32_t paddingMark = ~0u;
+
+    std::unique_ptr<uint8_t[]> data;
+    uint32_t capacity;
+    // Producer only. Padding to be published together with the reserved record
+    uint32_t pendingPadding = 0;
+
+    alignas(64) std::atomic<uint64_t> head{ 0 };
+    alignas(64) std::atomic<uint64_t> tail{ 0 };
+};
+
+// Type of a binary encoded message argument
+enum class ArgType : uint8_t {
+    Int,
+    UInt,
+    Double,
+    String,
+    Pointer,
+};
+
+// Header of a binary encoded message. Arguments follow it
+struct RecordHeader {
+    // Size of the whole record, multiple of 8
+    uint32_t size;
+    uint32_t argsCount;
+    const char* lvl;
+    const char* tag;
+    const char* file;
+    const char* fmt;
+    int line;
+};
+
+/**
+ * @brief
+ * Asynchronous logger. Messages are binary encoded into a per-thread lock-free ring
+ * without formatting, a background thread formats and prints them.
+ * Memory is bounded by LOGS_RING_SIZE * LOGS_MAX_THREAD_RINGS, messages which don't fit are dropped
+*/
+class Logger {
+
+public:
+
+    static Logger& Inst();
+
+    template<class... Args>
+    void Log(const char* lvl, const char* tag, const char* file, int line, const char* fmt, const Args&... args);
+    // Block until all the messages logged before are printed
+    void Flush();
+
+    uint64_t GetWrittenCount() const { return written.load(std::memory_order_relaxed); }
+    uint64_t GetDroppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+    // Logger is already destroyed on exit, messages must be printed synchronously
+    static bool IsDestroyed() { return destroyed.load(std::memory_order_acquire); }
+
+private:
+
+    Logger();
+    Logger(const Logger&) = delete;
+    ~Logger();
+
+    LogRing* GetThreadRing();
+    void WorkerFunc();
+    // Print all the published records. Returns count of printed ones
+    uint32_t Drain();
+    void FormatRecord(const uint8_t* record, std::string& out) const;
+
+    template<class T>
+    static uint32_t ArgSize(const T& arg);
+    template<class T>
+    static uint8_t* EncodeArg(uint8_t* ptr, const T& arg);
+
+private:
+
+    static std::atomic<bool> destroyed;
+
+    // Rings are registered once per thread and reused after the thread exits
+    std::unique_ptr<LogRing> rings[LOGS_MAX_THREAD_RINGS];
+    std::atomic<uint32_t> ringsCount{ 0 };
+    std::mutex registerMutex;
+
+    std::atomic<uint64_t> written{ 0 };
+    std::atomic<uint64_t> dropped{ 0 };
+
+    std::thread worker;
+    std::atomic<bool> stopping{ false };
+    // Only one consumer of the rings at a time: the logger thread or Flush caller
+    std::mutex drainMutex;
+};
+
+
+template<class Func>
+uint32_t LogRing::Consume(Func&& func) {
+    uint64_t readPos = tail.load(std::memory_order_relaxed);
+    uint64_t writePos = head.load(std::memory_order_acquire);
+    uint32_t count = 0;
+
+    while (readPos != writePos) {
+        const uint8_t* record = &data[readPos % capacity];
+        uint32_t size;
+        uint32_t mark;
+        std::memcpy(&size, record, sizeof(size));
+        std::memcpy(&mark, record + sizeof(size), sizeof(mark));
+        if (mark != paddingMark) {
+            func(record);
+            ++count;
+        }
+        readPos += size;
+    }
+
+    tail.store(readPos, std::memory_order_release);
+    return count;
+}
+
+
+template<class T>
+uint32_t Logger::ArgSize(const T& arg) {
+    if constexpr (std::is_same_v<std::decay_t<T>, const char*> || std::is_same_v<std::decay_t<T>, char*>) {
+        size_t length = arg ? strnlen(arg, LOGS_MAX_STRING_LENGTH) : 0;
+        return static_cast<uint32_t>(1 + sizeof(uint32_t) + length);
+    } else {
+        return 1 + sizeof(uint64_t);
+    }
+}
+
+template<class T>
+uint8_t* Logger::EncodeArg(uint8_t* ptr, const T& arg) {
+    typedef std::decay_t<T> Type;
+
+    if constexpr (std::is_same_v<Type, const char*> || std::is_same_v<Type, char*>) {
+        // Strings are copied, the pointer may die before the record is printed
+        uint32_t length = arg ? static_cast<uint32_t>(strnlen(arg, LOGS_MAX_STRING_LENGTH)) : 0;
+        *ptr++ = static_cast<uint8_t>(ArgType::String);
+        std::memcpy(ptr, &length, sizeof(length));
+        ptr += sizeof(length);
+        std::memcpy(ptr, arg, length);
+        return ptr + length;
+    } else {
+        ArgType type;
+        uint64_t bits = 0;
+        if constexpr (std::is_floating_point_v<Type>) {
+            type = ArgType::Double;
+            double value = static_cast<double>(arg);
+            std::memcpy(&bits, &value, sizeof(bits));
+        } else if constexpr (std::is_pointer_v<Type>) {
+            type = ArgType::Pointer;
+            bits = reinterpret_cast<uintptr_t>(arg);
+        } else if constexpr (std::is_enum_v<Type>) {
+            type = ArgType::Int;
+            bits = static_cast<uint64_t>(static_cast<int64_t>(arg));
+        } else if constexpr (std::is_signed_v<Type>) {
+            type = ArgType::Int;
+            bits = static_cast<uint64_t>(static_cast<int64_t>(arg));
+        } else {
+            static_assert(std::is_integral_v<Type>, "unsupported log argument type");
+            type = ArgType::UInt;
+            bits = static_cast<uint64_t>(arg);
+        }
+        *ptr++ = static_cast<uint8_t>(type);
+        std::memcpy(ptr, &bits, sizeof(bits));
+        return ptr + sizeof(bits);
+    }
+}
+
+template<class... Args>
+void Logger::Log(const char* lvl, const char* tag, const char* file, int line, const char* fmt, const Args&... args) {
+
+    uint32_t size = static_cast<uint32_t>(sizeof(RecordHeader));
+    ((size += ArgSize(args)), ...);
+    size = (size + 7u) & ~7u;
+
+    LogRing* ring = GetThreadRing();
+    uint8_t* ptr = ring ? ring->Reserve(size) : nullptr;
+    if (!ptr) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    RecordHeader header{};
+    header.size      = size;
+    header.argsCount = static_cast<uint32_t>(sizeof...(Args));
+    header.lvl       = lvl;
+    header.tag       = tag;
+    header.file      = file;
+    header.fmt       = fmt;
+    header.line      = line;
+    std::memcpy(ptr, &header, sizeof(header));
+
+    uint8_t* argsPtr = ptr + sizeof(header);
+    ((argsPtr = EncodeArg(argsPtr, args)), ...);
+    (void)argsPtr;
+
+    ring->Commit(size);
+    written.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace logs
@@ -3,12 +3,11 @@
 #include <app_consts.h>
 #include <stdio.h>
 #include <log_color.h>
-
-#define LOGS_DEFAULT_TAG "JNK"
-#define LOGS_LAYER_TAG "validation layer"
+#include <log_filter.h>
+#include <logger.h>
 
 template<class LvlType, class TagType, class... Args>
-void _app_log_message(LvlType lvl, TagType tag, Args... args) { throw "unexpected realization"; }
+void _app_log_message(LvlType lvl, TagType tag, const char* file, int line, Args... args) { throw "unexpected realization"; }
 
 #if defined(WIN32) || defined(LINUX) || defined(MAC_OS)
 #define LOGS_LVL_ERROR   COLOR_RED    "Error"
@@ -17,16 +16,22 @@ void _app_log_message(LvlType lvl, TagType tag, Args... args) { throw "unexpecte
 #define LOGS_LVL_INFO    COLOR_GREEN  "Info"
 #endif
 
-#define PRINT_TAG_E(tag, ...) _app_log_message(LOGS_LVL_ERROR,   tag, __VA_ARGS__)
-#if DEBUG_LOGS
-#define PRINT_TAG_W(tag, ...) _app_log_message(LOGS_LVL_WARNING, tag, __VA_ARGS__)
-#define PRINT_TAG_V(tag, ...) _app_log_message(LOGS_LVL_VERBOSE, tag, __VA_ARGS__)
-#define PRINT_TAG_I(tag, ...) _app_log_message(LOGS_LVL_INFO,    tag, __VA_ARGS__)
-#else
-#define PRINT_TAG_W(tag, ...)
-#define PRINT_TAG_V(tag, ...)
-#define PRINT_TAG_I(tag, ...)
-#endif
+// Messages above the compiled level of the tag produce no code. Others check the runtime level
+// of the tag with a single relaxed load before the arguments are touched
+#define _APP_LOG_FILTERED(level, lvlName, tag, ...)                                  \
+    do {                                                                             \
+        if constexpr (level <= logs::CompiledLevel(tag)) {                           \
+            constexpr size_t _logsTagIndex = logs::TagIndex(tag);                    \
+            if (logs::IsEnabled(_logsTagIndex, level)) {                             \
+                _app_log_message(lvlName, tag, __FILE__, __LINE__, __VA_ARGS__);     \
+            }                                                                        \
+        }                                                                            \
+    } while(0)
+
+#define PRINT_TAG_E(tag, ...) _APP_LOG_FILTERED(LOGS_LEVEL_ERROR,   LOGS_LVL_ERROR,   tag, __VA_ARGS__)
+#define PRINT_TAG_W(tag, ...) _APP_LOG_FILTERED(LOGS_LEVEL_WARNING, LOGS_LVL_WARNING, tag, __VA_ARGS__)
+#define PRINT_TAG_V(tag, ...) _APP_LOG_FILTERED(LOGS_LEVEL_VERBOSE, LOGS_LVL_VERBOSE, tag, __VA_ARGS__)
+#define PRINT_TAG_I(tag, ...) _APP_LOG_FILTERED(LOGS_LEVEL_INFO,    LOGS_LVL_INFO,    tag, __VA_ARGS__)
 
 #define PRINT_E(...) PRINT_TAG_E(LOGS_DEFAULT_TAG, __VA_ARGS__)
 #define PRINT_W(...) PRINT_TAG_W(LOGS_DEFAULT_TAG, __VA_ARGS__)
@@ -38,11 +43,24 @@ void _app_log_message(LvlType lvl, TagType tag, Args... args) { throw "unexpecte
 
 
 #if defined(WIN32) || defined(LINUX) || defined(MAC_OS)
+// Format and print a message right on the calling thread
 template<class... Args>
-void _app_log_message(const char* lvl, const char* tag, Args... args) {
-    printf("%s  (%s:%d)\t%s\t: ", tag, __FILE__, __LINE__, lvl);
-    printf(args...);
-    printf("\n" COLOR_RESET); 
+void _app_log_print(const char* lvl, const char* tag, const char* file, int line, const char* fmt, Args... args) {
+    printf("%s  (%s:%d)\t%s\t: ", tag, file, line, lvl);
+    printf(fmt, args...);
+    printf("\n" COLOR_RESET);
+}
+
+template<class... Args>
+void _app_log_message(const char* lvl, const char* tag, const char* file, int line, const char* fmt, Args... args) {
+#if LOGS_ASYNC
+    // Formatting and printing are done by the logger thread
+    if (!logs::Logger::IsDestroyed()) {
+        logs::Logger::Inst().Log(lvl, tag, file, line, fmt, args...);
+        return;
+    }
+#endif
+    _app_log_print(lvl, tag, file, line, fmt, args...);
 }
 #else
 #error "logs are not supported on this platform"
@@ -1,16 +1,38 @@
-#define GLM_FORCE_RADIANS
-#define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/vec4.hpp>
 #include <glm/mat4x4.hpp>
 
 #include <app.h>
+#include <app_options.h>
+#include <log_benchmark.h>
 #include <logs.h>
+#include <scene/cull_benchmark.h>
+#include <scene/mesh_benchmark.h>
+#include <scene/scene_benchmark.h>
 
 #include <vector>
 
-int main() {
+int main(int argc, char** argv) {
 
-    auto result = App::Inst().Run();
+    AppOptions options;
+    auto result = ParseAppOptions(argc, argv, options);
+    if (!APP_CHECK_RESULT(result)) {
+        return result;
+    }
+
+    if (options.sceneBenchNodes) {
+        return RunSceneBenchmark(options.sceneBenchNodes);
+    }
+    if (options.cullBenchObjects) {
+        return RunCullBenchmark(options.cullBenchObjects);
+    }
+    if (!options.meshBenchPath.empty()) {
+        return RunMeshBenchmark(options.meshBenchPath.c_str());
+    }
+    if (options.logBenchMessages) {
+        return RunLogBenchmark(options.logBenchMessages);
+    }
+
+    result = App::Inst().Run(options);
 
     if (!APP_CHECK_RESULT(result)) {
         PRINT_E("Failed to run app. Code: %d", result);
@@ -0,0 +1,87 @@
+// Virtual texture lookups of VirtualTexture. Needs GL_EXT_nonuniform_qualifier
+// and the bindless set of BindlessTable
+
+#ifndef VIRTUAL_TEXTURE_GLSL
+#define VIRTUAL_TEXTURE_GLSL
+
+// Must match VirtualTexture page table entries
+const uint VT_ENTRY_VALID       = 1u << 31;
+const uint VT_ENTRY_LEVEL_SHIFT = 24u;
+const uint VT_ENTRY_LEVEL_MASK  = 0xFu;
+const uint VT_ENTRY_SLOT_MASK   = 0xFFFFFFu;
+
+layout(set = 0, binding = 0) uniform texture2D vtTextures[];
+layout(set = 0, binding = 2) uniform sampler vtSamplers[];
+
+// Page table of a frame: header and an entry per page of every level
+layout(set = 0, binding = 1, std430) readonly buffer VtPageTable {
+    uint levelsCount;
+    uint tileSize;
+    uint width;
+    uint height;
+    uint atlasSlotsX;
+    uint sparse;
+    uint padding0;
+    uint padding1;
+    // firstPage, pagesX, pagesY of every level
+    uvec4 levels[16];
+    uint entries[];
+} vtPageTables[];
+
+// A uint per page, non-zero if the frame needs the page
+layout(set = 0, binding = 1, std430) writeonly buffer VtFeedback {
+    uint requested[];
+} vtFeedbacks[];
+
+uvec2 VtLevelSize(uint table, uint level) {
+    return max(uvec2(vtPageTables[table].width, vtPageTables[table].height) >> level, uvec2(1));
+}
+
+// Level to sample for the texture coordinate derivatives of a pixel
+float VtComputeLod(uint table, vec2 dx, vec2 dy) {
+    vec2 size = vec2(VtLevelSize(table, 0u));
+    float texels = max(length(dx * size), length(dy * size));
+    return clamp(log2(max(texels, 1e-8)), 0.0, float(vtPageTables[table].levelsCount - 1));
+}
+
+uint VtPageIndex(uint table, uint level, vec2 uv) {
+    uvec4 info = vtPageTables[table].levels[level];
+    vec2 texel = clamp(uv, 0.0, 1.0) * vec2(VtLevelSize(table, level));
+    uvec2 page = min(uvec2(texel) / vtPageTables[table].tileSize, info.yz - 1u);
+    return info.x + page.y * info.y + page.x;
+}
+
+// Report the page of the finer level needed for the LOD to the feedback. The LOD must be in the level range
+void VtRequest(uint feedback, uint table, vec2 uv, float lod) {
+    vtFeedbacks[feedback].requested[VtPageIndex(table, uint(lod), uv)] = 1u;
+}
+
+// Sample with the finest resident data: the LOD is clamped on sparse images,
+// the texel of the resident page is fetched from its atlas slot otherwise
+vec4 VtSample(uint table, uint textureIndex, uint samplerIndex, vec2 uv, float lod) {
+    uint requestedLevel = min(uint(max(lod, 0.0)), vtPageTables[table].levelsCount - 1u);
+    uint entry = vtPageTables[table].entries[VtPageIndex(table, requestedLevel, uv)];
+    if ((entry & VT_ENTRY_VALID) == 0u) {
+        return vec4(0.0);
+    }
+    uint level = (entry >> VT_ENTRY_LEVEL_SHIFT) & VT_ENTRY_LEVEL_MASK;
+    if (vtPageTables[table].sparse != 0u) {
+        return textureLod(sampler2D(vtTextures[textureIndex], vtSamplers[samplerIndex]), uv, max(lod, float(level)));
+    }
+
+    // Atlas slots have no mips and no borders: keep the bilinear footprint inside the page
+    uint tileSize = vtPageTables[table].tileSize;
+    uvec2 levelSize = VtLevelSize(table, level);
+    vec2 texel = clamp(uv, 0.0, 1.0) * vec2(levelSize);
+    uvec2 page = min(uvec2(texel) / tileSize, vtPageTables[table].levels[level].yz - 1u);
+    vec2 pageSize = vec2(min(uvec2(tileSize), levelSize - page * tileSize));
+    vec2 local = clamp(texel - vec2(page * tileSize), vec2(0.5), pageSize - 0.5);
+
+    uint slot = entry & VT_ENTRY_SLOT_MASK;
+    uint slotsX = vtPageTables[table].atlasSlotsX;
+    vec2 atlasTexel = vec2(uvec2(slot % slotsX, slot / slotsX) * tileSize) + local;
+    vec2 atlasSize = vec2(textureSize(sampler2D(vtTextures[textureIndex], vtSamplers[samplerIndex]), 0));
+    return textureLod(sampler2D(vtTextures[textureIndex], vtSamplers[samplerIndex]), atlasTexel / atlasSize, 0.0);
+}
+
+#endif // VIRTUAL_TEXTURE_GLSL
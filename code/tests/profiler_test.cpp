@@ -0,0 +1,365 @@
+#include <tests.h>
+
+#include <logs.h>
+#include <test_check.h>
+#include <utils/profiler.h>
+#include <utils/temp_path.h>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t testThreads = 4;
+constexpr uint32_t testFrames  = 16;
+// Scopes with durations of 1 to knownCount ms
+constexpr uint32_t knownCount = 100;
+// Known scopes start far from the profiler creation to check the timestamps precision in the trace
+constexpr uint64_t knownOffset = 100ull * 1000 * 1000 * 1000;
+
+// Escaped to check the JSON strings
+const char* const outerName = "test \"outer\"";
+const char* const innerName = "test\\inner";
+const char* const knownName = "test known";
+
+// Names of the checks
+const char* const statsTest = "statistics";
+const char* const traceTest = "trace";
+
+// Parsed JSON value. Only what the trace events need
+struct JsonValue {
+    enum class Type { Null, Bool, Number, String, Array, Object } type = Type::Null;
+    double number = 0.0;
+    std::string string;
+    std::vector<JsonValue> array;
+    std::map<std::string, JsonValue> object;
+
+    const JsonValue* Find(const char* key) const {
+        auto it = object.find(key);
+        return it != object.end() ? &it->second : nullptr;
+    }
+};
+
+// Strict recursive descent parser of RFC 8259 JSON. Escapes are unescaped, \u ones are not decoded
+class JsonParser {
+
+public:
+
+    explicit JsonParser(const std::string& text) : ptr(text.c_str()), end(text.c_str() + text.size()) {}
+
+    // Whole text must be a single value
+    bool Parse(JsonValue& value) {
+        if (!ParseValue(value, 0)) {
+            return false;
+        }
+        SkipSpaces();
+        return ptr == end;
+    }
+
+private:
+
+    static constexpr int maxDepth = 64;
+
+    void SkipSpaces() {
+        while (ptr != end && (*ptr == ' ' || *ptr == '\t' || *ptr == '\n' || *ptr == '\r')) {
+            ++ptr;
+        }
+    }
+
+    bool Consume(const char* literal) {
+        const char* p = ptr;
+        for (; *literal; ++literal, ++p) {
+            if (p == end || *p != *literal) {
+                return false;
+            }
+        }
+        ptr = p;
+        return true;
+    }
+
+    bool ParseString(std::string& str) {
+        if (!Consume("\"")) {
+            return false;
+        }
+        while (ptr != end && *ptr != '"') {
+            if (static_cast<unsigned char>(*ptr) < 0x20) {
+                return false;
+            }
+            if (*ptr == '\\') {
+                if (++ptr == end || !std::strchr("\"\\/bfnrtu", *ptr)) {
+                    return false;
+                }
+            }
+            str += *ptr++;
+        }
+        return Consume("\"");
+    }
+
+    bool ParseNumber(double& number) {
+        // strtod accepts more than JSON does: hex, inf, leading '+' and '.'
+        const char* start = ptr;
+        if (ptr != end && *ptr == '-') {
+            ++ptr;
+        }
+        if (ptr == end || !std::isdigit(static_cast<unsigned char>(*ptr))) {
+            return false;
+        }
+        while (ptr != end && (std::isdigit(static_cast<unsigned char>(*ptr)) || std::strchr(".eE+-", *ptr))) {
+            ++ptr;
+        }
+        std::string token(start, ptr);
+        char* tokenEnd = nullptr;
+        number = std::strtod(token.c_str(), &tokenEnd);
+        return *tokenEnd == '\0';
+    }
+
+    bool ParseValue(JsonValue& value, int depth) {
+        SkipSpaces();
+        if (ptr == end || depth > maxDepth) {
+            return false;
+        }
+        if (*ptr == '{') {
+            ++ptr;
+            value.type = JsonValue::Type::Object;
+            SkipSpaces();
+            if (Consume("}")) {
+                return true;
+            }
+            do {
+                SkipSpaces();
+                std::string key;
+                if (!ParseString(key)) {
+                    return false;
+                }
+                SkipSpaces();
+                if (!Consume(":") || !ParseValue(value.object[key], depth + 1)) {
+                    return false;
+                }
+                SkipSpaces();
+            } while (Consume(","));
+            return Consume("}");
+        }
+        if (*ptr == '[') {
+            ++ptr;
+            value.type = JsonValue::Type::Array;
+            SkipSpaces();
+            if (Consume("]")) {
+                return true;
+            }
+            do {
+                value.array.emplace_back();
+                if (!ParseValue(value.array.back(), depth + 1)) {
+                    return false;
+                }
+                SkipSpaces();
+            } while (Consume(","));
+            return Consume("]");
+        }
+        if (*ptr == '"') {
+            value.type = JsonValue::Type::String;
+            return ParseString(value.string);
+        }
+        if (Consume("true") || Consume("false")) {
+            value.type = JsonValue::Type::Bool;
+            return true;
+        }
+        if (Consume("null")) {
+            return true;
+        }
+        value.type = JsonValue::Type::Number;
+        return ParseNumber(value.number);
+    }
+
+private:
+
+    const char* ptr;
+    const char* end;
+};
+
+// Busy wait, sleeps are too coarse on some systems
+void Spin(std::chrono::microseconds duration) {
+    auto until = std::chrono::steady_clock::now() + duration;
+    while (std::chrono::steady_clock::now() < until) {
+    }
+}
+
+// Both scopes of a thread for a frame, the outer one lasts longer
+void RecordNestedScopes() {
+    PROFILE_SCOPE(outerName);
+    Spin(std::chrono::microseconds(50));
+    {
+        PROFILE_SCOPE(innerName);
+        Spin(std::chrono::microseconds(100));
+    }
+    Spin(std::chrono::microseconds(50));
+}
+
+bool IsNear(double value, double expected) {
+    return std::abs(value - expected) <= 1e-3 * std::max(1.0, std::abs(expected));
+}
+
+// Trace event fields used by the checks
+struct TraceEvent {
+    std::string name;
+    double ts;
+    double dur;
+    double tid;
+    double frame;
+};
+
+bool ReadTrace(const std::string& path, std::vector<TraceEvent>& events) {
+
+    std::ifstream file(path, std::ios::binary);
+    std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    JsonValue root;
+    if (!Check(file.good() || file.eof(), traceTest, "trace can't be read") ||
+        !Check(JsonParser(text).Parse(root), traceTest, "trace is not valid JSON")) {
+        return false;
+    }
+
+    const JsonValue* traceEvents = root.Find("traceEvents");
+    if (!Check(traceEvents && traceEvents->type == JsonValue::Type::Array, traceTest,
+               "trace has no traceEvents array")) {
+        return false;
+    }
+    for (const auto& value : traceEvents->array) {
+        const JsonValue* name = value.Find("name");
+        const JsonValue* ph   = value.Find("ph");
+        if (!Check(name && name->type == JsonValue::Type::String && ph && ph->type == JsonValue::Type::String,
+                   traceTest, "trace event has no name or phase")) {
+            return false;
+        }
+        if (ph->string == "M") {
+            continue;
+        }
+        const JsonValue* ts    = value.Find("ts");
+        const JsonValue* dur   = value.Find("dur");
+        const JsonValue* tid   = value.Find("tid");
+        const JsonValue* args  = value.Find("args");
+        const JsonValue* frame = args ? args->Find("frame") : nullptr;
+        auto isNumber = [](const JsonValue* v) { return v && v->type == JsonValue::Type::Number; };
+        if (!Check(ph->string == "X" && isNumber(ts) && isNumber(dur) && isNumber(tid) && isNumber(frame),
+                   traceTest, "trace event is not a complete event with a frame")) {
+            return false;
+        }
+        events.push_back({ name->string, ts->number, dur->number, tid->number, frame->number });
+    }
+    return true;
+}
+
+} // namespace
+
+AppResult RunProfilerTest() {
+
+    auto& profiler = Profiler::Inst();
+    profiler.StartCapture(1u << 16);
+    bool ok = true;
+
+    // Nested scopes on several threads, every frame
+    for (uint32_t frame = 0; frame < testFrames; ++frame) {
+        std::vector<std::thread> threads;
+        for (uint32_t i = 0; i < testThreads; ++i) {
+            threads.emplace_back(RecordNestedScopes);
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        profiler.EndFrame();
+    }
+
+    // Known durations spread over frames and added in a mixed order
+    uint64_t knownStart = Profiler::Now() + knownOffset;
+    for (uint32_t i = 0; i < knownCount; ++i) {
+        uint64_t durationMs = (i * 37) % knownCount + 1;
+        profiler.AddEvent(knownName, knownStart + i * 1000, knownStart + i * 1000 + durationMs * 1000000,
+                          Profiler::EventKind::Cpu);
+        if (i % 10 == 9) {
+            profiler.EndFrame();
+        }
+    }
+
+    std::string tracePath = MakeTempPath("profiler_test.json");
+    if (!APP_CHECK_RESULT(profiler.SaveChromeTrace(tracePath.c_str()))) {
+        return APP_CODE_IO_FAILURE;
+    }
+
+    // Percentile of 1..100 ms is the sample at index fraction * 100
+    auto known = profiler.GetScopeStats(knownName);
+    ok &= Check(known.count == knownCount, statsTest, "wrong count of the known scope");
+    ok &= Check(IsNear(known.p50, 51.0) && IsNear(known.p95, 96.0) && IsNear(known.p99, 100.0), statsTest,
+                "wrong percentiles of the known scope");
+
+    auto outer = profiler.GetScopeStats(outerName);
+    auto inner = profiler.GetScopeStats(innerName);
+    ok &= Check(outer.count == testThreads * testFrames && inner.count == testThreads * testFrames, statsTest,
+                "wrong count of the nested scopes");
+    // Every inner scope is shorter than its outer one, so are the order statistics
+    ok &= Check(inner.p50 > 0.0 && inner.p50 <= outer.p50 && inner.p95 <= outer.p95 && inner.p99 <= outer.p99,
+                statsTest, "inner scope percentiles exceed the outer ones");
+    ok &= Check(!profiler.GetDroppedCount(), statsTest, "events were dropped");
+
+    std::vector<TraceEvent> events;
+    bool traceRead = ReadTrace(tracePath, events);
+    std::remove(tracePath.c_str());
+    if (!traceRead) {
+        return APP_CODE_UNKNOWN;
+    }
+
+    std::vector<const TraceEvent*> outers, inners;
+    std::vector<double> knownStarts, knownDurations;
+    for (const auto& event : events) {
+        if (event.name == outerName) {
+            outers.push_back(&event);
+        } else if (event.name == innerName) {
+            inners.push_back(&event);
+        } else if (event.name == knownName) {
+            knownStarts.push_back(event.ts);
+            knownDurations.push_back(event.dur);
+        }
+    }
+    if (!Check(outers.size() == testThreads * testFrames && inners.size() == outers.size() &&
+               knownStarts.size() == knownCount, traceTest, "wrong count of the trace events")) {
+        return APP_CODE_UNKNOWN;
+    }
+
+    // Every inner event lies within an outer event of the same thread and frame
+    std::set<double> threadIds;
+    for (const auto* in : inners) {
+        bool nested = false;
+        for (const auto* out : outers) {
+            nested |= out->tid == in->tid && out->frame == in->frame &&
+                      out->ts <= in->ts && in->ts + in->dur <= out->ts + out->dur;
+        }
+        ok &= Check(nested, traceTest, "inner trace event is not nested in an outer one");
+        threadIds.insert(in->tid);
+    }
+    ok &= Check(threadIds.size() > 1, traceTest, "nested scopes of the threads share a trace track");
+
+    // Microseconds, the known scopes start 1 us apart long after the profiler creation
+    std::sort(knownStarts.begin(), knownStarts.end());
+    std::sort(knownDurations.begin(), knownDurations.end());
+    bool knownValid = true;
+    for (uint32_t i = 0; i < knownCount; ++i) {
+        knownValid &= IsNear(knownDurations[i], (i + 1) * 1000.0);
+        knownValid &= !i || IsNear(knownStarts[i] - knownStarts[i - 1], 1.0);
+    }
+    ok &= Check(knownValid, traceTest, "wrong timestamps or durations in the trace");
+
+    if (!ok) {
+        return APP_CODE_UNKNOWN;
+    }
+    PRINT("Profiler test passed: %zu trace events on %zu threads", events.size(), threadIds.size());
+    return APP_CODE_OK;
+}
@@ -0,0 +1,226 @@
+#include <tests.h>
+
+#include <logs.h>
+#include <test_check.h>
+#include <vulkan_app/render_graph.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+typedef RenderGraph::Access Access;
+
+constexpr VkDeviceSize granularity = 64 * 1024;
+// Requirements reported for the test resources. Image size is not a multiple of the granularity
+constexpr VkDeviceSize imageSize      = 1024 * 1024 + 4096;
+constexpr VkDeviceSize imageAlignment = 4096;
+constexpr VkDeviceSize bufferAlignment = 256;
+
+VkMemoryRequirements GetTestRequirements(const RenderGraph::TransientDesc& desc) {
+    VkMemoryRequirements requirements{};
+    requirements.size           = desc.image ? imageSize : (desc.bufferDesc.size + bufferAlignment - 1) /
+                                                           bufferAlignment * bufferAlignment;
+    requirements.alignment      = desc.image ? imageAlignment : bufferAlignment;
+    requirements.memoryTypeBits = ~0u;
+    return requirements;
+}
+
+RenderGraph::ImageDesc ColorDesc() {
+    RenderGraph::ImageDesc desc;
+    desc.format = VK_FORMAT_R8G8B8A8_UNORM;
+    desc.width  = 512;
+    desc.height = 512;
+    return desc;
+}
+
+RenderGraph::ImageDesc DepthDesc() {
+    RenderGraph::ImageDesc desc = ColorDesc();
+    desc.format = VK_FORMAT_D32_SFLOAT;
+    desc.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+    return desc;
+}
+
+RenderGraph::ExternalState TransferDstFinal() {
+    RenderGraph::ExternalState state;
+    state.layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    state.stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    state.access = VK_ACCESS_TRANSFER_WRITE_BIT;
+    return state;
+}
+
+bool TestCulling() {
+    const char* test = "culling";
+    RenderGraph graph;
+
+    auto depth   = graph.CreateImage("Depth", DepthDesc());
+    auto color   = graph.CreateImage("Color", ColorDesc());
+    auto unused  = graph.CreateBuffer("Unused", { 4096 });
+    auto chainA  = graph.CreateImage("ChainA", ColorDesc());
+    auto chainB  = graph.CreateImage("ChainB", ColorDesc());
+    auto output  = graph.ImportImage("Output", VK_NULL_HANDLE, ColorDesc(), {}, TransferDstFinal());
+
+    auto depthPass = graph.AddPass("Depth", nullptr);
+    graph.Write(depthPass, depth, Access::DepthAttachmentWrite);
+    auto unusedPass = graph.AddPass("Unused", nullptr);
+    graph.Write(unusedPass, unused, Access::StorageWrite);
+    auto lightingPass = graph.AddPass("Lighting", nullptr);
+    graph.Read(lightingPass, depth, Access::SampledRead);
+    graph.Write(lightingPass, color, Access::ColorAttachmentWrite);
+    // Dead chain: the second pass is culled, so is the first one it reads from
+    auto chainPassA = graph.AddPass("ChainA", nullptr);
+    graph.Write(chainPassA, chainA, Access::ColorAttachmentWrite);
+    auto chainPassB = graph.AddPass("ChainB", nullptr);
+    graph.Read(chainPassB, chainA, Access::SampledRead);
+    graph.Write(chainPassB, chainB, Access::ColorAttachmentWrite);
+    auto sideEffectsPass = graph.AddPass("SideEffects", nullptr);
+    graph.SetSideEffects(sideEffectsPass);
+    auto copyPass = graph.AddPass("Copy", nullptr);
+    graph.Read(copyPass, color, Access::TransferRead);
+    graph.Write(copyPass, output, Access::TransferWrite);
+
+    if (!Check(APP_CHECK_RESULT(graph.Compile()), test, "compile failed")) {
+        return false;
+    }
+    std::vector<RenderGraph::PassId> expected = { depthPass, lightingPass, sideEffectsPass, copyPass };
+    return Check(graph.GetSchedule() == expected, test, "wrong schedule") &&
+           Check(graph.IsPassCulled(unusedPass) && graph.IsPassCulled(chainPassA) && graph.IsPassCulled(chainPassB),
+                 test, "unread passes are not culled") &&
+           Check(graph.GetStats().culledPasses == 3, test, "wrong culled passes count") &&
+           Check(graph.GetPlacement(unused).heap == RenderGraph::invalidId &&
+                 graph.GetPlacement(chainB).heap == RenderGraph::invalidId, test,
+                 "resources of the culled passes have memory");
+}
+
+bool TestBarrierMerging() {
+    const char* test = "barrier merging";
+    RenderGraph graph;
+
+    // Three producers, one consumer of all of them
+    RenderGraph::ResourceId buffers[3];
+    RenderGraph::ResourceId images[2];
+    for (auto& buffer : buffers) {
+        buffer = graph.CreateBuffer("Buffer", { 4096 });
+        auto pass = graph.AddPass("Produce buffer", nullptr);
+        graph.Write(pass, buffer, Access::StorageWrite);
+    }
+    for (auto& image : images) {
+        image = graph.CreateImage("Image", ColorDesc());
+        auto pass = graph.AddPass("Produce image", nullptr);
+        graph.Write(pass, image, Access::ColorAttachmentWrite);
+    }
+    auto output = graph.ImportImage("Output", VK_NULL_HANDLE, ColorDesc(), {}, {});
+    auto consumer = graph.AddPass("Consume", nullptr);
+    for (auto buffer : buffers) {
+        graph.Read(consumer, buffer, Access::StorageRead);
+    }
+    for (auto image : images) {
+        graph.Read(consumer, image, Access::SampledRead);
+    }
+    graph.Write(consumer, output, Access::StorageWrite);
+
+    if (!Check(APP_CHECK_RESULT(graph.Compile()), test, "compile failed") ||
+        !Check(graph.GetSchedule().size() == 6, test, "producers are culled")) {
+        return false;
+    }
+
+    // Output transition joins the hazards of the inputs
+    const auto& batch = graph.GetBarriers(5);
+    uint32_t dependencies = 0;
+    for (uint32_t position = 0; position < graph.GetSchedule().size(); ++position) {
+        dependencies += graph.GetBarriers(position).dependencies;
+    }
+    return Check(batch.dependencies == 6, test, "consumer hazards are not in one batch") &&
+           Check(batch.transitions.size() == 3, test, "wrong count of layout transitions") &&
+           Check((batch.srcAccess & VK_ACCESS_SHADER_WRITE_BIT) && (batch.dstAccess & VK_ACCESS_SHADER_READ_BIT) &&
+                 (batch.srcStages & VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT) &&
+                 (batch.dstStages & VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT), test, "wrong buffer barrier masks") &&
+           Check(graph.GetStats().dependencies == dependencies, test, "wrong dependencies count") &&
+           Check(graph.GetStats().barrierCalls < graph.GetStats().dependencies, test, "barriers are not merged");
+}
+
+bool TestAliasing() {
+    const char* test = "aliasing";
+    RenderGraph graph;
+    graph.SetRequirementsQuery(GetTestRequirements);
+    graph.SetBufferImageGranularity(granularity);
+
+    // A [0, 1], B [1, 2], C [2, 3] and a linear buffer E [0, 1] next to the optimal images
+    auto a = graph.CreateImage("A", ColorDesc());
+    auto b = graph.CreateImage("B", ColorDesc());
+    auto c = graph.CreateImage("C", ColorDesc());
+    auto e = graph.CreateBuffer("E", { 1000 });
+    auto output = graph.ImportImage("Output", VK_NULL_HANDLE, ColorDesc(), {}, TransferDstFinal());
+
+    auto passA = graph.AddPass("A", nullptr);
+    graph.Write(passA, a, Access::ColorAttachmentWrite);
+    graph.Write(passA, e, Access::TransferWrite);
+    auto passB = graph.AddPass("B", nullptr);
+    graph.Read(passB, a, Access::SampledRead);
+    graph.Read(passB, e, Access::UniformRead);
+    graph.Write(passB, b, Access::ColorAttachmentWrite);
+    auto passC = graph.AddPass("C", nullptr);
+    graph.Read(passC, b, Access::SampledRead);
+    graph.Write(passC, c, Access::ColorAttachmentWrite);
+    auto passOut = graph.AddPass("Out", nullptr);
+    graph.Read(passOut, c, Access::TransferRead);
+    graph.Write(passOut, output, Access::TransferWrite);
+
+    if (!Check(APP_CHECK_RESULT(graph.Compile()), test, "compile failed")) {
+        return false;
+    }
+
+    bool ok = true;
+    RenderGraph::ResourceId transients[] = { a, b, c, e };
+    for (auto left : transients) {
+        const auto& l = graph.GetPlacement(left);
+        ok &= Check(l.heap == 0 && l.offset % granularity == 0, test, "placement is not granularity aligned");
+        for (auto right : transients) {
+            const auto& r = graph.GetPlacement(right);
+            bool lifetimesOverlap = l.firstPass <= r.lastPass && r.firstPass <= l.lastPass;
+            // Pages of the resources alive together must be different
+            bool pagesOverlap = l.offset / granularity <= (r.offset + r.size - 1) / granularity &&
+                                r.offset / granularity <= (l.offset + l.size - 1) / granularity;
+            ok &= Check(left == right || !lifetimesOverlap || !pagesOverlap, test,
+                        "resources alive together share a granularity page");
+        }
+    }
+
+    // C lives after A, so it takes its memory. E goes after B on a separate page
+    const auto& stats = graph.GetStats();
+    VkDeviceSize aliasedSize = 2 * ((imageSize + granularity - 1) / granularity * granularity) +
+                               (1000 + bufferAlignment - 1) / bufferAlignment * bufferAlignment;
+    return ok && Check(graph.GetPlacement(c).offset == graph.GetPlacement(a).offset, test,
+                       "disjoint lifetimes are not aliased") &&
+           Check(stats.transients == 4 && stats.heapBytes == aliasedSize && stats.heapBytes < stats.transientBytes,
+                 test, "wrong heap size");
+}
+
+bool TestLayoutConflict() {
+    const char* test = "layout conflict";
+    RenderGraph graph;
+
+    auto image = graph.CreateImage("Image", ColorDesc());
+    auto pass = graph.AddPass("Feedback", nullptr);
+    graph.SetSideEffects(pass);
+    graph.Read(pass, image, Access::SampledRead);
+    graph.Write(pass, image, Access::ColorAttachmentWrite);
+    return Check(graph.Compile() == APP_CODE_INVALID_ARGS, test, "conflicting layouts are accepted");
+}
+
+} // namespace
+
+AppResult RunRenderGraphTest() {
+
+    bool ok = true;
+    ok &= TestCulling();
+    ok &= TestBarrierMerging();
+    ok &= TestAliasing();
+    ok &= TestLayoutConflict();
+
+    if (!ok) {
+        return APP_CODE_UNKNOWN;
+    }
+    PRINT("Render graph test passed");
+    return APP_CODE_OK;
+}
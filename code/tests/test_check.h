@@ -0,0 +1,22 @@
+#pragma once
+
+#include <logs.h>
+
+/**
+ * @brief
+ * Print the failed check of a test
+ * @param condition
+ * checked condition
+ * @param test
+ * name of the test
+ * @param what
+ * description of the failure
+ * @return
+ * condition
+*/
+inline bool Check(bool condition, const char* test, const char* what) {
+    if (!condition) {
+        PRINT_E("Test \"%s\" failed: %s", test, what);
+    }
+    return condition;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <app_result.h>
+
+// Device-free checks of the app modules. Each returns APP_CODE_UNKNOWN if a check fails
+
+/**
+ * @brief
+ * Check TlsfAllocator: allocation and freeing, merging of the neighbour free ranges,
+ * alignment, bufferImageGranularity pages and a long random allocation sequence
+ * @return
+ * AppResult code
+*/
+AppResult RunTlsfAllocatorTest();
+
+/**
+ * @brief
+ * Check Profiler: nested PROFILE_SCOPEs recorded on several threads over several frames,
+ * p50/p95/p99 of scopes with known durations and the Chrome trace JSON written for them
+ * @return
+ * AppResult code
+*/
+AppResult RunProfilerTest();
+
+/**
+ * @brief
+ * Compile render graphs and check the result: culling of the passes nobody reads,
+ * hazards of a pass merged into one barrier and transient resources with disjoint lifetimes aliased
+ * in a heap while keeping linear and optimal resources on different bufferImageGranularity pages
+ * @return
+ * AppResult code
+*/
+AppResult RunRenderGraphTest();
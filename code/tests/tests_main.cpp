@@ -0,0 +1,45 @@
+#include <tests.h>
+
+#include <logs.h>
+
+#include <string_view>
+
+namespace {
+
+struct Suite {
+    const char* name;
+    AppResult (*run)();
+};
+
+// Names are passed by add_test of CMakeLists.txt
+constexpr Suite suites[] = {
+    { "tlsf_allocator", RunTlsfAllocatorTest },
+    { "profiler",       RunProfilerTest      },
+    { "render_graph",   RunRenderGraphTest   },
+};
+
+} // namespace
+
+// Run the suite named by the argument, all of them without arguments
+int main(int argc, char** argv) {
+
+    std::string_view filter = argc > 1 ? argv[1] : "";
+    bool found = false;
+    AppResult result = APP_CODE_OK;
+    for (const auto& suite : suites) {
+        if (!filter.empty() && filter != suite.name) {
+            continue;
+        }
+        found = true;
+        AppResult suiteResult = suite.run();
+        if (!APP_CHECK_RESULT(suiteResult)) {
+            PRINT_E("Suite %s failed. Code: %d", suite.name, suiteResult);
+            result = suiteResult;
+        }
+    }
+    if (!found) {
+        PRINT_E("Unknown test suite %s", argv[1]);
+        return APP_CODE_INVALID_ARGS;
+    }
+    return result;
+}
@@ -0,0 +1,227 @@
+#include <tests.h>
+
+#include <logs.h>
+#include <test_check.h>
+#include <vulkan_app/tlsf_allocator.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace {
+
+typedef TlsfAllocator::ResourceKind Kind;
+
+// Allocations don't overlap and neighbour linear and optimal ones are on different pages
+bool IsLayoutValid(const TlsfAllocator& allocator, uint64_t granularity) {
+    bool valid = allocator.Validate();
+    uint64_t prevEnd = 0;
+    Kind prevKind = Kind::Free;
+    allocator.ForEachAllocation([&](TlsfAllocator::Handle, uint64_t offset, uint64_t size, Kind kind) {
+        if (offset < prevEnd || offset + size > allocator.GetSize()) {
+            valid = false;
+        }
+        if (prevKind != Kind::Free && prevKind != kind && (prevEnd - 1) / granularity == offset / granularity) {
+            valid = false;
+        }
+        prevEnd  = offset + size;
+        prevKind = kind;
+    });
+    return valid;
+}
+
+bool TestAllocFree() {
+    const char* test = "alloc/free";
+    TlsfAllocator allocator(1024 * 1024);
+
+    std::vector<TlsfAllocator::Handle> handles;
+    for (uint64_t size : { 1, 100, 4096, 65536, 1000 }) {
+        uint64_t offset = 0;
+        auto handle = allocator.Allocate(size, 1, Kind::Linear, offset);
+        if (!Check(handle != TlsfAllocator::invalidHandle, test, "allocation failed") ||
+            !Check(allocator.GetOffset(handle) == offset && allocator.GetAllocationSize(handle) == size, test,
+                   "wrong allocation range")) {
+            return false;
+        }
+        handles.push_back(handle);
+    }
+    uint64_t offset = 0;
+    bool ok = Check(allocator.GetUsedSize() == 1 + 100 + 4096 + 65536 + 1000, test, "wrong used size") &&
+              Check(allocator.GetAllocationsCount() == handles.size(), test, "wrong allocations count") &&
+              Check(IsLayoutValid(allocator, 1), test, "invalid layout") &&
+              Check(allocator.Allocate(allocator.GetSize(), 1, Kind::Linear, offset) == TlsfAllocator::invalidHandle,
+                    test, "allocated more than free") &&
+              Check(allocator.Allocate(0, 1, Kind::Linear, offset) == TlsfAllocator::invalidHandle, test,
+                    "allocated zero size");
+    for (auto handle : handles) {
+        allocator.Free(handle);
+    }
+    return ok && Check(allocator.IsEmpty() && !allocator.GetUsedSize(), test, "not empty after freeing") &&
+           Check(allocator.GetLargestFreeRange() == allocator.GetSize(), test, "free ranges not merged") &&
+           Check(allocator.Validate(), test, "invalid layout after freeing");
+}
+
+bool TestMerging() {
+    const char* test = "neighbour merging";
+    constexpr uint64_t blockSize = 1024;
+    TlsfAllocator allocator(4 * blockSize);
+
+    // The range is filled up, so the blocks are in address order
+    TlsfAllocator::Handle handles[4];
+    for (uint32_t i = 0; i < 4; ++i) {
+        uint64_t offset = 0;
+        handles[i] = allocator.Allocate(blockSize, 1, Kind::Linear, offset);
+        if (!Check(handles[i] != TlsfAllocator::invalidHandle && offset == i * blockSize, test,
+                   "range is not filled in order")) {
+            return false;
+        }
+    }
+    if (!Check(allocator.GetLargestFreeRange() == 0, test, "full range has free space")) {
+        return false;
+    }
+
+    // Merge with the previous range
+    allocator.Free(handles[1]);
+    allocator.Free(handles[2]);
+    if (!Check(allocator.GetLargestFreeRange() == 2 * blockSize, test, "previous range not merged") ||
+        !Check(allocator.Validate(), test, "invalid layout")) {
+        return false;
+    }
+    uint64_t offset = 0;
+    handles[1] = allocator.Allocate(2 * blockSize, 1, Kind::Linear, offset);
+    if (!Check(handles[1] != TlsfAllocator::invalidHandle && offset == blockSize, test, "merged range not reused")) {
+        return false;
+    }
+
+    // Merge with the next range, then with both
+    allocator.Free(handles[3]);
+    allocator.Free(handles[1]);
+    if (!Check(allocator.GetLargestFreeRange() == 3 * blockSize, test, "next range not merged")) {
+        return false;
+    }
+    allocator.Free(handles[0]);
+    return Check(allocator.GetLargestFreeRange() == allocator.GetSize(), test, "both ranges not merged") &&
+           Check(allocator.Validate(), test, "invalid layout after freeing");
+}
+
+bool TestAlignment() {
+    const char* test = "alignment";
+    TlsfAllocator allocator(4 * 1024 * 1024);
+
+    // Odd sized allocations in between misalign the free ranges
+    for (uint64_t alignment = 1; alignment <= 64 * 1024; alignment *= 2) {
+        uint64_t offset = 0;
+        auto odd = allocator.Allocate(3, 1, Kind::Linear, offset);
+        auto aligned = allocator.Allocate(100, alignment, Kind::Linear, offset);
+        if (!Check(odd != TlsfAllocator::invalidHandle && aligned != TlsfAllocator::invalidHandle, test,
+                   "allocation failed") ||
+            !Check(offset % alignment == 0, test, "offset is not aligned")) {
+            return false;
+        }
+    }
+    return Check(IsLayoutValid(allocator, 1), test, "invalid layout");
+}
+
+bool TestGranularity() {
+    const char* test = "granularity";
+    constexpr uint64_t granularity = 4096;
+    TlsfAllocator allocator(64 * 1024, granularity);
+
+    uint64_t linearOffset = 0, optimalOffset = 0, nextOffset = 0;
+    auto linear  = allocator.Allocate(100, 16, Kind::Linear, linearOffset);
+    auto optimal = allocator.Allocate(100, 16, Kind::Optimal, optimalOffset);
+    auto next    = allocator.Allocate(100, 16, Kind::Linear, nextOffset);
+    if (!Check(linear != TlsfAllocator::invalidHandle && optimal != TlsfAllocator::invalidHandle &&
+               next != TlsfAllocator::invalidHandle, test, "allocation failed")) {
+        return false;
+    }
+    bool ok = Check(IsLayoutValid(allocator, granularity), test, "linear and optimal resources share a page");
+
+    // The pages stay separated when the ranges are reused
+    allocator.Free(optimal);
+    optimal = allocator.Allocate(100, 16, Kind::Optimal, optimalOffset);
+    return ok && Check(optimal != TlsfAllocator::invalidHandle, test, "allocation failed") &&
+           Check(IsLayoutValid(allocator, granularity), test, "reused range shares a page");
+}
+
+bool TestFragmentation() {
+    const char* test = "fragmentation";
+    constexpr uint64_t granularity = 1024;
+    TlsfAllocator allocator(16 * 1024 * 1024, granularity);
+
+    struct Allocation {
+        TlsfAllocator::Handle handle;
+        uint64_t size;
+    };
+    std::vector<Allocation> live;
+    std::mt19937 random(7);
+    std::uniform_int_distribution<uint64_t> sizes(256, 64 * 1024);
+    std::uniform_int_distribution<uint32_t> alignmentLog2(0, 12);
+    uint32_t failed = 0;
+
+    for (uint32_t i = 0; i < 20000; ++i) {
+        // Grow the usage to about a half of the range and keep it there
+        bool allocate = live.empty() || (random() % 100) < (allocator.GetUsedSize() < allocator.GetSize() / 2 ? 70 : 30);
+        if (allocate) {
+            uint64_t size = sizes(random);
+            uint64_t alignment = 1ull << alignmentLog2(random);
+            Kind kind = (random() % 2) ? Kind::Linear : Kind::Optimal;
+            uint64_t offset = 0;
+            auto handle = allocator.Allocate(size, alignment, kind, offset);
+            if (handle == TlsfAllocator::invalidHandle) {
+                ++failed;
+            } else if (!Check(offset % alignment == 0, test, "offset is not aligned")) {
+                return false;
+            } else {
+                live.push_back({ handle, size });
+            }
+        } else {
+            size_t index = random() % live.size();
+            allocator.Free(live[index].handle);
+            live[index] = live.back();
+            live.pop_back();
+        }
+        if (i % 256 == 0 && !Check(IsLayoutValid(allocator, granularity), test, "invalid layout")) {
+            return false;
+        }
+    }
+
+    uint64_t liveSize = 0;
+    for (const auto& allocation : live) {
+        liveSize += allocation.size;
+    }
+    uint64_t freeSize = allocator.GetSize() - allocator.GetUsedSize();
+    if (!Check(allocator.GetUsedSize() == liveSize && allocator.GetAllocationsCount() == live.size(), test,
+               "wrong used size") ||
+        !Check(IsLayoutValid(allocator, granularity), test, "invalid layout")) {
+        return false;
+    }
+    PRINT("TLSF allocator: %zu allocations use %.1f%% of the range, %u failed, largest free range is %.1f%% of free space",
+          live.size(), 100.0 * allocator.GetUsedSize() / allocator.GetSize(), failed,
+          freeSize ? 100.0 * allocator.GetLargestFreeRange() / freeSize : 100.0);
+
+    for (const auto& allocation : live) {
+        allocator.Free(allocation.handle);
+    }
+    return Check(!failed, test, "allocation failed with half of the range free") &&
+           Check(allocator.IsEmpty() && allocator.GetLargestFreeRange() == allocator.GetSize(), test,
+                 "free ranges not merged after freeing all");
+}
+
+} // namespace
+
+AppResult RunTlsfAllocatorTest() {
+
+    bool ok = true;
+    ok &= TestAllocFree();
+    ok &= TestMerging();
+    ok &= TestAlignment();
+    ok &= TestGranularity();
+    ok &= TestFragmentation();
+
+    if (!ok) {
+        return APP_CODE_UNKNOWN;
+    }
+    PRINT("TLSF allocator test passed");
+    return APP_CODE_OK;
+}
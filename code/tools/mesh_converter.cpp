@@ -0,0 +1,58 @@
+#include <app_consts.h>
+#include <app_result.h>
+#include <logs.h>
+#include <scene/mesh_builder.h>
+#include <scene/obj_loader.h>
+
+#include <cstdlib>
+#include <string_view>
+
+namespace {
+
+void PrintUsage() {
+    PRINT("Usage: mesh_converter <input.obj> <output.mesh>");
+    PRINT("       mesh_converter --generate <output.obj> [segments]");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+
+    if (argc >= 3 && std::string_view(argv[1]) == "--generate") {
+        uint32_t segments = APP_MESH_GENERATED_SEGMENTS;
+        if (argc >= 4) {
+            segments = static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10));
+        }
+        MeshData mesh;
+        GenerateTestMesh(segments, mesh);
+        auto result = WriteObj(argv[2], mesh);
+        if (!APP_CHECK_RESULT(result)) {
+            return result;
+        }
+        PRINT("Test mesh %s generated: %zu vertices, %zu triangles", argv[2], mesh.vertices.size(),
+              mesh.indices.size() / 3);
+        return 0;
+    }
+    if (argc != 3) {
+        PrintUsage();
+        return APP_CODE_INVALID_ARGS;
+    }
+
+    MeshData mesh;
+    auto result = LoadObj(argv[1], mesh);
+    if (!APP_CHECK_RESULT(result)) {
+        return result;
+    }
+    MeshBuildStats stats;
+    result = BuildMeshFile(mesh, argv[2], APP_MESH_VERTEX_CACHE_SIZE, stats);
+    if (!APP_CHECK_RESULT(result)) {
+        return result;
+    }
+
+    PRINT("%s converted to %s: %u vertices, %u triangles, %u-bit indices, %.1f KiB",
+          argv[1], argv[2], stats.vertexCount, stats.indexCount / 3, stats.indexSize * 8, stats.fileSize / 1024.0);
+    PRINT("Vertex cache (FIFO %u): ACMR %.3f -> %.3f, ATVR %.3f -> %.3f", APP_MESH_VERTEX_CACHE_SIZE,
+          stats.cacheBefore.acmr, stats.cacheAfter.acmr, stats.cacheBefore.atvr, stats.cacheAfter.atvr);
+    PRINT("Quantization error: position %.6f, normal %.4f degrees", stats.positionError, stats.normalError);
+    return 0;
+}